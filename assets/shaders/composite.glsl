@@ -0,0 +1,99 @@
+#version 460 core
+// Compute version of vertex.glsl + frag.glsl for one axis aligned quad, see computeComposite.h
+// NO_TEXEL_CACHE samples straight from the pools instead of staging texels in shared memory
+#pragma keywords NO_TEXEL_CACHE
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, rgba32f) uniform writeonly image2D target;
+
+// Same bindings as frag.glsl
+uniform layout(binding=0) sampler2DArray pools[16];
+
+struct Material {
+    uint pool;
+    uint layer;
+    float minLod;
+};
+
+layout (binding = 1, std430) readonly buffer materialBuffer {
+    Material materials[];
+};
+
+layout (binding = 0, std140) uniform DrawConstants {
+    vec2 blend;
+};
+
+uniform uint material1;
+uniform uint material2;
+
+// Where the quad is, x0 y0 x1 y1 in NDC, and the uv at those two corners
+uniform vec4 posRect;
+uniform vec4 uvRect;
+uniform vec4 bgColor;
+
+// Texels a workgroup can stage, 40x40 covers the tile at up to about 2.3 texels per pixel
+const int cacheSide = 40;
+shared vec4 cache[cacheSide * cacheSide];
+
+vec2 uvAt(vec2 pixel){
+    vec2 ndc = pixel / vec2(imageSize(target)) * 2.0 - 1.0;
+    return mix(uvRect.xy, uvRect.zw, (ndc - posRect.xy) / (posRect.zw - posRect.xy));
+}
+
+// GL_REPEAT
+ivec2 wrap(ivec2 c, ivec2 size){
+    return ((c % size) + size) % size;
+}
+
+// Every invocation has to get here, the barriers count on it
+vec4 sampleMaterial(uint index, vec2 uv){
+    Material m = materials[index];
+    if(m.minLod < 0) return vec4(0.5, 0.5, 0.5, 1.0);
+    const int lod = int(m.minLod);
+
+#ifndef NO_TEXEL_CACHE
+    // Bilinear footprint of the whole tile, from its corner pixels since uv is linear in the pixel position
+    const ivec2 size = textureSize(pools[m.pool], lod).xy;
+    const vec2 tileMin = vec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) + 0.5;
+    const vec2 tileMax = tileMin + vec2(gl_WorkGroupSize.xy) - 1.0;
+    const vec2 a = uvAt(tileMin) * size - 0.5, b = uvAt(tileMax) * size - 0.5;
+    const ivec2 lo = ivec2(floor(min(a, b)));
+    const ivec2 span = ivec2(floor(max(a, b))) - lo + 2;
+
+    // Too minified to fit, the whole workgroup agrees on that so falling through is fine
+    if(span.x <= cacheSide && span.y <= cacheSide){
+        const uint groupSize = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+        for(uint i = gl_LocalInvocationIndex; i < span.x * span.y; i += groupSize){
+            const ivec2 c = lo + ivec2(i % span.x, i / span.x);
+            cache[i] = texelFetch(pools[m.pool], ivec3(wrap(c, size), m.layer), lod);
+        }
+        memoryBarrierShared();
+        barrier();
+
+        const vec2 t = uv * size - 0.5;
+        const ivec2 i0 = clamp(ivec2(floor(t)) - lo, ivec2(0), span - 2);
+        const vec2 f = fract(t);
+        const int row = i0.y * span.x + i0.x;
+        const vec4 top    = mix(cache[row],          cache[row + 1],          f.x);
+        const vec4 bottom = mix(cache[row + span.x], cache[row + span.x + 1], f.x);
+        // Everyone has to be done reading before the next material overwrites the cache
+        memoryBarrierShared();
+        barrier();
+        return mix(top, bottom, f.y);
+    }
+#endif
+    return textureLod(pools[m.pool], vec3(uv, m.layer), lod);
+}
+
+void main(){
+    const ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    const vec2 center = vec2(pixel) + 0.5;
+    const vec2 uv = uvAt(center);
+
+    vec4 color = sampleMaterial(material1, uv)*blend.x + sampleMaterial(material2, uv)*blend.y;
+
+    // Outside the quad is whatever it was cleared to
+    const vec2 ndc = center / vec2(imageSize(target)) * 2.0 - 1.0;
+    if(any(lessThan(ndc, posRect.xy)) || any(greaterThanEqual(ndc, posRect.zw))) color = bgColor;
+    if(all(lessThan(pixel, imageSize(target)))) imageStore(target, pixel, color);
+}
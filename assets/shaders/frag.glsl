@@ -1,15 +1,49 @@
 #version 460 core
+// SHOW_LOAD_LEVEL tints materials by the mip level they're stuck at while loading
+// SINGLE_MATERIAL draws material1 on its own
+#pragma keywords SHOW_LOAD_LEVEL SINGLE_MATERIAL
 in vec2 uv;
 
-uniform layout(binding=0) sampler2D tex1;
-uniform layout(binding=1) sampler2D tex2;
+// Texture arrays grouped by size and format, see texturePool.h
+uniform layout(binding=0) sampler2DArray pools[16];
 
-uniform float time;
+struct Material {
+    uint pool;
+    uint layer;
+    // Level to sample, the finest one loaded so far. Negative while there's nothing yet
+    float minLod;
+};
+
+layout (binding = 1, std430) readonly buffer materialBuffer {
+    Material materials[];
+};
+
+uniform uint material1;
+uniform uint material2;
+
+// Anything that only depends on uniforms, worked out once per draw on the CPU (see drawConstants.h)
+layout (binding = 0, std140) uniform DrawConstants {
+    vec2 blend;
+};
 
 out vec4 FragColor;
 
-const float pi = 3.1415926535;
+vec4 sampleMaterial(uint index){
+    Material m = materials[index];
+    if(m.minLod < 0) return vec4(0.5, 0.5, 0.5, 1.0);
+    vec4 color = textureLod(pools[m.pool], vec3(uv, m.layer), m.minLod);
+#ifdef SHOW_LOAD_LEVEL
+    // Full res untouched, then green, yellow, red the coarser it is
+    const vec3 tints[4] = vec3[](vec3(1.0), vec3(0.5, 1.0, 0.5), vec3(1.0, 1.0, 0.4), vec3(1.0, 0.4, 0.4));
+    color.rgb *= tints[min(int(m.minLod), 3)];
+#endif
+    return color;
+}
 
 void main(){
-    FragColor = (texture(tex1, uv)*(sin(time)+1)/2.0f) + (texture(tex2, uv)*(sin(time+pi)+1)/2.0f);
+#ifdef SINGLE_MATERIAL
+    FragColor = sampleMaterial(material1);
+#else
+    FragColor = sampleMaterial(material1)*blend.x + sampleMaterial(material2)*blend.y;
+#endif
 }
\ No newline at end of file
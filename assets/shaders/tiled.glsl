@@ -0,0 +1,44 @@
+#version 460 core
+in vec2 uv;
+
+// Page cache and indirection table from tileStream.h
+uniform layout(binding=0) sampler2D pages;
+uniform layout(binding=1) usampler2DArray indirection;
+
+uniform ivec2 imageSize;
+uniform int levels;
+uniform float pageCacheSize;
+
+// Part of the image shown on the quad: xy is the top left, zw the size, both in uv
+uniform vec4 view;
+
+out vec4 FragColor;
+
+// Has to match tilePyramid.h
+const float payload = 254.0f;
+const float border = 1.0f;
+const float pageSize = 256.0f;
+
+void main(){
+    vec2 imageUv = clamp(view.xy + uv * view.zw, vec2(0.0f), vec2(1.0f));
+    vec2 texel = imageUv * vec2(imageSize);
+
+    // Finest level that's no more than one texel per pixel
+    float rho = max(length(dFdx(texel)), length(dFdy(texel)));
+    int level = clamp(int(floor(log2(max(rho, 1.0f)))), 0, levels - 1);
+
+    // Level n texel coordinates are level 0's over 2^n
+    texel = min(texel, vec2(imageSize) - 0.001f);
+    ivec2 tile = ivec2(texel / (payload * exp2(level)));
+    uvec4 entry = texelFetch(indirection, ivec3(tile, level), 0);
+    if(entry.w == 0u){
+        // Not even the coarsest tile is in yet
+        FragColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+        return;
+    }
+
+    // The entry may point at a coarser tile standing in for this one
+    vec2 texelAt = texel / exp2(float(entry.z));
+    vec2 within = texelAt - floor(texelAt / payload) * payload;
+    FragColor = texture(pages, (vec2(entry.xy) * pageSize + border + within) / pageCacheSize);
+}
\ No newline at end of file
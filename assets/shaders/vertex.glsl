@@ -1,4 +1,76 @@
 #version 460 core
+// VERTEX_ATTRIBS takes the vertex from attributes a VAO sets up instead of pulling it out of the ssbo (see mesh.h)
+// QUANTIZED is for cooked meshes, PackedVert instead of Vert (see vert.h)
+// INSTANCE_TRANSFORMS puts the vertex through the world matrix the draw's base instance picks (see transforms.h)
+#pragma keywords VERTEX_ATTRIBS QUANTIZED INSTANCE_TRANSFORMS
+
+out vec2 uv;
+
+#ifdef INSTANCE_TRANSFORMS
+layout (binding = 2, std430) readonly buffer instanceBuffer {
+    mat4 instanceWorld[];
+};
+
+vec4 toWorld(vec3 position){
+    return instanceWorld[gl_BaseInstance] * vec4(position, 1.0f);
+}
+#else
+vec4 toWorld(vec3 position){
+    return vec4(position, 1.0f);
+}
+#endif
+
+#ifdef QUANTIZED
+// position = packed * posScale + posOffset, uv = packed * uvTransform.xy + uvTransform.zw
+uniform vec4 posScale;
+uniform vec4 posOffset;
+uniform vec4 uvTransform;
+
+vec3 dequantPos(vec3 q){
+    return q * posScale.xyz + posOffset.xyz;
+}
+
+vec2 dequantUv(vec2 q){
+    return q * uvTransform.xy + uvTransform.zw;
+}
+#else
+vec3 dequantPos(vec3 position){
+    return position;
+}
+
+vec2 dequantUv(vec2 uv){
+    return uv;
+}
+#endif
+
+#ifdef VERTEX_ATTRIBS
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 inUv;
+
+void main(){
+    // Normalized shorts come in already turned into [-1, 1] and [0, 1]
+    gl_Position = toWorld(dequantPos(position));
+    uv = dequantUv(inUv);
+}
+
+#elif defined(QUANTIZED)
+
+// Three uints a vertex: pos.xy, pos.z and padding, uv
+layout (binding = 0, std430) buffer ssbo {
+    uint packedVerts[];
+};
+
+void main(){
+    const uint base = uint(gl_VertexID) * 3;
+    const vec2 xy = unpackSnorm2x16(packedVerts[base]);
+    const float z = unpackSnorm2x16(packedVerts[base + 1]).x;
+    gl_Position = toWorld(dequantPos(vec3(xy, z)));
+    uv = dequantUv(unpackUnorm2x16(packedVerts[base + 2]));
+}
+
+#else
+
 struct Vert {
     float position[3];
     float uv[2];
@@ -8,8 +80,6 @@ layout (binding = 0, std430) buffer ssbo {
     Vert[] verts;
 };
 
-out vec2 uv;
-
 vec3 unpackPos(){
     return vec3(
         verts[gl_VertexID].position[0],
@@ -26,6 +96,8 @@ vec2 unpackUv(){
 }
 
 void main(){
-    gl_Position = vec4(unpackPos(), 1.0f);
+    gl_Position = toWorld(unpackPos());
     uv = unpackUv();
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
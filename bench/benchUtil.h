@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+
+// Timing and input helpers every CPU bench shares
+
+// Best of a few runs of fn, in milliseconds
+template<typename Fn>
+double bestMs(Fn fn){
+    double best = 1e30;
+    for(int run = 0; run < 5; run++){
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if(elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+// Best of a few runs of fn going through `count` items, in millions of items per second
+template<typename Fn>
+double bestRate(size_t count, Fn fn){
+    return count / bestMs(fn) / 1e3;
+}
+
+// Uniform in [lo, hi], off rand() so runs are repeatable
+inline float randomFloat(float lo, float hi){
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
@@ -0,0 +1,135 @@
+// Raster quad vs compute composite (with and without the shared memory texel cache) at a few target sizes.
+// Needs a GL 4.6 context, the window is never shown. Run from the repo root so assets/ is found.
+#include <stdio.h>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "glad/glad.h"
+#include <GLFW/glfw3.h>
+
+#include "computeComposite.h"
+#include "drawConstants.h"
+#include "gpuMemory.h"
+#include "gpuResources.h"
+#include "jobs.h"
+#include "shaderVariants.h"
+#include "texCache.h"
+#include "texturePool.h"
+
+namespace {
+    const Vert quad[] = {
+        { { -.95, -.95, 0}, { 0,  1} },
+        { {  .95, -.95, 0}, { 1,  1} },
+        { {  .95,  .95, 0}, { 1,  0} },
+
+        { { -.95, -.95, 0}, { 0,  1} },
+        { {  .95,  .95, 0}, { 1,  0} },
+        { { -.95,  .95, 0}, { 0,  0} },
+    };
+    const float bgColor[] = {1.0, 1.0, 0.0, 1.0};
+    const int sizes[] = {256, 512, 1024, 2048};
+    const int frames = 20;
+
+    // Wall time per run of fn in ms, averaged over `frames` after one warm up. glFinish on both ends rather than
+    // timer queries, some drivers (llvmpipe) don't time anything useful with those.
+    template<typename Fn>
+    double measure(Fn fn){
+        fn();
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < frames; i++) fn();
+        glFinish();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / frames;
+    }
+
+    GpuTexture makeTarget(int size){
+        return gpuTextureCreate({GL_TEXTURE_2D, GL_RGBA32F, size, size}, gpuRenderTargets, "bench target");
+    }
+
+    double maxDiff(GLuint a, GLuint b, int size){
+        std::vector<float> pa((size_t)size * size * 4), pb(pa.size());
+        glGetTextureImage(a, 0, GL_RGBA, GL_FLOAT, pa.size() * sizeof(float), pa.data());
+        glGetTextureImage(b, 0, GL_RGBA, GL_FLOAT, pb.size() * sizeof(float), pb.data());
+        double diff = 0;
+        for(size_t i = 0; i < pa.size(); i++) diff = std::fmax(diff, std::fabs(pa[i] - pb[i]));
+        return diff;
+    }
+}
+
+int main(){
+    if(!glfwInit()) return 1;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "compositeBench", NULL, NULL);
+    if(!window) return 1;
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return 1;
+    jobsInit();
+
+    // Full size textures so the big targets aren't all magnification
+    const char* const images[] = {"assets/container.jpg", "assets/bird.jpg"};
+    int materials[2] = {0, 0};
+    for(int i = 0; i < 2; i++){
+        CachedTexture tex;
+        if(!texCacheLoad(tex, images[i], ImageLoadOptions(), false)) return 1;
+        materials[i] = textureAdd(tex);
+        texCacheRelease(tex);
+    }
+    texturePoolsBind();
+    GpuBuffer constants = drawConstantsCreate();
+    drawConstantsUpload(constants, drawConstantsAt(1.0f));
+
+    GpuBuffer verts = gpuBufferCreate({sizeof(quad)}, gpuBuffers, "quad verts", quad);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, verts.id());
+    GLuint vao;
+    glCreateVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    ShaderProgram scene;
+    if(!shaderProgramLoad(scene, "assets/shaders/vertex.glsl", "assets/shaders/frag.glsl")) return 1;
+    GLuint raster = shaderVariant(scene, 0);
+    glProgramUniform1ui(raster, glGetUniformLocation(raster, "material1"), materials[0]);
+    glProgramUniform1ui(raster, glGetUniformLocation(raster, "material2"), materials[1]);
+
+    ComputeComposite cached, uncached;
+    if(!raster || !computeCompositeInit(cached) || !computeCompositeInit(uncached, "NO_TEXEL_CACHE")) return 1;
+
+    printf("%-6s %12s %16s %16s %12s\n", "size", "raster ms", "compute ms", "no cache ms", "max diff");
+    for(int size : sizes){
+        // Released at the end of each size, only names get reused across sizes since storage never matches
+        GpuTexture rasterTex = makeTarget(size), computeTex = makeTarget(size);
+        GpuFramebuffer fbo = gpuFramebufferCreate("bench fbo");
+        glNamedFramebufferTexture(fbo.id(), GL_COLOR_ATTACHMENT0, rasterTex.id(), 0);
+
+        double rasterMs = measure([&]{
+            glClearNamedFramebufferfv(fbo.id(), GL_COLOR, 0, bgColor);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo.id());
+            glViewport(0, 0, size, size);
+            glUseProgram(raster);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+        double uncachedMs = measure([&]{
+            computeCompositeDispatch(uncached, computeTex.id(), size, size, quad[0], quad[2], materials[0], materials[1], bgColor);
+        });
+        double cachedMs = measure([&]{
+            computeCompositeDispatch(cached, computeTex.id(), size, size, quad[0], quad[2], materials[0], materials[1], bgColor);
+        });
+
+        printf("%-6d %12.3f %9.3f (x%.2f) %9.3f (x%.2f) %12.2e\n", size, rasterMs,
+               cachedMs, rasterMs / cachedMs, uncachedMs, rasterMs / uncachedMs, maxDiff(rasterTex.id(), computeTex.id(), size));
+    }
+
+    computeCompositeFree(cached);
+    computeCompositeFree(uncached);
+    shaderProgramFree(scene);
+    texturePoolsFree();
+    constants.reset();
+    verts.reset();
+    glDeleteVertexArrays(1, &vao);
+    gpuResourcesShutdown();
+    gpuMemoryReportLeaks();
+    jobsShutdown();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
@@ -0,0 +1,83 @@
+// Frustum culling throughput: the SIMD kernel on one thread and spread over the workers, against a plain
+// per-object loop
+#include <stdio.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "benchUtil.h"
+#include "cull.h"
+#include "jobs.h"
+
+namespace {
+    const size_t objectCounts[] = {1000, 100000, 1000000};
+
+    // What cullFrustum does, one object and one plane at a time
+    void reference(const CullBounds& b, const Frustum& f, std::vector<uint32_t>& visible){
+        visible.clear();
+        for(size_t i = 0; i < cullCount(b); i++){
+            bool culled = false;
+            for(const float* p : f.planes){
+                const float dist = p[0] * b.centerX[i] + p[1] * b.centerY[i] + p[2] * b.centerZ[i] + p[3];
+                const float reach = std::fabs(p[0]) * b.extentX[i] + std::fabs(p[1]) * b.extentY[i] +
+                                    std::fabs(p[2]) * b.extentZ[i] + b.radius[i];
+                culled = culled || dist + reach < 0;
+            }
+            if(!culled) visible.push_back((uint32_t)i);
+        }
+    }
+
+    // Mismatched indices, allowing for the odd object sitting right on a plane that fused multiply-adds round
+    // the other way
+    size_t compare(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b){
+        size_t i = 0, j = 0, mismatches = 0;
+        while(i < a.size() || j < b.size()){
+            if(i < a.size() && j < b.size() && a[i] == b[j]){
+                i++;
+                j++;
+            } else if(j == b.size() || (i < a.size() && a[i] < b[j])){
+                i++;
+                mismatches++;
+            } else {
+                j++;
+                mismatches++;
+            }
+        }
+        return mismatches;
+    }
+}
+
+int main(){
+    jobsInit();
+    // A perspective camera at the origin looking down -z, 90 degree fov, near 0.1, far 100
+    const float n = 0.1f, f = 100.0f;
+    const float viewProj[16] = {
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, -(f + n) / (f - n), -1,
+        0, 0, -2 * f * n / (f - n), 0,
+    };
+    Frustum frustum;
+    frustumFromMatrix(frustum, viewProj);
+
+    for(size_t count : objectCounts){
+        // Boxes and spheres scattered all around the camera, about a sixth of them end up in view
+        CullBounds bounds;
+        srand(1);
+        for(size_t i = 0; i < count; i++){
+            const float center[3] = {randomFloat(-100, 100), randomFloat(-100, 100), randomFloat(-100, 100)};
+            const float extent[3] = {randomFloat(0, 2), randomFloat(0, 2), randomFloat(0, 2)};
+            const float point[3] = {0, 0, 0};
+            if(i % 4) cullAdd(bounds, center, extent);
+            else      cullAdd(bounds, center, point, randomFloat(0, 3));
+        }
+
+        std::vector<uint32_t> expected, visible;
+        const double plain = bestRate(count, [&]{ reference(bounds, frustum, expected); });
+        const double kernel = bestRate(count, [&]{ cullFrustum(bounds, frustum, visible); });
+        printf("%8zu objects   plain %8.1f M/s   cullFrustum %8.1f M/s   x%5.1f   %zu visible   mismatches %zu\n", count, plain,
+               kernel, kernel / plain, visible.size(), compare(expected, visible));
+    }
+    printf("cullFrustum goes wide past %zu objects, %u workers\n", cullParallelMin, jobsWorkerCount());
+    jobsShutdown();
+}
@@ -0,0 +1,68 @@
+// Plays back a file recorded with --gl-capture as fast as the driver will take it and times every frame.
+// The calls are exactly what the app made, so the numbers are driver and GPU cost with the app's CPU work taken out.
+// Needs a GL 4.6 context, the window is never shown. Usage: glReplay <capture file>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "glad/glad.h"
+#include <GLFW/glfw3.h>
+
+#include "glCapture.h"
+
+int main(int argc, char** argv){
+    if(argc < 2){
+        printf("Usage: glReplay <capture file>\n");
+        return 1;
+    }
+
+    GlReplay replay;
+    if(!glReplayOpen(replay, argv[1])) return 1;
+
+    if(!glfwInit()) return 1;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    // Same default framebuffer size so blits to it and the default viewport match the recording
+    GLFWwindow* window = glfwCreateWindow(std::max(replay.width, 1), std::max(replay.height, 1), "glReplay", NULL, NULL);
+    if(!window) return 1;
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return 1;
+
+    // Wall time per frame with a glFinish at the end of each, so GPU work lands in the frame that queued it
+    std::vector<double> times;
+    uint64_t setupCalls = 0;
+    double setupTime = 0;
+    for(uint32_t frame = 0; frame < replay.frames; frame++){
+        const uint64_t callsBefore = replay.calls;
+        auto start = std::chrono::steady_clock::now();
+        const bool more = glReplayFrame(replay);
+        glFinish();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if(!more) break;
+
+        // The first frame also has all the loading and shader building in it
+        if(frame == 0){
+            setupTime = elapsed.count();
+            setupCalls = replay.calls - callsBefore;
+        } else {
+            times.push_back(elapsed.count());
+        }
+    }
+    const bool failed = replay.failed;
+    const uint64_t frameCalls = replay.calls - setupCalls;
+    glReplayClose(replay);
+
+    printf("Setup and first frame: %.2f ms, %llu calls\n", setupTime, (unsigned long long)setupCalls);
+    if(!times.empty()){
+        std::vector<double> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for(double t : times) total += t;
+        printf("%zu frames: %.3f ms average, %.3f median, %.3f min, %.3f max, %.1f calls a frame\n", times.size(),
+               total / times.size(), sorted[sorted.size() / 2], sorted.front(), sorted.back(), (double)frameCalls / times.size());
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+// Throughput of each pixel format kernel against the generic per-pixel path
+#include <stdio.h>
+#include <cstdlib>
+#include <vector>
+
+#include "benchUtil.h"
+#include "pixelFormat.h"
+
+namespace {
+    const size_t pixelCount = 2048 * 2048;
+
+    template<typename Src, typename Dst>
+    void bench(const char* name){
+        std::vector<typename Src::Channel> src(pixelCount * Src::channels);
+        std::vector<typename Dst::Channel> dst(pixelCount * Dst::channels);
+
+        // Values in range for every format, floats included
+        for(size_t i = 0; i < src.size(); i++){
+            float v = (rand() & 0xff) / 255.0f;
+            float px[4] = {v, v, v, v};
+            if(sizeof(typename Src::Channel) == 1) src[i] = (typename Src::Channel)(rand() & 0xff);
+            else Src::store(&src[i - i % Src::channels], px);
+        }
+
+        double generic = bestRate(pixelCount, [&]{ PixelConverter<Src, Dst>::generic(src.data(), dst.data(), pixelCount); });
+        std::vector<typename Dst::Channel> reference = dst;
+        double fast = bestRate(pixelCount, [&]{ PixelConverter<Src, Dst>::run(src.data(), dst.data(), pixelCount); });
+
+        size_t mismatches = 0;
+        for(size_t i = 0; i < dst.size(); i++){
+            if(dst[i] != reference[i]) mismatches++;
+        }
+
+        printf("%-28s generic %8.1f MP/s   kernel %8.1f MP/s   x%5.1f   mismatches %zu\n",
+               name, generic, fast, fast / generic, mismatches);
+    }
+}
+
+int main(){
+    bench<RGB8,    RGBA8>("RGB8 -> RGBA8");
+    bench<RGBA8,   RGB8>("RGBA8 -> RGB8");
+    bench<RGBA8,   BGRA8>("RGBA8 -> BGRA8");
+    bench<RGBA8,   Premultiplied<RGBA8>>("RGBA8 -> premultiplied");
+    bench<RGB8,    RGBA32F>("RGB8 -> RGBA32F");
+    bench<RGBA8,   RGBA32F>("RGBA8 -> RGBA32F");
+    bench<SRGB8,   RGBA32F>("sRGB8 -> linear RGBA32F");
+    bench<RGBA32F, RGBA8>("RGBA32F -> RGBA8");
+    bench<RGBA32F, RGB8>("RGBA32F -> RGB8");
+    bench<RGBA32F, RGBA16F>("RGBA32F -> RGBA16F");
+    bench<RGB8,    RGBA16F>("RGB8 -> RGBA16F");
+    bench<RGBA8,   RGBA16F>("RGBA8 -> RGBA16F");
+}
@@ -0,0 +1,65 @@
+// Loads a handful of JPEGs without restart markers through the progressive path on a single worker.
+// Those decode on the thread that picked the load up and hand their rows out as jobs of their own, so with more
+// loads than workers a wait that only sleeps never comes back. Exits non zero if it hangs or anything fails.
+// Needs a GL 4.6 context, the window is never shown. Run from the repo root so bench/data/ is found.
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+#include "glad/glad.h"
+#include <GLFW/glfw3.h>
+
+#include "gpuResources.h"
+#include "jobs.h"
+#include "progressiveLoad.h"
+#include "texturePool.h"
+
+namespace {
+    const char* const images[] = {
+        "bench/data/plain0.jpg", "bench/data/plain1.jpg", "bench/data/plain2.jpg",
+        "bench/data/plain3.jpg", "bench/data/plain4.jpg", "bench/data/plain5.jpg",
+    };
+    const int timeoutSeconds = 60;
+}
+
+int main(){
+    if(!glfwInit()) return 1;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "progressiveLoadCheck", NULL, NULL);
+    if(!window) return 1;
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return 1;
+    // One worker so there are always more loads than workers
+    jobsInit(1);
+
+    // A deadlock just sits there, so something else has to call it
+    std::thread([]{
+        std::this_thread::sleep_for(std::chrono::seconds(timeoutSeconds));
+        printf("FAIL: progressive loads still going after %ds\n", timeoutSeconds);
+        fflush(stdout);
+        _exit(1);
+    }).detach();
+
+    auto start = std::chrono::steady_clock::now();
+    for(const char* image : images){
+        if(progressiveTextureAdd(image, ImageLoadOptions()) < 0){
+            printf("FAIL: couldn't add \'%s\'\n", image);
+            return 1;
+        }
+    }
+    int frames = 0;
+    while(progressiveTexturesUpdate()){
+        frames++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    progressiveTexturesFree();
+    texturePoolsFree();
+    gpuResourcesShutdown();
+    jobsShutdown();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    printf("OK: %zu textures in %.1f ms over %d frames\n", sizeof(images) / sizeof(images[0]), elapsed.count(), frames);
+}
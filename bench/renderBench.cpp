@@ -0,0 +1,367 @@
+// Microbenchmarks of the GL primitives the render path is built from: texture uploads per format, pulling vertices
+// out of an SSBO vs VAO attributes (both vertex.glsl variants, see mesh.h), drawing into fb_tex and blitting vs drawing straight to the back buffer, and
+// fill rate at a few target sizes. Every sample is one run with a glFinish after it, the percentiles are over those.
+// Needs a GL 4.6 context, the window is never shown. Run from the repo root so assets/ is found.
+// Usage: renderBench [results.json]
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glad/glad.h"
+#include <GLFW/glfw3.h>
+
+namespace {
+    const int samples = 30;
+    // Same size as the demo window
+    const int windowSize = 400;
+
+    struct Result {
+        std::string group, name;
+        // Per sample
+        std::vector<double> ms;
+        // Work per sample in millions of `unit`, so the rate comes out in unit per second
+        double work;
+        const char* unit;
+    };
+    std::vector<Result> results;
+
+    // Nearest rank on a sorted list
+    double percentile(const std::vector<double>& sorted, double p){
+        size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+        return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+    }
+
+    template<typename Fn>
+    void measure(const char* group, const std::string& name, double work, const char* unit, Fn fn){
+        // One to warm up, first use of anything tends to be slow
+        fn();
+        glFinish();
+        Result r = {group, name, {}, work, unit};
+        for(int i = 0; i < samples; i++){
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            glFinish();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            r.ms.push_back(elapsed.count());
+        }
+        std::vector<double> sorted = r.ms;
+        std::sort(sorted.begin(), sorted.end());
+        const double median = percentile(sorted, 50);
+        printf("%-10s %-24s %9.3f %9.3f %9.3f %12.1f %s\n", group, name.c_str(), median, percentile(sorted, 90),
+               percentile(sorted, 99), work / (median / 1000), unit);
+        results.push_back(r);
+    }
+
+    GLuint compileStage(GLenum type, const char* source){
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if(!success){
+            char infoLog[512] = {0};
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            printf("compiling a bench shader failed:\n%s\n", infoLog);
+        }
+        return shader;
+    }
+
+    GLuint makeProgram(const char* vertSource, const char* fragSource){
+        GLuint prog = glCreateProgram();
+        GLuint vert = compileStage(GL_VERTEX_SHADER, vertSource);
+        GLuint frag = compileStage(GL_FRAGMENT_SHADER, fragSource);
+        glAttachShader(prog, vert);
+        glAttachShader(prog, frag);
+        glLinkProgram(prog);
+        glDeleteShader(vert);
+        glDeleteShader(frag);
+        GLint linked;
+        glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+        if(!linked){
+            char infoLog[512] = {0};
+            glGetProgramInfoLog(prog, sizeof(infoLog), NULL, infoLog);
+            printf("linking a bench shader failed:\n%s\n", infoLog);
+            glDeleteProgram(prog);
+            return 0;
+        }
+        return prog;
+    }
+
+    // vertex.glsl with `define` slipped in after #version, the way shaderVariants does it
+    std::string vertexSource(const char* define){
+        std::ifstream file("assets/shaders/vertex.glsl");
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string text = source.str();
+        if(text.empty()) printf("Couldn\'t read assets/shaders/vertex.glsl\n");
+        const size_t split = text.find('\n');
+        if(define && split != std::string::npos) text.insert(split + 1, std::string("#define ") + define + "\n#line 2\n");
+        return text;
+    }
+
+    const char* const uvFrag = R"(#version 460 core
+in vec2 uv;
+out vec4 color;
+void main(){
+    color = vec4(uv, 0.5, 1.0);
+}
+)";
+
+    // One triangle over the whole target, no vertex data at all
+    const char* const fullscreenVert = R"(#version 460 core
+out vec2 uv;
+void main(){
+    uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+    struct Vert {
+        float pos[3];
+        float uv[2];
+    };
+
+    GLuint makeTarget(GLenum format, int size, GLuint& fbo){
+        GLuint tex;
+        glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+        glTextureStorage2D(tex, 1, format, size, size);
+        glCreateFramebuffers(1, &fbo);
+        glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, tex, 0);
+        glNamedFramebufferDrawBuffer(fbo, GL_COLOR_ATTACHMENT0);
+        return tex;
+    }
+
+    void benchUploads(){
+        const int size = 1024;
+        struct Format {
+            const char* name;
+            GLenum internalFormat, format, type;
+            int bytes;
+        };
+        // RGB8 is what most decoded images are, RGBA32F is what the soft backend hands fb_tex every frame
+        const Format formats[] = {
+            {"RGB8", GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 3},
+            {"RGBA8", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4},
+            {"RGBA32F", GL_RGBA32F, GL_RGBA, GL_FLOAT, 16},
+        };
+        std::vector<unsigned char> pixels((size_t)size * size * 16);
+        for(size_t i = 0; i < pixels.size(); i++) pixels[i] = (unsigned char)(i * 7);
+
+        for(const Format& f : formats){
+            GLuint tex;
+            glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+            glTextureStorage2D(tex, 1, f.internalFormat, size, size);
+            const double bytes = (double)size * size * f.bytes;
+            measure("upload", std::string(f.name) + " 1024x1024", bytes / 1e6, "MB/s", [&]{
+                glTextureSubImage2D(tex, 0, 0, 0, size, size, f.format, f.type, pixels.data());
+            });
+            glDeleteTextures(1, &tex);
+        }
+    }
+
+    // Vertex bound scenes: lots of tiny triangles into a small target, drawn by both vertex.glsl variants
+    void benchVertexFetch(){
+        const int meshSizes[] = {1 << 10, 1 << 14, 1 << 18};
+        const int targetSize = 64;
+        GLuint fbo;
+        GLuint target = makeTarget(GL_RGBA8, targetSize, fbo);
+        const std::string pullSource = vertexSource(nullptr), attribSource = vertexSource("VERTEX_ATTRIBS");
+        GLuint pull = makeProgram(pullSource.c_str(), uvFrag), attrib = makeProgram(attribSource.c_str(), uvFrag);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, targetSize, targetSize);
+
+        for(int triangles : meshSizes){
+            std::vector<Vert> verts(triangles * 3);
+            for(size_t i = 0; i < verts.size(); i++){
+                const float x = (float)(i % 97) / 48.5f - 1, y = (float)(i % 89) / 44.5f - 1;
+                const float d = (i % 3) * 0.01f;
+                verts[i] = {{x + d, y + (i % 3 == 2 ? 0.01f : 0), 0}, {x, y}};
+            }
+            GLuint buffer;
+            glCreateBuffers(1, &buffer);
+            glNamedBufferStorage(buffer, verts.size() * sizeof(Vert), verts.data(), 0);
+
+            // Same setup as mesh.cpp. Pulling still needs a VAO bound, the attributes just go unused.
+            GLuint vao;
+            glCreateVertexArrays(1, &vao);
+            glVertexArrayVertexBuffer(vao, 0, buffer, 0, sizeof(Vert));
+            glEnableVertexArrayAttrib(vao, 0);
+            glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vert, pos));
+            glVertexArrayAttribBinding(vao, 0, 0);
+            glEnableVertexArrayAttrib(vao, 1);
+            glVertexArrayAttribFormat(vao, 1, 2, GL_FLOAT, GL_FALSE, offsetof(Vert, uv));
+            glVertexArrayAttribBinding(vao, 1, 0);
+            glBindVertexArray(vao);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+
+            const double mverts = verts.size() / 1e6;
+            char name[64];
+            if(pull){
+                snprintf(name, sizeof(name), "pull %zu verts", verts.size());
+                measure("vertices", name, mverts, "Mverts/s", [&]{
+                    glUseProgram(pull);
+                    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)verts.size());
+                });
+            }
+            if(attrib){
+                snprintf(name, sizeof(name), "attribs %zu verts", verts.size());
+                measure("vertices", name, mverts, "Mverts/s", [&]{
+                    glUseProgram(attrib);
+                    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)verts.size());
+                });
+            }
+            glBindVertexArray(0);
+            glDeleteVertexArrays(1, &vao);
+            glDeleteBuffers(1, &buffer);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteProgram(pull);
+        glDeleteProgram(attrib);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &target);
+    }
+
+    // What main.cpp does every frame (clear an RGBA32F target, draw, blit it to the window) against drawing
+    // straight into the back buffer
+    void benchPresent(GLuint fullscreen, GLuint emptyVao){
+        // Hidden windows on some platforms get no back buffer at all, every draw to it would be a no-op
+        if(glCheckNamedFramebufferStatus(0, GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+            printf("%-10s no back buffer to present to, skipped\n", "present");
+            return;
+        }
+        const float clear[] = {1, 1, 0, 1};
+        const double mpixels = (double)windowSize * windowSize / 1e6;
+        glBindVertexArray(emptyVao);
+        glUseProgram(fullscreen);
+        glViewport(0, 0, windowSize, windowSize);
+
+        const GLenum formats[] = {GL_RGBA32F, GL_RGBA8};
+        const char* const names[] = {"RGBA32F clear+blit", "RGBA8 clear+blit"};
+        for(int i = 0; i < 2; i++){
+            GLuint fbo;
+            GLuint target = makeTarget(formats[i], windowSize, fbo);
+            measure("present", names[i], mpixels, "Mpixels/s", [&]{
+                glClearNamedFramebufferfv(fbo, GL_COLOR, 0, clear);
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                glBlitNamedFramebuffer(fbo, 0, 0, 0, windowSize, windowSize, 0, 0, windowSize, windowSize,
+                                       GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            });
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteTextures(1, &target);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        measure("present", "direct to back buffer", mpixels, "Mpixels/s", [&]{
+            glClearNamedFramebufferfv(0, GL_COLOR, 0, clear);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        });
+    }
+
+    void benchFill(GLuint fullscreen, GLuint emptyVao){
+        // Several layers a sample so the draw call overhead doesn't hide the fill cost at small sizes
+        const int layers = 4;
+        const int sizes[] = {256, 512, 1024, 2048};
+        const GLenum formats[] = {GL_RGBA8, GL_RGBA32F};
+        const char* const names[] = {"RGBA8", "RGBA32F"};
+        glBindVertexArray(emptyVao);
+        glUseProgram(fullscreen);
+        for(int f = 0; f < 2; f++){
+            for(int size : sizes){
+                GLuint fbo;
+                GLuint target = makeTarget(formats[f], size, fbo);
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+                glViewport(0, 0, size, size);
+                char name[64];
+                snprintf(name, sizeof(name), "%s %dx%d", names[f], size, size);
+                measure("fill", name, (double)size * size * layers / 1e6, "Mpixels/s", [&]{
+                    for(int i = 0; i < layers; i++) glDrawArrays(GL_TRIANGLES, 0, 3);
+                });
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glDeleteFramebuffers(1, &fbo);
+                glDeleteTextures(1, &target);
+            }
+        }
+    }
+
+    void writeString(FILE* f, const char* s){
+        fputc('"', f);
+        for(; *s; s++){
+            if(*s == '"' || *s == '\\') fputc('\\', f);
+            if((unsigned char)*s >= 0x20) fputc(*s, f);
+        }
+        fputc('"', f);
+    }
+
+    bool writeJson(const char* fName){
+        FILE* f = fopen(fName, "wb");
+        if(!f){
+            printf("Failed to open \'%s\'\n", fName);
+            return false;
+        }
+        fprintf(f, "{\n  \"renderer\": ");
+        writeString(f, (const char*)glGetString(GL_RENDERER));
+        fprintf(f, ",\n  \"version\": ");
+        writeString(f, (const char*)glGetString(GL_VERSION));
+        fprintf(f, ",\n  \"samples\": %d,\n  \"results\": [", samples);
+        for(size_t i = 0; i < results.size(); i++){
+            const Result& r = results[i];
+            std::vector<double> sorted = r.ms;
+            std::sort(sorted.begin(), sorted.end());
+            double total = 0;
+            for(double ms : r.ms) total += ms;
+            fprintf(f, "%s\n    {\"group\": ", i ? "," : "");
+            writeString(f, r.group.c_str());
+            fprintf(f, ", \"name\": ");
+            writeString(f, r.name.c_str());
+            fprintf(f, ", \"mean_ms\": %.4f, \"min_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f",
+                    total / r.ms.size(), sorted.front(), percentile(sorted, 50), percentile(sorted, 90), percentile(sorted, 99),
+                    sorted.back());
+            // Rate at the median
+            fprintf(f, ", \"rate\": %.2f, \"unit\": \"%s\"}", r.work / (percentile(sorted, 50) / 1000), r.unit);
+        }
+        fprintf(f, "\n  ]\n}\n");
+        const bool ok = !ferror(f);
+        fclose(f);
+        return ok;
+    }
+}
+
+int main(int argc, char** argv){
+    const char* outName = argc > 1 ? argv[1] : "renderBench.json";
+
+    if(!glfwInit()) return 1;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(windowSize, windowSize, "renderBench", NULL, NULL);
+    if(!window) return 1;
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return 1;
+    // No vsync, the back buffer bench would just measure the refresh rate
+    glfwSwapInterval(0);
+
+    GLuint fullscreen = makeProgram(fullscreenVert, uvFrag);
+    if(!fullscreen) return 1;
+    GLuint emptyVao;
+    glCreateVertexArrays(1, &emptyVao);
+
+    printf("%-10s %-24s %9s %9s %9s %12s\n", "group", "name", "p50 ms", "p90 ms", "p99 ms", "rate");
+    benchUploads();
+    benchVertexFetch();
+    benchPresent(fullscreen, emptyVao);
+    benchFill(fullscreen, emptyVao);
+
+    glDeleteProgram(fullscreen);
+    glDeleteVertexArrays(1, &emptyVao);
+
+    const bool ok = writeJson(outName);
+    if(ok) printf("Results in \'%s\'\n", outName);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return ok ? 0 : 1;
+}
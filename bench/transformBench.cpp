@@ -0,0 +1,109 @@
+// Transform hierarchy updates: transformsUpdate over every node and over a few moved subtrees, against the
+// usual node-with-children-pointers tree walked recursively
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "benchUtil.h"
+#include "jobs.h"
+#include "transforms.h"
+
+namespace {
+    const size_t nodeCounts[] = {1000, 100000, 1000000};
+    // Fraction of the nodes moved for the partial update
+    const size_t movedFraction = 100;
+
+    struct Node {
+        float pos[3], rot[4], scale[3];
+        float world[16];
+        std::vector<Node*> children;
+    };
+
+    void trs(const Node& n, float* m){
+        const float x = n.rot[0], y = n.rot[1], z = n.rot[2], w = n.rot[3];
+        const float r[9] = {1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y),
+                            2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x),
+                            2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y)};
+        for(int c = 0; c < 3; c++){
+            for(int k = 0; k < 3; k++) m[c * 4 + k] = r[c * 3 + k] * n.scale[c];
+            m[c * 4 + 3] = 0;
+        }
+        m[12] = n.pos[0];
+        m[13] = n.pos[1];
+        m[14] = n.pos[2];
+        m[15] = 1;
+    }
+
+    // One node at a time, a full 4x4 multiply each
+    void walk(Node& n, const float* parent){
+        float local[16];
+        trs(n, local);
+        for(int c = 0; c < 4; c++){
+            for(int r = 0; r < 4; r++){
+                float sum = 0;
+                for(int k = 0; k < 4; k++) sum += (parent ? parent[k * 4 + r] : (k == r ? 1.0f : 0.0f)) * local[c * 4 + k];
+                n.world[c * 4 + r] = sum;
+            }
+        }
+        for(Node* child : n.children) walk(*child, n.world);
+    }
+}
+
+int main(){
+    jobsInit();
+    for(size_t count : nodeCounts){
+        // A forest where every node hangs under one a little before it, so it comes out about 12 deep at a million.
+        // Nodes are added in that order, so the first update has to sort them.
+        srand(1);
+        std::vector<Node> nodes(count);
+        std::vector<size_t> parents(count);
+        Transforms transforms;
+        for(size_t i = 0; i < count; i++){
+            Node& n = nodes[i];
+            for(int c = 0; c < 3; c++){
+                n.pos[c] = randomFloat(-1, 1);
+                n.scale[c] = randomFloat(0.5f, 1.5f);
+            }
+            float len = 0;
+            for(int c = 0; c < 4; c++){
+                n.rot[c] = randomFloat(-1, 1);
+                len += n.rot[c] * n.rot[c];
+            }
+            for(int c = 0; c < 4; c++) n.rot[c] /= std::sqrt(len);
+
+            parents[i] = i < 8 ? ~(size_t)0 : rand() % (i / 2 + 1) + i / 4;
+            const TransformId id = transformAdd(transforms, parents[i] == ~(size_t)0 ? noTransform : (TransformId)parents[i]);
+            transformSet(transforms, id, n.pos, n.rot, n.scale);
+            if(parents[i] != ~(size_t)0) nodes[parents[i]].children.push_back(&n);
+        }
+
+        std::vector<TransformId> changed;
+        const double first = bestMs([&]{
+            for(size_t i = 0; i < count; i++) transformSet(transforms, (TransformId)i, nodes[i].pos, nodes[i].rot, nodes[i].scale);
+            transformsUpdate(transforms, changed);
+        });
+        const double pointers = bestMs([&]{
+            for(size_t i = 0; i < 8; i++) walk(nodes[i], nullptr);
+        });
+
+        float maxError = 0;
+        for(size_t i = 0; i < count; i++){
+            const float* world = &transformWorld(transforms, (TransformId)i).cols[0].x;
+            for(int c = 0; c < 16; c++) maxError = std::max(maxError, std::fabs(world[c] - nodes[i].world[c]));
+        }
+
+        // A few scattered nodes move, everything under them follows
+        size_t followed = 0;
+        const double partial = bestMs([&]{
+            for(size_t i = 0; i < count; i += movedFraction) transformSet(transforms, (TransformId)i, nodes[i].pos, nodes[i].rot, nodes[i].scale);
+            transformsUpdate(transforms, changed);
+            followed = changed.size();
+        });
+        printf("%8zu nodes   pointer tree %8.3f ms   transformsUpdate all %8.3f ms   x%5.1f   %zu moved %8.3f ms (%zu followed)   max error %g\n",
+               count, pointers, first, pointers / first, count / movedFraction, partial, followed, maxError);
+    }
+    printf("%u workers, %zu nodes a job\n", jobsWorkerCount(), transformChunk);
+    jobsShutdown();
+}
@@ -0,0 +1,90 @@
+// vecMath.h batches against plain loops: transformPoints over SoA points and mulMatrices over pairs of Mat4s.
+// Also checks that the constexpr path gives the same answers as the SIMD one.
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "benchUtil.h"
+#include "vecMath.h"
+
+namespace {
+    const size_t counts[] = {1000, 100000, 1000000};
+
+    // Worked out at compile time, compared against the same thing at run time below
+    constexpr Mat4 constMat = mat4Trs({1, 2, 3}, {0, 0.6f, 0, 0.8f}, {2, 2, 2}) * affineInverse(mat4Trs({0, 1, 0}, {0.6f, 0, 0, 0.8f}, {1, 2, 1}));
+    constexpr Vec3 constPoint = transformPoint(constMat, {1, 1, 1});
+    static_assert(cross(Vec3{1, 0, 0}, Vec3{0, 1, 0}) == Vec3{0, 0, 1}, "");
+    static_assert(mat4Identity() * Vec4{1, 2, 3, 4} == Vec4{1, 2, 3, 4}, "");
+    static_assert(rotate(Quat{0, 0, 1, 0}, Vec3{1, 0, 0}) == Vec3{-1, 0, 0}, "");
+
+    Mat4 randomMatrix(){
+        const Quat q = normalize(Quat{randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1)});
+        return mat4Trs({randomFloat(-10, 10), randomFloat(-10, 10), randomFloat(-10, 10)}, q, {randomFloat(0.5f, 2), randomFloat(0.5f, 2), randomFloat(0.5f, 2)});
+    }
+
+    // Scalar on purpose, kept from being vectorized so it stands in for float[16] code
+    __attribute__((optimize("no-tree-vectorize"))) void plainMul(const float* a, const float* b, float* out){
+        for(int c = 0; c < 4; c++){
+            for(int r = 0; r < 4; r++){
+                float sum = 0;
+                for(int k = 0; k < 4; k++) sum += a[k * 4 + r] * b[c * 4 + k];
+                out[c * 4 + r] = sum;
+            }
+        }
+    }
+
+    __attribute__((optimize("no-tree-vectorize"))) void plainTransform(const float* m, const float* x, const float* y, const float* z,
+                                                                       float* ox, float* oy, float* oz, size_t count){
+        for(size_t i = 0; i < count; i++){
+            ox[i] = m[0] * x[i] + m[4] * y[i] + m[8] * z[i] + m[12];
+            oy[i] = m[1] * x[i] + m[5] * y[i] + m[9] * z[i] + m[13];
+            oz[i] = m[2] * x[i] + m[6] * y[i] + m[10] * z[i] + m[14];
+        }
+    }
+
+    float maxDiff(const float* a, const float* b, size_t count){
+        float diff = 0;
+        for(size_t i = 0; i < count; i++) diff = std::max(diff, std::fabs(a[i] - b[i]));
+        return diff;
+    }
+}
+
+int main(){
+    // Same expression again, this time at run time through the intrinsics
+    volatile float one = 1;
+    const Mat4 runMat = mat4Trs({1, 2, 3}, {0, 0.6f, 0, 0.8f}, {2, 2, 2}) * affineInverse(mat4Trs({0, 1, 0}, {0.6f, 0, 0, 0.8f}, {1, 2, 1}));
+    const Vec3 runPoint = transformPoint(runMat, {one, one, one});
+    printf("constexpr vs run time: %g\n", std::max(std::max(std::fabs(constPoint.x - runPoint.x), std::fabs(constPoint.y - runPoint.y)),
+                                                   std::fabs(constPoint.z - runPoint.z)));
+
+    srand(1);
+    const Mat4 m = randomMatrix();
+    for(size_t count : counts){
+        std::vector<float> x(count), y(count), z(count), ox(count), oy(count), oz(count), px(count), py(count), pz(count);
+        for(size_t i = 0; i < count; i++){
+            x[i] = randomFloat(-100, 100);
+            y[i] = randomFloat(-100, 100);
+            z[i] = randomFloat(-100, 100);
+        }
+        const double plain = bestRate(count, [&]{ plainTransform(&m.cols[0].x, x.data(), y.data(), z.data(), px.data(), py.data(), pz.data(), count); });
+        const double batch = bestRate(count, [&]{ transformPoints(m, x.data(), y.data(), z.data(), ox.data(), oy.data(), oz.data(), count); });
+        const float diff = std::max(maxDiff(ox.data(), px.data(), count), std::max(maxDiff(oy.data(), py.data(), count), maxDiff(oz.data(), pz.data(), count)));
+        printf("%8zu points     plain %8.1f M/s   transformPoints %8.1f M/s   x%5.1f   max diff %g\n", count, plain, batch, batch / plain, diff);
+    }
+
+    for(size_t count : counts){
+        std::vector<Mat4> a(count), b(count), out(count), expected(count);
+        for(size_t i = 0; i < count; i++){
+            a[i] = randomMatrix();
+            b[i] = randomMatrix();
+        }
+        const double plain = bestRate(count, [&]{
+            for(size_t i = 0; i < count; i++) plainMul(&a[i].cols[0].x, &b[i].cols[0].x, &expected[i].cols[0].x);
+        });
+        const double batch = bestRate(count, [&]{ mulMatrices(a.data(), b.data(), out.data(), count); });
+        const float diff = maxDiff(&out[0].cols[0].x, &expected[0].cols[0].x, count * 16);
+        printf("%8zu matrices   plain %8.1f M/s   mulMatrices     %8.1f M/s   x%5.1f   max diff %g\n", count, plain, batch, batch / plain, diff);
+    }
+}
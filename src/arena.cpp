@@ -0,0 +1,204 @@
+#include "arena.h"
+
+#include <stdio.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    const size_t scratchCapacity = 1 << 20;
+    // Big decodes past this just spill, a worker shouldn't sit on more than that between loads
+    const size_t scratchMaxCapacity = 64 << 20;
+
+    Arena frameArenas[2];
+    int currentFrame = 0;
+
+    struct ThreadArena {
+        Arena arena;
+        bool ready = false;
+        ~ThreadArena(){ arenaDestroy(arena); }
+    };
+    thread_local ThreadArena threadArena;
+    thread_local Arena* currentScratch = nullptr;
+
+    size_t alignUp(size_t v, size_t align){
+        return (v + align - 1) & ~(align - 1);
+    }
+
+    void notePeak(Arena& arena){
+        if(arena.used + arena.spilledBytes > arena.peak) arena.peak = arena.used + arena.spilledBytes;
+    }
+
+    bool inBlock(const Arena& arena, const void* p){
+        return p >= arena.base && p < arena.base + arena.capacity;
+    }
+
+    Arena::Spill* findSpill(Arena& arena, const void* p){
+        for(Arena::Spill& s : arena.spills) if(s.p == p) return &s;
+        return nullptr;
+    }
+}
+
+bool arenaInit(Arena& arena, size_t capacity, size_t maxCapacity){
+    arenaDestroy(arena);
+    arena.base = (unsigned char*)malloc(capacity);
+    if(!arena.base) return false;
+    arena.capacity = capacity;
+    arena.maxCapacity = maxCapacity;
+    return true;
+}
+
+void arenaDestroy(Arena& arena){
+    for(Arena::Spill& s : arena.spills) free(s.p);
+    free(arena.base);
+    arena = Arena();
+}
+
+void* arenaAlloc(Arena& arena, size_t size, size_t align){
+    // Offsets get aligned rather than addresses, malloc already gives the base max_align_t alignment
+    const uintptr_t start = alignUp((uintptr_t)arena.base + arena.used, align) - (uintptr_t)arena.base;
+    if(arena.base && start + size <= arena.capacity){
+        arena.used = start + size;
+        notePeak(arena);
+        return arena.base + start;
+    }
+
+    void* p = nullptr;
+    if(align <= alignof(std::max_align_t)) p = malloc(size);
+    else if(posix_memalign(&p, align, size)) p = nullptr;
+    if(!p) return nullptr;
+    arena.spills.push_back({p, size});
+    arena.spilledBytes += size;
+    notePeak(arena);
+    return p;
+}
+
+void* arenaRealloc(Arena& arena, void* p, size_t oldSize, size_t newSize){
+    if(!p) return arenaAlloc(arena, newSize);
+
+    if(inBlock(arena, p)){
+        // The last thing handed out ends right where the free space starts
+        unsigned char* c = (unsigned char*)p;
+        if(c + oldSize == arena.base + arena.used && c + newSize <= arena.base + arena.capacity){
+            arena.used = c - arena.base + newSize;
+            notePeak(arena);
+            return p;
+        }
+        if(newSize <= oldSize) return p;
+        void* grown = arenaAlloc(arena, newSize);
+        if(grown) memcpy(grown, p, oldSize);
+        return grown;
+    }
+
+    if(Arena::Spill* s = findSpill(arena, p)){
+        void* grown = realloc(p, newSize);
+        if(!grown) return nullptr;
+        arena.spilledBytes += newSize - s->size;
+        s->p = grown;
+        s->size = newSize;
+        notePeak(arena);
+        return grown;
+    }
+    return nullptr;
+}
+
+bool arenaOwns(const Arena& arena, const void* p){
+    if(inBlock(arena, p)) return true;
+    for(const Arena::Spill& s : arena.spills) if(s.p == p) return true;
+    return false;
+}
+
+ArenaMark arenaMark(const Arena& arena){
+    return {arena.used, arena.spills.size()};
+}
+
+void arenaRewind(Arena& arena, const ArenaMark& mark){
+    for(size_t i = mark.spills; i < arena.spills.size(); i++){
+        free(arena.spills[i].p);
+        arena.spilledBytes -= arena.spills[i].size;
+    }
+    arena.spills.resize(mark.spills);
+    arena.used = mark.used;
+}
+
+void arenaReset(Arena& arena){
+    arenaRewind(arena, ArenaMark());
+
+    size_t wanted = arena.peak;
+    if(arena.maxCapacity && wanted > arena.maxCapacity) wanted = arena.maxCapacity;
+    if(wanted > arena.capacity){
+        // A bit extra so creeping growth doesn't mean a new block every time
+        const size_t capacity = alignUp(wanted + wanted / 4, 4096);
+        unsigned char* base = (unsigned char*)malloc(capacity);
+        if(base){
+            free(arena.base);
+            arena.base = base;
+            arena.capacity = capacity;
+        }
+    }
+    arena.peak = 0;
+}
+
+void frameArenaInit(size_t capacity){
+    for(Arena& arena : frameArenas){
+        if(!arenaInit(arena, capacity)) printf("Failed to allocate a %zu byte frame arena\n", capacity);
+    }
+    currentFrame = 0;
+}
+
+void frameArenaShutdown(){
+    for(Arena& arena : frameArenas) arenaDestroy(arena);
+}
+
+void frameArenaBegin(){
+    currentFrame ^= 1;
+    arenaReset(frameArenas[currentFrame]);
+}
+
+Arena& frameArena(){
+    return frameArenas[currentFrame];
+}
+
+ArenaScope::ArenaScope(Arena& arena) : arena(arena), mark(arenaMark(arena)), previous(currentScratch){
+    currentScratch = &arena;
+}
+
+ArenaScope::~ArenaScope(){
+    // The outermost scope gets to grow the block for next time
+    if(mark.used == 0 && mark.spills == 0) arenaReset(arena);
+    else                                   arenaRewind(arena, mark);
+    currentScratch = previous;
+}
+
+Arena& threadScratchArena(){
+    if(!threadArena.ready){
+        arenaInit(threadArena.arena, scratchCapacity, scratchMaxCapacity);
+        threadArena.ready = true;
+    }
+    return threadArena.arena;
+}
+
+void* scratchMalloc(size_t size){
+    return currentScratch ? arenaAlloc(*currentScratch, size) : malloc(size);
+}
+
+void* scratchRealloc(void* p, size_t oldSize, size_t newSize){
+    if(currentScratch && (!p || arenaOwns(*currentScratch, p))) return arenaRealloc(*currentScratch, p, oldSize, newSize);
+    return realloc(p, newSize);
+}
+
+void scratchFree(void* p){
+    if(!p) return;
+    if(currentScratch){
+        if(inBlock(*currentScratch, p)) return;
+        // Spills can go right away, the entry stays so marks still line up
+        if(Arena::Spill* s = findSpill(*currentScratch, p)){
+            free(s->p);
+            currentScratch->spilledBytes -= s->size;
+            s->p = nullptr;
+            s->size = 0;
+            return;
+        }
+    }
+    free(p);
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Bump allocators for CPU data that only lives a little while, so hot paths don't go to the heap.
+// An arena is one block handed out front to back and rewound all at once. Anything that doesn't fit gets
+// malloc'd on the side, and the next reset grows the block to the most that was ever asked for, so after
+// the first few rounds nothing spills any more.
+//
+// Two ways in:
+// - Frame arenas: two of them taking turns, frameAlloc memory stays good until the end of the next frame
+//   (so it can be handed to something that finishes a frame late). Main thread only.
+// - Scratch scopes: an ArenaScope makes an arena the place scratchMalloc on that thread allocates from,
+//   and rewinds it when it ends. stb_image and the decoders allocate through scratchMalloc, so a decode
+//   inside a scope reuses the same memory every time. Without a scope scratchMalloc is plain malloc.
+
+struct Arena {
+    unsigned char* base = nullptr;
+    size_t capacity = 0, used = 0;
+    // Most bytes wanted between resets, spills included
+    size_t peak = 0;
+    // Didn't fit in the block, freed on rewind or reset. Entries freed early are left as nullptr so marks stay put.
+    struct Spill {
+        void* p;
+        size_t size;
+    };
+    std::vector<Spill> spills;
+    size_t spilledBytes = 0;
+    // Past this reset stops growing the block and just keeps spilling, 0 for no limit
+    size_t maxCapacity = 0;
+};
+
+bool arenaInit(Arena& arena, size_t capacity, size_t maxCapacity = 0);
+void arenaDestroy(Arena& arena);
+// `align` has to be a power of two. nullptr only if the heap is out too.
+void* arenaAlloc(Arena& arena, size_t size, size_t align = alignof(std::max_align_t));
+// Grows in place when p was the last thing handed out, otherwise copies
+void* arenaRealloc(Arena& arena, void* p, size_t oldSize, size_t newSize);
+bool arenaOwns(const Arena& arena, const void* p);
+
+// Where to rewind to, spills included
+struct ArenaMark {
+    size_t used;
+    size_t spills;
+};
+ArenaMark arenaMark(const Arena& arena);
+void arenaRewind(Arena& arena, const ArenaMark& mark);
+// Rewind to empty, free the spills and grow to fit the peak
+void arenaReset(Arena& arena);
+
+template<typename T>
+T* arenaAllocArray(Arena& arena, size_t count){
+    return (T*)arenaAlloc(arena, count * sizeof(T), alignof(T) > alignof(std::max_align_t) ? alignof(T) : alignof(std::max_align_t));
+}
+
+// ---- Frame arenas ----
+
+void frameArenaInit(size_t capacity = 256 << 10);
+void frameArenaShutdown();
+// Call at the top of every frame, resets the arena from two frames ago and makes it current
+void frameArenaBegin();
+Arena& frameArena();
+
+template<typename T>
+T* frameAlloc(size_t count){
+    return arenaAllocArray<T>(frameArena(), count);
+}
+
+// ---- Scratch scopes ----
+
+// Until it goes out of scope, scratchMalloc on this thread comes out of `arena`. Scopes nest.
+// Everything allocated inside is gone afterwards, so scratch memory must not outlive the scope.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena);
+    ~ArenaScope();
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena& arena;
+    ArenaMark mark;
+    Arena* previous;
+};
+
+// This thread's scratch arena, made the first time it's asked for
+Arena& threadScratchArena();
+
+void* scratchMalloc(size_t size);
+void* scratchRealloc(void* p, size_t oldSize, size_t newSize);
+// Nothing for memory in the current scope's arena (it goes with the scope), free() for anything else
+void scratchFree(void* p);
@@ -0,0 +1,46 @@
+#include "computeComposite.h"
+
+#include <algorithm>
+
+namespace {
+    // Has to match local_size in composite.glsl
+    const int groupSize = 16;
+}
+
+bool computeCompositeInit(ComputeComposite& cc, const char* keywords){
+    if(!shaderComputeLoad(cc.shader, "assets/shaders/composite.glsl")) return false;
+    cc.program = shaderVariant(cc.shader, shaderKeywords(cc.shader, keywords));
+    if(!cc.program) return false;
+
+    cc.material1Loc = glGetUniformLocation(cc.program, "material1");
+    cc.material2Loc = glGetUniformLocation(cc.program, "material2");
+    cc.posRectLoc = glGetUniformLocation(cc.program, "posRect");
+    cc.uvRectLoc = glGetUniformLocation(cc.program, "uvRect");
+    cc.bgColorLoc = glGetUniformLocation(cc.program, "bgColor");
+    return true;
+}
+
+void computeCompositeDispatch(ComputeComposite& cc, GLuint target, int width, int height, const Vert& c0, const Vert& c1,
+                              uint32_t material1, uint32_t material2, const float clearColor[4]){
+    // Keep the rect's min corner first, the uvs follow whichever vert they came with
+    const Vert& lo = c0.pos[0] <= c1.pos[0] ? c0 : c1;
+    const Vert& hi = &lo == &c0 ? c1 : c0;
+    const bool flipY = lo.pos[1] > hi.pos[1];
+    glProgramUniform4f(cc.program, cc.posRectLoc, lo.pos[0], std::min(lo.pos[1], hi.pos[1]),
+                       hi.pos[0], std::max(lo.pos[1], hi.pos[1]));
+    glProgramUniform4f(cc.program, cc.uvRectLoc, lo.uv[0], flipY ? hi.uv[1] : lo.uv[1], hi.uv[0], flipY ? lo.uv[1] : hi.uv[1]);
+    glProgramUniform4fv(cc.program, cc.bgColorLoc, 1, clearColor);
+    glProgramUniform1ui(cc.program, cc.material1Loc, material1);
+    glProgramUniform1ui(cc.program, cc.material2Loc, material2);
+
+    glUseProgram(cc.program);
+    glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glDispatchCompute((width + groupSize - 1) / groupSize, (height + groupSize - 1) / groupSize, 1);
+    // Whoever reads the target next (a blit, a sampler) has to see the stores
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
+
+void computeCompositeFree(ComputeComposite& cc){
+    shaderProgramFree(cc.shader);
+    cc = ComputeComposite();
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+
+#include "glad/glad.h"
+#include "shaderVariants.h"
+#include "vert.h"
+
+// Draws the two material blend with a compute shader instead of rasterizing a quad: every 16x16 workgroup
+// stages the texels its tile needs in shared memory once and bilinear filters out of that, then imageStores
+// straight into the target. Only handles what the scene actually draws, one axis aligned quad.
+// Expects the same state the raster path does: texture pools and the draw constants buffer bound.
+
+struct ComputeComposite {
+    ShaderProgram shader;
+    GLuint program = 0;
+    GLint material1Loc = -1, material2Loc = -1;
+    GLint posRectLoc = -1, uvRectLoc = -1, bgColorLoc = -1;
+};
+
+// `keywords` from composite.glsl, e.g. "NO_TEXEL_CACHE"
+bool computeCompositeInit(ComputeComposite& cc, const char* keywords = "");
+// Fill all of `target` (RGBA32F, width x height): the quad spanning corners c0 and c1 and clearColor around it
+void computeCompositeDispatch(ComputeComposite& cc, GLuint target, int width, int height, const Vert& c0, const Vert& c1,
+                              uint32_t material1, uint32_t material2, const float clearColor[4]);
+void computeCompositeFree(ComputeComposite& cc);
@@ -0,0 +1,190 @@
+#include "cull.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+// vaddvq_u32 is AArch64 only
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CULL_NEON 1
+#endif
+
+#include "jobs.h"
+#include "profiler.h"
+
+namespace {
+    // Objects a job when going wide, a multiple of 8 so only the last chunk has a scalar tail
+    const size_t chunkObjects = 4096;
+
+    // Scalar version of the test, for tails and for boxes without SIMD
+    bool outside(const CullBounds& b, const Frustum& f, size_t i){
+        for(const float* p : f.planes){
+            const float dist = p[0] * b.centerX[i] + p[1] * b.centerY[i] + p[2] * b.centerZ[i] + p[3];
+            // How far the box reaches towards the plane
+            const float reach = std::fabs(p[0]) * b.extentX[i] + std::fabs(p[1]) * b.extentY[i] + std::fabs(p[2]) * b.extentZ[i] +
+                                b.radius[i];
+            if(dist + reach < 0) return true;
+        }
+        return false;
+    }
+
+    // Visible objects in [begin, end) go to `out`, which has room for all of them. Returns how many.
+    size_t cullRange(const CullBounds& b, const Frustum& f, size_t begin, size_t end, uint32_t* out){
+        size_t count = 0;
+        size_t i = begin;
+#if defined(__AVX2__)
+        __m256 n[6][3], d[6], a[6][3];
+        for(int p = 0; p < 6; p++){
+            for(int c = 0; c < 3; c++){
+                n[p][c] = _mm256_set1_ps(f.planes[p][c]);
+                a[p][c] = _mm256_set1_ps(std::fabs(f.planes[p][c]));
+            }
+            d[p] = _mm256_set1_ps(f.planes[p][3]);
+        }
+        const __m256 zero = _mm256_setzero_ps();
+        for(; i + 8 <= end; i += 8){
+            const __m256 cx = _mm256_loadu_ps(&b.centerX[i]), cy = _mm256_loadu_ps(&b.centerY[i]), cz = _mm256_loadu_ps(&b.centerZ[i]);
+            const __m256 ex = _mm256_loadu_ps(&b.extentX[i]), ey = _mm256_loadu_ps(&b.extentY[i]), ez = _mm256_loadu_ps(&b.extentZ[i]);
+            const __m256 r = _mm256_loadu_ps(&b.radius[i]);
+            __m256 culled = zero;
+            for(int p = 0; p < 6; p++){
+                __m256 dist = _mm256_add_ps(_mm256_mul_ps(n[p][0], cx), d[p]);
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(n[p][1], cy));
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(n[p][2], cz));
+                __m256 reach = _mm256_add_ps(_mm256_mul_ps(a[p][0], ex), r);
+                reach = _mm256_add_ps(reach, _mm256_mul_ps(a[p][1], ey));
+                reach = _mm256_add_ps(reach, _mm256_mul_ps(a[p][2], ez));
+                culled = _mm256_or_ps(culled, _mm256_cmp_ps(_mm256_add_ps(dist, reach), zero, _CMP_LT_OQ));
+            }
+            // Compact: one index out per set bit
+            unsigned visible = ~(unsigned)_mm256_movemask_ps(culled) & 0xff;
+            while(visible){
+                out[count++] = (uint32_t)(i + __builtin_ctz(visible));
+                visible &= visible - 1;
+            }
+        }
+#elif defined(CULL_NEON)
+        float32x4_t n[6][3], d[6], a[6][3];
+        for(int p = 0; p < 6; p++){
+            for(int c = 0; c < 3; c++){
+                n[p][c] = vdupq_n_f32(f.planes[p][c]);
+                a[p][c] = vdupq_n_f32(std::fabs(f.planes[p][c]));
+            }
+            d[p] = vdupq_n_f32(f.planes[p][3]);
+        }
+        const uint32_t laneBits[4] = {1, 2, 4, 8};
+        const uint32x4_t bits = vld1q_u32(laneBits);
+        const float32x4_t zero = vdupq_n_f32(0);
+        for(; i + 4 <= end; i += 4){
+            const float32x4_t cx = vld1q_f32(&b.centerX[i]), cy = vld1q_f32(&b.centerY[i]), cz = vld1q_f32(&b.centerZ[i]);
+            const float32x4_t ex = vld1q_f32(&b.extentX[i]), ey = vld1q_f32(&b.extentY[i]), ez = vld1q_f32(&b.extentZ[i]);
+            const float32x4_t r = vld1q_f32(&b.radius[i]);
+            uint32x4_t culled = vdupq_n_u32(0);
+            for(int p = 0; p < 6; p++){
+                float32x4_t dist = vmlaq_f32(d[p], n[p][0], cx);
+                dist = vmlaq_f32(dist, n[p][1], cy);
+                dist = vmlaq_f32(dist, n[p][2], cz);
+                float32x4_t reach = vmlaq_f32(r, a[p][0], ex);
+                reach = vmlaq_f32(reach, a[p][1], ey);
+                reach = vmlaq_f32(reach, a[p][2], ez);
+                culled = vorrq_u32(culled, vcltq_f32(vaddq_f32(dist, reach), zero));
+            }
+            unsigned visible = ~vaddvq_u32(vandq_u32(culled, bits)) & 0xf;
+            while(visible){
+                out[count++] = (uint32_t)(i + __builtin_ctz(visible));
+                visible &= visible - 1;
+            }
+        }
+#endif
+        for(; i < end; i++){
+            if(!outside(b, f, i)) out[count++] = (uint32_t)i;
+        }
+        return count;
+    }
+
+    void setPlane(float* plane, float x, float y, float z, float w){
+        // Normalized so distances come out in world units, which is what the extents and radius are in
+        const float len = std::sqrt(x * x + y * y + z * z);
+        const float scale = len > 0 ? 1.0f / len : 1.0f;
+        plane[0] = x * scale;
+        plane[1] = y * scale;
+        plane[2] = z * scale;
+        plane[3] = w * scale;
+    }
+}
+
+uint32_t cullAdd(CullBounds& bounds, const float center[3], const float extent[3], float radius){
+    const uint32_t index = (uint32_t)cullCount(bounds);
+    bounds.centerX.push_back(0);
+    bounds.centerY.push_back(0);
+    bounds.centerZ.push_back(0);
+    bounds.extentX.push_back(0);
+    bounds.extentY.push_back(0);
+    bounds.extentZ.push_back(0);
+    bounds.radius.push_back(0);
+    cullSet(bounds, index, center, extent, radius);
+    return index;
+}
+
+void cullSet(CullBounds& bounds, uint32_t index, const float center[3], const float extent[3], float radius){
+    bounds.centerX[index] = center[0];
+    bounds.centerY[index] = center[1];
+    bounds.centerZ[index] = center[2];
+    bounds.extentX[index] = extent[0];
+    bounds.extentY[index] = extent[1];
+    bounds.extentZ[index] = extent[2];
+    bounds.radius[index] = radius;
+}
+
+void cullClear(CullBounds& bounds){
+    bounds.centerX.clear();
+    bounds.centerY.clear();
+    bounds.centerZ.clear();
+    bounds.extentX.clear();
+    bounds.extentY.clear();
+    bounds.extentZ.clear();
+    bounds.radius.clear();
+}
+
+void frustumFromMatrix(Frustum& frustum, const float viewProj[16]){
+    // Rows of the column major matrix, each plane is row 3 plus or minus one of the others (Gribb & Hartmann)
+    float row[4][4];
+    for(int r = 0; r < 4; r++){
+        for(int c = 0; c < 4; c++) row[r][c] = viewProj[c * 4 + r];
+    }
+    for(int axis = 0; axis < 3; axis++){
+        for(int side = 0; side < 2; side++){
+            const float sign = side ? -1.0f : 1.0f;
+            setPlane(frustum.planes[axis * 2 + side], row[3][0] + sign * row[axis][0], row[3][1] + sign * row[axis][1],
+                     row[3][2] + sign * row[axis][2], row[3][3] + sign * row[axis][3]);
+        }
+    }
+}
+
+size_t cullFrustum(const CullBounds& bounds, const Frustum& frustum, std::vector<uint32_t>& visible){
+    PROFILE_ZONE("cull");
+    const size_t count = cullCount(bounds);
+    visible.resize(count);
+    if(count < cullParallelMin){
+        visible.resize(cullRange(bounds, frustum, 0, count, visible.data()));
+        return visible.size();
+    }
+
+    // Every chunk compacts into its own stretch of `visible`, then the stretches get slid down together
+    const size_t chunks = (count + chunkObjects - 1) / chunkObjects;
+    std::vector<size_t> found(chunks);
+    parallelFor(chunks, [&](size_t c){
+        const size_t begin = c * chunkObjects;
+        found[c] = cullRange(bounds, frustum, begin, std::min(count, begin + chunkObjects), visible.data() + begin);
+    });
+    size_t total = found[0];
+    for(size_t c = 1; c < chunks; c++){
+        std::copy(visible.begin() + c * chunkObjects, visible.begin() + c * chunkObjects + found[c], visible.begin() + total);
+        total += found[c];
+    }
+    visible.resize(total);
+    return total;
+}
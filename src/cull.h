@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Frustum culling of many objects at once.
+// Bounds are kept one array per component (SoA) so the kernel loads a component of 8 objects in one go, AVX2
+// does 8 objects an iteration and NEON two lots of 4. Each object is an AABB grown by a sphere radius: give
+// extents and radius 0 for a box, extents 0 and a radius for a sphere.
+// An object is culled when it's entirely behind one of the six planes. That's conservative, a box that
+// straddles a frustum corner can pass without touching it.
+
+struct CullBounds {
+    std::vector<float> centerX, centerY, centerZ;
+    // Half sizes of the box
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> radius;
+};
+
+// Planes as (nx, ny, nz, d), a point p is inside all of them when dot(n, p) + d >= 0
+struct Frustum {
+    float planes[6][4];
+};
+
+// Past this many objects cullFrustum splits the work over the job workers
+const size_t cullParallelMin = 1 << 14;
+
+// Index of the new object
+uint32_t cullAdd(CullBounds& bounds, const float center[3], const float extent[3], float radius = 0);
+void cullSet(CullBounds& bounds, uint32_t index, const float center[3], const float extent[3], float radius = 0);
+inline size_t cullCount(const CullBounds& bounds){
+    return bounds.centerX.size();
+}
+void cullClear(CullBounds& bounds);
+
+// Pull the planes out of a column major view-projection matrix (GL clip space, z in [-w, w]).
+// The identity gives the clip space cube itself.
+void frustumFromMatrix(Frustum& frustum, const float viewProj[16]);
+
+// Indices of the objects that aren't culled, ascending. `visible` is overwritten and only grows,
+// so a vector kept across frames stops allocating once it's big enough.
+size_t cullFrustum(const CullBounds& bounds, const Frustum& frustum, std::vector<uint32_t>& visible);
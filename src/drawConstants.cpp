@@ -0,0 +1,21 @@
+#include "drawConstants.h"
+
+#include <cmath>
+
+DrawConstants drawConstantsAt(float time){
+    const float pi = 3.1415926535f;
+    DrawConstants c = {};
+    c.blend[0] = (std::sin(time) + 1) / 2.0f;
+    c.blend[1] = (std::sin(time + pi) + 1) / 2.0f;
+    return c;
+}
+
+GpuBuffer drawConstantsCreate(){
+    GpuBuffer buffer = gpuBufferCreate({sizeof(DrawConstants), GL_DYNAMIC_STORAGE_BIT}, gpuBuffers, "draw constants");
+    glBindBufferBase(GL_UNIFORM_BUFFER, drawConstantsBinding, buffer.id());
+    return buffer;
+}
+
+void drawConstantsUpload(const GpuBuffer& buffer, const DrawConstants& constants){
+    glNamedBufferSubData(buffer.id(), 0, sizeof(constants), &constants);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "gpuResources.h"
+
+// Values frag.glsl needs that only depend on uniforms, worked out once per draw on the CPU instead of once per
+// pixel on the GPU. drawConstantsAt is the single definition of them, the software rasterizer calls it too.
+
+// Uniform block binding the DrawConstants block in frag.glsl uses
+const GLuint drawConstantsBinding = 0;
+
+// Mirrors the DrawConstants block in frag.glsl (std140)
+struct DrawConstants {
+    // How much of material1 and material2 end up in the blend
+    float blend[2];
+    float pad[2];
+};
+
+DrawConstants drawConstantsAt(float time);
+
+// A uniform buffer big enough for one DrawConstants, bound to drawConstantsBinding
+GpuBuffer drawConstantsCreate();
+void drawConstantsUpload(const GpuBuffer& buffer, const DrawConstants& constants);
@@ -0,0 +1,78 @@
+#include "fileUtil.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Temp files get renamed as soon as they're written, one this old was left by a writer that died
+    const time_t staleTempSeconds = 60 * 60;
+
+    std::atomic<unsigned long long> tempCounter{0};
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t h){
+    const uint64_t prime = 0x100000001b3ull;
+    const uint8_t* p = (const uint8_t*)data;
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8){
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h = (h ^ word) * prime;
+        h ^= h >> 29;
+    }
+    for(; i < size; i++) h = (h ^ p[i]) * prime;
+    return h;
+}
+
+bool makeDirs(const std::string& path){
+    for(size_t i = 1; i <= path.size(); i++){
+        if(i == path.size() || path[i] == '/'){
+            std::string part = path.substr(0, i);
+            if(mkdir(part.c_str(), 0755) && errno != EEXIST) return false;
+        }
+    }
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool writeFileAtomic(const std::string& path, const void* data, size_t size){
+    const std::string tmp = path + ".tmp" + std::to_string(getpid()) + "." + std::to_string(tempCounter++);
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if(fd < 0) return false;
+
+    const uint8_t* p = (const uint8_t*)data;
+    bool ok = true;
+    for(size_t done = 0; ok && done < size;){
+        const ssize_t n = write(fd, p + done, size - done);
+        if(n < 0 && errno == EINTR) continue;
+        ok = n > 0;
+        if(ok) done += n;
+    }
+    ok = close(fd) == 0 && ok;
+    if(!ok || rename(tmp.c_str(), path.c_str())){
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool staleTempFile(const char* name, time_t modified){
+    const char* tmp = strstr(name, ".tmp");
+    if(!tmp) return false;
+    char* end;
+    const long pid = strtol(tmp + 4, &end, 10);
+    if(end == tmp + 4 || pid <= 0) return false;
+    // Older builds left off the counter
+    if(*end == '.') strtoull(end + 1, &end, 10);
+    if(*end) return false;
+    // Ours are still being written, and so are those of anyone else who's alive
+    if(pid == getpid()) return false;
+    return (kill((pid_t)pid, 0) && errno == ESRCH) || time(nullptr) - modified > staleTempSeconds;
+}
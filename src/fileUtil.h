@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+// File handling the on-disk caches (textures, shaders, meshes) and the frame capture all need
+
+const uint64_t hashSeed = 0xcbf29ce484222325ull;
+// FNV-1a over 8 byte words with a bit of extra mixing, good enough to tell files apart.
+// Chain calls by passing the last result back in as `h`.
+uint64_t hashBytes(const void* data, size_t size, uint64_t h = hashSeed);
+
+// mkdir -p, true if `path` is a directory afterwards
+bool makeDirs(const std::string& path);
+
+// Write to "<path>.tmp<pid>.<n>" then rename over `path`, so nobody ever reads half a file.
+// The temp name is unique per call, two threads storing the same path just race on the rename.
+bool writeFileAtomic(const std::string& path, const void* data, size_t size);
+// A temp file from writeFileAtomic whose writer died before renaming it (or one so old it must have).
+// Nothing else would ever clean those up.
+bool staleTempFile(const char* name, time_t modified);
@@ -0,0 +1,122 @@
+#include "frameCapture.h"
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "pixelFormat.h"
+#include "pngWrite.h"
+#include "profiler.h"
+
+namespace {
+    const GLbitfield packMapFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    size_t packBytes(const FrameCapture& capture){
+        return (size_t)capture.width * capture.height * 4 * sizeof(float);
+    }
+
+    // Runs on a worker, the slot's pixels stay put until `encoded` is set
+    void encodeSlot(FrameCapture& capture, CaptureSlot& slot){
+        PROFILE_ZONE("encode capture");
+        ArenaScope scratch(threadScratchArena());
+        const int width = capture.width, height = capture.height;
+        uint8_t* rgba = (uint8_t*)scratchMalloc((size_t)width * height * 4);
+        if(rgba){
+            // GL rows go bottom up, PNG rows top down
+            for(int y = 0; y < height; y++){
+                convertPixels<RGBA32F, RGBA8>(slot.pixels + (size_t)(height - 1 - y) * width * 4, rgba + (size_t)y * width * 4, width);
+            }
+        }
+        // Out of memory just loses this frame, the slot still gets handed back
+        if(rgba && pngWrite(slot.fileName.c_str(), rgba, width, height, 4)) capture.written++;
+        else printf("Failed to write capture \'%s\'\n", slot.fileName.c_str());
+
+        slot.encoded.store(true, std::memory_order_release);
+    }
+
+    void startEncode(FrameCapture& capture, CaptureSlot& slot){
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        slot.state = CaptureSlot::slotEncoding;
+        slot.encoded.store(false, std::memory_order_relaxed);
+        jobsSubmit(capture.jobs, [&capture, &slot]{ encodeSlot(capture, slot); });
+    }
+}
+
+void frameCaptureInit(FrameCapture& capture, int width, int height){
+    capture.width = width;
+    capture.height = height;
+}
+
+bool frameCaptureGrab(FrameCapture& capture, GLuint tex, const char* fileName){
+    if(!capture.mapped){
+        // Made on the first grab so runs that never capture don't carry them around
+        for(CaptureSlot& slot : capture.slots){
+            slot.pack = gpuBufferCreate({packBytes(capture), packMapFlags}, gpuStreaming, "capture");
+            slot.pixels = (const float*)glMapNamedBufferRange(slot.pack.id(), 0, packBytes(capture), packMapFlags);
+            if(!slot.pixels) printf("Failed to map a capture buffer\n");
+        }
+        capture.mapped = true;
+    }
+    // Anything that finished since the last poll can make room
+    frameCapturePoll(capture);
+
+    CaptureSlot* slot = nullptr;
+    for(CaptureSlot& s : capture.slots){
+        if(s.pixels && s.state == CaptureSlot::slotFree){
+            slot = &s;
+            break;
+        }
+    }
+    if(!slot){
+        capture.dropped++;
+        return false;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pack.id());
+    // With a pack buffer bound the last argument is an offset into it, the copy happens on the GPU's time
+    glGetTextureImage(tex, 0, GL_RGBA, GL_FLOAT, packBytes(capture), nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Make sure the fence actually gets to the GPU, otherwise polling it could wait forever
+    glFlush();
+
+    slot->fileName = fileName;
+    slot->state = CaptureSlot::slotReading;
+    capture.grabbed++;
+    return true;
+}
+
+void frameCapturePoll(FrameCapture& capture){
+    for(CaptureSlot& slot : capture.slots){
+        if(slot.state == CaptureSlot::slotReading){
+            // 0 timeout, just asks
+            const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+            if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) startEncode(capture, slot);
+        } else if(slot.state == CaptureSlot::slotEncoding && slot.encoded.load(std::memory_order_acquire)){
+            slot.state = CaptureSlot::slotFree;
+        }
+    }
+}
+
+void frameCaptureClose(FrameCapture& capture){
+    for(CaptureSlot& slot : capture.slots){
+        if(slot.state != CaptureSlot::slotReading) continue;
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~(GLuint64)0);
+        startEncode(capture, slot);
+    }
+    jobsWait(capture.jobs);
+
+    for(CaptureSlot& slot : capture.slots){
+        // Unmapped first, a recycled buffer can't be mapped twice
+        if(slot.pixels) glUnmapNamedBuffer(slot.pack.id());
+        slot.pixels = nullptr;
+        slot.state = CaptureSlot::slotFree;
+        slot.pack.reset();
+    }
+    capture.mapped = false;
+
+    if(capture.grabbed || capture.dropped){
+        printf("Capture: %llu frames written, %llu dropped\n", (unsigned long long)capture.written.load(),
+               (unsigned long long)capture.dropped);
+    }
+}
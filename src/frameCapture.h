@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "glad/glad.h"
+#include "gpuResources.h"
+#include "jobs.h"
+
+// Saves render targets to PNG without waiting on the GPU.
+// A grab copies the texture into one of a ring of pixel pack buffers and drops a fence behind it. A few frames
+// later, once the fence has passed, the buffer (mapped the whole time) goes to a worker that converts it to
+// 8-bit, flips it top down and encodes the PNG. When every slot is still busy the grab is skipped and counted
+// as dropped instead of stalling the frame.
+
+const int captureSlots = 4;
+
+struct CaptureSlot {
+    enum State {
+        slotFree,
+        // The copy is queued behind `fence`
+        slotReading,
+        // A worker has the pixels, it sets `encoded` when it's done with them
+        slotEncoding,
+    };
+
+    GpuBuffer pack;
+    // Persistently mapped RGBA32F copy of the texture
+    const float* pixels = nullptr;
+    GLsync fence = nullptr;
+    State state = slotFree;
+    std::atomic<bool> encoded{false};
+    std::string fileName;
+};
+
+struct FrameCapture {
+    int width = 0, height = 0;
+    // The buffers exist and are mapped
+    bool mapped = false;
+    CaptureSlot slots[captureSlots];
+    JobGroup jobs;
+
+    uint64_t grabbed = 0;
+    uint64_t dropped = 0;
+    std::atomic<uint64_t> written{0};
+};
+
+// For a width x height RGBA32F texture, the buffers wait for the first grab
+void frameCaptureInit(FrameCapture& capture, int width, int height);
+// Queue a copy of level 0 of `tex` that ends up in `fileName`. False if it was dropped.
+bool frameCaptureGrab(FrameCapture& capture, GLuint tex, const char* fileName);
+// Hand finished copies to the workers and take back slots they're done with, call once a frame
+void frameCapturePoll(FrameCapture& capture);
+// Waits for everything grabbed so far to be written, then frees the buffers
+void frameCaptureClose(FrameCapture& capture);
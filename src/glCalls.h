@@ -0,0 +1,139 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "glad/glad.h"
+
+// The GL entry points this project calls, for the layers that sit on glad's function pointers
+// (glCapture, glStats). A GL call missing from here goes straight to the driver and none of them see
+// it, so new ones get added here.
+// SIMPLE calls take only plain values. glCapture records and replays them generically, and each argument is
+// tagged with the kind of GL name it is (N plain value, T texture, B buffer, F framebuffer, P program,
+// S shader, V vertex array). CUSTOM ones take pointers or hand back names and need code of their own in
+// whatever hooks them.
+#define GL_CALLS(SIMPLE, CUSTOM) \
+    SIMPLE(AttachShader, P, S) \
+    SIMPLE(BindBuffer, N, B) \
+    SIMPLE(BindBufferBase, N, N, B) \
+    SIMPLE(BindBufferRange, N, N, B, N, N) \
+    SIMPLE(BindFramebuffer, N, F) \
+    SIMPLE(BindImageTexture, N, T, N, N, N, N, N) \
+    SIMPLE(BindTexture, N, T) \
+    SIMPLE(BindTextureUnit, N, T) \
+    SIMPLE(BindVertexArray, V) \
+    SIMPLE(BlitNamedFramebuffer, F, F, N, N, N, N, N, N, N, N, N, N) \
+    SIMPLE(CheckNamedFramebufferStatus, F, N) \
+    SIMPLE(Clear, N) \
+    SIMPLE(ClearColor, N, N, N, N) \
+    SIMPLE(CompileShader, S) \
+    SIMPLE(CopyImageSubData, T, N, N, N, N, N, T, N, N, N, N, N, N, N, N) \
+    SIMPLE(DeleteProgram, P) \
+    SIMPLE(DeleteShader, S) \
+    SIMPLE(DispatchCompute, N, N, N) \
+    SIMPLE(DrawArrays, N, N, N) \
+    SIMPLE(DrawArraysInstancedBaseInstance, N, N, N, N, N) \
+    SIMPLE(EnableVertexArrayAttrib, V, N) \
+    SIMPLE(Finish) \
+    SIMPLE(Flush) \
+    SIMPLE(GetString, N) \
+    SIMPLE(LinkProgram, P) \
+    SIMPLE(MapNamedBufferRange, B, N, N, N) \
+    SIMPLE(MemoryBarrier, N) \
+    SIMPLE(NamedFramebufferDrawBuffer, F, N) \
+    SIMPLE(NamedFramebufferTexture, F, N, T, N) \
+    SIMPLE(ProgramParameteri, P, N, N) \
+    SIMPLE(ProgramUniform1f, P, N, N) \
+    SIMPLE(ProgramUniform1i, P, N, N) \
+    SIMPLE(ProgramUniform1ui, P, N, N) \
+    SIMPLE(ProgramUniform2i, P, N, N, N) \
+    SIMPLE(ProgramUniform4f, P, N, N, N, N, N) \
+    SIMPLE(TextureParameteri, T, N, N) \
+    SIMPLE(TextureStorage2D, T, N, N, N, N) \
+    SIMPLE(TextureStorage3D, T, N, N, N, N, N) \
+    SIMPLE(Uniform4f, N, N, N, N, N) \
+    SIMPLE(UnmapNamedBuffer, B) \
+    SIMPLE(UseProgram, P) \
+    SIMPLE(VertexArrayAttribBinding, V, N, N) \
+    SIMPLE(VertexArrayAttribFormat, V, N, N, N, N, N) \
+    SIMPLE(VertexArrayElementBuffer, V, B) \
+    SIMPLE(VertexArrayVertexBuffer, V, N, B, N, N) \
+    SIMPLE(Viewport, N, N, N, N) \
+    CUSTOM(ClearNamedFramebufferfv) \
+    CUSTOM(ClientWaitSync) \
+    CUSTOM(CreateBuffers) \
+    CUSTOM(CreateFramebuffers) \
+    CUSTOM(CreateProgram) \
+    CUSTOM(CreateShader) \
+    CUSTOM(CreateTextures) \
+    CUSTOM(CreateVertexArrays) \
+    CUSTOM(DeleteBuffers) \
+    CUSTOM(DeleteFramebuffers) \
+    CUSTOM(DeleteSync) \
+    CUSTOM(DeleteTextures) \
+    CUSTOM(DeleteVertexArrays) \
+    CUSTOM(DrawElements) \
+    CUSTOM(DrawElementsInstancedBaseInstance) \
+    CUSTOM(FenceSync) \
+    CUSTOM(GetIntegerv) \
+    CUSTOM(GetProgramBinary) \
+    CUSTOM(GetProgramInfoLog) \
+    CUSTOM(GetProgramiv) \
+    CUSTOM(GetShaderInfoLog) \
+    CUSTOM(GetShaderiv) \
+    CUSTOM(GetTextureImage) \
+    CUSTOM(GetUniformLocation) \
+    CUSTOM(NamedBufferStorage) \
+    CUSTOM(NamedBufferSubData) \
+    CUSTOM(ObjectLabel) \
+    CUSTOM(PixelStorei) \
+    CUSTOM(ProgramBinary) \
+    CUSTOM(ProgramUniform4fv) \
+    CUSTOM(ShaderSource) \
+    CUSTOM(TextureSubImage2D) \
+    CUSTOM(TextureSubImage3D)
+
+enum GlCall : uint16_t {
+#define GL_CALL_ID(name, ...) glCall##name,
+    GL_CALLS(GL_CALL_ID, GL_CALL_ID)
+#undef GL_CALL_ID
+    glCallCount
+};
+
+inline const char* glCallName(GlCall call){
+#define GL_CALL_NAME(name, ...) "gl" #name,
+    static const char* const names[glCallCount] = {GL_CALLS(GL_CALL_NAME, GL_CALL_NAME)};
+#undef GL_CALL_NAME
+    return call < glCallCount ? names[call] : "?";
+}
+
+// Bytes per pixel of client side pixel data
+inline size_t glPixelBytes(GLenum format, GLenum type){
+    switch(type){
+        // Packed, the whole pixel in one
+        case GL_UNSIGNED_INT_8_8_8_8:
+        case GL_UNSIGNED_INT_8_8_8_8_REV:
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_24_8:          return 4;
+    }
+    size_t components = 4;
+    switch(format){
+        case GL_RED:
+        case GL_RED_INTEGER:
+        case GL_DEPTH_COMPONENT:
+        case GL_STENCIL_INDEX:  components = 1; break;
+        case GL_RG:
+        case GL_RG_INTEGER:     components = 2; break;
+        case GL_RGB:
+        case GL_BGR:
+        case GL_RGB_INTEGER:
+        case GL_BGR_INTEGER:    components = 3; break;
+    }
+    switch(type){
+        case GL_UNSIGNED_BYTE:
+        case GL_BYTE:           return components;
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT:
+        case GL_HALF_FLOAT:     return components * 2;
+    }
+    return components * 4;
+}
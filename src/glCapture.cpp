@@ -0,0 +1,975 @@
+#include "glCapture.h"
+
+#include <stdio.h>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "glCalls.h"
+
+namespace {
+    // What kind of GL name each argument is, for the table below:
+    // N plain value, T texture, B buffer, F framebuffer, P program, S shader, V vertex array
+    const GlNameSpace N = glNoName, T = glTextureName, B = glBufferName, F = glFramebufferName;
+    const GlNameSpace P = glProgramName, S = glShaderName, V = glVertexArrayName;
+}
+
+namespace {
+    // Stream markers, past anything GlCall will ever get to
+    const uint16_t streamFrameEnd = 0xfffe;
+    const uint16_t streamEnd = 0xffff;
+
+    template<typename Fn> struct Arity;
+    template<typename R, typename... A> struct Arity<R (*)(A...)> {
+        static const size_t value = sizeof...(A);
+    };
+
+#define CHECK_TAGS(name, ...) static_assert(std::initializer_list<GlNameSpace>{__VA_ARGS__}.size() == Arity<decltype(glad_gl##name)>::value, \
+                                            "gl" #name " needs a tag for each of its arguments");
+#define NO_CHECK(name)
+    GL_CALLS(CHECK_TAGS, NO_CHECK)
+#undef CHECK_TAGS
+#undef NO_CHECK
+
+    const char magic[4] = {'G', 'L', 'C', 'P'};
+    const uint32_t formatVersion = 5;
+    // magic, version, frames, width, height
+    const size_t headerBytes = 20;
+    // Calls pile up in memory and go to the file in chunks this big
+    const size_t flushBytes = 4 << 20;
+
+    // ---- Recording ----
+
+    struct Capture {
+        FILE* file = nullptr;
+        std::string fileName;
+        std::vector<uint8_t> buffer;
+        int framesLeft = 0;
+        uint32_t frames = 0;
+        uint64_t calls = 0;
+        uint64_t bytes = 0;
+        // The driver's entry points, and where glad keeps them so they can be put back
+        void* real[glCallCount] = {};
+        void** slot[glCallCount] = {};
+        // Unpack state, to work out how much memory a texture upload reads
+        GLint unpackAlignment = 4, unpackRowLength = 0, unpackImageHeight = 0;
+        GLint unpackSkipPixels = 0, unpackSkipRows = 0, unpackSkipImages = 0;
+    };
+    Capture capture;
+
+#define REAL(name) ((decltype(glad_gl##name))capture.real[glCall##name])
+
+    template<typename V>
+    void put(V v){
+        static_assert(std::is_arithmetic<V>::value, "pointers need a custom recorder");
+        const uint8_t* p = (const uint8_t*)&v;
+        capture.buffer.insert(capture.buffer.end(), p, p + sizeof(V));
+    }
+
+    void putBlob(const void* data, size_t size){
+        put<uint64_t>(size);
+        const uint8_t* p = (const uint8_t*)data;
+        if(size) capture.buffer.insert(capture.buffer.end(), p, p + size);
+    }
+
+    // The terminator goes in too so replay can hand the stream straight to GL
+    void putString(const char* s){
+        putBlob(s, strlen(s) + 1);
+    }
+
+    void putSync(GLsync sync){
+        put<uint64_t>((uint64_t)(uintptr_t)sync);
+    }
+
+    void flushBuffer(){
+        if(capture.buffer.empty()) return;
+        fwrite(capture.buffer.data(), 1, capture.buffer.size(), capture.file);
+        capture.bytes += capture.buffer.size();
+        capture.buffer.clear();
+    }
+
+    void beginCall(GlCall id){
+        put<uint16_t>(id);
+        capture.calls++;
+    }
+
+    void endCall(){
+        if(capture.buffer.size() >= flushBytes) flushBuffer();
+    }
+
+    template<GlCall Id, typename Fn> struct Simple;
+    template<GlCall Id, typename R, typename... A>
+    struct Simple<Id, R (*)(A...)> {
+        static R APIENTRY record(A... args){
+            beginCall(Id);
+            (put(args), ...);
+            endCall();
+            return ((R (*)(A...))capture.real[Id])(args...);
+        }
+    };
+
+    // Bytes an upload reads starting at its pointer, skips and row padding from glPixelStorei included
+    size_t uploadBytes(int width, int height, int depth, GLenum format, GLenum type){
+        if(width <= 0 || height <= 0 || depth <= 0) return 0;
+        const size_t pixel = glPixelBytes(format, type);
+        const size_t rowPixels = capture.unpackRowLength ? capture.unpackRowLength : width;
+        const size_t align = capture.unpackAlignment;
+        const size_t row = (rowPixels * pixel + align - 1) / align * align;
+        const size_t image = row * (capture.unpackImageHeight ? capture.unpackImageHeight : height);
+        return (capture.unpackSkipImages + depth - 1) * image + (capture.unpackSkipRows + height - 1) * row +
+               (capture.unpackSkipPixels + width) * pixel;
+    }
+
+    // Upload sources: 0 nothing, 1 the bytes themselves, 2 an offset into the bound unpack buffer
+    void putPixels(const void* pixels, size_t size){
+        GLint unpackBuffer = 0;
+        REAL(GetIntegerv)(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+        if(unpackBuffer){
+            put<uint8_t>(2);
+            put<uint64_t>((uintptr_t)pixels);
+        } else if(pixels){
+            put<uint8_t>(1);
+            putBlob(pixels, size);
+        } else {
+            put<uint8_t>(0);
+        }
+    }
+
+    void APIENTRY recordClearNamedFramebufferfv(GLuint framebuffer, GLenum buffer, GLint drawbuffer, const GLfloat* value){
+        beginCall(glCallClearNamedFramebufferfv);
+        put(framebuffer);
+        put(buffer);
+        put(drawbuffer);
+        for(int i = 0; i < (buffer == GL_COLOR ? 4 : 1); i++) put(value[i]);
+        endCall();
+        REAL(ClearNamedFramebufferfv)(framebuffer, buffer, drawbuffer, value);
+    }
+
+    GLenum APIENTRY recordClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout){
+        beginCall(glCallClientWaitSync);
+        putSync(sync);
+        put(flags);
+        put(timeout);
+        endCall();
+        return REAL(ClientWaitSync)(sync, flags, timeout);
+    }
+
+    // Names the driver handed out, so replay can line its own up with them
+    void putNames(GLsizei n, const GLuint* names){
+        put(n);
+        for(GLsizei i = 0; i < n; i++) put(names[i]);
+    }
+
+    void APIENTRY recordCreateBuffers(GLsizei n, GLuint* buffers){
+        REAL(CreateBuffers)(n, buffers);
+        beginCall(glCallCreateBuffers);
+        putNames(n, buffers);
+        endCall();
+    }
+
+    void APIENTRY recordCreateFramebuffers(GLsizei n, GLuint* framebuffers){
+        REAL(CreateFramebuffers)(n, framebuffers);
+        beginCall(glCallCreateFramebuffers);
+        putNames(n, framebuffers);
+        endCall();
+    }
+
+    GLuint APIENTRY recordCreateProgram(){
+        const GLuint program = REAL(CreateProgram)();
+        beginCall(glCallCreateProgram);
+        put(program);
+        endCall();
+        return program;
+    }
+
+    GLuint APIENTRY recordCreateShader(GLenum type){
+        const GLuint shader = REAL(CreateShader)(type);
+        beginCall(glCallCreateShader);
+        put(type);
+        put(shader);
+        endCall();
+        return shader;
+    }
+
+    void APIENTRY recordCreateTextures(GLenum target, GLsizei n, GLuint* textures){
+        REAL(CreateTextures)(target, n, textures);
+        beginCall(glCallCreateTextures);
+        put(target);
+        putNames(n, textures);
+        endCall();
+    }
+
+    void APIENTRY recordCreateVertexArrays(GLsizei n, GLuint* arrays){
+        REAL(CreateVertexArrays)(n, arrays);
+        beginCall(glCallCreateVertexArrays);
+        putNames(n, arrays);
+        endCall();
+    }
+
+    void APIENTRY recordDeleteBuffers(GLsizei n, const GLuint* buffers){
+        beginCall(glCallDeleteBuffers);
+        putNames(n, buffers);
+        endCall();
+        REAL(DeleteBuffers)(n, buffers);
+    }
+
+    void APIENTRY recordDeleteFramebuffers(GLsizei n, const GLuint* framebuffers){
+        beginCall(glCallDeleteFramebuffers);
+        putNames(n, framebuffers);
+        endCall();
+        REAL(DeleteFramebuffers)(n, framebuffers);
+    }
+
+    void APIENTRY recordDeleteSync(GLsync sync){
+        beginCall(glCallDeleteSync);
+        putSync(sync);
+        endCall();
+        REAL(DeleteSync)(sync);
+    }
+
+    void APIENTRY recordDeleteTextures(GLsizei n, const GLuint* textures){
+        beginCall(glCallDeleteTextures);
+        putNames(n, textures);
+        endCall();
+        REAL(DeleteTextures)(n, textures);
+    }
+
+    void APIENTRY recordDeleteVertexArrays(GLsizei n, const GLuint* arrays){
+        beginCall(glCallDeleteVertexArrays);
+        putNames(n, arrays);
+        endCall();
+        REAL(DeleteVertexArrays)(n, arrays);
+    }
+
+    // Indices always come out of the VAO's element buffer here, so the pointer is an offset into it
+    void APIENTRY recordDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices){
+        beginCall(glCallDrawElements);
+        put(mode);
+        put(count);
+        put(type);
+        put<uint64_t>((uintptr_t)indices);
+        endCall();
+        REAL(DrawElements)(mode, count, type, indices);
+    }
+
+    void APIENTRY recordDrawElementsInstancedBaseInstance(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances,
+                                                          GLuint baseInstance){
+        beginCall(glCallDrawElementsInstancedBaseInstance);
+        put(mode);
+        put(count);
+        put(type);
+        put<uint64_t>((uintptr_t)indices);
+        put(instances);
+        put(baseInstance);
+        endCall();
+        REAL(DrawElementsInstancedBaseInstance)(mode, count, type, indices, instances, baseInstance);
+    }
+
+    GLsync APIENTRY recordFenceSync(GLenum condition, GLbitfield flags){
+        GLsync sync = REAL(FenceSync)(condition, flags);
+        beginCall(glCallFenceSync);
+        put(condition);
+        put(flags);
+        putSync(sync);
+        endCall();
+        return sync;
+    }
+
+    // Queries only keep their inputs, replay asks again and throws the answer away
+    void APIENTRY recordGetIntegerv(GLenum pname, GLint* data){
+        beginCall(glCallGetIntegerv);
+        put(pname);
+        endCall();
+        REAL(GetIntegerv)(pname, data);
+    }
+
+    void APIENTRY recordGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary){
+        beginCall(glCallGetProgramBinary);
+        put(program);
+        put(bufSize);
+        endCall();
+        REAL(GetProgramBinary)(program, bufSize, length, binaryFormat, binary);
+    }
+
+    void APIENTRY recordGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog){
+        beginCall(glCallGetProgramInfoLog);
+        put(program);
+        put(bufSize);
+        endCall();
+        REAL(GetProgramInfoLog)(program, bufSize, length, infoLog);
+    }
+
+    void APIENTRY recordGetProgramiv(GLuint program, GLenum pname, GLint* params){
+        beginCall(glCallGetProgramiv);
+        put(program);
+        put(pname);
+        endCall();
+        REAL(GetProgramiv)(program, pname, params);
+    }
+
+    void APIENTRY recordGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog){
+        beginCall(glCallGetShaderInfoLog);
+        put(shader);
+        put(bufSize);
+        endCall();
+        REAL(GetShaderInfoLog)(shader, bufSize, length, infoLog);
+    }
+
+    void APIENTRY recordGetShaderiv(GLuint shader, GLenum pname, GLint* params){
+        beginCall(glCallGetShaderiv);
+        put(shader);
+        put(pname);
+        endCall();
+        REAL(GetShaderiv)(shader, pname, params);
+    }
+
+    void APIENTRY recordGetTextureImage(GLuint texture, GLint level, GLenum format, GLenum type, GLsizei bufSize, void* pixels){
+        GLint packBuffer = 0;
+        REAL(GetIntegerv)(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+        beginCall(glCallGetTextureImage);
+        put(texture);
+        put(level);
+        put(format);
+        put(type);
+        put(bufSize);
+        // Into a pack buffer it's an offset that replay needs as it is, into memory replay brings its own
+        put<uint8_t>(packBuffer != 0);
+        if(packBuffer) put<uint64_t>((uintptr_t)pixels);
+        endCall();
+        REAL(GetTextureImage)(texture, level, format, type, bufSize, pixels);
+    }
+
+    GLint APIENTRY recordGetUniformLocation(GLuint program, const GLchar* name){
+        beginCall(glCallGetUniformLocation);
+        put(program);
+        putString(name);
+        endCall();
+        return REAL(GetUniformLocation)(program, name);
+    }
+
+    void APIENTRY recordNamedBufferStorage(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags){
+        beginCall(glCallNamedBufferStorage);
+        put(buffer);
+        put(size);
+        put(flags);
+        put<uint8_t>(data != nullptr);
+        if(data) putBlob(data, size);
+        endCall();
+        REAL(NamedBufferStorage)(buffer, size, data, flags);
+    }
+
+    void APIENTRY recordNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data){
+        beginCall(glCallNamedBufferSubData);
+        put(buffer);
+        put(offset);
+        putBlob(data, size);
+        endCall();
+        REAL(NamedBufferSubData)(buffer, offset, size, data);
+    }
+
+    void APIENTRY recordObjectLabel(GLenum identifier, GLuint name, GLsizei length, const GLchar* label){
+        beginCall(glCallObjectLabel);
+        put(identifier);
+        put(name);
+        putBlob(label, length < 0 ? strlen(label) : length);
+        endCall();
+        REAL(ObjectLabel)(identifier, name, length, label);
+    }
+
+    void APIENTRY recordPixelStorei(GLenum pname, GLint param){
+        switch(pname){
+            case GL_UNPACK_ALIGNMENT:    capture.unpackAlignment = param; break;
+            case GL_UNPACK_ROW_LENGTH:   capture.unpackRowLength = param; break;
+            case GL_UNPACK_IMAGE_HEIGHT: capture.unpackImageHeight = param; break;
+            case GL_UNPACK_SKIP_PIXELS:  capture.unpackSkipPixels = param; break;
+            case GL_UNPACK_SKIP_ROWS:    capture.unpackSkipRows = param; break;
+            case GL_UNPACK_SKIP_IMAGES:  capture.unpackSkipImages = param; break;
+        }
+        beginCall(glCallPixelStorei);
+        put(pname);
+        put(param);
+        endCall();
+        REAL(PixelStorei)(pname, param);
+    }
+
+    void APIENTRY recordProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length){
+        beginCall(glCallProgramBinary);
+        put(program);
+        put(binaryFormat);
+        putBlob(binary, length);
+        endCall();
+        REAL(ProgramBinary)(program, binaryFormat, binary, length);
+    }
+
+    void APIENTRY recordProgramUniform4fv(GLuint program, GLint location, GLsizei count, const GLfloat* value){
+        beginCall(glCallProgramUniform4fv);
+        put(program);
+        put(location);
+        putBlob(value, (size_t)count * 4 * sizeof(GLfloat));
+        endCall();
+        REAL(ProgramUniform4fv)(program, location, count, value);
+    }
+
+    void APIENTRY recordShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length){
+        beginCall(glCallShaderSource);
+        put(shader);
+        put(count);
+        for(GLsizei i = 0; i < count; i++) putBlob(string[i], length && length[i] >= 0 ? length[i] : strlen(string[i]));
+        endCall();
+        REAL(ShaderSource)(shader, count, string, length);
+    }
+
+    void APIENTRY recordTextureSubImage2D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                          GLenum format, GLenum type, const void* pixels){
+        beginCall(glCallTextureSubImage2D);
+        put(texture);
+        put(level);
+        put(xoffset);
+        put(yoffset);
+        put(width);
+        put(height);
+        put(format);
+        put(type);
+        putPixels(pixels, uploadBytes(width, height, 1, format, type));
+        endCall();
+        REAL(TextureSubImage2D)(texture, level, xoffset, yoffset, width, height, format, type, pixels);
+    }
+
+    void APIENTRY recordTextureSubImage3D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+                                          GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels){
+        beginCall(glCallTextureSubImage3D);
+        put(texture);
+        put(level);
+        put(xoffset);
+        put(yoffset);
+        put(zoffset);
+        put(width);
+        put(height);
+        put(depth);
+        put(format);
+        put(type);
+        putPixels(pixels, uploadBytes(width, height, depth, format, type));
+        endCall();
+        REAL(TextureSubImage3D)(texture, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+    }
+
+    void hook(GlCall id, void** slot, void* wrapper){
+        capture.slot[id] = slot;
+        capture.real[id] = *slot;
+        // Not loaded, nothing to forward to
+        if(*slot) *slot = wrapper;
+    }
+
+    void hookAll(){
+#define HOOK_SIMPLE(name, ...) hook(glCall##name, (void**)&glad_gl##name, (void*)&Simple<glCall##name, decltype(glad_gl##name)>::record);
+#define HOOK_CUSTOM(name) \
+        static_assert(std::is_same<decltype(&record##name), decltype(glad_gl##name)>::value, "record" #name " doesn't match gl" #name); \
+        hook(glCall##name, (void**)&glad_gl##name, (void*)&record##name);
+        GL_CALLS(HOOK_SIMPLE, HOOK_CUSTOM)
+#undef HOOK_SIMPLE
+#undef HOOK_CUSTOM
+    }
+
+    void unhookAll(){
+        for(int id = 0; id < glCallCount; id++){
+            if(capture.slot[id]) *capture.slot[id] = capture.real[id];
+            capture.slot[id] = nullptr;
+        }
+    }
+
+    // ---- Replay ----
+
+    struct Reader {
+        const uint8_t* p;
+        const uint8_t* end;
+        bool ok = true;
+
+        template<typename V>
+        V get(){
+            V v = V();
+            if(end - p < (ptrdiff_t)sizeof(V)){
+                ok = false;
+                return v;
+            }
+            memcpy(&v, p, sizeof(V));
+            p += sizeof(V);
+            return v;
+        }
+
+        // Points into the stream, nullptr when it runs past the end
+        const uint8_t* blob(size_t& size){
+            size = get<uint64_t>();
+            if(!ok || (size_t)(end - p) < size){
+                ok = false;
+                size = 0;
+                return nullptr;
+            }
+            const uint8_t* b = p;
+            p += size;
+            return b;
+        }
+    };
+
+    // Names replay never saw made (0 included) go through as they are
+    GLuint translate(GlReplay& replay, GLuint name, GlNameSpace ns){
+        if(!name || ns == glNoName) return name;
+        auto found = replay.names[ns].find(name);
+        return found == replay.names[ns].end() ? name : found->second;
+    }
+
+    template<typename V>
+    V translate(GlReplay&, V v, GlNameSpace){
+        return v;
+    }
+
+    template<typename R, typename... A, size_t... I>
+    void replayArgs(GlReplay& replay, Reader& in, R (*fn)(A...), std::initializer_list<GlNameSpace> tags, std::index_sequence<I...>){
+        // Braces read the arguments left to right
+        std::tuple<A...> args{in.get<A>()...};
+        if(in.ok) fn(translate(replay, std::get<I>(args), tags.begin()[I])...);
+    }
+
+    template<typename R, typename... A>
+    void replaySimple(GlReplay& replay, Reader& in, R (*fn)(A...), std::initializer_list<GlNameSpace> tags){
+        replayArgs(replay, in, fn, tags, std::index_sequence_for<A...>());
+    }
+
+    GLsync findSync(GlReplay& replay, uint64_t recorded){
+        auto found = replay.syncs.find(recorded);
+        return found == replay.syncs.end() ? nullptr : found->second;
+    }
+
+    void* scratch(GlReplay& replay, size_t size){
+        if(replay.scratch.size() < size) replay.scratch.resize(size);
+        return replay.scratch.data();
+    }
+
+    const void* getPixels(Reader& in){
+        const uint8_t source = in.get<uint8_t>();
+        if(source == 1){
+            size_t size;
+            return in.blob(size);
+        }
+        if(source == 2) return (const void*)(uintptr_t)in.get<uint64_t>();
+        return nullptr;
+    }
+
+    // Reads the recorded names, makes n of its own with `create` and pairs them up
+    template<typename Create>
+    void replayCreate(GlReplay& replay, Reader& in, GlNameSpace ns, Create create){
+        const GLsizei n = in.get<GLsizei>();
+        std::vector<GLuint> recorded(n > 0 ? n : 0), made(recorded.size());
+        for(GLuint& name : recorded) name = in.get<GLuint>();
+        if(!in.ok || recorded.empty()) return;
+        create((GLsizei)made.size(), made.data());
+        for(size_t i = 0; i < made.size(); i++) replay.names[ns][recorded[i]] = made[i];
+    }
+
+    template<typename Delete>
+    void replayDelete(GlReplay& replay, Reader& in, GlNameSpace ns, Delete del){
+        const GLsizei n = in.get<GLsizei>();
+        std::vector<GLuint> names(n > 0 ? n : 0);
+        for(GLuint& name : names){
+            const GLuint recorded = in.get<GLuint>();
+            name = translate(replay, recorded, ns);
+            replay.names[ns].erase(recorded);
+        }
+        if(in.ok && !names.empty()) del((GLsizei)names.size(), names.data());
+    }
+
+    void replayClearNamedFramebufferfv(GlReplay& replay, Reader& in){
+        const GLuint framebuffer = translate(replay, in.get<GLuint>(), glFramebufferName);
+        const GLenum buffer = in.get<GLenum>();
+        const GLint drawbuffer = in.get<GLint>();
+        GLfloat value[4] = {0};
+        for(int i = 0; i < (buffer == GL_COLOR ? 4 : 1); i++) value[i] = in.get<GLfloat>();
+        if(in.ok) glClearNamedFramebufferfv(framebuffer, buffer, drawbuffer, value);
+    }
+
+    void replayClientWaitSync(GlReplay& replay, Reader& in){
+        GLsync sync = findSync(replay, in.get<uint64_t>());
+        const GLbitfield flags = in.get<GLbitfield>();
+        const GLuint64 timeout = in.get<GLuint64>();
+        if(in.ok && sync) glClientWaitSync(sync, flags, timeout);
+    }
+
+    void replayCreateBuffers(GlReplay& replay, Reader& in){
+        replayCreate(replay, in, glBufferName, [](GLsizei n, GLuint* names){ glCreateBuffers(n, names); });
+    }
+
+    void replayCreateFramebuffers(GlReplay& replay, Reader& in){
+        replayCreate(replay, in, glFramebufferName, [](GLsizei n, GLuint* names){ glCreateFramebuffers(n, names); });
+    }
+
+    void replayCreateProgram(GlReplay& replay, Reader& in){
+        const GLuint recorded = in.get<GLuint>();
+        if(in.ok) replay.names[glProgramName][recorded] = glCreateProgram();
+    }
+
+    void replayCreateShader(GlReplay& replay, Reader& in){
+        const GLenum type = in.get<GLenum>();
+        const GLuint recorded = in.get<GLuint>();
+        if(in.ok) replay.names[glShaderName][recorded] = glCreateShader(type);
+    }
+
+    void replayCreateTextures(GlReplay& replay, Reader& in){
+        const GLenum target = in.get<GLenum>();
+        replayCreate(replay, in, glTextureName, [target](GLsizei n, GLuint* names){ glCreateTextures(target, n, names); });
+    }
+
+    void replayCreateVertexArrays(GlReplay& replay, Reader& in){
+        replayCreate(replay, in, glVertexArrayName, [](GLsizei n, GLuint* names){ glCreateVertexArrays(n, names); });
+    }
+
+    void replayDeleteBuffers(GlReplay& replay, Reader& in){
+        replayDelete(replay, in, glBufferName, [](GLsizei n, const GLuint* names){ glDeleteBuffers(n, names); });
+    }
+
+    void replayDeleteFramebuffers(GlReplay& replay, Reader& in){
+        replayDelete(replay, in, glFramebufferName, [](GLsizei n, const GLuint* names){ glDeleteFramebuffers(n, names); });
+    }
+
+    void replayDeleteSync(GlReplay& replay, Reader& in){
+        const uint64_t recorded = in.get<uint64_t>();
+        GLsync sync = findSync(replay, recorded);
+        if(!in.ok || !sync) return;
+        glDeleteSync(sync);
+        replay.syncs.erase(recorded);
+    }
+
+    void replayDeleteTextures(GlReplay& replay, Reader& in){
+        replayDelete(replay, in, glTextureName, [](GLsizei n, const GLuint* names){ glDeleteTextures(n, names); });
+    }
+
+    void replayDeleteVertexArrays(GlReplay& replay, Reader& in){
+        replayDelete(replay, in, glVertexArrayName, [](GLsizei n, const GLuint* names){ glDeleteVertexArrays(n, names); });
+    }
+
+    void replayDrawElements(GlReplay&, Reader& in){
+        const GLenum mode = in.get<GLenum>();
+        const GLsizei count = in.get<GLsizei>();
+        const GLenum type = in.get<GLenum>();
+        const uint64_t offset = in.get<uint64_t>();
+        if(in.ok) glDrawElements(mode, count, type, (const void*)(uintptr_t)offset);
+    }
+
+    void replayDrawElementsInstancedBaseInstance(GlReplay&, Reader& in){
+        const GLenum mode = in.get<GLenum>();
+        const GLsizei count = in.get<GLsizei>();
+        const GLenum type = in.get<GLenum>();
+        const uint64_t offset = in.get<uint64_t>();
+        const GLsizei instances = in.get<GLsizei>();
+        const GLuint baseInstance = in.get<GLuint>();
+        if(in.ok) glDrawElementsInstancedBaseInstance(mode, count, type, (const void*)(uintptr_t)offset, instances, baseInstance);
+    }
+
+    void replayFenceSync(GlReplay& replay, Reader& in){
+        const GLenum condition = in.get<GLenum>();
+        const GLbitfield flags = in.get<GLbitfield>();
+        const uint64_t recorded = in.get<uint64_t>();
+        if(in.ok) replay.syncs[recorded] = glFenceSync(condition, flags);
+    }
+
+    void replayGetIntegerv(GlReplay& replay, Reader& in){
+        const GLenum pname = in.get<GLenum>();
+        // Nothing hands back more than 16 values
+        if(in.ok) glGetIntegerv(pname, (GLint*)scratch(replay, 16 * sizeof(GLint64)));
+    }
+
+    void replayGetProgramBinary(GlReplay& replay, Reader& in){
+        const GLuint program = translate(replay, in.get<GLuint>(), glProgramName);
+        const GLsizei bufSize = in.get<GLsizei>();
+        GLsizei length;
+        GLenum binaryFormat;
+        if(in.ok) glGetProgramBinary(program, bufSize, &length, &binaryFormat, scratch(replay, bufSize));
+    }
+
+    void replayGetProgramInfoLog(GlReplay& replay, Reader& in){
+        const GLuint program = translate(replay, in.get<GLuint>(), glProgramName);
+        const GLsizei bufSize = in.get<GLsizei>();
+        GLsizei length;
+        if(in.ok) glGetProgramInfoLog(program, bufSize, &length, (GLchar*)scratch(replay, bufSize));
+    }
+
+    void replayGetProgramiv(GlReplay& replay, Reader& in){
+        const GLuint program = translate(replay, in.get<GLuint>(), glProgramName);
+        const GLenum pname = in.get<GLenum>();
+        if(in.ok) glGetProgramiv(program, pname, (GLint*)scratch(replay, 4 * sizeof(GLint)));
+    }
+
+    void replayGetShaderInfoLog(GlReplay& replay, Reader& in){
+        const GLuint shader = translate(replay, in.get<GLuint>(), glShaderName);
+        const GLsizei bufSize = in.get<GLsizei>();
+        GLsizei length;
+        if(in.ok) glGetShaderInfoLog(shader, bufSize, &length, (GLchar*)scratch(replay, bufSize));
+    }
+
+    void replayGetShaderiv(GlReplay& replay, Reader& in){
+        const GLuint shader = translate(replay, in.get<GLuint>(), glShaderName);
+        const GLenum pname = in.get<GLenum>();
+        if(in.ok) glGetShaderiv(shader, pname, (GLint*)scratch(replay, 4 * sizeof(GLint)));
+    }
+
+    void replayGetTextureImage(GlReplay& replay, Reader& in){
+        const GLuint texture = translate(replay, in.get<GLuint>(), glTextureName);
+        const GLint level = in.get<GLint>();
+        const GLenum format = in.get<GLenum>();
+        const GLenum type = in.get<GLenum>();
+        const GLsizei bufSize = in.get<GLsizei>();
+        void* pixels = in.get<uint8_t>() ? (void*)(uintptr_t)in.get<uint64_t>() : scratch(replay, bufSize);
+        if(in.ok) glGetTextureImage(texture, level, format, type, bufSize, pixels);
+    }
+
+    void replayGetUniformLocation(GlReplay& replay, Reader& in){
+        const GLuint program = translate(replay, in.get<GLuint>(), glProgramName);
+        size_t size;
+        const GLchar* name = (const GLchar*)in.blob(size);
+        // Locations aren't remapped, the same shaders on the same driver give the same ones
+        if(in.ok && size) glGetUniformLocation(program, name);
+    }
+
+    void replayNamedBufferStorage(GlReplay& replay, Reader& in){
+        const GLuint buffer = translate(replay, in.get<GLuint>(), glBufferName);
+        const GLsizeiptr size = in.get<GLsizeiptr>();
+        const GLbitfield flags = in.get<GLbitfield>();
+        const void* data = nullptr;
+        if(in.get<uint8_t>()){
+            size_t blobSize;
+            data = in.blob(blobSize);
+        }
+        if(in.ok) glNamedBufferStorage(buffer, size, data, flags);
+    }
+
+    void replayNamedBufferSubData(GlReplay& replay, Reader& in){
+        const GLuint buffer = translate(replay, in.get<GLuint>(), glBufferName);
+        const GLintptr offset = in.get<GLintptr>();
+        size_t size;
+        const void* data = in.blob(size);
+        if(in.ok) glNamedBufferSubData(buffer, offset, size, data);
+    }
+
+    void replayObjectLabel(GlReplay& replay, Reader& in){
+        const GLenum identifier = in.get<GLenum>();
+        GlNameSpace ns = glNoName;
+        switch(identifier){
+            case GL_TEXTURE:      ns = glTextureName; break;
+            case GL_BUFFER:       ns = glBufferName; break;
+            case GL_FRAMEBUFFER:  ns = glFramebufferName; break;
+            case GL_PROGRAM:      ns = glProgramName; break;
+            case GL_SHADER:       ns = glShaderName; break;
+            case GL_VERTEX_ARRAY: ns = glVertexArrayName; break;
+        }
+        const GLuint name = translate(replay, in.get<GLuint>(), ns);
+        size_t size;
+        const GLchar* label = (const GLchar*)in.blob(size);
+        if(in.ok) glObjectLabel(identifier, name, size, label);
+    }
+
+    void replayPixelStorei(GlReplay&, Reader& in){
+        const GLenum pname = in.get<GLenum>();
+        const GLint param = in.get<GLint>();
+        if(in.ok) glPixelStorei(pname, param);
+    }
+
+    void replayProgramBinary(GlReplay& replay, Reader& in){
+        const GLuint program = translate(replay, in.get<GLuint>(), glProgramName);
+        const GLenum binaryFormat = in.get<GLenum>();
+        size_t size;
+        const void* binary = in.blob(size);
+        if(in.ok) glProgramBinary(program, binaryFormat, binary, size);
+    }
+
+    void replayProgramUniform4fv(GlReplay& replay, Reader& in){
+        const GLuint program = translate(replay, in.get<GLuint>(), glProgramName);
+        const GLint location = in.get<GLint>();
+        size_t size;
+        const uint8_t* value = in.blob(size);
+        if(!in.ok) return;
+        // The stream isn't aligned for floats
+        GLfloat* aligned = (GLfloat*)scratch(replay, size);
+        memcpy(aligned, value, size);
+        glProgramUniform4fv(program, location, size / (4 * sizeof(GLfloat)), aligned);
+    }
+
+    void replayShaderSource(GlReplay& replay, Reader& in){
+        const GLuint shader = translate(replay, in.get<GLuint>(), glShaderName);
+        const GLsizei count = in.get<GLsizei>();
+        std::vector<const GLchar*> strings(count > 0 ? count : 0);
+        std::vector<GLint> lengths(strings.size());
+        for(size_t i = 0; i < strings.size(); i++){
+            size_t size;
+            strings[i] = (const GLchar*)in.blob(size);
+            lengths[i] = size;
+        }
+        if(in.ok) glShaderSource(shader, count, strings.data(), lengths.data());
+    }
+
+    void replayTextureSubImage2D(GlReplay& replay, Reader& in){
+        const GLuint texture = translate(replay, in.get<GLuint>(), glTextureName);
+        const GLint level = in.get<GLint>();
+        const GLint xoffset = in.get<GLint>();
+        const GLint yoffset = in.get<GLint>();
+        const GLsizei width = in.get<GLsizei>();
+        const GLsizei height = in.get<GLsizei>();
+        const GLenum format = in.get<GLenum>();
+        const GLenum type = in.get<GLenum>();
+        const void* pixels = getPixels(in);
+        if(in.ok) glTextureSubImage2D(texture, level, xoffset, yoffset, width, height, format, type, pixels);
+    }
+
+    void replayTextureSubImage3D(GlReplay& replay, Reader& in){
+        const GLuint texture = translate(replay, in.get<GLuint>(), glTextureName);
+        const GLint level = in.get<GLint>();
+        const GLint xoffset = in.get<GLint>();
+        const GLint yoffset = in.get<GLint>();
+        const GLint zoffset = in.get<GLint>();
+        const GLsizei width = in.get<GLsizei>();
+        const GLsizei height = in.get<GLsizei>();
+        const GLsizei depth = in.get<GLsizei>();
+        const GLenum format = in.get<GLenum>();
+        const GLenum type = in.get<GLenum>();
+        const void* pixels = getPixels(in);
+        if(in.ok) glTextureSubImage3D(texture, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+    }
+
+    // False on anything it doesn't know, the rest of the stream can't be trusted after that
+    bool replayCall(GlReplay& replay, Reader& in, uint16_t id){
+        switch(id){
+#define REPLAY_SIMPLE(name, ...) case glCall##name: replaySimple(replay, in, glad_gl##name, {__VA_ARGS__}); break;
+#define REPLAY_CUSTOM(name) case glCall##name: replay##name(replay, in); break;
+            GL_CALLS(REPLAY_SIMPLE, REPLAY_CUSTOM)
+#undef REPLAY_SIMPLE
+#undef REPLAY_CUSTOM
+            default:
+                printf("GL replay: unknown call %u\n", id);
+                return false;
+        }
+        return in.ok;
+    }
+}
+
+bool glCaptureBegin(const char* fName, int frames){
+    if(capture.file){
+        printf("GL capture: already recording into \'%s\'\n", capture.fileName.c_str());
+        return false;
+    }
+    capture.file = fopen(fName, "wb");
+    if(!capture.file){
+        printf("Failed to open file \'%s\'\n", fName);
+        return false;
+    }
+
+    // Before hooking, the replay window needs this size but it isn't a call
+    GLint viewport[4] = {0};
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    capture.fileName = fName;
+    capture.framesLeft = frames;
+    capture.frames = 0;
+    capture.calls = capture.bytes = 0;
+    capture.buffer.insert(capture.buffer.end(), magic, magic + 4);
+    put(formatVersion);
+    // Frame count, filled in at the end
+    put<uint32_t>(0);
+    put<int32_t>(viewport[2]);
+    put<int32_t>(viewport[3]);
+    hookAll();
+    return true;
+}
+
+void glCaptureFrameEnd(){
+    if(!capture.file) return;
+    put<uint16_t>(streamFrameEnd);
+    capture.frames++;
+    if(--capture.framesLeft <= 0) glCaptureEnd();
+}
+
+void glCaptureEnd(){
+    if(!capture.file) return;
+    unhookAll();
+    put<uint16_t>(streamEnd);
+    flushBuffer();
+    fseek(capture.file, 8, SEEK_SET);
+    fwrite(&capture.frames, sizeof(capture.frames), 1, capture.file);
+    const bool ok = !ferror(capture.file);
+    fclose(capture.file);
+    capture.file = nullptr;
+
+    if(ok){
+        printf("GL capture: %u frames, %llu calls, %.1f MB in \'%s\'\n", capture.frames, (unsigned long long)capture.calls,
+               capture.bytes / (1024.0 * 1024.0), capture.fileName.c_str());
+    } else {
+        printf("GL capture: failed writing \'%s\'\n", capture.fileName.c_str());
+    }
+    capture.buffer = std::vector<uint8_t>();
+}
+
+bool glCaptureActive(){
+    return capture.file != nullptr;
+}
+
+bool glReplayOpen(GlReplay& replay, const char* fName){
+    FILE* f = fopen(fName, "rb");
+    if(!f){
+        printf("Failed to open file \'%s\'\n", fName);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    replay = GlReplay();
+    replay.stream.resize(size > 0 ? size : 0);
+    const bool read = fread(replay.stream.data(), 1, replay.stream.size(), f) == replay.stream.size();
+    fclose(f);
+
+    Reader in = {replay.stream.data(), replay.stream.data() + replay.stream.size()};
+    char fileMagic[4];
+    for(char& c : fileMagic) c = in.get<char>();
+    const uint32_t version = in.get<uint32_t>();
+    replay.frames = in.get<uint32_t>();
+    replay.width = in.get<int32_t>();
+    replay.height = in.get<int32_t>();
+    if(!read || !in.ok || memcmp(fileMagic, magic, 4) || version != formatVersion){
+        printf("\'%s\' isn't a GL capture this build can read\n", fName);
+        replay.stream.clear();
+        return false;
+    }
+    replay.pos = headerBytes;
+    return true;
+}
+
+bool glReplayFrame(GlReplay& replay){
+    if(replay.failed || replay.pos >= replay.stream.size()) return false;
+
+    Reader in = {replay.stream.data() + replay.pos, replay.stream.data() + replay.stream.size()};
+    while(true){
+        const uint16_t id = in.get<uint16_t>();
+        if(!in.ok){
+            printf("GL replay: the stream stops in the middle of a frame\n");
+            replay.failed = true;
+            return false;
+        }
+        if(id == streamFrameEnd){
+            replay.pos = in.p - replay.stream.data();
+            return true;
+        }
+        if(id == streamEnd){
+            replay.pos = replay.stream.size();
+            return false;
+        }
+        if(!replayCall(replay, in, id)){
+            printf("GL replay: broken call %u at byte %zu\n", id, (size_t)(in.p - replay.stream.data()));
+            replay.failed = true;
+            return false;
+        }
+        replay.calls++;
+    }
+}
+
+void glReplayClose(GlReplay& replay){
+    for(auto& sync : replay.syncs) glDeleteSync(sync.second);
+    replay = GlReplay();
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "glad/glad.h"
+
+// Records the GL calls the project makes, along with the data they hand the driver, so a run can be
+// played back later without the app. Replay issues exactly the same calls, so its timings measure
+// only the driver and the GPU.
+//
+// Recording swaps glad's function pointers for wrappers that write each call to the file and then
+// forward it. Only the entry points listed in glCalls.h are hooked; anything else goes straight
+// to the driver and won't be in the file. Add new GL calls to that list.
+// Calls from other threads aren't supported. Everything here assumes GL is only used on one thread.
+
+// Start recording into `fName` for `frames` frames. Call right after the loader is set up, before
+// anything else touches GL. Objects made before this point can't be replayed.
+bool glCaptureBegin(const char* fName, int frames);
+// Mark the end of a frame. The capture finishes by itself after `frames` of them.
+void glCaptureFrameEnd();
+// Stop early and write out what there is. Fine to call when nothing is being recorded.
+void glCaptureEnd();
+bool glCaptureActive();
+
+// ---- Replay ----
+
+// Kinds of GL names. A replay context won't hand out the same names the recording got, so each kind
+// has its own table of recorded name -> new name.
+enum GlNameSpace {
+    glNoName,
+    glTextureName,
+    glBufferName,
+    glFramebufferName,
+    glProgramName,
+    glShaderName,
+    glVertexArrayName,
+    glNameSpaceCount
+};
+
+struct GlReplay {
+    std::vector<uint8_t> stream;
+    size_t pos = 0;
+    // Frame count and default framebuffer size when it was recorded
+    uint32_t frames = 0;
+    int width = 0, height = 0;
+    uint64_t calls = 0;
+    std::unordered_map<GLuint, GLuint> names[glNameSpaceCount];
+    std::unordered_map<uint64_t, GLsync> syncs;
+    // Queries write their answers here, nobody looks at them
+    std::vector<uint8_t> scratch;
+    bool failed = false;
+};
+
+// Loads the whole file. Needs a current context for glReplayFrame, not for this.
+bool glReplayOpen(GlReplay& replay, const char* fName);
+// Issue every call up to the next frame end. False once the stream runs out or turns out to be broken.
+// The first frame also holds everything the app set up before it.
+bool glReplayFrame(GlReplay& replay);
+// Delete the fences it made. Everything else goes away with the context.
+void glReplayClose(GlReplay& replay);
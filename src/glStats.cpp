@@ -0,0 +1,231 @@
+#include "glStats.h"
+
+#ifdef GL_STATS
+
+#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    enum CallKind : uint8_t {
+        kindOther,
+        kindDraw,
+        kindDispatch,
+        kindBind,
+    };
+
+    struct Stats {
+        bool active = false;
+        // The driver's entry points, where glad keeps them, and what went there instead
+        void* real[glCallCount] = {};
+        void** slot[glCallCount] = {};
+        void* wrapper[glCallCount] = {};
+        CallKind kind[glCallCount] = {};
+
+        GlFrameStats frame;
+        GlFrameStats last;
+        GlStatsBudget budget;
+        bool lastOver = false;
+
+        // Everything after frame 0
+        uint64_t frames = 0;
+        uint64_t calls = 0, draws = 0, dispatches = 0, binds = 0;
+        uint64_t uploadBytes = 0, readbackBytes = 0;
+        uint64_t perCall[glCallCount] = {};
+        uint32_t peakCalls = 0;
+        uint64_t peakBytes = 0;
+        uint64_t overBudget = 0;
+        // Frame 0 on its own
+        GlFrameStats setup;
+    };
+    Stats stats;
+
+    void count(GlCall id){
+        GlFrameStats& frame = stats.frame;
+        frame.calls++;
+        frame.perCall[id]++;
+        switch(stats.kind[id]){
+            case kindDraw:      frame.draws++; break;
+            case kindDispatch:  frame.dispatches++; break;
+            case kindBind:      frame.binds++; break;
+            case kindOther:     break;
+        }
+    }
+
+    // Calls that move data count its bytes too, everything else uses the empty one
+    template<GlCall Id> struct Bytes {
+        template<typename... A> static void count(A...){}
+    };
+
+    template<> struct Bytes<glCallNamedBufferStorage> {
+        static void count(GLuint, GLsizeiptr size, const void* data, GLbitfield){
+            if(data) stats.frame.uploadBytes += size;
+        }
+    };
+
+    template<> struct Bytes<glCallNamedBufferSubData> {
+        static void count(GLuint, GLintptr, GLsizeiptr size, const void*){
+            stats.frame.uploadBytes += size;
+        }
+    };
+
+    // Pixels the upload writes, whether they come from client memory or an unpack buffer
+    template<> struct Bytes<glCallTextureSubImage2D> {
+        static void count(GLuint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, const void*){
+            stats.frame.uploadBytes += (uint64_t)width * height * glPixelBytes(format, type);
+        }
+    };
+
+    template<> struct Bytes<glCallTextureSubImage3D> {
+        static void count(GLuint, GLint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void*){
+            stats.frame.uploadBytes += (uint64_t)width * height * depth * glPixelBytes(format, type);
+        }
+    };
+
+    template<> struct Bytes<glCallGetTextureImage> {
+        static void count(GLuint, GLint, GLenum, GLenum, GLsizei bufSize, void*){
+            stats.frame.readbackBytes += bufSize;
+        }
+    };
+
+    template<GlCall Id, typename Fn> struct Counted;
+    template<GlCall Id, typename R, typename... A>
+    struct Counted<Id, R (*)(A...)> {
+        static R APIENTRY call(A... args){
+            count(Id);
+            Bytes<Id>::count(args...);
+            return ((R (*)(A...))stats.real[Id])(args...);
+        }
+    };
+
+    bool startsWith(const char* s, const char* prefix){
+        return !strncmp(s, prefix, strlen(prefix));
+    }
+
+    CallKind kindOf(GlCall id){
+        const char* name = glCallName(id);
+        if(startsWith(name, "glDraw")) return kindDraw;
+        if(startsWith(name, "glDispatch")) return kindDispatch;
+        if(startsWith(name, "glBind") || !strcmp(name, "glUseProgram")) return kindBind;
+        return kindOther;
+    }
+
+    void hook(GlCall id, void** slot, void* wrapper){
+        stats.slot[id] = slot;
+        stats.real[id] = *slot;
+        stats.wrapper[id] = wrapper;
+        stats.kind[id] = kindOf(id);
+        // Not loaded, nothing to forward to
+        if(*slot) *slot = wrapper;
+    }
+
+    void hookAll(){
+#define HOOK(name, ...) hook(glCall##name, (void**)&glad_gl##name, (void*)&Counted<glCall##name, decltype(glad_gl##name)>::call);
+        GL_CALLS(HOOK, HOOK)
+#undef HOOK
+    }
+
+    void unhookAll(){
+        for(int id = 0; id < glCallCount; id++){
+            // Something hooked on top of us and is still there, it forwards to us so leave it be
+            if(stats.slot[id] && *stats.slot[id] == stats.wrapper[id]) *stats.slot[id] = stats.real[id];
+            stats.slot[id] = nullptr;
+        }
+    }
+
+    double megabytes(uint64_t bytes){
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    void printFrame(const char* what, const GlFrameStats& frame){
+        printf("  %s %llu: %u calls, %u draws, %u dispatches, %u binds, %.3f MB up, %.3f MB back%s\n", what,
+               (unsigned long long)frame.frame, frame.calls, frame.draws, frame.dispatches, frame.binds,
+               megabytes(frame.uploadBytes), megabytes(frame.readbackBytes), frame.overBudget ? ", over budget" : "");
+    }
+
+    bool overBudget(const GlFrameStats& frame, const GlStatsBudget& budget){
+        return (budget.calls && frame.calls > budget.calls) || (budget.draws && frame.draws > budget.draws) ||
+               (budget.uploadBytes && frame.uploadBytes > budget.uploadBytes) ||
+               (budget.readbackBytes && frame.readbackBytes > budget.readbackBytes);
+    }
+}
+
+bool glStatsBegin(){
+    if(stats.active) return true;
+    stats = Stats();
+    hookAll();
+    stats.active = true;
+    return true;
+}
+
+void glStatsSetBudget(const GlStatsBudget& budget){
+    stats.budget = budget;
+}
+
+void glStatsFrameEnd(){
+    if(!stats.active) return;
+    GlFrameStats& frame = stats.frame;
+
+    if(frame.frame == 0){
+        stats.setup = frame;
+    } else {
+        frame.overBudget = overBudget(frame, stats.budget);
+        if(frame.overBudget){
+            stats.overBudget++;
+            // Once when it goes over, a frame loop stuck over budget would drown everything else
+            if(!stats.lastOver) printf("GL stats: frame %llu went over budget\n", (unsigned long long)frame.frame);
+        }
+        stats.lastOver = frame.overBudget;
+
+        stats.frames++;
+        stats.calls += frame.calls;
+        stats.draws += frame.draws;
+        stats.dispatches += frame.dispatches;
+        stats.binds += frame.binds;
+        stats.uploadBytes += frame.uploadBytes;
+        stats.readbackBytes += frame.readbackBytes;
+        for(int id = 0; id < glCallCount; id++) stats.perCall[id] += frame.perCall[id];
+        stats.peakCalls = std::max(stats.peakCalls, frame.calls);
+        stats.peakBytes = std::max(stats.peakBytes, frame.uploadBytes + frame.readbackBytes);
+    }
+
+    stats.last = frame;
+    const uint64_t next = frame.frame + 1;
+    frame = GlFrameStats();
+    frame.frame = next;
+}
+
+const GlFrameStats& glStatsLastFrame(){
+    return stats.last;
+}
+
+void glStatsReport(){
+    if(!stats.active) return;
+    printf("GL stats: %llu frames after setup, %llu over budget\n", (unsigned long long)stats.frames,
+           (unsigned long long)stats.overBudget);
+    printFrame("setup frame", stats.setup);
+    if(stats.frames){
+        const double frames = (double)stats.frames;
+        printf("  a frame: %.1f calls (peak %u), %.1f draws, %.1f dispatches, %.1f binds, %.3f MB up, %.3f MB back (peak %.3f MB)\n",
+               stats.calls / frames, stats.peakCalls, stats.draws / frames, stats.dispatches / frames, stats.binds / frames,
+               megabytes(stats.uploadBytes) / frames, megabytes(stats.readbackBytes) / frames, megabytes(stats.peakBytes));
+        printFrame("last frame", stats.last);
+
+        // Busiest entry points
+        int order[glCallCount];
+        for(int id = 0; id < glCallCount; id++) order[id] = id;
+        std::sort(order, order + glCallCount, [](int a, int b){ return stats.perCall[a] > stats.perCall[b]; });
+        for(int i = 0; i < 8 && stats.perCall[order[i]]; i++){
+            printf("  %-28s %.1f a frame\n", glCallName((GlCall)order[i]), stats.perCall[order[i]] / frames);
+        }
+    }
+}
+
+void glStatsEnd(){
+    if(!stats.active) return;
+    glStatsReport();
+    unhookAll();
+    stats.active = false;
+}
+
+#endif
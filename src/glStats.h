@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+#include "glCalls.h"
+
+// Counts the GL calls the project makes every frame: how many of each entry point, draws, dispatches, binds,
+// and the bytes going into buffers and textures or coming back out of them. Frames can be held to a budget,
+// the ones that go over get flagged.
+//
+// Counting swaps glad's function pointers for wrappers the same way glCapture does, so only the entry points
+// in glCalls.h are seen. It's only compiled in with GL_STATS defined (make GL_STATS=1). Without it everything
+// below is an empty inline and nothing gets hooked, so the calls left in the frame loops cost nothing.
+// GL on one thread only, same as glCapture.
+
+struct GlFrameStats {
+    uint64_t frame = 0;
+    // Every hooked call, then how many of each
+    uint32_t calls = 0;
+    uint32_t perCall[glCallCount] = {};
+    uint32_t draws = 0;
+    uint32_t dispatches = 0;
+    // glBind* and glUseProgram
+    uint32_t binds = 0;
+    // Handed to the driver for buffers and textures, and copied back out of textures
+    uint64_t uploadBytes = 0;
+    uint64_t readbackBytes = 0;
+    bool overBudget = false;
+};
+
+// Most a frame should take, 0 for no limit
+struct GlStatsBudget {
+    uint32_t calls = 0;
+    uint32_t draws = 0;
+    uint64_t uploadBytes = 0;
+    uint64_t readbackBytes = 0;
+};
+
+#ifdef GL_STATS
+
+// Start counting. Call right after the loader is set up and before glCaptureBegin, so a capture records
+// through the counters instead of around them. Frame 0 is everything up to the first glStatsFrameEnd,
+// setup included, so it's kept out of the budget and the averages.
+bool glStatsBegin();
+void glStatsSetBudget(const GlStatsBudget& budget);
+// Close the current frame, check it against the budget and start the next one
+void glStatsFrameEnd();
+// The last frame that was closed
+const GlFrameStats& glStatsLastFrame();
+// Averages and peaks so far, the last frame, and the entry points called the most
+void glStatsReport();
+// Report and put glad's pointers back. Fine to call when nothing is being counted.
+void glStatsEnd();
+
+#else
+
+inline bool glStatsBegin(){ return false; }
+inline void glStatsSetBudget(const GlStatsBudget&){}
+inline void glStatsFrameEnd(){}
+inline const GlFrameStats& glStatsLastFrame(){
+    static const GlFrameStats none;
+    return none;
+}
+inline void glStatsReport(){}
+inline void glStatsEnd(){}
+
+#endif
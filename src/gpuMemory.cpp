@@ -0,0 +1,218 @@
+#include "gpuMemory.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    enum ResourceKind {
+        kindTexture,
+        kindBuffer,
+        kindFramebuffer
+    };
+
+    struct Resource {
+        ResourceKind kind;
+        GpuCategory category;
+        std::string label;
+        GLenum internalFormat;
+        int width, height, layers, levels;
+        size_t bytes;
+    };
+
+    const char* const categoryNames[gpuCategoryCount] = {"render targets", "textures", "streaming", "buffers"};
+    const char* const kindNames[] = {"texture", "buffer", "framebuffer"};
+
+    // GL names are only unique per object type, so one map for each
+    std::unordered_map<GLuint, Resource> textures, buffers, framebuffers;
+    size_t live[gpuCategoryCount] = {0};
+    size_t budgets[gpuCategoryCount] = {0};
+    size_t totalBudget = 0;
+
+    std::unordered_map<GLuint, Resource>& registryFor(ResourceKind kind){
+        if(kind == kindTexture) return textures;
+        if(kind == kindBuffer)  return buffers;
+        return framebuffers;
+    }
+
+    size_t totalLive(){
+        size_t total = 0;
+        for(size_t bytes : live) total += bytes;
+        return total;
+    }
+
+    double megabytes(size_t bytes){
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    // Bytes per texel of the formats this project makes, 0 for anything else
+    size_t texelBytes(GLenum internalFormat){
+        switch(internalFormat){
+            case GL_R8:                 return 1;
+            case GL_RG8:                return 2;
+            case GL_RGBA8:
+            case GL_SRGB8_ALPHA8:
+            case GL_R32F:
+            case GL_DEPTH24_STENCIL8:
+            case GL_DEPTH_COMPONENT32F: return 4;
+            case GL_RGBA16F:
+            case GL_RGBA16UI:           return 8;
+            case GL_RGBA32F:            return 16;
+        }
+        return 0;
+    }
+
+    const char* formatName(GLenum internalFormat){
+        switch(internalFormat){
+            case GL_R8:                 return "R8";
+            case GL_RG8:                return "RG8";
+            case GL_RGBA8:              return "RGBA8";
+            case GL_SRGB8_ALPHA8:       return "SRGB8_ALPHA8";
+            case GL_R32F:               return "R32F";
+            case GL_DEPTH24_STENCIL8:   return "DEPTH24_STENCIL8";
+            case GL_DEPTH_COMPONENT32F: return "DEPTH32F";
+            case GL_RGBA16F:            return "RGBA16F";
+            case GL_RGBA16UI:           return "RGBA16UI";
+            case GL_RGBA32F:            return "RGBA32F";
+        }
+        return "?";
+    }
+
+    // Only says so on the way over, not every time something's added while already over
+    void checkBudgets(GpuCategory category, size_t added){
+        const size_t after = live[category], before = after - added;
+        if(budgets[category] && before <= budgets[category] && after > budgets[category]){
+            printf("GPU memory: %s at %.1f MB, over its %.1f MB budget\n",
+                   categoryNames[category], megabytes(after), megabytes(budgets[category]));
+        }
+        const size_t total = totalLive();
+        if(totalBudget && total - added <= totalBudget && total > totalBudget){
+            printf("GPU memory: %.1f MB in use, over the %.1f MB budget\n", megabytes(total), megabytes(totalBudget));
+        }
+    }
+
+    void track(GLuint name, const Resource& res){
+        if(!name) return;
+        auto& registry = registryFor(res.kind);
+        // Re-registering the same name replaces it, e.g. when storage is remade
+        auto old = registry.find(name);
+        if(old != registry.end()) live[old->second.category] -= old->second.bytes;
+
+        registry[name] = res;
+        live[res.category] += res.bytes;
+        checkBudgets(res.category, res.bytes);
+
+        static const GLenum identifiers[] = {GL_TEXTURE, GL_BUFFER, GL_FRAMEBUFFER};
+        glObjectLabel(identifiers[res.kind], name, -1, res.label.c_str());
+    }
+
+    void untrack(ResourceKind kind, GLuint name){
+        auto& registry = registryFor(kind);
+        auto found = registry.find(name);
+        if(found == registry.end()){
+            printf("GPU memory: deleting untracked %s %u\n", kindNames[kind], name);
+            return;
+        }
+        live[found->second.category] -= found->second.bytes;
+        registry.erase(found);
+    }
+
+    void describe(GLuint name, const Resource& res){
+        printf("  %-11s %4u %-28s %-14s ", kindNames[res.kind], name, res.label.c_str(), categoryNames[res.category]);
+        // Constant buffers and the like would all be 0.00 MB
+        if(res.bytes < 1024 * 1024) printf("%9.2f KB", res.bytes / 1024.0);
+        else                        printf("%9.2f MB", megabytes(res.bytes));
+        if(res.kind == kindTexture){
+            printf("  %s %dx%d", formatName(res.internalFormat), res.width, res.height);
+            if(res.layers > 1) printf("x%d", res.layers);
+            if(res.levels > 1) printf(" %d levels", res.levels);
+        }
+        printf("\n");
+    }
+
+    // Everything registered, biggest first
+    std::vector<std::pair<GLuint, const Resource*>> allResources(){
+        std::vector<std::pair<GLuint, const Resource*>> all;
+        for(auto* registry : {&textures, &buffers, &framebuffers}){
+            for(auto& r : *registry) all.push_back({r.first, &r.second});
+        }
+        std::sort(all.begin(), all.end(), [](const auto& a, const auto& b){ return a.second->bytes > b.second->bytes; });
+        return all;
+    }
+}
+
+void gpuTrackTexture(GLuint tex, GpuCategory category, const char* label, GLenum internalFormat,
+                     int width, int height, int layers, int levels){
+    const size_t texel = texelBytes(internalFormat);
+    if(!texel) printf("GPU memory: no size for format 0x%x of \'%s\', counting it as 0 bytes\n", internalFormat, label);
+
+    // Array layers don't shrink down the mip chain, width and height do
+    size_t bytes = 0;
+    for(int level = 0; level < levels; level++){
+        bytes += (size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * layers * texel;
+    }
+    track(tex, {kindTexture, category, label, internalFormat, width, height, layers, levels, bytes});
+}
+
+void gpuTrackBuffer(GLuint buffer, GpuCategory category, const char* label, size_t bytes){
+    track(buffer, {kindBuffer, category, label, 0, 0, 0, 0, 0, bytes});
+}
+
+void gpuTrackFramebuffer(GLuint fbo, const char* label){
+    track(fbo, {kindFramebuffer, gpuRenderTargets, label, 0, 0, 0, 0, 0, 0});
+}
+
+void gpuDeleteTexture(GLuint& tex){
+    if(!tex) return;
+    untrack(kindTexture, tex);
+    glDeleteTextures(1, &tex);
+    tex = 0;
+}
+
+void gpuDeleteBuffer(GLuint& buffer){
+    if(!buffer) return;
+    untrack(kindBuffer, buffer);
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+void gpuDeleteFramebuffer(GLuint& fbo){
+    if(!fbo) return;
+    untrack(kindFramebuffer, fbo);
+    glDeleteFramebuffers(1, &fbo);
+    fbo = 0;
+}
+
+void gpuMemorySetBudget(GpuCategory category, size_t bytes){
+    budgets[category] = bytes;
+}
+
+void gpuMemorySetTotalBudget(size_t bytes){
+    totalBudget = bytes;
+}
+
+size_t gpuMemoryLive(GpuCategory category){
+    return live[category];
+}
+
+void gpuMemoryReport(){
+    printf("GPU memory: %.2f MB live", megabytes(totalLive()));
+    if(totalBudget) printf(" of a %.1f MB budget", megabytes(totalBudget));
+    printf("\n");
+    for(int c = 0; c < gpuCategoryCount; c++){
+        printf("  %-14s %9.2f MB", categoryNames[c], megabytes(live[c]));
+        if(budgets[c]) printf(" of %.1f MB", megabytes(budgets[c]));
+        printf("\n");
+    }
+    for(auto& r : allResources()) describe(r.first, *r.second);
+}
+
+size_t gpuMemoryReportLeaks(){
+    auto all = allResources();
+    if(all.empty()) return 0;
+    printf("GPU memory: %zu resources (%.2f MB) never deleted\n", all.size(), megabytes(totalLive()));
+    for(auto& r : all) describe(r.first, *r.second);
+    return all.size();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+
+#include "glad/glad.h"
+
+// Book keeping for everything that lives in GPU memory. Whoever makes a texture, buffer or framebuffer registers
+// it here, which also gives it a debug label for tools like RenderDoc, and frees it through gpuDelete*.
+// That way live bytes can be reported per category, budgets can warn when they're crossed, and anything still
+// registered at shutdown is a leak. Sizes come from format and dimensions, drivers may pad on top of that.
+
+enum GpuCategory {
+    // What gets drawn into, framebuffers count here too (at 0 bytes, their attachments are counted on their own)
+    gpuRenderTargets,
+    // Material texture pools
+    gpuTextures,
+    // Tile page caches and indirection tables
+    gpuStreaming,
+    // Vertex data, material and constant buffers
+    gpuBuffers,
+    gpuCategoryCount
+};
+
+// Register a texture after its storage was allocated, `layers` is the depth of array textures
+void gpuTrackTexture(GLuint tex, GpuCategory category, const char* label, GLenum internalFormat,
+                     int width, int height, int layers = 1, int levels = 1);
+void gpuTrackBuffer(GLuint buffer, GpuCategory category, const char* label, size_t bytes);
+void gpuTrackFramebuffer(GLuint fbo, const char* label);
+
+// Unregister and delete, the handle is zeroed. Fine to call with 0.
+void gpuDeleteTexture(GLuint& tex);
+void gpuDeleteBuffer(GLuint& buffer);
+void gpuDeleteFramebuffer(GLuint& fbo);
+
+// Warn whenever live bytes in `category` go above `bytes`, 0 for no limit
+void gpuMemorySetBudget(GpuCategory category, size_t bytes);
+// Same over every category together
+void gpuMemorySetTotalBudget(size_t bytes);
+
+size_t gpuMemoryLive(GpuCategory category);
+// Live bytes per category, then every resource biggest first
+void gpuMemoryReport();
+// Print whatever is still registered, returns how many there were
+size_t gpuMemoryReportLeaks();
@@ -0,0 +1,235 @@
+#include "gpuResources.h"
+
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    struct Slot {
+        // 0 while the slot is free
+        GLuint name = 0;
+        uint32_t generation = 1;
+        GpuCategory category = gpuBuffers;
+        GpuTextureDesc tex = {};
+        GpuBufferDesc buf = {};
+    };
+
+    struct Spare {
+        GLuint name;
+        GpuCategory category;
+        GpuTextureDesc tex;
+        GpuBufferDesc buf;
+    };
+
+    struct Pool {
+        std::vector<Slot> slots;
+        std::vector<uint32_t> freeSlots;
+        // Released objects that still have their storage, oldest first
+        std::vector<Spare> spares;
+        // Names from a batch nobody has used yet, by texture target (0 for buffers and framebuffers)
+        std::unordered_map<GLenum, std::vector<GLuint>> names;
+    };
+
+    Pool pools[gpuResourceKindCount];
+    GpuResourceStats stats;
+
+    GLuint newName(GpuResourceKind kind, GLenum target){
+        std::vector<GLuint>& names = pools[kind].names[target];
+        if(names.empty()){
+            names.resize(gpuNameBatch);
+            if(kind == gpuTextureKind)     glCreateTextures(target, gpuNameBatch, names.data());
+            else if(kind == gpuBufferKind) glCreateBuffers(gpuNameBatch, names.data());
+            else                           glCreateFramebuffers(gpuNameBatch, names.data());
+            stats.namesCreated += gpuNameBatch;
+        }
+        GLuint name = names.back();
+        names.pop_back();
+        return name;
+    }
+
+    bool sameTexture(const GpuTextureDesc& a, const GpuTextureDesc& b){
+        return a.target == b.target && a.internalFormat == b.internalFormat && a.width == b.width && a.height == b.height &&
+               a.levels == b.levels && (a.target != GL_TEXTURE_2D_ARRAY || a.layers == b.layers);
+    }
+
+    void track(GpuResourceKind kind, GLuint name, GpuCategory category, const GpuTextureDesc& tex, const GpuBufferDesc& buf,
+               const char* label){
+        if(kind == gpuTextureKind){
+            const int layers = tex.target == GL_TEXTURE_2D_ARRAY ? tex.layers : 1;
+            gpuTrackTexture(name, category, label, tex.internalFormat, tex.width, tex.height, layers, tex.levels);
+        } else if(kind == gpuBufferKind){
+            gpuTrackBuffer(name, category, label, buf.size);
+        } else {
+            gpuTrackFramebuffer(name, label);
+        }
+    }
+
+    // Spares and objects destroyed outright, gpuMemory forgets them too
+    void deleteSpare(GpuResourceKind kind, Spare& spare){
+        if(kind == gpuTextureKind)     gpuDeleteTexture(spare.name);
+        else if(kind == gpuBufferKind) gpuDeleteBuffer(spare.name);
+        else                           gpuDeleteFramebuffer(spare.name);
+    }
+
+    // The newest spare `matches` accepts, taken off the list. 0 when there isn't one.
+    template<typename Match>
+    GLuint takeSpare(GpuResourceKind kind, Match matches){
+        std::vector<Spare>& spares = pools[kind].spares;
+        for(size_t i = spares.size(); i-- > 0;){
+            if(!matches(spares[i])) continue;
+            GLuint name = spares[i].name;
+            spares.erase(spares.begin() + i);
+            stats.recycled++;
+            return name;
+        }
+        return 0;
+    }
+
+    GpuHandle occupy(GpuResourceKind kind, GLuint name, GpuCategory category, const GpuTextureDesc& tex, const GpuBufferDesc& buf){
+        Pool& pool = pools[kind];
+        uint32_t index;
+        if(!pool.freeSlots.empty()){
+            index = pool.freeSlots.back();
+            pool.freeSlots.pop_back();
+        } else {
+            index = pool.slots.size();
+            pool.slots.push_back(Slot());
+        }
+
+        Slot& slot = pool.slots[index];
+        slot.name = name;
+        slot.category = category;
+        slot.tex = tex;
+        slot.buf = buf;
+        stats.acquired++;
+
+        GpuHandle handle;
+        handle.index = index;
+        handle.generation = slot.generation;
+        handle.kind = kind;
+        return handle;
+    }
+
+    Slot* slotFor(const GpuHandle& handle){
+        // Empty handles never look at the pools, globals holding one can go after they do
+        if(!handle.generation || handle.kind >= gpuResourceKindCount) return nullptr;
+        Pool& pool = pools[handle.kind];
+        if(handle.index >= pool.slots.size()) return nullptr;
+        Slot& slot = pool.slots[handle.index];
+        return slot.name && slot.generation == handle.generation ? &slot : nullptr;
+    }
+
+    void freeSlot(const GpuHandle& handle){
+        Slot& slot = pools[handle.kind].slots[handle.index];
+        slot.name = 0;
+        // Skip 0 on wrap around, that's what empty handles have
+        if(++slot.generation == 0) slot.generation = 1;
+        pools[handle.kind].freeSlots.push_back(handle.index);
+    }
+
+    // So the next owner doesn't render into (or keep alive) the last one's textures
+    void detachAll(GLuint fbo){
+        for(int i = 0; i < 8; i++) glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0 + i, 0, 0);
+        glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, 0, 0);
+        glNamedFramebufferTexture(fbo, GL_STENCIL_ATTACHMENT, 0, 0);
+        glNamedFramebufferDrawBuffer(fbo, GL_COLOR_ATTACHMENT0);
+    }
+}
+
+GpuHandle gpuTextureAcquire(const GpuTextureDesc& desc, GpuCategory category, const char* label){
+    GLuint name = takeSpare(gpuTextureKind, [&](const Spare& s){ return sameTexture(s.tex, desc); });
+    if(!name){
+        name = newName(gpuTextureKind, desc.target);
+        if(desc.target == GL_TEXTURE_2D_ARRAY) glTextureStorage3D(name, desc.levels, desc.internalFormat, desc.width, desc.height, desc.layers);
+        else                                   glTextureStorage2D(name, desc.levels, desc.internalFormat, desc.width, desc.height);
+    }
+    track(gpuTextureKind, name, category, desc, GpuBufferDesc(), label);
+    return occupy(gpuTextureKind, name, category, desc, GpuBufferDesc());
+}
+
+GpuHandle gpuBufferAcquire(const GpuBufferDesc& desc, GpuCategory category, const char* label, const void* data){
+    // Storage without GL_DYNAMIC_STORAGE_BIT can only be filled when it's made
+    const bool canUpload = !data || (desc.flags & GL_DYNAMIC_STORAGE_BIT);
+    GLuint name = 0;
+    if(canUpload){
+        name = takeSpare(gpuBufferKind, [&](const Spare& s){ return s.buf.size == desc.size && s.buf.flags == desc.flags; });
+    }
+    if(name){
+        if(data) glNamedBufferSubData(name, 0, desc.size, data);
+    } else {
+        name = newName(gpuBufferKind, 0);
+        glNamedBufferStorage(name, desc.size, data, desc.flags);
+    }
+    track(gpuBufferKind, name, category, GpuTextureDesc(), desc, label);
+    return occupy(gpuBufferKind, name, category, GpuTextureDesc(), desc);
+}
+
+GpuHandle gpuFramebufferAcquire(const char* label){
+    GLuint name = takeSpare(gpuFramebufferKind, [](const Spare&){ return true; });
+    if(!name) name = newName(gpuFramebufferKind, 0);
+    track(gpuFramebufferKind, name, gpuRenderTargets, GpuTextureDesc(), GpuBufferDesc(), label);
+    return occupy(gpuFramebufferKind, name, gpuRenderTargets, GpuTextureDesc(), GpuBufferDesc());
+}
+
+void gpuRelease(GpuHandle& handle){
+    Slot* slot = slotFor(handle);
+    if(slot){
+        const GpuResourceKind kind = handle.kind;
+        Pool& pool = pools[kind];
+        if(kind == gpuFramebufferKind) detachAll(slot->name);
+
+        // Spares still take up memory, they just show up as spare until something picks them up
+        Spare spare = {slot->name, slot->category, slot->tex, slot->buf};
+        track(kind, spare.name, spare.category, spare.tex, spare.buf, "spare");
+        pool.spares.push_back(spare);
+        if(pool.spares.size() > (size_t)maxGpuSpares){
+            deleteSpare(kind, pool.spares.front());
+            pool.spares.erase(pool.spares.begin());
+        }
+        freeSlot(handle);
+    }
+    handle = GpuHandle();
+}
+
+void gpuDestroy(GpuHandle& handle){
+    Slot* slot = slotFor(handle);
+    if(slot){
+        Spare gone = {slot->name, slot->category, slot->tex, slot->buf};
+        deleteSpare(handle.kind, gone);
+        freeSlot(handle);
+    }
+    handle = GpuHandle();
+}
+
+GLuint gpuResourceName(const GpuHandle& handle){
+    const Slot* slot = slotFor(handle);
+    return slot ? slot->name : 0;
+}
+
+GpuResourceStats gpuResourceStats(){
+    return stats;
+}
+
+void gpuResourcesTrim(){
+    for(int k = 0; k < gpuResourceKindCount; k++){
+        Pool& pool = pools[k];
+        for(Spare& spare : pool.spares) deleteSpare((GpuResourceKind)k, spare);
+        pool.spares.clear();
+
+        // Never had storage or a label, gpuMemory doesn't know about these
+        for(auto& names : pool.names){
+            if(names.second.empty()) continue;
+            if(k == gpuTextureKind)     glDeleteTextures(names.second.size(), names.second.data());
+            else if(k == gpuBufferKind) glDeleteBuffers(names.second.size(), names.second.data());
+            else                        glDeleteFramebuffers(names.second.size(), names.second.data());
+        }
+        pool.names.clear();
+    }
+}
+
+void gpuResourcesShutdown(){
+    gpuResourcesTrim();
+    size_t held = 0;
+    for(const Pool& pool : pools) held += pool.slots.size() - pool.freeSlots.size();
+    if(held) printf("GPU resources: %zu handles still held at shutdown\n", held);
+}
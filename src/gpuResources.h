@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "glad/glad.h"
+#include "gpuMemory.h"
+
+// Textures, buffers and framebuffers handed out from pools instead of made and deleted on the spot.
+// - Names are created in batches, one glCreate* call per gpuNameBatch objects.
+// - Released objects keep their immutable storage and go on a spare list. The next request with the same
+//   target, format and size (or buffer size and flags) gets one of those back instead of a new allocation.
+// - What callers hold is a generational handle: a slot index and the generation that slot was on when it was
+//   handed out. Releasing bumps the generation, so a stale copy resolves to 0 instead of whatever took its place.
+// GpuTexture, GpuBuffer and GpuFramebuffer own a handle and release it when they go, they can be moved but not
+// copied. Everything is registered with gpuMemory, spares included, until gpuResourcesTrim deletes them.
+// A recycled object keeps whatever contents and texture parameters its last owner left behind.
+
+const int gpuNameBatch = 16;
+// Most spares of each kind kept around, the oldest get deleted past that
+const int maxGpuSpares = 8;
+
+enum GpuResourceKind {
+    gpuTextureKind,
+    gpuBufferKind,
+    gpuFramebufferKind,
+    gpuResourceKindCount
+};
+
+struct GpuHandle {
+    uint32_t index = 0;
+    // 0 is never handed out, so a default constructed handle is always stale
+    uint32_t generation = 0;
+    GpuResourceKind kind = gpuTextureKind;
+};
+
+struct GpuTextureDesc {
+    // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+    GLenum target;
+    GLenum internalFormat;
+    int width, height;
+    // Array layers, ignored for GL_TEXTURE_2D
+    int layers = 1;
+    int levels = 1;
+};
+
+struct GpuBufferDesc {
+    size_t size;
+    // glNamedBufferStorage flags, recycling only happens between buffers with the same ones
+    GLbitfield flags = 0;
+};
+
+// Storage is allocated, `label` goes to gpuMemory and the debugger
+GpuHandle gpuTextureAcquire(const GpuTextureDesc& desc, GpuCategory category, const char* label);
+// `data` fills it if there is any, a recycled buffer can only take data with GL_DYNAMIC_STORAGE_BIT
+GpuHandle gpuBufferAcquire(const GpuBufferDesc& desc, GpuCategory category, const char* label, const void* data = nullptr);
+GpuHandle gpuFramebufferAcquire(const char* label);
+// Back to the spares, the handle is cleared. Stale or empty handles are ignored.
+void gpuRelease(GpuHandle& handle);
+// Delete it outright instead, for storage nothing is going to ask for again
+void gpuDestroy(GpuHandle& handle);
+// GL name behind `handle`, 0 once it's been released
+GLuint gpuResourceName(const GpuHandle& handle);
+
+struct GpuResourceStats {
+    uint64_t acquired = 0;
+    // Acquires served from the spares
+    uint64_t recycled = 0;
+    uint64_t namesCreated = 0;
+};
+GpuResourceStats gpuResourceStats();
+
+// Delete every spare and unused name, live objects stay
+void gpuResourcesTrim();
+// Trim and report anything still held, needs the context to still be around
+void gpuResourcesShutdown();
+
+template<GpuResourceKind Kind>
+class GpuResource {
+public:
+    GpuResource() = default;
+    explicit GpuResource(GpuHandle h) : handle(h) {}
+    GpuResource(GpuResource&& other) : handle(other.handle) { other.handle = GpuHandle(); }
+    GpuResource& operator=(GpuResource&& other){
+        if(this != &other){
+            gpuRelease(handle);
+            handle = other.handle;
+            other.handle = GpuHandle();
+        }
+        return *this;
+    }
+    GpuResource(const GpuResource&) = delete;
+    GpuResource& operator=(const GpuResource&) = delete;
+    ~GpuResource(){ gpuRelease(handle); }
+
+    GLuint id() const { return gpuResourceName(handle); }
+    const GpuHandle& get() const { return handle; }
+    void reset(){ gpuRelease(handle); }
+    void destroy(){ gpuDestroy(handle); }
+
+private:
+    GpuHandle handle;
+};
+
+typedef GpuResource<gpuTextureKind> GpuTexture;
+typedef GpuResource<gpuBufferKind> GpuBuffer;
+typedef GpuResource<gpuFramebufferKind> GpuFramebuffer;
+
+inline GpuTexture gpuTextureCreate(const GpuTextureDesc& desc, GpuCategory category, const char* label){
+    return GpuTexture(gpuTextureAcquire(desc, category, label));
+}
+inline GpuBuffer gpuBufferCreate(const GpuBufferDesc& desc, GpuCategory category, const char* label, const void* data = nullptr){
+    return GpuBuffer(gpuBufferAcquire(desc, category, label, data));
+}
+inline GpuFramebuffer gpuFramebufferCreate(const char* label){
+    return GpuFramebuffer(gpuFramebufferAcquire(label));
+}
@@ -0,0 +1,138 @@
+#include "imageLoad.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "arena.h"
+#include "jpegDecode.h"
+#include "profiler.h"
+#include "stb/stb_image.h"
+
+namespace {
+    const int maxScaleShift = 3;
+
+    int scaledSize(int size, int shift){
+        return (size + (1 << shift) - 1) >> shift;
+    }
+
+    // How many times the image can be halved and still satisfy opts
+    int pickScaleShift(int width, int height, int numCh, const ImageLoadOptions& opts){
+        int shift = std::min(std::max(opts.scaleShift, 0), maxScaleShift);
+        if(opts.displayWidth > 0 && opts.displayHeight > 0){
+            while(shift < maxScaleShift &&
+                  scaledSize(width,  shift + 1) >= opts.displayWidth &&
+                  scaledSize(height, shift + 1) >= opts.displayHeight){
+                shift++;
+            }
+        }
+        if(opts.maxBytes){
+            while(shift < maxScaleShift &&
+                  (size_t)scaledSize(width, shift) * scaledSize(height, shift) * numCh > opts.maxBytes){
+                shift++;
+            }
+        }
+        return shift;
+    }
+
+    // Average each (1 << shift) square down to one pixel, the blocks on the right and bottom edges
+    // only average what's there. Frees `pixels` and returns the new ones.
+    unsigned char* boxDownscale(unsigned char* pixels, int* width, int* height, int numCh, int shift){
+        const int w = *width, h = *height;
+        const int outW = scaledSize(w, shift), outH = scaledSize(h, shift);
+        unsigned char* out = (unsigned char*)scratchMalloc((size_t)outW * outH * numCh);
+        if(!out){
+            scratchFree(pixels);
+            return nullptr;
+        }
+
+        const int block = 1 << shift;
+        unsigned int* sums = (unsigned int*)scratchMalloc((size_t)outW * numCh * sizeof(unsigned int));
+        if(!sums){
+            scratchFree(out);
+            scratchFree(pixels);
+            return nullptr;
+        }
+        for(int oy = 0; oy < outH; oy++){
+            std::fill(sums, sums + (size_t)outW * numCh, 0);
+            const int yEnd = std::min(oy * block + block, h);
+            for(int y = oy * block; y < yEnd; y++){
+                const unsigned char* row = pixels + (size_t)y * w * numCh;
+                for(int x = 0; x < w; x++){
+                    for(int c = 0; c < numCh; c++) sums[(x >> shift) * numCh + c] += row[x * numCh + c];
+                }
+            }
+            const int rows = yEnd - oy * block;
+            unsigned char* dst = out + (size_t)oy * outW * numCh;
+            for(int ox = 0; ox < outW; ox++){
+                const unsigned int n = rows * (std::min(ox * block + block, w) - ox * block);
+                for(int c = 0; c < numCh; c++) dst[ox * numCh + c] = (sums[ox * numCh + c] + n / 2) / n;
+            }
+        }
+
+        scratchFree(sums);
+        scratchFree(pixels);
+        *width = outW;
+        *height = outH;
+        return out;
+    }
+}
+
+bool imageReadFile(const char* fName, std::vector<unsigned char>& data){
+    FILE* f = fopen(fName, "rb");
+    if(!f) return false;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    data.resize(len > 0 ? len : 0);
+    bool ok = len > 0 && fread(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+unsigned char* imageLoad(const char* fName, int* width, int* height, int* numCh, const ImageLoadOptions& opts){
+    std::vector<unsigned char> data;
+    if(!imageReadFile(fName, data)){
+        printf("Failed to open file \'%s\'\n", fName);
+        return nullptr;
+    }
+    return imageLoadMemory(data.data(), data.size(), width, height, numCh, opts);
+}
+
+bool imageLoadInfo(const unsigned char* data, size_t size, int* width, int* height, const ImageLoadOptions& opts){
+    int fullW, fullH, fileCh;
+    if(!stbi_info_from_memory(data, size, &fullW, &fullH, &fileCh)) return false;
+    const int shift = pickScaleShift(fullW, fullH, fileCh, opts);
+    *width = scaledSize(fullW, shift);
+    *height = scaledSize(fullH, shift);
+    return true;
+}
+
+unsigned char* imageLoadMemory(const unsigned char* data, size_t size, int* width, int* height, int* numCh, const ImageLoadOptions& opts){
+    PROFILE_ZONE("decode image");
+    // Only the header is needed to know how far down the image can go
+    int shift = 0;
+    int fullW, fullH, fileCh;
+    if(stbi_info_from_memory(data, size, &fullW, &fullH, &fileCh)){
+        shift = pickScaleShift(fullW, fullH, fileCh, opts);
+    }
+
+    // SOI marker
+    if(size > 2 && data[0] == 0xFF && data[1] == 0xD8){
+        unsigned char* pixels = jpegDecode(data, size, width, height, numCh, shift);
+        if(pixels) return pixels;
+    }
+
+    unsigned char* pixels = stbi_load_from_memory(data, size, width, height, numCh, 0);
+    if(pixels && shift){
+        pixels = boxDownscale(pixels, width, height, *numCh, shift);
+    }
+    return pixels;
+}
+
+void imageFree(unsigned char* pixels){
+    // jpegDecode and stb_image both allocate through the scratch allocator
+    scratchFree(pixels);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Lets the loader skip resolution nobody will see. Each step halves both sides, down to 1/8 scale at most.
+struct ImageLoadOptions {
+    // Smallest size the image is shown at, it gets shrunk as long as both sides stay at least this big.
+    // Left at 0 the image keeps its full size.
+    int displayWidth = 0, displayHeight = 0;
+    // Most bytes the decoded pixels may take, keeps halving until it fits. 0 for no limit.
+    size_t maxBytes = 0;
+    // Halve at least this many times whatever the above say, for quick previews
+    int scaleShift = 0;
+};
+
+// Decode an image file into 8-bit pixels, `numCh` gets the channel count of what came back.
+// JPEGs go through the multithreaded decoder in jpegDecode, everything else (or anything it
+// turns down) through stb_image. Release the pixels with imageFree.
+// Inside an ArenaScope the pixels come out of its arena, so they have to be freed (or dropped) before it ends.
+// With options that ask for a smaller image, JPEGs are decoded straight at the smaller size, anything
+// else is decoded in full and box filtered down. `width` and `height` are the size that came back.
+unsigned char* imageLoad(const char* fName, int* width, int* height, int* numCh, const ImageLoadOptions& opts = ImageLoadOptions());
+// Same thing for a file that's already in memory
+unsigned char* imageLoadMemory(const unsigned char* data, size_t size, int* width, int* height, int* numCh, const ImageLoadOptions& opts = ImageLoadOptions());
+// Size imageLoadMemory would come back with, from the header alone
+bool imageLoadInfo(const unsigned char* data, size_t size, int* width, int* height, const ImageLoadOptions& opts = ImageLoadOptions());
+// Whole file into `data`, false if it can't be read or is empty
+bool imageReadFile(const char* fName, std::vector<unsigned char>& data);
+void imageFree(unsigned char* pixels);
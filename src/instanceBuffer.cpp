@@ -0,0 +1,123 @@
+#include "instanceBuffer.h"
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "glCapture.h"
+
+namespace {
+    const GLbitfield instanceMapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    // Smallest copy in matrices. 16KB, so every copy's offset is aligned way past GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT.
+    const size_t minInstanceCapacity = 256;
+
+    void waitCopy(InstanceBuffer& instances, int frame){
+        GLsync& fence = instances.fences[frame];
+        if(!fence) return;
+        // Normally long signaled, the copy was last drawn with instanceFrames - 1 frames ago
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~(GLuint64)0);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    size_t copyBytes(const InstanceBuffer& instances){
+        return instances.capacity * sizeof(Mat4);
+    }
+
+    void releaseBuffer(InstanceBuffer& instances){
+        for(int f = 0; f < instanceFrames; f++){
+            waitCopy(instances, f);
+            instances.written[f].clear();
+        }
+        // Unmapped first, a recycled buffer can't be mapped twice
+        if(instances.mapped) glUnmapNamedBuffer(instances.buffer.id());
+        instances.mapped = nullptr;
+        instances.buffer.reset();
+        instances.capacity = 0;
+    }
+
+    bool growBuffer(InstanceBuffer& instances, size_t count){
+        releaseBuffer(instances);
+        size_t capacity = minInstanceCapacity;
+        while(capacity < count) capacity *= 2;
+        instances.capacity = capacity;
+
+        const bool recording = glCaptureActive();
+        const GLbitfield flags = recording ? GL_DYNAMIC_STORAGE_BIT : instanceMapFlags;
+        instances.buffer = gpuBufferCreate({copyBytes(instances) * instanceFrames, flags}, gpuBuffers, "instance transforms");
+        if(!instances.buffer.id()){
+            printf("Failed to make the instance transform buffer\n");
+            instances.capacity = 0;
+            return false;
+        }
+        if(!recording){
+            instances.mapped = (Mat4*)glMapNamedBufferRange(instances.buffer.id(), 0, copyBytes(instances) * instanceFrames, instanceMapFlags);
+            if(!instances.mapped){
+                printf("Failed to map the instance transform buffer\n");
+                instances.buffer.reset();
+                instances.capacity = 0;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void writeMatrices(Mat4* copy, const Transforms& t, const std::vector<TransformId>& ids){
+        for(TransformId id : ids) copy[id] = transformWorld(t, id);
+    }
+}
+
+bool instanceBufferUpdate(InstanceBuffer& instances, const Transforms& t, const std::vector<TransformId>& changed){
+    const size_t count = t.indexOf.size();
+    if(!count) return true;
+    waitCopy(instances, instances.frame);
+
+    const bool grown = count > instances.capacity;
+    if(grown && !growBuffer(instances, count)) return false;
+    if(instances.mapped){
+        Mat4* copy = instances.mapped + (size_t)instances.frame * instances.capacity;
+        if(grown){
+            // Every copy starts out empty
+            for(int f = 0; f < instanceFrames; f++){
+                Mat4* fresh = instances.mapped + (size_t)f * instances.capacity;
+                for(size_t i = 0; i < count; i++) fresh[t.idAt[i]] = t.world[i];
+            }
+        } else {
+            // This copy missed everything the others got since it was last written
+            for(int f = 0; f < instanceFrames; f++){
+                if(f != instances.frame) writeMatrices(copy, t, instances.written[f]);
+            }
+            writeMatrices(copy, t, changed);
+        }
+    } else {
+        // Recording, the whole copy goes through glNamedBufferSubData so the file has it
+        bool stale = grown || !changed.empty();
+        for(const std::vector<TransformId>& ids : instances.written) stale = stale || !ids.empty();
+        if(stale){
+            Mat4* copy = frameAlloc<Mat4>(count);
+            for(size_t i = 0; i < count; i++) copy[t.idAt[i]] = t.world[i];
+            for(int f = 0; f < instanceFrames; f++){
+                if(grown || f == instances.frame){
+                    glNamedBufferSubData(instances.buffer.id(), f * copyBytes(instances), count * sizeof(Mat4), copy);
+                }
+            }
+        }
+    }
+    instances.written[instances.frame] = changed;
+    return true;
+}
+
+void instanceBufferBind(const InstanceBuffer& instances){
+    if(!instances.capacity) return;
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, instanceBinding, instances.buffer.id(), instances.frame * copyBytes(instances), copyBytes(instances));
+}
+
+void instanceBufferFrameEnd(InstanceBuffer& instances){
+    if(!instances.capacity) return;
+    instances.fences[instances.frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    instances.frame = (instances.frame + 1) % instanceFrames;
+}
+
+void instanceBufferFree(InstanceBuffer& instances){
+    releaseBuffer(instances);
+    instances.frame = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "glad/glad.h"
+#include "gpuResources.h"
+#include "transforms.h"
+
+// World matrices from transforms.h on the GPU, for vertex.glsl with INSTANCE_TRANSFORMS. Indexed by TransformId,
+// Mat4 is laid out like a std430 mat4, so the matrices go across as they are.
+// The buffer holds a copy per frame in flight and stays persistently mapped, so an update writes changed matrices
+// straight into the copy this frame draws with. A copy also has to catch up on what changed while the others were
+// being written, so the last few frames' changes are kept around. While glCapture is recording, writes through a
+// mapping wouldn't make it into the file, so the copy is uploaded whole with glNamedBufferSubData instead.
+
+// Ssbo binding vertex.glsl reads them from, the draw's gl_BaseInstance picks one
+const GLuint instanceBinding = 2;
+// Each frame writes the next copy, so the CPU never touches one the GPU could still be reading
+const int instanceFrames = 3;
+
+struct InstanceBuffer {
+    GpuBuffer buffer;
+    Mat4* mapped = nullptr;
+    // Matrices a copy has room for
+    size_t capacity = 0;
+    int frame = 0;
+    GLsync fences[instanceFrames] = {};
+    // What changed in the frame that last wrote each copy
+    std::vector<TransformId> written[instanceFrames];
+};
+
+// Write this frame's copy, `changed` from transformsUpdate. Grows the buffer when there are more ids than fit.
+bool instanceBufferUpdate(InstanceBuffer& instances, const Transforms& transforms, const std::vector<TransformId>& changed);
+// Bind this frame's copy at instanceBinding
+void instanceBufferBind(const InstanceBuffer& instances);
+// After the frame's draws, fences this frame's copy and moves on to the next
+void instanceBufferFrameEnd(InstanceBuffer& instances);
+void instanceBufferFree(InstanceBuffer& instances);
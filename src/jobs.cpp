@@ -0,0 +1,201 @@
+#include "jobs.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "profiler.h"
+
+namespace {
+    struct Job {
+        int priority;
+        unsigned long long seq;
+        std::function<void()> fn;
+
+        // priority_queue pops the "largest", so invert: low priority value and low seq come out first
+        bool operator<(const Job& other) const {
+            if(priority != other.priority) return priority > other.priority;
+            return seq > other.seq;
+        }
+    };
+
+    struct {
+        std::vector<std::thread> threads;
+        std::priority_queue<Job> queue;
+        std::mutex lock;
+        std::condition_variable wake;
+        unsigned long long seq = 0;
+        bool quit = false;
+    } pool;
+
+    void workerMain(unsigned int index){
+        char name[32];
+        snprintf(name, sizeof(name), "worker %u", index);
+        profilerThreadName(name);
+
+        while(true){
+            Job job;
+            {
+                std::unique_lock<std::mutex> lk(pool.lock);
+                pool.wake.wait(lk, []{ return pool.quit || !pool.queue.empty(); });
+                if(pool.queue.empty()) return;
+                job = pool.queue.top();
+                pool.queue.pop();
+            }
+            job.fn();
+        }
+    }
+
+    // Shared between the caller of parallelFor and any workers that pick up a share of it.
+    // A helper job can get dequeued after the caller already returned, so the last one holding it hands it
+    // back to spareBatches. Reusing them (and capturing a plain pointer, small enough for std::function to
+    // keep inline) means a parallelFor doesn't allocate once a few have run.
+    struct ForBatch {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::atomic<int> refs{0};
+        size_t count;
+        const std::function<void(size_t)>* fn;
+        std::mutex lock;
+        std::condition_variable finished;
+    };
+
+    // Guarded by pool.lock
+    std::vector<std::unique_ptr<ForBatch>> spareBatches;
+
+    void releaseBatch(ForBatch* batch){
+        if(--batch->refs > 0) return;
+        std::lock_guard<std::mutex> lk(pool.lock);
+        spareBatches.emplace_back(batch);
+    }
+
+    void runBatch(ForBatch& batch){
+        size_t ran = 0;
+        for(size_t i; (i = batch.next.fetch_add(1)) < batch.count; ran++){
+            (*batch.fn)(i);
+        }
+        if(ran && batch.done.fetch_add(ran) + ran == batch.count){
+            std::lock_guard<std::mutex> lk(batch.lock);
+            batch.finished.notify_all();
+        }
+    }
+}
+
+void jobsInit(unsigned int numThreads){
+    if(!pool.threads.empty()) return;
+
+    if(numThreads == 0){
+        unsigned int hw = std::thread::hardware_concurrency();
+        numThreads = hw > 1 ? hw - 1 : 1;
+    }
+
+    pool.quit = false;
+    for(unsigned int i = 0; i < numThreads; i++){
+        pool.threads.emplace_back(workerMain, i);
+    }
+}
+
+void jobsShutdown(){
+    {
+        std::lock_guard<std::mutex> lk(pool.lock);
+        pool.quit = true;
+    }
+    pool.wake.notify_all();
+    for(auto& t : pool.threads) t.join();
+    pool.threads.clear();
+    spareBatches.clear();
+}
+
+unsigned int jobsWorkerCount(){
+    return pool.threads.size();
+}
+
+void jobsSubmit(std::function<void()> fn, int priority){
+    if(pool.threads.empty()){
+        // Nobody to hand it to
+        fn();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(pool.lock);
+        pool.queue.push({priority, pool.seq++, std::move(fn)});
+    }
+    pool.wake.notify_one();
+}
+
+void jobsSubmit(JobGroup& group, std::function<void()> fn, int priority){
+    group.pending++;
+    jobsSubmit([&group, fn = std::move(fn)]{
+        fn();
+        // Take the lock so a waiter can't miss the wakeup between its check and its wait
+        std::lock_guard<std::mutex> lk(group.lock);
+        if(--group.pending == 0) group.done.notify_all();
+    }, priority);
+}
+
+void jobsWait(JobGroup& group){
+    // Help out rather than just sleep. A job that waits on jobs of its own (a decode on a worker handing its rows
+    // out) would otherwise deadlock as soon as every worker is doing the same thing.
+    while(group.pending.load() != 0){
+        Job job;
+        {
+            std::lock_guard<std::mutex> lk(pool.lock);
+            if(!pool.queue.empty()){
+                job = pool.queue.top();
+                pool.queue.pop();
+            }
+        }
+        if(job.fn){
+            job.fn();
+            continue;
+        }
+        // Nothing left queued, whatever is still pending is running somewhere and will get there
+        std::unique_lock<std::mutex> lk(group.lock);
+        group.done.wait(lk, [&]{ return group.pending.load() == 0; });
+    }
+}
+
+void parallelFor(size_t count, const std::function<void(size_t)>& fn){
+    if(count == 0) return;
+
+    size_t helpers = std::min<size_t>(pool.threads.size(), count - 1);
+    if(helpers == 0){
+        for(size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    ForBatch* batch;
+    {
+        std::lock_guard<std::mutex> lk(pool.lock);
+        if(spareBatches.empty()){
+            batch = new ForBatch();
+        } else {
+            batch = spareBatches.back().release();
+            spareBatches.pop_back();
+        }
+        batch->next = 0;
+        batch->done = 0;
+        batch->refs = helpers + 1;
+        batch->count = count;
+        batch->fn = &fn;
+
+        // Go ahead of background work, the caller is blocked on this
+        for(size_t i = 0; i < helpers; i++){
+            pool.queue.push({-1000000, pool.seq++, [batch]{
+                runBatch(*batch);
+                releaseBatch(batch);
+            }});
+        }
+    }
+    pool.wake.notify_all();
+
+    runBatch(*batch);
+    {
+        std::unique_lock<std::mutex> lk(batch->lock);
+        batch->finished.wait(lk, [&]{ return batch->done.load() == count; });
+    }
+    releaseBatch(batch);
+}
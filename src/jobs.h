@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+// Tiny thread pool shared by everything that wants to go wide (the software rasterizer, decoders, ...)
+
+// Spin up the workers. 0 means one per hardware thread, minus the one calling this.
+// There is always at least one worker so submitted jobs make progress on single core boxes.
+void jobsInit(unsigned int numThreads = 0);
+// Finish whatever is queued and join the workers
+void jobsShutdown();
+unsigned int jobsWorkerCount();
+
+// Call fn(i) for every i in [0, count) spread across the workers.
+// The calling thread works too and only returns once every index is done.
+void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+// Queue fn to run on a worker some time later, lower priority values are picked first.
+void jobsSubmit(std::function<void()> fn, int priority = 0);
+
+// Tracks a batch of submitted jobs so the submitter can wait for just those
+struct JobGroup {
+    std::atomic<int> pending{0};
+    std::mutex lock;
+    std::condition_variable done;
+};
+
+void jobsSubmit(JobGroup& group, std::function<void()> fn, int priority = 0);
+// Block until every job submitted to `group` has finished, running queued jobs (anyone's) in the meantime.
+// Safe to call from inside a job.
+void jobsWait(JobGroup& group);
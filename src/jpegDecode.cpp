@@ -0,0 +1,975 @@
+#include "jpegDecode.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "arena.h"
+
+#if defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "jobs.h"
+
+namespace {
+    // Natural order index of each zigzag position
+    const uint8_t dezigzag[64] = {
+         0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+    };
+
+    // Codes up to this long are resolved with one table lookup
+    const int fastBits = 9;
+
+    struct Huffman {
+        // (length << 8) | symbol, 0xffff when the code is longer than fastBits
+        uint16_t fast[1 << fastBits];
+        uint16_t firstCode[17];
+        uint16_t count[17];
+        uint16_t symStart[17];
+        uint8_t symbols[256];
+        // AC tables only: run, value and total bit count for codes whose value bits also fit in fastBits.
+        // (value << 8) | (run << 4) | length, 0 if it has to go the long way.
+        int16_t fastAc[1 << fastBits];
+        bool valid = false;
+    };
+
+    struct Component {
+        int id;
+        int h, v;
+        int tq;
+        int td, ta;
+        // Plane size in blocks, padded out to whole MCUs
+        int blocksX, blocksY;
+        // Samples actually covered by the image
+        int width, height;
+        uint8_t* plane;
+        int stride;
+    };
+
+    struct Jpeg {
+        const uint8_t* data;
+        size_t size;
+
+        int width = 0, height = 0;
+        // Size after scaling, blocks come out blockSize square instead of 8
+        int outWidth = 0, outHeight = 0;
+        int scaleShift = 0, blockSize = 8;
+        int ncomp = 0;
+        Component comp[3];
+        uint16_t quant[4][64];
+        bool haveQuant[4] = {};
+        Huffman dc[4], ac[4];
+        int restartInterval = 0;
+        int adobeTransform = -1;
+
+        int hmax = 1, vmax = 1;
+        int mcusX = 0, mcusY = 0;
+
+        // Components of the (single) scan in the order they're coded
+        int scanComp[3];
+        size_t scanStart = 0;
+    };
+
+    inline unsigned int be16(const uint8_t* p){
+        return p[0] << 8 | p[1];
+    }
+
+    bool buildHuffman(Huffman& h, const uint8_t* counts, const uint8_t* symbols){
+        // Check the counts describe a valid code before anything gets written, a bad one would index past fast[]
+        int total = 0;
+        unsigned int code = 0;
+        for(int len = 1; len <= 16; len++){
+            total += counts[len - 1];
+            code += counts[len - 1];
+            if(total > 256 || code > (1u << len)) return false;
+            code <<= 1;
+        }
+
+        total = 0;
+        code = 0;
+        memset(h.fast, 0xff, sizeof(h.fast));
+        for(int len = 1; len <= 16; len++){
+            h.count[len] = counts[len - 1];
+            h.firstCode[len] = code;
+            h.symStart[len] = total;
+
+            for(int i = 0; i < counts[len - 1]; i++, code++){
+                if(len <= fastBits){
+                    // Every fastBits wide pattern starting with this code maps to it
+                    unsigned int first = code << (fastBits - len);
+                    for(unsigned int k = 0; k < (1u << (fastBits - len)); k++){
+                        h.fast[first + k] = (len << 8) | symbols[total + i];
+                    }
+                }
+            }
+            total += counts[len - 1];
+            code <<= 1;
+        }
+
+        memcpy(h.symbols, symbols, total);
+        h.valid = true;
+        return true;
+    }
+
+    inline int extend(int v, int s){
+        return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+    }
+
+    void buildFastAc(Huffman& h){
+        for(int i = 0; i < (1 << fastBits); i++){
+            h.fastAc[i] = 0;
+            if(h.fast[i] == 0xffff) continue;
+
+            int len = h.fast[i] >> 8, sym = h.fast[i] & 0xff;
+            int run = sym >> 4, size = sym & 15;
+            if(size == 0 || len + size > fastBits) continue;
+
+            // The value bits sit right after the code
+            int bits = (i << len) & ((1 << fastBits) - 1);
+            int value = extend(bits >> (fastBits - size), size);
+            if(value >= -128 && value <= 127){
+                h.fastAc[i] = (int16_t)(value * 256 + run * 16 + len + size);
+            }
+        }
+    }
+
+    // Reads the markers up to and including the first SOS.
+    // Returns false for anything broken or not handled here.
+    bool parseHeaders(Jpeg& j){
+        const uint8_t* p = j.data;
+        const uint8_t* end = j.data + j.size;
+        if(j.size < 4 || p[0] != 0xFF || p[1] != 0xD8) return false;
+        p += 2;
+
+        bool haveFrame = false;
+        while(p + 4 <= end){
+            if(p[0] != 0xFF) return false;
+            const uint8_t marker = p[1];
+            if(marker == 0xFF){
+                // Fill byte
+                p++;
+                continue;
+            }
+            p += 2;
+
+            // Markers without a length
+            if(marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) continue;
+            if(marker == 0xD9) return false;
+
+            const size_t len = be16(p);
+            if(len < 2 || p + len > end) return false;
+            const uint8_t* seg = p + 2;
+            const uint8_t* segEnd = p + len;
+
+            switch(marker){
+                case 0xDB: // DQT
+                    while(seg < segEnd){
+                        int precision = seg[0] >> 4, id = seg[0] & 15;
+                        seg++;
+                        if(id > 3 || seg + 64 * (precision + 1) > segEnd) return false;
+                        for(int k = 0; k < 64; k++){
+                            j.quant[id][k] = precision ? be16(seg + k * 2) : seg[k];
+                        }
+                        seg += 64 * (precision + 1);
+                        j.haveQuant[id] = true;
+                    }
+                    break;
+
+                case 0xC4: // DHT
+                    while(seg + 17 <= segEnd){
+                        int tableClass = seg[0] >> 4, id = seg[0] & 15;
+                        if(tableClass > 1 || id > 3) return false;
+                        int total = 0;
+                        for(int i = 0; i < 16; i++) total += seg[1 + i];
+                        if(seg + 17 + total > segEnd) return false;
+                        if(!buildHuffman(tableClass ? j.ac[id] : j.dc[id], seg + 1, seg + 17)) return false;
+                        if(tableClass) buildFastAc(j.ac[id]);
+                        seg += 17 + total;
+                    }
+                    break;
+
+                case 0xC0: // SOF0 baseline
+                case 0xC1: // SOF1 extended sequential, huffman
+                    if(len < 8 || seg[0] != 8) return false;
+                    j.height = be16(seg + 1);
+                    j.width  = be16(seg + 3);
+                    j.ncomp  = seg[5];
+                    // Height 0 means a DNL marker later on, not worth supporting
+                    if(j.width == 0 || j.height == 0) return false;
+                    if(j.ncomp != 1 && j.ncomp != 3) return false;
+                    if(len < 8 + 3u * j.ncomp) return false;
+                    for(int c = 0; c < j.ncomp; c++){
+                        Component& comp = j.comp[c];
+                        comp.id = seg[6 + c * 3];
+                        comp.h  = seg[7 + c * 3] >> 4;
+                        comp.v  = seg[7 + c * 3] & 15;
+                        comp.tq = seg[8 + c * 3];
+                        if(comp.h < 1 || comp.h > 4 || comp.v < 1 || comp.v > 4 || comp.tq > 3) return false;
+                    }
+                    haveFrame = true;
+                    break;
+
+                case 0xDD: // DRI
+                    if(len != 4) return false;
+                    j.restartInterval = be16(seg);
+                    break;
+
+                case 0xEE: // APP14, Adobe says whether 3 components are RGB or YCbCr
+                    if(len >= 14 && !memcmp(seg, "Adobe", 5)) j.adobeTransform = seg[11];
+                    break;
+
+                case 0xDA: { // SOS
+                    if(!haveFrame) return false;
+                    int count = seg[0];
+                    // Only a single scan holding every component, which is what baseline encoders write
+                    if(count != j.ncomp || len != 6 + 2u * count) return false;
+                    for(int i = 0; i < count; i++){
+                        int id = seg[1 + i * 2];
+                        int c = 0;
+                        while(c < j.ncomp && j.comp[c].id != id) c++;
+                        if(c == j.ncomp) return false;
+                        j.comp[c].td = seg[2 + i * 2] >> 4;
+                        j.comp[c].ta = seg[2 + i * 2] & 15;
+                        if(j.comp[c].td > 3 || j.comp[c].ta > 3) return false;
+                        if(!j.dc[j.comp[c].td].valid || !j.ac[j.comp[c].ta].valid) return false;
+                        if(!j.haveQuant[j.comp[c].tq]) return false;
+                        j.scanComp[i] = c;
+                    }
+                    const uint8_t* spectral = seg + 1 + count * 2;
+                    if(spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0) return false;
+
+                    j.scanStart = segEnd - j.data;
+                    return true;
+                }
+
+                default:
+                    // Progressive, lossless, hierarchical and arithmetic coded frames
+                    if(marker >= 0xC2 && marker <= 0xCF) return false;
+                    // Everything else (APPn, COM, ...) gets skipped
+                    break;
+            }
+            p += len;
+        }
+        return false;
+    }
+
+    // Sets up the MCU grid and block planes, false if the sampling factors don't divide evenly
+    bool setupGeometry(Jpeg& j){
+        if(j.ncomp == 1){
+            // A lone component is coded one block per MCU whatever its sampling factors say
+            j.comp[0].h = j.comp[0].v = 1;
+        }
+
+        for(int c = 0; c < j.ncomp; c++){
+            j.hmax = std::max(j.hmax, j.comp[c].h);
+            j.vmax = std::max(j.vmax, j.comp[c].v);
+        }
+        for(int c = 0; c < j.ncomp; c++){
+            if(j.hmax % j.comp[c].h || j.vmax % j.comp[c].v) return false;
+        }
+
+        j.mcusX = (j.width  + 8 * j.hmax - 1) / (8 * j.hmax);
+        j.mcusY = (j.height + 8 * j.vmax - 1) / (8 * j.vmax);
+
+        j.blockSize = 8 >> j.scaleShift;
+        j.outWidth  = (j.width  + (1 << j.scaleShift) - 1) >> j.scaleShift;
+        j.outHeight = (j.height + (1 << j.scaleShift) - 1) >> j.scaleShift;
+
+        for(int c = 0; c < j.ncomp; c++){
+            Component& comp = j.comp[c];
+            comp.blocksX = j.mcusX * comp.h;
+            comp.blocksY = j.mcusY * comp.v;
+            comp.stride = comp.blocksX * j.blockSize;
+            comp.width  = (j.outWidth  * comp.h + j.hmax - 1) / j.hmax;
+            comp.height = (j.outHeight * comp.v + j.vmax - 1) / j.vmax;
+            comp.plane = nullptr;
+        }
+        return true;
+    }
+
+    // ---- Entropy decoding ----
+
+    struct BitReader {
+        const uint8_t* p;
+        const uint8_t* end;
+        uint64_t buf = 0;
+        int bits = 0;
+        bool hitMarker = false;
+
+        BitReader(const uint8_t* start, const uint8_t* stop) : p(start), end(stop) {}
+
+        // Top the buffer up past 56 bits, undoing byte stuffing. Once a marker shows up it only feeds zeros.
+        void fill(){
+            while(bits <= 56){
+                uint64_t b = 0;
+                if(!hitMarker && p < end){
+                    b = *p;
+                    if(b == 0xFF){
+                        if(p + 1 < end && p[1] == 0x00){
+                            p += 2;
+                        } else {
+                            hitMarker = true;
+                            b = 0;
+                        }
+                    } else {
+                        p++;
+                    }
+                }
+                buf |= b << (56 - bits);
+                bits += 8;
+            }
+        }
+
+        // n must be in [1, 16]
+        int getBits(int n){
+            if(bits < n) fill();
+            int v = (int)(buf >> (64 - n));
+            buf <<= n;
+            bits -= n;
+            return v;
+        }
+    };
+
+    inline int decodeSymbol(BitReader& br, const Huffman& h){
+        if(br.bits < 16) br.fill();
+
+        unsigned int e = h.fast[br.buf >> (64 - fastBits)];
+        if(e != 0xffff){
+            br.buf <<= e >> 8;
+            br.bits -= e >> 8;
+            return e & 0xff;
+        }
+
+        unsigned int code = (unsigned int)(br.buf >> 48);
+        for(int len = fastBits + 1; len <= 16; len++){
+            unsigned int idx = (code >> (16 - len)) - h.firstCode[len];
+            if(idx < h.count[len]){
+                br.buf <<= len;
+                br.bits -= len;
+                return h.symbols[h.symStart[len] + idx];
+            }
+        }
+        return -1;
+    }
+
+    // One 8x8 block into `coef` (natural order, dequantized). `coef` has to be zeroed going in.
+    bool decodeBlock(BitReader& br, int16_t* coef, const Huffman& dc, const Huffman& ac, const uint16_t* quant, int& dcPred){
+        int t = decodeSymbol(br, dc);
+        if(t < 0 || t > 11) return false;
+        int diff = t ? extend(br.getBits(t), t) : 0;
+        dcPred += diff;
+        coef[0] = (int16_t)(dcPred * quant[0]);
+
+        for(int k = 1; k < 64;){
+            if(br.bits < 16) br.fill();
+            int fast = ac.fastAc[br.buf >> (64 - fastBits)];
+            if(fast){
+                k += (fast >> 4) & 15;
+                if(k > 63) return false;
+                br.buf <<= fast & 15;
+                br.bits -= fast & 15;
+                coef[dezigzag[k]] = (int16_t)((fast >> 8) * quant[k]);
+                k++;
+                continue;
+            }
+
+            int rs = decodeSymbol(br, ac);
+            if(rs < 0) return false;
+            int run = rs >> 4, size = rs & 15;
+            if(size == 0){
+                if(run != 15) break;   // end of block
+                k += 16;
+                continue;
+            }
+            k += run;
+            if(k > 63) return false;
+            coef[dezigzag[k]] = (int16_t)(extend(br.getBits(size), size) * quant[k]);
+            k++;
+        }
+        return true;
+    }
+
+    // Decode MCUs [first, last). sink.begin(comp, bx, by) hands out zeroed space for a block's coefficients,
+    // sink.end(comp, bx, by, coef) gets called once they're in.
+    // dcPred carries the dc predictions between calls and needs zeroing at the start of each restart interval.
+    template<typename Sink>
+    bool decodeMcus(const Jpeg& j, BitReader& br, int first, int last, int dcPred[3], Sink& sink){
+
+        for(int mcu = first; mcu < last; mcu++){
+            const int mx = mcu % j.mcusX, my = mcu / j.mcusX;
+            for(int s = 0; s < j.ncomp; s++){
+                const int c = j.scanComp[s];
+                const Component& comp = j.comp[c];
+                for(int v = 0; v < comp.v; v++){
+                    for(int h = 0; h < comp.h; h++){
+                        const int bx = mx * comp.h + h, by = my * comp.v + v;
+                        int16_t* coef = sink.begin(c, bx, by);
+                        if(!decodeBlock(br, coef, j.dc[comp.td], j.ac[comp.ta], j.quant[comp.tq], dcPred[c])) return false;
+                        sink.end(c, bx, by, coef);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // ---- IDCT ----
+    // Separable float IDCT done as two small matrix products: rows = coef * M^T, then out = M * rows.
+    // Each output row is a plain 8 wide vector so it maps straight onto AVX, or two SSE/NEON registers.
+
+    struct IdctTable {
+        // basis[u][x] = c(u)/2 * cos((2x + 1) * u * pi / 16)
+        alignas(32) float basis[8][8];
+
+        IdctTable(){
+            const double pi = 3.14159265358979323846;
+            for(int u = 0; u < 8; u++){
+                double cu = u == 0 ? std::sqrt(0.5) : 1.0;
+                for(int x = 0; x < 8; x++){
+                    basis[u][x] = (float)(cu / 2 * std::cos((2 * x + 1) * u * pi / 16));
+                }
+            }
+        }
+    };
+    const IdctTable idctTable;
+
+    inline bool rowIsZero(const int16_t* row){
+        uint64_t a, b;
+        memcpy(&a, row, 8);
+        memcpy(&b, row + 4, 8);
+        return (a | b) == 0;
+    }
+
+    void idctBlock(const int16_t* coef, uint8_t* out, int stride){
+        const float (*basis)[8] = idctTable.basis;
+#if defined(__AVX2__) && defined(__FMA__)
+        __m256 rows[8];
+        for(int v = 0; v < 8; v++){
+            const int16_t* in = coef + v * 8;
+            __m256 acc = _mm256_setzero_ps();
+            if(!rowIsZero(in)){
+                for(int u = 0; u < 8; u++){
+                    acc = _mm256_fmadd_ps(_mm256_set1_ps(in[u]), _mm256_load_ps(basis[u]), acc);
+                }
+            }
+            rows[v] = acc;
+        }
+        for(int y = 0; y < 8; y++){
+            // Level shift back up to unsigned while accumulating
+            __m256 acc = _mm256_set1_ps(128.0f);
+            for(int v = 0; v < 8; v++){
+                acc = _mm256_fmadd_ps(_mm256_set1_ps(basis[v][y]), rows[v], acc);
+            }
+            __m256i px = _mm256_cvtps_epi32(acc);
+            __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(px), _mm256_extracti128_si256(px, 1));
+            _mm_storel_epi64((__m128i*)(out + y * stride), _mm_packus_epi16(words, words));
+        }
+#elif defined(__SSE4_1__)
+        __m128 rows[8][2];
+        for(int v = 0; v < 8; v++){
+            const int16_t* in = coef + v * 8;
+            __m128 lo = _mm_setzero_ps(), hi = _mm_setzero_ps();
+            if(!rowIsZero(in)){
+                for(int u = 0; u < 8; u++){
+                    __m128 c = _mm_set1_ps(in[u]);
+                    lo = _mm_add_ps(lo, _mm_mul_ps(c, _mm_load_ps(basis[u])));
+                    hi = _mm_add_ps(hi, _mm_mul_ps(c, _mm_load_ps(basis[u] + 4)));
+                }
+            }
+            rows[v][0] = lo;
+            rows[v][1] = hi;
+        }
+        for(int y = 0; y < 8; y++){
+            __m128 lo = _mm_set1_ps(128.0f), hi = _mm_set1_ps(128.0f);
+            for(int v = 0; v < 8; v++){
+                __m128 b = _mm_set1_ps(basis[v][y]);
+                lo = _mm_add_ps(lo, _mm_mul_ps(b, rows[v][0]));
+                hi = _mm_add_ps(hi, _mm_mul_ps(b, rows[v][1]));
+            }
+            __m128i words = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+            _mm_storel_epi64((__m128i*)(out + y * stride), _mm_packus_epi16(words, words));
+        }
+#elif defined(__ARM_NEON)
+        float32x4_t rows[8][2];
+        for(int v = 0; v < 8; v++){
+            const int16_t* in = coef + v * 8;
+            float32x4_t lo = vdupq_n_f32(0), hi = vdupq_n_f32(0);
+            if(!rowIsZero(in)){
+                for(int u = 0; u < 8; u++){
+                    lo = vmlaq_n_f32(lo, vld1q_f32(basis[u]), in[u]);
+                    hi = vmlaq_n_f32(hi, vld1q_f32(basis[u] + 4), in[u]);
+                }
+            }
+            rows[v][0] = lo;
+            rows[v][1] = hi;
+        }
+        for(int y = 0; y < 8; y++){
+            float32x4_t lo = vdupq_n_f32(128.5f), hi = vdupq_n_f32(128.5f);
+            for(int v = 0; v < 8; v++){
+                lo = vmlaq_n_f32(lo, rows[v][0], basis[v][y]);
+                hi = vmlaq_n_f32(hi, rows[v][1], basis[v][y]);
+            }
+            // +0.5 above and a saturating truncate here rounds and clamps in one go
+            int16x8_t words = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(lo)), vqmovn_s32(vcvtq_s32_f32(hi)));
+            vst1_u8(out + y * stride, vqmovun_s16(words));
+        }
+#else
+        float rows[8][8];
+        for(int v = 0; v < 8; v++){
+            for(int x = 0; x < 8; x++){
+                float acc = 0;
+                for(int u = 0; u < 8; u++) acc += coef[v * 8 + u] * basis[u][x];
+                rows[v][x] = acc;
+            }
+        }
+        for(int y = 0; y < 8; y++){
+            for(int x = 0; x < 8; x++){
+                float acc = 128.0f;
+                for(int v = 0; v < 8; v++) acc += basis[v][y] * rows[v][x];
+                int px = (int)std::lrint(acc);
+                out[y * stride + x] = (uint8_t)std::min(std::max(px, 0), 255);
+            }
+        }
+#endif
+    }
+
+    // Scaled decodes only look at the top left NxN coefficients and run an N point IDCT on them.
+    // Keeping the 8 point normalization means each output pixel comes out close to the average
+    // of the (8/N)^2 pixels it replaces, same trick libjpeg uses for its scaled decodes.
+    template<int N>
+    struct SmallIdctTable {
+        float basis[N][N];
+
+        SmallIdctTable(){
+            const double pi = 3.14159265358979323846;
+            for(int u = 0; u < N; u++){
+                double cu = u == 0 ? std::sqrt(0.5) : 1.0;
+                for(int x = 0; x < N; x++){
+                    basis[u][x] = (float)(cu / 2 * std::cos((2 * x + 1) * u * pi / (2 * N)));
+                }
+            }
+        }
+    };
+
+    template<int N>
+    void idctBlockSmall(const int16_t* coef, uint8_t* out, int stride){
+        static const SmallIdctTable<N> table;
+        float rows[N][N];
+        for(int v = 0; v < N; v++){
+            for(int x = 0; x < N; x++){
+                float acc = 0;
+                for(int u = 0; u < N; u++) acc += coef[v * 8 + u] * table.basis[u][x];
+                rows[v][x] = acc;
+            }
+        }
+        for(int y = 0; y < N; y++){
+            for(int x = 0; x < N; x++){
+                float acc = 128.0f;
+                for(int v = 0; v < N; v++) acc += table.basis[v][y] * rows[v][x];
+                int px = (int)std::lrint(acc);
+                out[y * stride + x] = (uint8_t)std::min(std::max(px, 0), 255);
+            }
+        }
+    }
+
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+    // At 1/2 scale every row is exactly one 4 wide vector
+    template<>
+    void idctBlockSmall<4>(const int16_t* coef, uint8_t* out, int stride){
+        static const SmallIdctTable<4> table;
+        const float (*basis)[4] = table.basis;
+#if defined(__SSE4_1__)
+        __m128 rows[4];
+        for(int v = 0; v < 4; v++){
+            const int16_t* in = coef + v * 8;
+            __m128 acc = _mm_setzero_ps();
+            for(int u = 0; u < 4; u++){
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(in[u]), _mm_loadu_ps(basis[u])));
+            }
+            rows[v] = acc;
+        }
+        for(int y = 0; y < 4; y++){
+            __m128 acc = _mm_set1_ps(128.0f);
+            for(int v = 0; v < 4; v++){
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(basis[v][y]), rows[v]));
+            }
+            __m128i words = _mm_packs_epi32(_mm_cvtps_epi32(acc), _mm_setzero_si128());
+            uint32_t px = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+            memcpy(out + y * stride, &px, 4);
+        }
+#else
+        float32x4_t rows[4];
+        for(int v = 0; v < 4; v++){
+            const int16_t* in = coef + v * 8;
+            float32x4_t acc = vdupq_n_f32(0);
+            for(int u = 0; u < 4; u++) acc = vmlaq_n_f32(acc, vld1q_f32(basis[u]), in[u]);
+            rows[v] = acc;
+        }
+        for(int y = 0; y < 4; y++){
+            float32x4_t acc = vdupq_n_f32(128.5f);
+            for(int v = 0; v < 4; v++) acc = vmlaq_n_f32(acc, rows[v], basis[v][y]);
+            int16x8_t words = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(acc)), vdup_n_s16(0));
+            uint32_t px = vget_lane_u32(vreinterpret_u32_u8(vqmovun_s16(words)), 0);
+            memcpy(out + y * stride, &px, 4);
+        }
+#endif
+    }
+#endif
+
+    // 1/8 scale is just the DC term
+    template<>
+    void idctBlockSmall<1>(const int16_t* coef, uint8_t* out, int){
+        int px = (int)std::lrint(coef[0] / 8.0f + 128.0f);
+        out[0] = (uint8_t)std::min(std::max(px, 0), 255);
+    }
+
+    // ---- Upsampling and color conversion ----
+    // The upsamplers are the "fancy" triangle filters libjpeg and stb_image use, so output lines up with theirs.
+
+    inline uint8_t div4(int x){ return (uint8_t)(x >> 2); }
+    inline uint8_t div16(int x){ return (uint8_t)(x >> 4); }
+
+    void upsampleH2V1(uint8_t* out, const uint8_t* in, int w){
+        if(w == 1){
+            out[0] = out[1] = in[0];
+            return;
+        }
+        out[0] = in[0];
+        out[1] = div4(in[0] * 3 + in[1] + 2);
+        int i;
+        for(i = 1; i < w - 1; i++){
+            int n = 3 * in[i] + 2;
+            out[i * 2 + 0] = div4(n + in[i - 1]);
+            out[i * 2 + 1] = div4(n + in[i + 1]);
+        }
+        out[i * 2 + 0] = div4(in[w - 2] * 3 + in[w - 1] + 2);
+        out[i * 2 + 1] = in[w - 1];
+    }
+
+    void upsampleH1V2(uint8_t* out, const uint8_t* near, const uint8_t* far, int w){
+        for(int i = 0; i < w; i++) out[i] = div4(3 * near[i] + far[i] + 2);
+    }
+
+    void upsampleH2V2(uint8_t* out, const uint8_t* near, const uint8_t* far, int w){
+        int t1 = 3 * near[0] + far[0];
+        if(w == 1){
+            out[0] = out[1] = div4(t1 + 2);
+            return;
+        }
+        out[0] = div4(t1 + 2);
+        for(int i = 1; i < w; i++){
+            int t0 = t1;
+            t1 = 3 * near[i] + far[i];
+            out[i * 2 - 1] = div16(3 * t0 + t1 + 8);
+            out[i * 2]     = div16(3 * t1 + t0 + 8);
+        }
+        out[w * 2 - 1] = div4(t1 + 2);
+    }
+
+    // Row `y` of component `c` at full resolution. Points into the plane when there's nothing to do, otherwise fills `tmp`.
+    const uint8_t* componentRow(const Jpeg& j, int c, int y, uint8_t* tmp){
+        const Component& comp = j.comp[c];
+        const int hs = j.hmax / comp.h, vs = j.vmax / comp.v;
+
+        if(hs == 1 && vs == 1) return comp.plane + (size_t)y * comp.stride;
+
+        if(vs <= 2 && hs <= 2){
+            int nearY = y / vs, farY = nearY;
+            if(vs == 2){
+                farY = (y & 1) ? nearY + 1 : nearY - 1;
+                farY = std::min(std::max(farY, 0), comp.height - 1);
+            }
+            const uint8_t* near = comp.plane + (size_t)nearY * comp.stride;
+            const uint8_t* far  = comp.plane + (size_t)farY  * comp.stride;
+
+            if(hs == 2 && vs == 2)  upsampleH2V2(tmp, near, far, comp.width);
+            else if(hs == 2)        upsampleH2V1(tmp, near, comp.width);
+            else                    upsampleH1V2(tmp, near, far, comp.width);
+            return tmp;
+        }
+
+        // Unusual factors just get replicated
+        const uint8_t* src = comp.plane + (size_t)(y / vs) * comp.stride;
+        for(int x = 0; x < j.outWidth; x++) tmp[x] = src[x / hs];
+        return tmp;
+    }
+
+    // JFIF YCbCr -> RGB in 16.16 fixed point
+    const int crToR =  91881;  // 1.402
+    const int cbToG = -22554;  // -0.344136
+    const int crToG = -46802;  // -0.714136
+    const int cbToB = 116130;  // 1.772
+
+    inline uint8_t clampByte(int v){
+        return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+
+    void ycbcrToRgbRow(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, int count){
+        int i = 0;
+#if defined(__AVX2__)
+        const __m256i c128 = _mm256_set1_epi32(128), half = _mm256_set1_epi32(1 << 15);
+        const __m256i kCrR = _mm256_set1_epi32(crToR), kCbG = _mm256_set1_epi32(cbToG);
+        const __m256i kCrG = _mm256_set1_epi32(crToG), kCbB = _mm256_set1_epi32(cbToB);
+        // Interleave 8 r, 8 g (rg) and 8 b into 24 bytes of RGB
+        const __m128i rgShufA = _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5);
+        const __m128i bShufA  = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+        const __m128i rgShufB = _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i bShufB  = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+
+        // 24 byte writes through a 16 + 8 byte pair, so no spill past the row
+        for(; i + 8 <= count; i += 8){
+            __m256i yy = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(y + i)));
+            __m256i b  = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(cb + i))), c128);
+            __m256i r  = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(cr + i))), c128);
+
+            __m256i outR = _mm256_add_epi32(yy, _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, kCrR), half), 16));
+            __m256i outG = _mm256_add_epi32(yy, _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(b, kCbG), _mm256_mullo_epi32(r, kCrG)), half), 16));
+            __m256i outB = _mm256_add_epi32(yy, _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(b, kCbB), half), 16));
+
+            // Saturate down to bytes: lane 0 ends up r0-7 b0-7, lane 1 g0-7 b0-7
+            __m256i rg = _mm256_permute4x64_epi64(_mm256_packs_epi32(outR, outG), 0xD8);
+            __m256i bb = _mm256_permute4x64_epi64(_mm256_packs_epi32(outB, outB), 0xD8);
+            __m256i bytes = _mm256_packus_epi16(rg, bb);
+            __m128i lane0 = _mm256_castsi256_si128(bytes), lane1 = _mm256_extracti128_si256(bytes, 1);
+            __m128i rgv = _mm_unpacklo_epi64(lane0, lane1);
+            __m128i bv  = _mm_unpackhi_epi64(lane0, lane0);
+
+            __m128i first  = _mm_or_si128(_mm_shuffle_epi8(rgv, rgShufA), _mm_shuffle_epi8(bv, bShufA));
+            __m128i second = _mm_or_si128(_mm_shuffle_epi8(rgv, rgShufB), _mm_shuffle_epi8(bv, bShufB));
+            _mm_storeu_si128((__m128i*)(out + i * 3), first);
+            _mm_storel_epi64((__m128i*)(out + i * 3 + 16), second);
+        }
+#elif defined(__ARM_NEON)
+        for(; i + 8 <= count; i += 8){
+            int16x8_t yy = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i)));
+            int16x8_t b  = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(cb + i))), vdupq_n_s16(128));
+            int16x8_t r  = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(cr + i))), vdupq_n_s16(128));
+            int32x4_t half = vdupq_n_s32(1 << 15);
+
+            int32x4_t rLo = vmlaq_n_s32(half, vmovl_s16(vget_low_s16(r)),  crToR);
+            int32x4_t rHi = vmlaq_n_s32(half, vmovl_s16(vget_high_s16(r)), crToR);
+            int32x4_t gLo = vmlaq_n_s32(vmlaq_n_s32(half, vmovl_s16(vget_low_s16(b)),  cbToG), vmovl_s16(vget_low_s16(r)),  crToG);
+            int32x4_t gHi = vmlaq_n_s32(vmlaq_n_s32(half, vmovl_s16(vget_high_s16(b)), cbToG), vmovl_s16(vget_high_s16(r)), crToG);
+            int32x4_t bLo = vmlaq_n_s32(half, vmovl_s16(vget_low_s16(b)),  cbToB);
+            int32x4_t bHi = vmlaq_n_s32(half, vmovl_s16(vget_high_s16(b)), cbToB);
+
+            uint8x8x3_t px;
+            px.val[0] = vqmovun_s16(vaddq_s16(yy, vcombine_s16(vshrn_n_s32(rLo, 16), vshrn_n_s32(rHi, 16))));
+            px.val[1] = vqmovun_s16(vaddq_s16(yy, vcombine_s16(vshrn_n_s32(gLo, 16), vshrn_n_s32(gHi, 16))));
+            px.val[2] = vqmovun_s16(vaddq_s16(yy, vcombine_s16(vshrn_n_s32(bLo, 16), vshrn_n_s32(bHi, 16))));
+            vst3_u8(out + i * 3, px);
+        }
+#endif
+        for(; i < count; i++){
+            int b = cb[i] - 128, r = cr[i] - 128;
+            out[i * 3 + 0] = clampByte(y[i] + ((r * crToR + (1 << 15)) >> 16));
+            out[i * 3 + 1] = clampByte(y[i] + ((b * cbToG + r * crToG + (1 << 15)) >> 16));
+            out[i * 3 + 2] = clampByte(y[i] + ((b * cbToB + (1 << 15)) >> 16));
+        }
+    }
+
+    void interleaveRow(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* out, int count){
+        for(int i = 0; i < count; i++){
+            out[i * 3 + 0] = r[i];
+            out[i * 3 + 1] = g[i];
+            out[i * 3 + 2] = b[i];
+        }
+    }
+
+    // ---- Drivers ----
+
+    void idctBlockInto(const Jpeg& j, int c, int bx, int by, const int16_t* coef){
+        const Component& comp = j.comp[c];
+        const int n = j.blockSize;
+        uint8_t* out = comp.plane + (size_t)by * n * comp.stride + bx * n;
+        switch(n){
+            case 8: idctBlock(coef, out, comp.stride);         break;
+            case 4: idctBlockSmall<4>(coef, out, comp.stride); break;
+            case 2: idctBlockSmall<2>(coef, out, comp.stride); break;
+            case 1: idctBlockSmall<1>(coef, out, comp.stride); break;
+        }
+    }
+
+    // Decodes into a scratch block and transforms it straight into the plane
+    struct IdctSink {
+        const Jpeg& j;
+        alignas(32) int16_t coef[64];
+
+        int16_t* begin(int, int, int){
+            memset(coef, 0, sizeof(coef));
+            return coef;
+        }
+        void end(int c, int bx, int by, const int16_t* block){
+            idctBlockInto(j, c, bx, by, block);
+        }
+    };
+
+    // Decodes into whole-image coefficient buffers (already zeroed) for someone else to transform
+    struct CoeffSink {
+        const Jpeg& j;
+        int16_t* const* coeffs;
+
+        int16_t* begin(int c, int bx, int by){
+            return &coeffs[c][((size_t)by * j.comp[c].blocksX + bx) * 64];
+        }
+        void end(int, int, int, const int16_t*){}
+    };
+
+    // Restart markers reset the decoder, so every interval can be decoded on its own
+    bool decodeIntervalsParallel(const Jpeg& j){
+        const int totalMcus = j.mcusX * j.mcusY;
+        const int intervals = (totalMcus + j.restartInterval - 1) / j.restartInterval;
+
+        // Find where each interval's data starts, that's right after each RSTn
+        std::vector<size_t> starts;
+        starts.reserve(intervals + 1);
+        starts.push_back(j.scanStart);
+        size_t p = j.scanStart;
+        size_t scanEnd = j.size;
+        while(p + 1 < j.size){
+            const void* ff = memchr(j.data + p, 0xFF, j.size - p - 1);
+            if(!ff) break;
+            p = (const uint8_t*)ff - j.data;
+            uint8_t next = j.data[p + 1];
+            if(next == 0x00 || next == 0xFF){
+                p++;
+            } else if(next >= 0xD0 && next <= 0xD7){
+                p += 2;
+                starts.push_back(p);
+            } else {
+                scanEnd = p;
+                break;
+            }
+        }
+        if((int)starts.size() < intervals) return false;
+        starts.resize(intervals);
+        starts.push_back(scanEnd);
+
+        // Hand out a few runs of intervals per worker so the smaller ones don't drown in overhead
+        const size_t chunks = std::min<size_t>(intervals, (jobsWorkerCount() + 1) * 4);
+        std::atomic<bool> ok{true};
+        parallelFor(chunks, [&](size_t chunk){
+            const size_t first = intervals * chunk / chunks;
+            const size_t last  = intervals * (chunk + 1) / chunks;
+            for(size_t i = first; i < last && ok; i++){
+                BitReader br(j.data + starts[i], j.data + starts[i + 1]);
+                int dcPred[3] = {0, 0, 0};
+                int mcuFirst = i * j.restartInterval;
+                int mcuLast  = std::min(mcuFirst + j.restartInterval, totalMcus);
+                IdctSink sink{j, {}};
+                if(!decodeMcus(j, br, mcuFirst, mcuLast, dcPred, sink)) ok = false;
+            }
+        });
+        return ok;
+    }
+
+    // No restart markers: huffman decode has to run start to finish on one thread.
+    // Finished bands of MCU rows are handed to the workers for IDCT while decoding carries on.
+    bool decodePipelined(const Jpeg& j){
+        int16_t* coeffs[3] = {nullptr, nullptr, nullptr};
+        bool ok = true;
+        for(int c = 0; c < j.ncomp; c++){
+            const size_t bytes = (size_t)j.comp[c].blocksX * j.comp[c].blocksY * 64 * sizeof(int16_t);
+            coeffs[c] = (int16_t*)scratchMalloc(bytes);
+            if(coeffs[c]) memset(coeffs[c], 0, bytes);
+            else          ok = false;
+        }
+
+        CoeffSink sink{j, coeffs};
+
+        const int bandRows = std::max(1, j.mcusY / (int)((jobsWorkerCount() + 1) * 4));
+        JobGroup group;
+        BitReader br(j.data + j.scanStart, j.data + j.size);
+        int dcPred[3] = {0, 0, 0};
+
+        for(int row = 0; row < j.mcusY && ok; row += bandRows){
+            const int rowEnd = std::min(row + bandRows, j.mcusY);
+            // dc prediction runs across the whole scan so the rows can't be split up here
+            ok = decodeMcus(j, br, row * j.mcusX, rowEnd * j.mcusX, dcPred, sink);
+            if(!ok) break;
+
+            jobsSubmit(group, [&j, &coeffs, row, rowEnd]{
+                for(int c = 0; c < j.ncomp; c++){
+                    const Component& comp = j.comp[c];
+                    for(int by = row * comp.v; by < rowEnd * comp.v; by++){
+                        for(int bx = 0; bx < comp.blocksX; bx++){
+                            idctBlockInto(j, c, bx, by, &coeffs[c][((size_t)by * comp.blocksX + bx) * 64]);
+                        }
+                    }
+                }
+            });
+        }
+        jobsWait(group);
+        for(int16_t* c : coeffs) scratchFree(c);
+        return ok;
+    }
+}
+
+unsigned char* jpegDecode(const unsigned char* data, size_t size, int* width, int* height, int* numCh, int scaleShift){
+    if(scaleShift < 0 || scaleShift > 3) return nullptr;
+
+    Jpeg j;
+    j.data = data;
+    j.size = size;
+    j.scaleShift = scaleShift;
+    if(!parseHeaders(j) || !setupGeometry(j)) return nullptr;
+
+    // Scratch memory, inside an ArenaScope the same bytes get reused decode after decode
+    uint8_t* planes[3] = {nullptr, nullptr, nullptr};
+    bool ok = true;
+    for(int c = 0; c < j.ncomp; c++){
+        const size_t bytes = (size_t)j.comp[c].stride * j.comp[c].blocksY * j.blockSize;
+        planes[c] = (uint8_t*)scratchMalloc(bytes);
+        if(planes[c]) memset(planes[c], 0, bytes);
+        else          ok = false;
+        j.comp[c].plane = planes[c];
+    }
+
+    ok = ok && (j.restartInterval ? decodeIntervalsParallel(j) : decodePipelined(j));
+    const int outCh = j.ncomp == 1 ? 1 : 3;
+    unsigned char* out = ok ? (unsigned char*)scratchMalloc((size_t)j.outWidth * j.outHeight * outCh) : nullptr;
+    if(!out){
+        for(uint8_t* p : planes) scratchFree(p);
+        return nullptr;
+    }
+
+    // Adobe transform 0 means the three components are plain RGB
+    const bool isRgb = j.ncomp == 3 && j.adobeTransform == 0;
+
+    const int bandHeight = 32;
+    const int bands = (j.outHeight + bandHeight - 1) / bandHeight;
+    parallelFor(bands, [&](size_t band){
+        std::vector<uint8_t> tmp[3];
+        for(auto& t : tmp) t.resize(j.outWidth + 16);
+
+        const int yEnd = std::min<int>((band + 1) * bandHeight, j.outHeight);
+        for(int y = band * bandHeight; y < yEnd; y++){
+            uint8_t* dst = out + (size_t)y * j.outWidth * outCh;
+            if(outCh == 1){
+                memcpy(dst, componentRow(j, 0, y, tmp[0].data()), j.outWidth);
+                continue;
+            }
+            const uint8_t* rows[3];
+            for(int c = 0; c < 3; c++) rows[c] = componentRow(j, c, y, tmp[c].data());
+            if(isRgb) interleaveRow(rows[0], rows[1], rows[2], dst, j.outWidth);
+            else      ycbcrToRgbRow(rows[0], rows[1], rows[2], dst, j.outWidth);
+        }
+    });
+
+    for(uint8_t* p : planes) scratchFree(p);
+    *width = j.outWidth;
+    *height = j.outHeight;
+    *numCh = outCh;
+    return out;
+}
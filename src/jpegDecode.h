@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+// Multithreaded baseline JPEG decoder.
+// Files with restart markers get their entropy coded data split at the markers and decoded on every core.
+// Files without them are huffman decoded on the calling thread while the workers IDCT the rows already done.
+// Color conversion is split by rows either way.
+//
+// Only sequential huffman 8-bit files with 1 or 3 components are handled, anything else (progressive,
+// arithmetic coding, CMYK, ...) returns nullptr so the caller can fall back to stb_image.
+// Output is tightly packed 8-bit grey or RGB from scratchMalloc (see arena.h), release it with scratchFree().
+//
+// scaleShift 1-3 decodes straight to 1/2, 1/4 or 1/8 size (rounded up) with smaller IDCTs instead of
+// shrinking afterwards, so the skipped pixels cost next to nothing.
+unsigned char* jpegDecode(const unsigned char* data, size_t size, int* width, int* height, int* numCh, int scaleShift = 0);
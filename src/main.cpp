@@ -1,73 +1,117 @@
 #include <stdio.h>
+#include <chrono>
 #include <cmath>
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
 
 #include "glad/glad.h"
 #include <GLFW/glfw3.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb/stb_image.h"
+#include "arena.h"
+#include "computeComposite.h"
+#include "cull.h"
+#include "drawConstants.h"
+#include "fileUtil.h"
+#include "frameCapture.h"
+#include "glCapture.h"
+#include "glStats.h"
+#include "gpuMemory.h"
+#include "gpuResources.h"
+#include "imageLoad.h"
+#include "instanceBuffer.h"
+#include "jobs.h"
+#include "mesh.h"
+#include "meshCache.h"
+#include "pixelFormat.h"
+#include "profiler.h"
+#include "progressiveLoad.h"
+#include "shaderVariants.h"
+#include "softRaster.h"
+#include "texCache.h"
+#include "texturePool.h"
+#include "tilePyramid.h"
+#include "tileStream.h"
+#include "transforms.h"
+#include "vecMath.h"
+#include "vert.h"
 
 GLFWwindow* window;
 
-
-unsigned int loadCompileShader(const char* fName, GLenum shaderType)
-{
-    // File stream to load shader at runtime
-    std::ifstream fs;
-    fs.open(fName, std::ifstream::in);
-
-    if(fs.fail()){
-        printf("Failed to open file \'%s\'\n", fName);
-    }
-
-    // get the length of the file
-    fs.seekg(0, fs.end);
-    GLint len = fs.tellg();
-    fs.seekg(0, fs.beg);
-
-    // Read the whole file into memory
-    char* src = new char[len];
-    fs.read(src, len);
-
-    // Get a shader handle from OpenGL
-    unsigned int shader = glCreateShader(shaderType);
-    // provide the GLSL source and compile it
-    glShaderSource(shader, 1, &src, &len);
-    glCompileShader(shader);
-
-    // We can delete the memory we allocated for the shader source, gpu has it now
-    delete[] src;
-
-    // Check for errors
-    struct {
-        int success;
-        char infoLog[512];
-    } shaderStat;
-
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &shaderStat.success);
-    // Print errors if they occurred
-    if(!shaderStat.success){
-        glGetShaderInfoLog(shader, 512, NULL, shaderStat.infoLog);
-        printf("compiling ");
-        switch(shaderType){
-            case GL_VERTEX_SHADER:   printf("vertex ");   break;
-            case GL_FRAGMENT_SHADER: printf("fragment "); break;
-        }
-        printf("shader failed: %d\n%s\n", shaderStat.success, shaderStat.infoLog);
-
-        glDeleteShader(shader);
-        return 0;
-    }
-
-    // Give the shader handle back to caller
-    return shader;
-}
+// Triangle vertex data
+const Vert triangleVerts[] = {
+    { { -.95, -.95, 0}, { 0,  1} },
+    { {  .95, -.95, 0}, { 1,  1} },
+    { {  .95,  .95, 0}, { 1,  0} },
+
+    { { -.95, -.95, 0}, { 0,  1} },
+    { {  .95,  .95, 0}, { 1,  0} },
+    { { -.95,  .95, 0}, { 0,  0} },
+};
+
+// Image files, each one becomes a material in the texture pools in this order
+const char* const images[] = {
+    "assets/container.jpg",
+    "assets/bird.jpg",
+};
+
+const float bgColor[] = {1.0, 1.0, 0.0, 1.0};
+
+// How the textures get loaded, filled in from the command line in main
+ImageLoadOptions textureOpts;
+// Keywords frag.glsl is built with, from --shader-keywords
+const char* sceneKeywords = "";
+// L flips SHOW_LOAD_LEVEL on and off
+bool showLoadLevel = false;
+// Composite with composite.glsl instead of drawing the quad, C flips it
+bool useComputeComposite = false;
+// How vertex.glsl gets the quad's vertices, from --vertex-fetch. F swaps pulling and attributes.
+VertexFetch vertexFetch = fetchAuto;
+bool flipVertexFetch = false;
+// Drawn in place of the quad when set, from --mesh. Goes through output/meshcache unless --no-mesh-cache.
+const char* meshFile = nullptr;
+// Levels of detail are picked so they're never off by more than this many pixels, from --lod-pixels
+float lodPixels = 1.0f;
+// Save every frame to captureDir, P flips it
+bool capturing = false;
+const char* captureDir = "output/capture";
+// Record the GL calls of the first glCaptureFrames frames into this file, see glCapture.h
+const char* glCaptureFile = nullptr;
+int glCaptureFrames = 60;
+// Count GL calls every frame, see glStats.h. Needs a build with GL_STATS=1.
+bool glStatsOn = false;
+GlStatsBudget glBudget;
+// Chrome trace of every zone in the run goes here at exit, see profiler.h
+const char* profileFile = nullptr;
 
 void keyHandler(GLFWwindow* window, int key, int scancode, int action, int modes){
     if(key == GLFW_KEY_ESCAPE && action == GLFW_RELEASE){
         glfwSetWindowShouldClose(window, true);
     }
+    if(key == GLFW_KEY_L && action == GLFW_RELEASE){
+        showLoadLevel = !showLoadLevel;
+    }
+    if(key == GLFW_KEY_C && action == GLFW_RELEASE){
+        useComputeComposite = !useComputeComposite;
+    }
+    if(key == GLFW_KEY_P && action == GLFW_RELEASE){
+        capturing = !capturing;
+    }
+    if(key == GLFW_KEY_F && action == GLFW_RELEASE){
+        flipVertexFetch = !flipVertexFetch;
+    }
+    if(key == GLFW_KEY_M && action == GLFW_RELEASE){
+        gpuMemoryReport();
+        GpuResourceStats stats = gpuResourceStats();
+        printf("GPU resources: %llu acquired, %llu from spares, %llu names made\n", (unsigned long long)stats.acquired,
+               (unsigned long long)stats.recycled, (unsigned long long)stats.namesCreated);
+    }
+    if(key == GLFW_KEY_G && action == GLFW_RELEASE){
+        glStatsReport();
+    }
 }
 
 void glfwErrorPrinter(int code, const char* desc){
@@ -79,6 +123,7 @@ void glErrorPrinter(GLenum source, GLenum type, GLuint id, GLenum severity, GLsi
 }
 
 bool init(){
+    PROFILE_ZONE("init");
     glfwSetErrorCallback(glfwErrorPrinter);
 
     if(!glfwInit())
@@ -101,6 +146,16 @@ bool init(){
         return false;
     }
 
+    // Counters go under the capture so it records through them
+    if(glStatsOn){
+        if(glStatsBegin()) glStatsSetBudget(glBudget);
+        else printf("GL stats aren't built in, rebuild with GL_STATS=1\n");
+    }
+    // Before any other GL call so the recording has everything it needs to stand on its own
+    if(glCaptureFile) glCaptureBegin(glCaptureFile, glCaptureFrames);
+
+    if(profileFile) profilerGpuInit();
+
     glDebugMessageCallback(glErrorPrinter, nullptr);
 
     // Enable V-Sync
@@ -115,127 +170,251 @@ bool init(){
     return true;
 }
 
-void loop(){
-    GLuint fb_tex;
-    glCreateTextures(GL_TEXTURE_2D, 1, &fb_tex);
-    glTextureParameteri(fb_tex, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(fb_tex, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTextureParameteri(fb_tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTextureParameteri(fb_tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTextureStorage2D(fb_tex, 1, GL_RGBA32F, 400, 400);
-
-    GLuint fbo;
-    glCreateFramebuffers(1, &fbo);
-    glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, fb_tex, 0);
-    glNamedFramebufferDrawBuffer(fbo, GL_COLOR_ATTACHMENT0);
-
-    GLuint err = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
+// Render one frame at `time` on the CPU and write it out, no window or GL needed
+bool renderReference(const char* outName, float time){
+    SoftTexture textures[2];
+    for(size_t i = 0; i < 2; i++){
+        if(!softTextureLoad(textures[i], images[i], textureOpts)) return false;
+    }
+
+    SoftTarget target;
+    softTargetCreate(target, 400, 400);
+
+    // First frame warms up the caches and worker threads, time the rest
+    const int frames = 10;
+    softRenderFrame(target, bgColor, triangleVerts, 6, textures[0], textures[1], time);
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < frames; i++){
+        softRenderFrame(target, bgColor, triangleVerts, 6, textures[0], textures[1], time);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    printf("Reference frame: %.3f ms (%u worker threads)\n", elapsed.count() / frames, jobsWorkerCount());
+
+    bool ok = softWritePPM(target, outName);
+
+    softTargetFree(target);
+    for(auto& tex : textures) softTextureFree(tex);
+    return ok;
+}
+
+// 400x400 RGBA32F render target everything draws into before it gets blitted to the window
+GpuFramebuffer createFramebuffer(GpuTexture& fb_tex){
+    fb_tex = gpuTextureCreate({GL_TEXTURE_2D, GL_RGBA32F, 400, 400}, gpuRenderTargets, "fb_tex");
+    glTextureParameteri(fb_tex.id(), GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(fb_tex.id(), GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(fb_tex.id(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(fb_tex.id(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GpuFramebuffer fbo = gpuFramebufferCreate("fbo");
+    glNamedFramebufferTexture(fbo.id(), GL_COLOR_ATTACHMENT0, fb_tex.id(), 0);
+    glNamedFramebufferDrawBuffer(fbo.id(), GL_COLOR_ATTACHMENT0);
+
+    GLuint err = glCheckNamedFramebufferStatus(fbo.id(), GL_FRAMEBUFFER);
     if(err != GL_FRAMEBUFFER_COMPLETE){
         printf("Error in fbo: %x\n", err);
     }
+    return fbo;
+}
 
-    // Triangle vertex data
-    struct {
-        float pos[3];
-        float uv[2];
-    } triangleVerts[] = {
-        { { -.95, -.95, 0}, { 0,  1} },
-        { {  .95, -.95, 0}, { 1,  1} },
-        { {  .95,  .95, 0}, { 1,  0} },
-
-        { { -.95, -.95, 0}, { 0,  1} },
-        { {  .95,  .95, 0}, { 1,  0} },
-        { { -.95,  .95, 0}, { 0,  0} },
-    };
-
-    // Simple anon struct to manage image files and what texture to bind them to
-    const struct{
-        const char* img;
-        const GLenum tex;
-    } images[] = {
-        {"assets/container.jpg", 0},
-        {"assets/bird.jpg", 1},
-    };
-
-    // Generate texture objects for each of  the images
-    for(size_t i = 0; i < 2; i++){
-        unsigned int tex;
-
-        struct {
-            int width, height;
-            int numCh;
-        } imageStats;
-        unsigned char* imageRaw = stbi_load(images[i].img, &imageStats.width, &imageStats.height, &imageStats.numCh, 0);
-        
-        if(imageRaw){
-            glCreateTextures(GL_TEXTURE_2D, 1, &tex);
-            glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTextureStorage2D(tex, 1, GL_RGBA32F, imageStats.width, imageStats.height);
-            glTextureSubImage2D(tex, 0, 0, 0, imageStats.width, imageStats.height, GL_RGB, GL_UNSIGNED_BYTE, imageRaw);
-            glBindTextureUnit(images[i].tex, tex);
-        } else {
-            printf("Failed to load texture\n");
+// Queue fb_tex for saving if capturing is on and collect whatever earlier frames are ready
+void captureFrame(FrameCapture& capture, GLuint fb_tex){
+    PROFILE_ZONE("capture");
+    // Numbered by frame, anything dropped leaves a gap
+    static int frameNumber = 0;
+    static bool madeDir = false;
+    if(capturing && !madeDir){
+        // Otherwise every single frame fails to write
+        madeDir = makeDirs(captureDir);
+        if(!madeDir){
+            printf("Failed to create capture directory \'%s\', capturing is off\n", captureDir);
+            capturing = false;
         }
+    }
+    if(capturing){
+        char fName[512];
+        snprintf(fName, sizeof(fName), "%s/frame_%05d.png", captureDir, frameNumber++);
+        frameCaptureGrab(capture, fb_tex, fName);
+    }
+    frameCapturePoll(capture);
+}
 
-        stbi_image_free(imageRaw);
+// `fName` through the mesh cache, scaled to cover what the quad would
+bool loadMesh(Mesh& mesh, const char* fName){
+    auto start = std::chrono::steady_clock::now();
+    CookedMesh cooked;
+    if(!meshCacheLoad(cooked, fName)) return false;
+    std::chrono::duration<double, std::milli> loaded = std::chrono::steady_clock::now() - start;
+    const bool ok = meshCreateCooked(mesh, cooked, fName, vertexFetch);
+    std::chrono::duration<double, std::milli> uploaded = std::chrono::steady_clock::now() - start;
+    if(ok){
+        printf("Mesh \'%s\': %u triangles, %zu vertices, %s in %.1f ms, on the GPU after %.1f ms\n", fName,
+               mesh.lods[0].indexCount / 3, cooked.vertCount, cooked.mapped ? "mapped from the cache" : "imported and cooked",
+               loaded.count(), uploaded.count());
+        meshFitView(mesh, .95f);
+        for(int l = 0; l < mesh.lodCount; l++){
+            printf("  LOD %d: %u triangles, off by %.3f%% of its size\n", l, mesh.lods[l].indexCount / 3, mesh.lods[l].error * 100);
+        }
     }
+    meshCacheRelease(cooked);
+    return ok;
+}
 
-    // Generate buffer for vert data
-    GLuint ssbo;
-    glCreateBuffers(1, &ssbo);
-    glNamedBufferStorage(ssbo, sizeof(triangleVerts), triangleVerts, GL_DYNAMIC_STORAGE_BIT);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);
+void loop(bool softBackend){
+    // Only reads the sources, first so there's nothing to clean up if they're missing
+    ShaderProgram scene;
+    if(!shaderProgramLoad(scene, "assets/shaders/vertex.glsl", "assets/shaders/frag.glsl")) return;
 
-    // Compile and link shaders
-    unsigned int shaderProg = glCreateProgram();
-    {
-        auto vertexShader = loadCompileShader("assets/shaders/vertex.glsl", GL_VERTEX_SHADER);
-        auto fragShader   = loadCompileShader("assets/shaders/frag.glsl",   GL_FRAGMENT_SHADER);
-        glAttachShader(shaderProg, vertexShader);
-        glAttachShader(shaderProg, fragShader);
-        glLinkProgram(shaderProg);
-        GLint result;
-        glGetProgramiv(shaderProg, GL_LINK_STATUS, &result);
-        if(result == GL_FALSE)
-        {
-            char infoLog[512] = {0};
-            GLsizei logLeng;
-            glGetProgramInfoLog(shaderProg, 512, &logLeng, infoLog);
-            printf("Error linking shader:\n%s\n", infoLog);
-        }
+    GpuTexture fb_tex;
+    GpuFramebuffer fbo = createFramebuffer(fb_tex);
+
+    // CPU copies of the textures for when the software backend is drawing
+    SoftTexture softTextures[2];
 
-        // Delete our shaders, gpu has them now.
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragShader);
+    // Put each of the images in a texture pool, the shader finds them by material index.
+    // They load in the background, drawing starts right away with placeholders and low res previews.
+    int materials[2] = {0, 0};
+    for(size_t i = 0; i < 2; i++){
+        if(softBackend){
+            // The CPU side has no mips to refine, it just waits for the whole thing
+            if(!softTextureLoad(softTextures[i], images[i], textureOpts)) printf("Failed to load texture\n");
+            continue;
+        }
+        int material = progressiveTextureAdd(images[i], textureOpts);
+        if(material >= 0) materials[i] = material;
+        else              printf("Failed to add texture \'%s\' to a pool\n", images[i]);
+    }
 
-        if(result == GL_FALSE) return;
+    // Generate buffer for vert data, --mesh takes the quad's place if it loads
+    Mesh quad;
+    if(softBackend || !meshFile || !loadMesh(quad, meshFile)) meshCreate(quad, triangleVerts, 6, "triangle verts", vertexFetch);
+    const VertexFetch quadFetch = quad.fetch;
+
+    // Where everything sits. There's no scene file yet, so it's just the quad under a root.
+    Transforms transforms;
+    const TransformId sceneRoot = transformAdd(transforms, noTransform);
+    InstanceBuffer instances;
+    std::vector<TransformId> changedTransforms;
+
+    // Everything the loop draws gets a box, only what's in view is submitted. There's no camera yet, so the
+    // frustum is clip space itself.
+    Mesh* objects[] = {&quad};
+    const TransformId objectNodes[] = {transformAdd(transforms, sceneRoot)};
+    CullBounds cullBounds;
+    for(Mesh* object : objects) cullAdd(cullBounds, object->center, object->extent);
+    // No camera yet, so the view-projection is the identity and the frustum is the clip space cube
+    const Mat4 viewProj = mat4Identity();
+    Frustum frustum;
+    frustumFromMatrix(frustum, &viewProj.cols[0].x);
+    std::vector<uint32_t> visible;
+    visible.reserve(cullCount(cullBounds));
+
+    // Variants get built as they're asked for, warm up the two L flips between so that doesn't hitch
+    const ShaderKeywords keywords = shaderKeywords(scene, sceneKeywords) | shaderKeywords(scene, "INSTANCE_TRANSFORMS");
+    const ShaderKeywords loadLevel = shaderKeywords(scene, "SHOW_LOAD_LEVEL");
+    const ShaderKeywords hot[] = {meshKeywords(quad, scene, keywords), meshKeywords(quad, scene, keywords ^ loadLevel)};
+    shaderWarmUp(scene, hot, 2);
+
+    GLuint shaderProg = 0;
+    // Blend weights and the like, refilled every frame instead of every pixel working them out
+    GpuBuffer constants = drawConstantsCreate();
+
+    ComputeComposite composite;
+    if(!softBackend) computeCompositeInit(composite);
+
+    SoftTarget softTarget;
+    if(softBackend){
+        softTargetCreate(softTarget, 400, 400);
     }
 
-    // Get location of `time` uniform in the shader program
-    const auto timeLoc = glGetUniformLocation(shaderProg, "time");
+    FrameCapture capture;
+    frameCaptureInit(capture, 400, 400);
 
-    float bgColor[] = {1.0, 1.0, 0.0, 1.0};
     while(!glfwWindowShouldClose(window)){
+        PROFILE_ZONE("frame");
+        PROFILE_GPU_ZONE("frame");
+        // Per frame scratch from here on, nothing in the loop should need the heap once it's warmed up
+        frameArenaBegin();
         
-        // Clear the render buffer
-        // glClear(GL_COLOR_BUFFER_BIT);
-        glClearNamedFramebufferfv(fbo, GL_COLOR, 0, bgColor);
-        // Bind the frame buffer so we can draw to it
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        
-        // Set the shader to use
-        glUseProgram(shaderProg);
-        glUniform1f(timeLoc, glfwGetTime());
-        // Draw the triangle
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        if(softBackend){
+            // Draw on the CPU and hand the result to fb_tex, the blit below takes it from there
+            softRenderFrame(softTarget, bgColor, triangleVerts, 6, softTextures[0], softTextures[1], glfwGetTime());
+            glTextureSubImage2D(fb_tex.id(), 0, 0, 0, 400, 400, GL_RGBA, GL_FLOAT, softTarget.pixels);
+        } else {
+            // Whatever finished loading goes up before drawing
+            progressiveTexturesUpdate();
+            texturePoolsBind();
+            drawConstantsUpload(constants, drawConstantsAt(glfwGetTime()));
+
+            // The compute path only knows how to composite the quad
+            if(useComputeComposite && composite.program && !quad.indexCount){
+                PROFILE_GPU_ZONE("composite");
+                // Writes every pixel of fb_tex itself, background included, so no clear
+                computeCompositeDispatch(composite, fb_tex.id(), 400, 400, triangleVerts[0], triangleVerts[2], materials[0], materials[1], bgColor);
+            } else {
+                PROFILE_GPU_ZONE("draw");
+                // Clear the render buffer
+                // glClear(GL_COLOR_BUFFER_BIT);
+                glClearNamedFramebufferfv(fbo.id(), GL_COLOR, 0, bgColor);
+                // Bind the frame buffer so we can draw to it
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo.id());
+
+                // F swaps how the quad is fetched, the variant follows
+                quad.fetch = !flipVertexFetch ? quadFetch : quadFetch == fetchAttribs ? fetchPull : fetchAttribs;
+
+                // Set the shader to use, the material uniforms only need setting when the variant changes
+                const GLuint variant = shaderVariant(scene, meshKeywords(quad, scene, showLoadLevel ? keywords ^ loadLevel : keywords));
+                if(variant != shaderProg){
+                    shaderProg = variant;
+                    glProgramUniform1ui(shaderProg, glGetUniformLocation(shaderProg, "material1"), materials[0]);
+                    glProgramUniform1ui(shaderProg, glGetUniformLocation(shaderProg, "material2"), materials[1]);
+                    meshUniforms(quad, shaderProg);
+                }
+                glUseProgram(shaderProg);
+
+                // Moved nodes go up to this frame's copy of the instance buffer and drag their boxes along.
+                // With this few objects they're all redone when anything moved.
+                transformsUpdate(transforms, changedTransforms);
+                instanceBufferUpdate(instances, transforms, changedTransforms);
+                instanceBufferBind(instances);
+                if(!changedTransforms.empty()){
+                    for(size_t o = 0; o < cullCount(cullBounds); o++){
+                        const float* c = objects[o]->center;
+                        const float* e = objects[o]->extent;
+                        const Aabb box = transformAabb(transformWorld(transforms, objectNodes[o]), aabbFromCenter({c[0], c[1], c[2]}, {e[0], e[1], e[2]}));
+                        const Vec3 center = aabbCenter(box), extent = aabbExtent(box);
+                        cullSet(cullBounds, (uint32_t)o, &center.x, &extent.x);
+                    }
+                }
+
+                // Draw whatever survives culling
+                cullFrustum(cullBounds, frustum, visible);
+                for(uint32_t object : visible){
+                    Mesh& mesh = *objects[object];
+                    // Clip space is 400 pixels across, so 200 a unit
+                    const float ex = cullBounds.extentX[object], ey = cullBounds.extentY[object], ez = cullBounds.extentZ[object];
+                    const float radius = std::sqrt(ex * ex + ey * ey + ez * ez);
+                    meshSelectLod(mesh, radius * 200, lodPixels);
+                    meshBind(mesh);
+                    meshDraw(mesh, objectNodes[object]);
+                }
+                instanceBufferFrameEnd(instances);
+            }
+        }
+        captureFrame(capture, fb_tex.id());
 
-        glBlitNamedFramebuffer(fbo, 0, 0, 0, 400, 400, 0, 0, 400, 400, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        {
+            PROFILE_GPU_ZONE("blit");
+            glBlitNamedFramebuffer(fbo.id(), 0, 0, 0, 400, 400, 0, 0, 400, 400, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        glCaptureFrameEnd();
+        glStatsFrameEnd();
+        profilerFrameEnd();
 
         // Swap render and display buffers
-        glfwSwapBuffers(window);
+        {
+            PROFILE_ZONE("swap");
+            glfwSwapBuffers(window);
+        }
 
         glfwPollEvents();
     }
@@ -245,17 +424,260 @@ void loop(){
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     glBindTexture(GL_TEXTURE_2D, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    frameCaptureClose(capture);
+    instanceBufferFree(instances);
+    meshFree(quad);
+    softTargetFree(softTarget);
+    for(auto& tex : softTextures) softTextureFree(tex);
+    progressiveTexturesFree();
+    texturePoolsFree();
+    shaderProgramFree(scene);
+    computeCompositeFree(composite);
 }
 
-int main()
+// Pyramid for `image`, cut next to the texture cache the first time or when the image is newer than it
+bool deepZoomPyramid(const char* image, std::string& pyramidFile){
+    const char* ext = strrchr(image, '.');
+    if(ext && !strcmp(ext, ".pyr")){
+        pyramidFile = image;
+        return true;
+    }
+
+    const char* base = strrchr(image, '/');
+    pyramidFile = std::string("output/") + (base ? base + 1 : image) + ".pyr";
+
+    struct stat imageStat, pyramidStat;
+    if(stat(pyramidFile.c_str(), &pyramidStat) == 0 && stat(image, &imageStat) == 0 && pyramidStat.st_mtime >= imageStat.st_mtime){
+        return true;
+    }
+
+    int width, height, numCh;
+    unsigned char* pixels = imageLoad(image, &width, &height, &numCh);
+    if(!pixels) return false;
+    mkdir("output", 0755);
+    bool ok = pyramidBuild(pyramidFile.c_str(), pixels, width, height, numCh);
+    imageFree(pixels);
+    return ok;
+}
+
+// Dive in and out of a tiled image, only the tiles the current zoom needs get loaded
+void deepZoomLoop(const char* pyramidFile){
+    GpuTexture fb_tex;
+    GpuFramebuffer fbo = createFramebuffer(fb_tex);
+
+    TileStream stream;
+    if(!tileStreamOpen(stream, pyramidFile)) return;
+
+    Mesh quad;
+    meshCreate(quad, triangleVerts, 6, "triangle verts", vertexFetch);
+
+    ShaderProgram tiled;
+    GLuint shaderProg = 0;
+    if(shaderProgramLoad(tiled, "assets/shaders/vertex.glsl", "assets/shaders/tiled.glsl")) shaderProg = shaderVariant(tiled, meshKeywords(quad, tiled, 0));
+    if(!shaderProg){
+        meshFree(quad);
+        tileStreamClose(stream);
+        return;
+    }
+    const auto viewLoc = glGetUniformLocation(shaderProg, "view");
+    tileStreamBind(stream, shaderProg, 0, 1);
+
+    // Spot to zoom in on, in uv
+    const float focus[2] = {0.62f, 0.41f};
+    // The quad covers 95% of the 400x400 target
+    const int quadPixels = 400 * .95;
+
+    FrameCapture capture;
+    frameCaptureInit(capture, 400, 400);
+
+    while(!glfwWindowShouldClose(window)){
+        PROFILE_ZONE("frame");
+        PROFILE_GPU_ZONE("frame");
+        frameArenaBegin();
+        // Go from the whole image down to 1/64th of it and back out
+        const float size = std::exp2(-6.0f * (0.5f - 0.5f * std::cos(glfwGetTime() * 0.3f)));
+        const float view[4] = {
+            focus[0] * (1 - size), focus[1] * (1 - size),
+            focus[0] * (1 - size) + size, focus[1] * (1 - size) + size,
+        };
+        tileStreamUpdate(stream, view, quadPixels, quadPixels);
+
+        glClearNamedFramebufferfv(fbo.id(), GL_COLOR, 0, bgColor);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo.id());
+        glUseProgram(shaderProg);
+        glUniform4f(viewLoc, view[0], view[1], size, size);
+        meshBind(quad);
+        meshDraw(quad);
+        captureFrame(capture, fb_tex.id());
+
+        {
+            PROFILE_GPU_ZONE("blit");
+            glBlitNamedFramebuffer(fbo.id(), 0, 0, 0, 400, 400, 0, 0, 400, 400, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        glCaptureFrameEnd();
+        glStatsFrameEnd();
+        profilerFrameEnd();
+        {
+            PROFILE_ZONE("swap");
+            glfwSwapBuffers(window);
+        }
+        glfwPollEvents();
+    }
+
+    printf("Deep zoom: %llu tiles loaded, %llu evicted\n", (unsigned long long)stream.tilesLoaded, (unsigned long long)stream.tilesEvicted);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    frameCaptureClose(capture);
+    meshFree(quad);
+    tileStreamClose(stream);
+    shaderProgramFree(tiled);
+}
+
+// Every thread has to be done with its zones, so after jobsShutdown
+void writeProfile(){
+    if(!profileFile) return;
+    mkdir("output", 0755);
+    profilerEnd(profileFile);
+}
+
+int main(int argc, char** argv)
 {
+    // --reference <out.ppm> [time]   render one frame on the CPU and exit
+    // --soft                         draw with the CPU rasterizer instead of the GPU
+    // --texture-budget <MB>          shrink textures until each one decodes to at most this much
+    // --full-res                     load textures at full size even when they're never shown that big
+    // --no-texture-cache             decode textures every run instead of keeping them in output/texcache
+    // --deep-zoom <image|.pyr>       stream a tiled pyramid of the image instead of the usual scene
+    // --shader-keywords <A,B,...>    build frag.glsl with these keywords on (see its #pragma keywords)
+    // --no-shader-cache              compile shaders every run instead of keeping binaries in output/shadercache
+    // --compute                      composite with a compute shader instead of drawing the quad (C flips it)
+    // --vertex-fetch <auto|pull|attribs>  how vertex.glsl gets the quad, ssbo pulling or VAO attributes (F flips it)
+    // --mesh <file.obj|.gltf|.glb>   draw this mesh instead of the quad, cooked into output/meshcache the first time
+    // --no-mesh-cache                import the mesh every run instead
+    // --lod-pixels <px>              how far off in pixels a mesh's level of detail can be, 1 by default, 0 for full detail
+    // --gpu-budget <MB>              warn when textures, buffers and render targets add up to more than this (M reports)
+    // --capture [dir]                save every frame as a PNG in dir, output/capture by default (P flips it)
+    // --gl-capture <file> [frames]   record every GL call of the first frames (60) for bench/glReplay
+    // --gl-stats                     count GL calls and bytes every frame, needs make GL_STATS=1 (G reports)
+    // --gl-budget <calls> [MB up] [MB back]  flag frames that make more calls or move more bytes than this
+    // --profile [file]               write a Chrome trace of CPU and GPU zones at exit, output/trace.json by default
+    const char* referenceOut = nullptr;
+    float referenceTime = 0;
+    bool softBackend = false;
+    bool useTextureCache = true;
+    bool useShaderCache = true;
+    bool useMeshCache = true;
+    const char* deepZoom = nullptr;
+
+    // The quad covers 95% of the 400x400 target, there's no point decoding more than that
+    textureOpts.displayWidth = textureOpts.displayHeight = (int)(400 * .95);
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "--reference") && i + 1 < argc){
+            referenceOut = argv[++i];
+            if(i + 1 < argc && argv[i + 1][0] != '-') referenceTime = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "--soft")){
+            softBackend = true;
+        } else if(!strcmp(argv[i], "--texture-budget") && i + 1 < argc){
+            textureOpts.maxBytes = (size_t)(atof(argv[++i]) * 1024 * 1024);
+        } else if(!strcmp(argv[i], "--full-res")){
+            textureOpts.displayWidth = textureOpts.displayHeight = 0;
+        } else if(!strcmp(argv[i], "--no-texture-cache")){
+            useTextureCache = false;
+        } else if(!strcmp(argv[i], "--deep-zoom") && i + 1 < argc){
+            deepZoom = argv[++i];
+        } else if(!strcmp(argv[i], "--shader-keywords") && i + 1 < argc){
+            sceneKeywords = argv[++i];
+        } else if(!strcmp(argv[i], "--no-shader-cache")){
+            useShaderCache = false;
+        } else if(!strcmp(argv[i], "--compute")){
+            useComputeComposite = true;
+        } else if(!strcmp(argv[i], "--vertex-fetch") && i + 1 < argc){
+            const char* fetch = argv[++i];
+            if(!strcmp(fetch, "pull"))         vertexFetch = fetchPull;
+            else if(!strcmp(fetch, "attribs")) vertexFetch = fetchAttribs;
+            else if(strcmp(fetch, "auto"))     printf("Unknown vertex fetch '%s', picking per mesh\n", fetch);
+        } else if(!strcmp(argv[i], "--mesh") && i + 1 < argc){
+            meshFile = argv[++i];
+        } else if(!strcmp(argv[i], "--no-mesh-cache")){
+            useMeshCache = false;
+        } else if(!strcmp(argv[i], "--lod-pixels") && i + 1 < argc){
+            lodPixels = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "--gpu-budget") && i + 1 < argc){
+            gpuMemorySetTotalBudget((size_t)(atof(argv[++i]) * 1024 * 1024));
+        } else if(!strcmp(argv[i], "--gl-capture") && i + 1 < argc){
+            glCaptureFile = argv[++i];
+            if(i + 1 < argc && argv[i + 1][0] != '-') glCaptureFrames = atoi(argv[++i]);
+        } else if(!strcmp(argv[i], "--gl-stats")){
+            glStatsOn = true;
+        } else if(!strcmp(argv[i], "--gl-budget") && i + 1 < argc){
+            glStatsOn = true;
+            glBudget.calls = atoi(argv[++i]);
+            if(i + 1 < argc && argv[i + 1][0] != '-') glBudget.uploadBytes = (uint64_t)(atof(argv[++i]) * 1024 * 1024);
+            if(i + 1 < argc && argv[i + 1][0] != '-') glBudget.readbackBytes = (uint64_t)(atof(argv[++i]) * 1024 * 1024);
+        } else if(!strcmp(argv[i], "--profile")){
+            profileFile = "output/trace.json";
+            if(i + 1 < argc && argv[i + 1][0] != '-') profileFile = argv[++i];
+        } else if(!strcmp(argv[i], "--capture")){
+            capturing = true;
+            if(i + 1 < argc && argv[i + 1][0] != '-') captureDir = argv[++i];
+        } else {
+            printf("Unknown argument \'%s\'\n", argv[i]);
+        }
+    }
+
+    // Before the workers start so they're named in the trace
+    if(profileFile){
+        profilerBegin();
+        profilerThreadName("main");
+    }
+    jobsInit();
+    frameArenaInit();
+    if(useTextureCache) texCacheInit("output/texcache", 256 << 20);
+    if(meshFile && useMeshCache) meshCacheInit("output/meshcache");
+
+    if(referenceOut){
+        bool ok = renderReference(referenceOut, referenceTime);
+        texCacheShutdown();
+        frameArenaShutdown();
+        jobsShutdown();
+        writeProfile();
+        return ok ? 0 : 1;
+    }
+
+    std::string pyramidFile;
+    if(deepZoom && !deepZoomPyramid(deepZoom, pyramidFile)){
+        printf("Failed to make a pyramid out of \'%s\'\n", deepZoom);
+        deepZoom = nullptr;
+    }
+
     // Set up window
-    if(init())
-    // Set up buffers and loop until esc pressed
-    loop();
+    if(init()){
+        // Program binaries need a context to make or check
+        if(useShaderCache) shaderCacheInit("output/shadercache");
+
+        // Set up buffers and loop until esc pressed
+        if(deepZoom) deepZoomLoop(pyramidFile.c_str());
+        else         loop(softBackend);
+        profilerGpuShutdown();
+
+        // Everything should have been given back by now, whatever is left after the spares go is a leak
+        gpuResourcesShutdown();
+        gpuMemoryReportLeaks();
+        // Closed windows before the frame count ran out still get a file
+        glCaptureEnd();
+        glStatsEnd();
+    }
 
     // ---- Cleanup ----
     glfwDestroyWindow(window);
     glfwTerminate();
     glfwSetErrorCallback(NULL);
+
+    shaderCacheShutdown();
+    texCacheShutdown();
+    meshCacheShutdown();
+    frameArenaShutdown();
+    jobsShutdown();
+    writeProfile();
 }
\ No newline at end of file
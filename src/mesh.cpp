@@ -0,0 +1,159 @@
+#include "mesh.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Attribute locations in vertex.glsl
+    const GLuint positionAttrib = 0;
+    const GLuint uvAttrib = 1;
+}
+
+bool meshCreate(Mesh& mesh, const Vert* verts, size_t count, const char* label, VertexFetch fetch){
+    if(!count) return false;
+    mesh.verts = gpuBufferCreate({count * sizeof(Vert)}, gpuBuffers, label, verts);
+    if(!mesh.verts.id()){
+        printf("Failed to make a vertex buffer for '%s'\n", label);
+        return false;
+    }
+    mesh.vertCount = (GLsizei)count;
+    if(fetch == fetchAuto) fetch = count >= attribMinVerts ? fetchAttribs : fetchPull;
+    for(int c = 0; c < 3; c++){
+        float lo = verts[0].pos[c], hi = verts[0].pos[c];
+        for(size_t i = 1; i < count; i++){
+            lo = std::min(lo, verts[i].pos[c]);
+            hi = std::max(hi, verts[i].pos[c]);
+        }
+        mesh.center[c] = (lo + hi) * 0.5f;
+        mesh.extent[c] = (hi - lo) * 0.5f;
+    }
+    mesh.fetch = fetch;
+
+    // Set up whichever way it starts out, so it can be flipped later without touching GL
+    glCreateVertexArrays(1, &mesh.vao);
+    glVertexArrayVertexBuffer(mesh.vao, 0, mesh.verts.id(), 0, sizeof(Vert));
+    glEnableVertexArrayAttrib(mesh.vao, positionAttrib);
+    glVertexArrayAttribFormat(mesh.vao, positionAttrib, 3, GL_FLOAT, GL_FALSE, offsetof(Vert, pos));
+    glVertexArrayAttribBinding(mesh.vao, positionAttrib, 0);
+    glEnableVertexArrayAttrib(mesh.vao, uvAttrib);
+    glVertexArrayAttribFormat(mesh.vao, uvAttrib, 2, GL_FLOAT, GL_FALSE, offsetof(Vert, uv));
+    glVertexArrayAttribBinding(mesh.vao, uvAttrib, 0);
+    return true;
+}
+
+bool meshCreateCooked(Mesh& mesh, const CookedMesh& cooked, const char* label, VertexFetch fetch){
+    if(!cooked.vertCount || !cooked.indexCount) return false;
+    // No storage flags, so gpuBufferAcquire goes straight to glNamedBufferStorage with the cooked bytes
+    mesh.verts = gpuBufferCreate({cooked.vertBytes}, gpuBuffers, label, cooked.verts);
+    mesh.indices = gpuBufferCreate({cooked.indexBytes}, gpuBuffers, label, cooked.indices);
+    if(!mesh.verts.id() || !mesh.indices.id()){
+        printf("Failed to make buffers for '%s'\n", label);
+        meshFree(mesh);
+        return false;
+    }
+    mesh.vertCount = (GLsizei)cooked.vertCount;
+    mesh.indexCount = (GLsizei)cooked.indexCount;
+    mesh.indexType = cooked.indexType;
+    memcpy(mesh.lods, cooked.lods, sizeof(mesh.lods));
+    mesh.lodCount = cooked.lodCount;
+    mesh.lod = 0;
+    if(fetch == fetchAuto) fetch = cooked.vertCount >= attribMinVerts ? fetchAttribs : fetchPull;
+    mesh.fetch = fetch;
+
+    mesh.quantized = true;
+    for(int c = 0; c < 3; c++){
+        mesh.posScale[c] = cooked.posScale[c];
+        mesh.posOffset[c] = cooked.posOffset[c];
+        // The quantizing range is the bounds, flat axes a little bigger
+        mesh.center[c] = cooked.posOffset[c];
+        mesh.extent[c] = cooked.posScale[c];
+    }
+    mesh.uvTransform[0] = cooked.uvScale[0];
+    mesh.uvTransform[1] = cooked.uvScale[1];
+    mesh.uvTransform[2] = cooked.uvOffset[0];
+    mesh.uvTransform[3] = cooked.uvOffset[1];
+
+    // Same attributes as meshCreate, just normalized shorts. The padding short is left out of position.
+    glCreateVertexArrays(1, &mesh.vao);
+    glVertexArrayVertexBuffer(mesh.vao, 0, mesh.verts.id(), 0, sizeof(PackedVert));
+    glVertexArrayElementBuffer(mesh.vao, mesh.indices.id());
+    glEnableVertexArrayAttrib(mesh.vao, positionAttrib);
+    glVertexArrayAttribFormat(mesh.vao, positionAttrib, 3, GL_SHORT, GL_TRUE, offsetof(PackedVert, pos));
+    glVertexArrayAttribBinding(mesh.vao, positionAttrib, 0);
+    glEnableVertexArrayAttrib(mesh.vao, uvAttrib);
+    glVertexArrayAttribFormat(mesh.vao, uvAttrib, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVert, uv));
+    glVertexArrayAttribBinding(mesh.vao, uvAttrib, 0);
+    return true;
+}
+
+void meshFitView(Mesh& mesh, float extent){
+    // The quantized bounds are posOffset +- posScale
+    const float longest = std::max(mesh.posScale[0], std::max(mesh.posScale[1], mesh.posScale[2]));
+    if(longest <= 0) return;
+    for(int c = 0; c < 3; c++){
+        mesh.posScale[c] *= extent / longest;
+        mesh.posOffset[c] = 0;
+        mesh.center[c] = 0;
+        mesh.extent[c] = mesh.posScale[c];
+    }
+}
+
+bool meshSelectLod(Mesh& mesh, float screenRadius, float maxPixels){
+    const int lod = lodSelect(mesh.lods, mesh.lodCount, mesh.lod, screenRadius, maxPixels);
+    if(lod == mesh.lod) return false;
+    mesh.lod = lod;
+    return true;
+}
+
+void meshBind(const Mesh& mesh){
+    glBindVertexArray(mesh.vao);
+    if(mesh.fetch == fetchPull) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh.verts.id());
+}
+
+ShaderKeywords meshKeywords(const Mesh& mesh, const ShaderProgram& prog, ShaderKeywords keywords){
+    for(size_t i = 0; i < prog.keywords.size(); i++){
+        const ShaderKeywords bit = 1u << i;
+        bool on;
+        if(prog.keywords[i] == "VERTEX_ATTRIBS") on = mesh.fetch == fetchAttribs;
+        else if(prog.keywords[i] == "QUANTIZED") on = mesh.quantized;
+        else continue;
+        keywords = on ? keywords | bit : keywords & ~bit;
+    }
+    return keywords;
+}
+
+void meshUniforms(const Mesh& mesh, GLuint program){
+    if(!mesh.quantized) return;
+    const float* s = mesh.posScale;
+    const float* o = mesh.posOffset;
+    const float* uv = mesh.uvTransform;
+    glProgramUniform4f(program, glGetUniformLocation(program, "posScale"), s[0], s[1], s[2], s[3]);
+    glProgramUniform4f(program, glGetUniformLocation(program, "posOffset"), o[0], o[1], o[2], o[3]);
+    glProgramUniform4f(program, glGetUniformLocation(program, "uvTransform"), uv[0], uv[1], uv[2], uv[3]);
+}
+
+void meshDraw(const Mesh& mesh, GLuint instance){
+    // One instance, `instance` only goes to gl_BaseInstance
+    if(mesh.lodCount){
+        const MeshLod& lod = mesh.lods[mesh.lod];
+        const size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, lod.indexCount, mesh.indexType, (const void*)(lod.firstIndex * indexSize), 1, instance);
+    } else if(mesh.indexCount){
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, mesh.indexCount, mesh.indexType, nullptr, 1, instance);
+    } else {
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, mesh.vertCount, 1, instance);
+    }
+}
+
+void meshFree(Mesh& mesh){
+    if(mesh.vao) glDeleteVertexArrays(1, &mesh.vao);
+    mesh.vao = 0;
+    mesh.verts.reset();
+    mesh.indices.reset();
+    mesh.vertCount = 0;
+    mesh.indexCount = 0;
+    mesh.quantized = false;
+    mesh.lodCount = 0;
+    mesh.lod = 0;
+}
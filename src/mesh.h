@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+
+#include "glad/glad.h"
+#include "gpuResources.h"
+#include "meshCache.h"
+#include "shaderVariants.h"
+#include "vert.h"
+
+// Vertex data for vertex.glsl, which can get at it two ways:
+// - pulled: the shader indexes the ssbo at binding 0 by gl_VertexID. Nothing to set up, but reading scalar
+//   float arrays goes around the fixed function vertex fetch and its cache on some drivers.
+// - attributes: a VAO feeds position and uv in as plain vertex inputs, the VERTEX_ATTRIBS variant.
+// Both read the same buffer, so a mesh can switch between them any time as long as the shader variant follows
+// (meshKeywords).
+// Cooked meshes (meshCache.h) are indexed and hold PackedVert instead, the QUANTIZED variant unpacks them with
+// the scale and offset meshUniforms sets.
+
+enum VertexFetch {
+    // Let meshCreate pick from the vertex count
+    fetchAuto,
+    fetchPull,
+    fetchAttribs,
+};
+
+// Meshes with fewer vertices than this are pulled, there's nothing for a fetch cache to win on a quad.
+// Past it attributes were never slower in bench/renderBench.
+const size_t attribMinVerts = 1024;
+
+struct Mesh {
+    GpuBuffer verts;
+    GLuint vao = 0;
+    GLsizei vertCount = 0;
+    VertexFetch fetch = fetchPull;
+
+    // Drawn indexed when there are indices
+    GpuBuffer indices;
+    GLsizei indexCount = 0;
+    GLenum indexType = 0;
+    bool quantized = false;
+    // position = packed * posScale + posOffset, uv = packed * uvTransform.xy + uvTransform.zw
+    float posScale[4] = {1, 1, 1, 0}, posOffset[4] = {};
+    float uvTransform[4] = {1, 1, 0, 0};
+
+    // Box around what vertex.glsl puts out, for culling
+    float center[3] = {}, extent[3] = {};
+
+    // Levels of detail in `indices` for cooked meshes, meshDraw draws level `lod`
+    MeshLod lods[meshMaxLods] = {};
+    int lodCount = 0;
+    int lod = 0;
+};
+
+// Upload `count` vertices and set up the VAO. fetchAuto picks by attribMinVerts.
+bool meshCreate(Mesh& mesh, const Vert* verts, size_t count, const char* label, VertexFetch fetch = fetchAuto);
+// Upload a cooked mesh. The buffers are made straight from its bytes, which for a cache hit is the mapped file.
+bool meshCreateCooked(Mesh& mesh, const CookedMesh& cooked, const char* label, VertexFetch fetch = fetchAuto);
+// Scale and center a cooked mesh so its bounds fill [-extent, extent] on the longest axis, keeping its proportions
+void meshFitView(Mesh& mesh, float extent);
+// Pick the level to draw for a mesh whose bounds cover `screenRadius` pixels, off by at most `maxPixels`
+// (see lodSelect). True if it changed.
+bool meshSelectLod(Mesh& mesh, float screenRadius, float maxPixels);
+// Bind the VAO, and the buffer at ssbo binding 0 when pulling. The VAO goes on either way, core profiles
+// won't draw without one.
+void meshBind(const Mesh& mesh);
+// `keywords` with VERTEX_ATTRIBS and QUANTIZED on or off to match `mesh`. Keywords `prog` doesn't have are left alone.
+ShaderKeywords meshKeywords(const Mesh& mesh, const ShaderProgram& prog, ShaderKeywords keywords);
+// Set the dequantizing uniforms on `program`, nothing for meshes that aren't quantized
+void meshUniforms(const Mesh& mesh, GLuint program);
+// `instance` picks the world matrix with INSTANCE_TRANSFORMS, a TransformId (see transforms.h)
+void meshDraw(const Mesh& mesh, GLuint instance = 0);
+void meshFree(Mesh& mesh);
@@ -0,0 +1,288 @@
+#include "meshCache.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fileUtil.h"
+#include "jobs.h"
+#include "meshImport.h"
+#include "profiler.h"
+
+namespace {
+    // Bump whenever the layout or the quantizing changes, old entries then just miss
+    const uint32_t fileVersion = 2;
+    const char fileMagic[8] = {'M', 'E', 'S', 'H', 'C', 'O', 'O', 'K'};
+    // Both sections start on a cache line, the mapping itself is page aligned
+    const size_t sectionAlign = 64;
+    // Vertices a job when quantizing
+    const size_t quantizeBatch = 1 << 16;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t indexType;
+        uint64_t key;
+        // What the source looked like when it was cooked
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        uint64_t vertCount, indexCount;
+        uint64_t vertOffset, indexOffset;
+        float posScale[3], posOffset[3];
+        float uvScale[2], uvOffset[2];
+        uint32_t lodCount;
+        uint32_t pad;
+        MeshLod lods[meshMaxLods];
+    };
+
+    std::string cacheDir;
+    bool cacheEnabled = false;
+
+    std::string entryPath(uint64_t key){
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.mesh", (unsigned long long)key);
+        return cacheDir + name;
+    }
+
+    size_t alignUp(size_t size){
+        return (size + sectionAlign - 1) / sectionAlign * sectionAlign;
+    }
+
+    size_t indexBytes(uint32_t indexType){
+        return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    // Indices a job when checking a mapped entry
+    const size_t checkBatch = 1 << 18;
+
+    // A stale or corrupt entry pointing past the vertices would have the GPU read out of bounds
+    template<typename Index>
+    bool indicesInRange(const Index* indices, size_t count, uint64_t vertCount){
+        const size_t batches = (count + checkBatch - 1) / checkBatch;
+        std::atomic<bool> ok{true};
+        parallelFor(batches, [&](size_t b){
+            const Index* first = indices + b * checkBatch;
+            const Index* last = indices + std::min(count, (b + 1) * checkBatch);
+            // Branch free max so the loop vectorizes
+            Index top = 0;
+            for(const Index* i = first; i < last; i++) top = std::max(top, *i);
+            if(top >= vertCount) ok = false;
+        });
+        return ok;
+    }
+
+    void fillMesh(CookedMesh& mesh, const FileHeader& header){
+        mesh.vertCount = header.vertCount;
+        mesh.indexCount = header.indexCount;
+        mesh.indexType = header.indexType;
+        memcpy(mesh.posScale, header.posScale, sizeof(mesh.posScale));
+        memcpy(mesh.posOffset, header.posOffset, sizeof(mesh.posOffset));
+        memcpy(mesh.uvScale, header.uvScale, sizeof(mesh.uvScale));
+        memcpy(mesh.uvOffset, header.uvOffset, sizeof(mesh.uvOffset));
+        mesh.verts = (const PackedVert*)((const uint8_t*)mesh.block + header.vertOffset);
+        mesh.indices = (const uint8_t*)mesh.block + header.indexOffset;
+        mesh.vertBytes = header.vertCount * sizeof(PackedVert);
+        mesh.indexBytes = header.indexCount * indexBytes(header.indexType);
+        mesh.lodCount = header.lodCount;
+        memcpy(mesh.lods, header.lods, sizeof(mesh.lods));
+    }
+
+    bool mapEntry(CookedMesh& mesh, const std::string& path, uint64_t key, const struct stat& source){
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+
+        struct stat st;
+        if(fstat(fd, &st) || (size_t)st.st_size < sizeof(FileHeader)){
+            close(fd);
+            return false;
+        }
+        // Populated up front, the upload is going to touch every page anyway and this reads them in big runs
+        void* block = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        close(fd);
+        if(block == MAP_FAILED) return false;
+
+        // Don't trust anything about the file until it checks out
+        const FileHeader& header = *(const FileHeader*)block;
+        const uint64_t size = st.st_size;
+        bool ok = !memcmp(header.magic, fileMagic, sizeof(fileMagic)) && header.version == fileVersion &&
+                  header.key == key && header.sourceSize == (uint64_t)source.st_size &&
+                  header.sourceMtime == (int64_t)source.st_mtim.tv_sec * 1000000000 + source.st_mtim.tv_nsec &&
+                  (header.indexType == GL_UNSIGNED_SHORT || header.indexType == GL_UNSIGNED_INT) &&
+                  header.vertCount && header.indexCount && header.indexCount % 3 == 0 &&
+                  header.vertOffset % sectionAlign == 0 && header.indexOffset % sectionAlign == 0 &&
+                  // Subtracting so a huge offset or count can't wrap around
+                  header.vertOffset <= size && header.vertCount <= (size - header.vertOffset) / sizeof(PackedVert) &&
+                  header.indexOffset <= size && header.indexCount <= (size - header.indexOffset) / indexBytes(header.indexType) &&
+                  header.lodCount >= 1 && header.lodCount <= (uint32_t)meshMaxLods;
+        for(uint32_t l = 0; ok && l < header.lodCount; l++){
+            const MeshLod& lod = header.lods[l];
+            ok = lod.indexCount && lod.indexCount % 3 == 0 && (uint64_t)lod.firstIndex + lod.indexCount <= header.indexCount;
+        }
+        // Every level is a range of the one index section, so checking the whole section covers them all
+        if(ok){
+            const void* indices = (const uint8_t*)block + header.indexOffset;
+            ok = header.indexType == GL_UNSIGNED_SHORT ?
+                indicesInRange((const uint16_t*)indices, header.indexCount, header.vertCount) :
+                indicesInRange((const uint32_t*)indices, header.indexCount, header.vertCount);
+        }
+        if(!ok){
+            munmap(block, st.st_size);
+            return false;
+        }
+
+        mesh.block = block;
+        mesh.blockSize = st.st_size;
+        mesh.mapped = true;
+        fillMesh(mesh, header);
+        return true;
+    }
+
+    // Import and quantize into a block laid out exactly like the cache file
+    bool buildEntry(CookedMesh& mesh, const char* fName, uint64_t key, const struct stat& source){
+        MeshData data;
+        if(!meshImport(fName, data)) return false;
+        if(data.verts.size() > UINT32_MAX){
+            printf("\'%s\': too many vertices to cook\n", fName);
+            return false;
+        }
+        PROFILE_ZONE("cook mesh");
+        MeshLod lods[meshMaxLods] = {};
+        const int lodCount = meshBuildLods(data.verts.data(), data.verts.size(), data.indices, lods);
+
+        FileHeader header = {};
+        memcpy(header.magic, fileMagic, sizeof(fileMagic));
+        header.version = fileVersion;
+        header.key = key;
+        header.sourceSize = source.st_size;
+        header.sourceMtime = (int64_t)source.st_mtim.tv_sec * 1000000000 + source.st_mtim.tv_nsec;
+        header.vertCount = data.verts.size();
+        header.indexCount = data.indices.size();
+        header.indexType = data.verts.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        header.lodCount = lodCount;
+        memcpy(header.lods, lods, sizeof(lods));
+
+        // Quantize over the bounds. Flat axes get a scale of 1 so nothing divides by 0.
+        float lo[5], hi[5];
+        for(int c = 0; c < 5; c++){
+            lo[c] = INFINITY;
+            hi[c] = -INFINITY;
+        }
+        for(const Vert& v : data.verts){
+            for(int c = 0; c < 3; c++){
+                lo[c] = std::min(lo[c], v.pos[c]);
+                hi[c] = std::max(hi[c], v.pos[c]);
+            }
+            for(int c = 0; c < 2; c++){
+                lo[3 + c] = std::min(lo[3 + c], v.uv[c]);
+                hi[3 + c] = std::max(hi[3 + c], v.uv[c]);
+            }
+        }
+        for(int c = 0; c < 3; c++){
+            header.posOffset[c] = (lo[c] + hi[c]) * 0.5f;
+            header.posScale[c] = hi[c] > lo[c] ? (hi[c] - lo[c]) * 0.5f : 1.0f;
+        }
+        for(int c = 0; c < 2; c++){
+            header.uvOffset[c] = lo[3 + c];
+            header.uvScale[c] = hi[3 + c] > lo[3 + c] ? hi[3 + c] - lo[3 + c] : 1.0f;
+        }
+
+        header.vertOffset = alignUp(sizeof(FileHeader));
+        header.indexOffset = header.vertOffset + alignUp(header.vertCount * sizeof(PackedVert));
+        const size_t size = header.indexOffset + alignUp(header.indexCount * indexBytes(header.indexType));
+
+        void* block = nullptr;
+        if(posix_memalign(&block, sectionAlign, size)) return false;
+        memset(block, 0, size);
+        memcpy(block, &header, sizeof(header));
+        mesh.block = block;
+        mesh.blockSize = size;
+        mesh.mapped = false;
+        fillMesh(mesh, header);
+
+        PackedVert* packed = (PackedVert*)((uint8_t*)block + header.vertOffset);
+        const size_t batches = (data.verts.size() + quantizeBatch - 1) / quantizeBatch;
+        parallelFor(batches, [&](size_t batch){
+            const size_t end = std::min(data.verts.size(), (batch + 1) * quantizeBatch);
+            for(size_t i = batch * quantizeBatch; i < end; i++){
+                const Vert& v = data.verts[i];
+                PackedVert& p = packed[i];
+                for(int c = 0; c < 3; c++){
+                    const float n = (v.pos[c] - header.posOffset[c]) / header.posScale[c];
+                    p.pos[c] = (int16_t)std::lround(std::min(std::max(n, -1.0f), 1.0f) * 32767.0f);
+                }
+                p.pos[3] = 0;
+                for(int c = 0; c < 2; c++){
+                    const float n = (v.uv[c] - header.uvOffset[c]) / header.uvScale[c];
+                    p.uv[c] = (uint16_t)std::lround(std::min(std::max(n, 0.0f), 1.0f) * 65535.0f);
+                }
+            }
+        });
+
+        uint8_t* indices = (uint8_t*)block + header.indexOffset;
+        if(header.indexType == GL_UNSIGNED_SHORT){
+            for(size_t i = 0; i < data.indices.size(); i++) ((uint16_t*)indices)[i] = (uint16_t)data.indices[i];
+        } else {
+            memcpy(indices, data.indices.data(), data.indices.size() * 4);
+        }
+        return true;
+    }
+
+    // Written whole then renamed in, so nobody ever maps half a file
+    void storeEntry(const CookedMesh& mesh, const std::string& path){
+        if(!writeFileAtomic(path, mesh.block, mesh.blockSize)) printf("Failed to write mesh cache entry \'%s\'\n", path.c_str());
+    }
+}
+
+bool meshCacheInit(const char* dir){
+    cacheDir = dir;
+    while(cacheDir.size() > 1 && cacheDir.back() == '/') cacheDir.pop_back();
+    cacheEnabled = makeDirs(cacheDir);
+    if(!cacheEnabled){
+        printf("Failed to create mesh cache directory \'%s\'\n", dir);
+        return false;
+    }
+    return true;
+}
+
+void meshCacheShutdown(){
+    cacheEnabled = false;
+    cacheDir.clear();
+}
+
+bool meshCacheLoad(CookedMesh& mesh, const char* fName){
+    struct stat source;
+    if(stat(fName, &source)){
+        printf("Failed to open file \'%s\'\n", fName);
+        return false;
+    }
+
+    const uint64_t key = hashBytes(&fileVersion, sizeof(fileVersion), hashBytes(fName, strlen(fName)));
+    std::string path;
+    if(cacheEnabled){
+        path = entryPath(key);
+        if(mapEntry(mesh, path, key, source)) return true;
+    }
+
+    if(!buildEntry(mesh, fName, key, source)){
+        meshCacheRelease(mesh);
+        return false;
+    }
+    if(cacheEnabled) storeEntry(mesh, path);
+    return true;
+}
+
+void meshCacheRelease(CookedMesh& mesh){
+    if(mesh.mapped) munmap(mesh.block, mesh.blockSize);
+    else            free(mesh.block);
+    mesh = CookedMesh();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+
+#include "glad/glad.h"
+#include "meshLod.h"
+#include "vert.h"
+
+// Imported meshes cooked into a file that's ready to hand straight to glNamedBufferStorage: PackedVert
+// vertices then the indices of every level of detail (meshLod.h), each section 64 byte aligned. A hit maps the
+// file and points into the mapping, there's nothing to parse, convert or simplify.
+// Entries are named by the source path and checked against its size and mtime, so an edited source gets cooked
+// again over the top of its old entry. The directory never holds more than one entry a source.
+// Hashing the source the way texCache does would cost about as much as parsing it, which is what this is
+// here to skip. The flip side is that a .gltf's side files aren't checked, only the .gltf itself.
+
+struct CookedMesh {
+    // indexCount covers every level
+    size_t vertCount = 0, indexCount = 0;
+    // GL_UNSIGNED_SHORT when every vertex fits in one, GL_UNSIGNED_INT otherwise
+    GLenum indexType = 0;
+    // Dequantizing: position = snorm * posScale + posOffset, uv = unorm * uvScale + uvOffset
+    float posScale[3] = {}, posOffset[3] = {};
+    float uvScale[2] = {}, uvOffset[2] = {};
+    const PackedVert* verts = nullptr;
+    const void* indices = nullptr;
+    size_t vertBytes = 0, indexBytes = 0;
+    MeshLod lods[meshMaxLods] = {};
+    int lodCount = 0;
+
+    // The bytes behind `verts` and `indices`, a mapping of the cache file on a hit or an allocation otherwise
+    void* block = nullptr;
+    size_t blockSize = 0;
+    bool mapped = false;
+};
+
+// Keep entries in `dir` (made if it's missing). Without a cache meshCacheLoad still works, it imports every time.
+bool meshCacheInit(const char* dir);
+void meshCacheShutdown();
+
+// Load `fName` (anything meshImport reads) from the cache, or import and cook it and store it for next time
+bool meshCacheLoad(CookedMesh& mesh, const char* fName);
+void meshCacheRelease(CookedMesh& mesh);
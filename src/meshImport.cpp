@@ -0,0 +1,918 @@
+#include "meshImport.h"
+
+#include <stdio.h>
+#include <strings.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "jobs.h"
+#include "profiler.h"
+
+namespace {
+    bool readFile(const char* fName, std::vector<char>& data){
+        FILE* f = fopen(fName, "rb");
+        if(!f) return false;
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        data.resize(size > 0 ? size : 0);
+        bool ok = size >= 0 && fread(data.data(), 1, data.size(), f) == data.size();
+        fclose(f);
+        return ok;
+    }
+
+    // Directory part of `fName` with the slash, "" if there isn't one
+    std::string directoryOf(const char* fName){
+        const char* slash = strrchr(fName, '/');
+        return slash ? std::string(fName, slash + 1) : std::string();
+    }
+
+    bool isSpace(char c){
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* skipSpaces(const char* p, const char* end){
+        while(p < end && isSpace(*p)) p++;
+        return p;
+    }
+
+    // strtof without the locale and the copying, close enough for anything that gets quantized to 16 bits.
+    // Returns `p` unchanged if there's no number there.
+    const char* parseFloat(const char* p, const char* end, float& out){
+        const char* start = p;
+        bool negative = false;
+        if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+        double value = 0;
+        bool digits = false;
+        for(; p < end && *p >= '0' && *p <= '9'; p++, digits = true) value = value * 10 + (*p - '0');
+        if(p < end && *p == '.'){
+            p++;
+            double scale = 0.1;
+            for(; p < end && *p >= '0' && *p <= '9'; p++, digits = true, scale *= 0.1) value += (*p - '0') * scale;
+        }
+        if(!digits) return start;
+        if(p < end && (*p == 'e' || *p == 'E')){
+            const char* e = p + 1;
+            bool negativeExp = false;
+            if(e < end && (*e == '-' || *e == '+')) negativeExp = *e++ == '-';
+            int exponent = 0;
+            bool expDigits = false;
+            for(; e < end && *e >= '0' && *e <= '9'; e++, expDigits = true) exponent = std::min(exponent * 10 + (*e - '0'), 400);
+            if(expDigits){
+                value *= std::pow(10.0, negativeExp ? -exponent : exponent);
+                p = e;
+            }
+        }
+        out = (float)(negative ? -value : value);
+        return p;
+    }
+
+    const char* parseInt(const char* p, const char* end, int64_t& out){
+        const char* start = p;
+        bool negative = false;
+        if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+        int64_t value = 0;
+        const char* digits = p;
+        for(; p < end && *p >= '0' && *p <= '9'; p++) value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+        if(p == digits) return start;
+        out = negative ? -value : value;
+        return p;
+    }
+
+    // ---- OBJ ----
+
+    struct ObjCorner {
+        // 0 based. Relative (negative) indices are counted from the start of the chunk until the chunks get
+        // stitched together, the flags say which.
+        int64_t v, vt;
+        uint8_t relative;
+    };
+    const uint8_t relativeV = 1, relativeVt = 2;
+    // No vt given
+    const int64_t noUv = INT64_MIN;
+
+    struct ObjChunk {
+        const char* begin;
+        const char* end;
+        std::vector<float> positions;
+        std::vector<float> uvs;
+        // Three per triangle, faces with more corners get fanned out
+        std::vector<ObjCorner> corners;
+        size_t firstPosition = 0, firstUv = 0;
+        size_t badLines = 0;
+    };
+
+    // One "v/vt/vn" group, vn is skipped. False if there's no vertex index.
+    bool parseCorner(const char*& p, const char* end, const ObjChunk& chunk, ObjCorner& corner){
+        int64_t v = 0;
+        const char* after = parseInt(p, end, v);
+        if(after == p || v == 0) return false;
+        p = after;
+        corner.relative = 0;
+        if(v < 0){
+            corner.v = (int64_t)chunk.positions.size() / 3 + v;
+            corner.relative |= relativeV;
+        } else {
+            corner.v = v - 1;
+        }
+        corner.vt = noUv;
+        if(p < end && *p == '/'){
+            p++;
+            int64_t vt = 0;
+            after = parseInt(p, end, vt);
+            if(after != p && vt != 0){
+                p = after;
+                if(vt < 0){
+                    corner.vt = (int64_t)chunk.uvs.size() / 2 + vt;
+                    corner.relative |= relativeVt;
+                } else {
+                    corner.vt = vt - 1;
+                }
+            }
+            if(p < end && *p == '/'){
+                p++;
+                int64_t vn;
+                p = parseInt(p, end, vn);
+            }
+        }
+        return true;
+    }
+
+    void parseObjChunk(ObjChunk& chunk){
+        const char* p = chunk.begin;
+        const char* end = chunk.end;
+        ObjCorner face[3];
+        while(p < end){
+            const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+            if(!lineEnd) lineEnd = end;
+            p = skipSpaces(p, lineEnd);
+
+            if(lineEnd - p > 2 && p[0] == 'v' && isSpace(p[1])){
+                float xyz[3];
+                const char* q = p + 1;
+                int i = 0;
+                for(; i < 3; i++){
+                    const char* after = parseFloat(skipSpaces(q, lineEnd), lineEnd, xyz[i]);
+                    if(after == skipSpaces(q, lineEnd)) break;
+                    q = after;
+                }
+                if(i == 3) chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+                else       chunk.badLines++;
+            } else if(lineEnd - p > 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])){
+                float uv[2] = {0, 0};
+                const char* q = p + 2;
+                for(int i = 0; i < 2; i++){
+                    q = skipSpaces(q, lineEnd);
+                    q = parseFloat(q, lineEnd, uv[i]);
+                }
+                chunk.uvs.push_back(uv[0]);
+                chunk.uvs.push_back(uv[1]);
+            } else if(lineEnd - p > 2 && p[0] == 'f' && isSpace(p[1])){
+                const char* q = p + 1;
+                int count = 0;
+                ObjCorner corner;
+                while(true){
+                    q = skipSpaces(q, lineEnd);
+                    if(q >= lineEnd || !parseCorner(q, lineEnd, chunk, corner)) break;
+                    // Fan: 0 1 2, 0 2 3, ...
+                    if(count < 3){
+                        face[count] = corner;
+                    } else {
+                        face[1] = face[2];
+                        face[2] = corner;
+                    }
+                    if(++count >= 3) chunk.corners.insert(chunk.corners.end(), face, face + 3);
+                }
+                if(count < 3) chunk.badLines++;
+            }
+            // vn, o, g, s, usemtl, mtllib, comments... nothing we need
+            p = lineEnd + 1;
+        }
+    }
+
+    // (v, vt) pairs -> index of the vertex made for them
+    struct CornerTable {
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> values;
+        uint64_t mask;
+
+        explicit CornerTable(size_t expected){
+            size_t size = 16;
+            while(size < expected * 2) size <<= 1;
+            keys.assign(size, ~0ull);
+            values.resize(size);
+            mask = size - 1;
+        }
+
+        // Index already given to `key`, or `next` after claiming it for it
+        uint32_t find(uint64_t key, uint32_t next, bool& added){
+            uint64_t slot = (key * 0x9e3779b97f4a7c15ull) >> 20 & mask;
+            while(keys[slot] != ~0ull){
+                if(keys[slot] == key){
+                    added = false;
+                    return values[slot];
+                }
+                slot = (slot + 1) & mask;
+            }
+            keys[slot] = key;
+            values[slot] = next;
+            added = true;
+            return next;
+        }
+    };
+
+    // ---- JSON, just enough for glTF ----
+
+    struct Json {
+        enum Type {
+            jsonNull,
+            jsonBool,
+            jsonNumber,
+            jsonString,
+            jsonArray,
+            jsonObject,
+        };
+        Type type = jsonNull;
+        double number = 0;
+        std::string string;
+        // Array elements, or object members in the order of `keys`
+        std::vector<Json> items;
+        std::vector<std::string> keys;
+
+        const Json* get(const char* key) const {
+            if(type != jsonObject) return nullptr;
+            for(size_t i = 0; i < keys.size(); i++) if(keys[i] == key) return &items[i];
+            return nullptr;
+        }
+        const Json* at(int64_t i) const {
+            return type == jsonArray && i >= 0 && (size_t)i < items.size() ? &items[i] : nullptr;
+        }
+        double num(const char* key, double fallback) const {
+            const Json* j = get(key);
+            return j && j->type == jsonNumber ? j->number : fallback;
+        }
+    };
+
+    struct JsonParser {
+        const char* p;
+        const char* end;
+        bool ok = true;
+        int depth = 0;
+
+        void skip(){
+            while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+        }
+
+        bool expect(char c){
+            skip();
+            if(p < end && *p == c){
+                p++;
+                return true;
+            }
+            ok = false;
+            return false;
+        }
+
+        // \u escapes outside ASCII turn into '?', nothing glTF needs goes through them
+        bool parseString(std::string& out){
+            if(!expect('"')) return false;
+            while(p < end && *p != '"'){
+                if(*p == '\\' && p + 1 < end){
+                    p++;
+                    switch(*p){
+                        case 'n': out += '\n'; break;
+                        case 't': out += '\t'; break;
+                        case 'r': out += '\r'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'u':
+                            if(end - p < 5){
+                                ok = false;
+                                return false;
+                            }
+                            {
+                                const unsigned code = (unsigned)strtoul(std::string(p + 1, p + 5).c_str(), nullptr, 16);
+                                out += code < 0x80 ? (char)code : '?';
+                            }
+                            p += 4;
+                            break;
+                        default: out += *p;
+                    }
+                    p++;
+                } else {
+                    out += *p++;
+                }
+            }
+            return expect('"');
+        }
+
+        bool parse(Json& out){
+            skip();
+            if(p >= end || ++depth > 64){
+                ok = false;
+                return false;
+            }
+            if(*p == '{'){
+                p++;
+                out.type = Json::jsonObject;
+                skip();
+                if(p < end && *p == '}') p++;
+                else while(ok){
+                    out.keys.emplace_back();
+                    out.items.emplace_back();
+                    if(!parseString(out.keys.back()) || !expect(':') || !parse(out.items.back())) break;
+                    skip();
+                    if(p < end && *p == ','){
+                        p++;
+                        continue;
+                    }
+                    expect('}');
+                    break;
+                }
+            } else if(*p == '['){
+                p++;
+                out.type = Json::jsonArray;
+                skip();
+                if(p < end && *p == ']') p++;
+                else while(ok){
+                    out.items.emplace_back();
+                    if(!parse(out.items.back())) break;
+                    skip();
+                    if(p < end && *p == ','){
+                        p++;
+                        continue;
+                    }
+                    expect(']');
+                    break;
+                }
+            } else if(*p == '"'){
+                out.type = Json::jsonString;
+                parseString(out.string);
+            } else if(end - p >= 4 && !memcmp(p, "true", 4)){
+                out.type = Json::jsonBool;
+                out.number = 1;
+                p += 4;
+            } else if(end - p >= 5 && !memcmp(p, "false", 5)){
+                out.type = Json::jsonBool;
+                p += 5;
+            } else if(end - p >= 4 && !memcmp(p, "null", 4)){
+                p += 4;
+            } else {
+                // Doubles for the offsets, a float wouldn't hold a big byteOffset exactly
+                char* after;
+                std::string text(p, std::min<size_t>(end - p, 64));
+                out.type = Json::jsonNumber;
+                out.number = strtod(text.c_str(), &after);
+                if(after == text.c_str()) ok = false;
+                p += after - text.c_str();
+            }
+            depth--;
+            return ok;
+        }
+    };
+
+    // ---- glTF ----
+
+    struct Gltf {
+        Json json;
+        std::vector<std::vector<char>> buffers;
+    };
+
+    bool decodeBase64(const char* p, const char* end, std::vector<char>& out){
+        uint32_t bits = 0;
+        int count = 0;
+        for(; p < end && *p != '='; p++){
+            int v;
+            if(*p >= 'A' && *p <= 'Z')      v = *p - 'A';
+            else if(*p >= 'a' && *p <= 'z') v = *p - 'a' + 26;
+            else if(*p >= '0' && *p <= '9') v = *p - '0' + 52;
+            else if(*p == '+')              v = 62;
+            else if(*p == '/')              v = 63;
+            else return false;
+            bits = bits << 6 | v;
+            if((count += 6) >= 8){
+                count -= 8;
+                out.push_back((char)(bits >> count & 0xff));
+            }
+        }
+        return true;
+    }
+
+    bool loadBuffers(Gltf& gltf, const char* fName, std::vector<char>& glbBin){
+        const Json* buffers = gltf.json.get("buffers");
+        if(!buffers) return true;
+        const std::string dir = directoryOf(fName);
+        for(size_t i = 0; i < buffers->items.size(); i++){
+            const Json& buffer = buffers->items[i];
+            const Json* uri = buffer.get("uri");
+            gltf.buffers.emplace_back();
+            std::vector<char>& data = gltf.buffers.back();
+            if(!uri){
+                // The first buffer of a .glb without a uri is its BIN chunk
+                if(i == 0) data.swap(glbBin);
+            } else if(!uri->string.compare(0, 5, "data:")){
+                const size_t comma = uri->string.find(";base64,");
+                if(comma == std::string::npos ||
+                   !decodeBase64(uri->string.c_str() + comma + 8, uri->string.c_str() + uri->string.size(), data)){
+                    printf("\'%s\': buffer %zu has a data uri that isn't base64\n", fName, i);
+                    return false;
+                }
+            } else if(!readFile((dir + uri->string).c_str(), data)){
+                printf("\'%s\': couldn't read buffer \'%s\'\n", fName, uri->string.c_str());
+                return false;
+            }
+            if(data.size() < (size_t)buffer.num("byteLength", 0)){
+                printf("\'%s\': buffer %zu is shorter than its byteLength\n", fName, i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // glTF's componentTypes are the GL enums, spelled out so this doesn't need a GL header
+    const int componentByte = 5120, componentUnsignedByte = 5121, componentShort = 5122, componentUnsignedShort = 5123,
+              componentUnsignedInt = 5125, componentFloat = 5126;
+
+    int componentBytes(int componentType){
+        switch(componentType){
+            case componentByte:          return 1;
+            case componentUnsignedByte:  return 1;
+            case componentShort:         return 2;
+            case componentUnsignedShort: return 2;
+            case componentUnsignedInt:   return 4;
+            case componentFloat:         return 4;
+        }
+        return 0;
+    }
+
+    // One element of an accessor as floats, normalized integers get mapped the way the spec says and plain
+    // integers (KHR_mesh_quantization) come through as they are
+    float readComponent(const char* p, int componentType, bool normalized){
+        switch(componentType){
+            case componentFloat: {
+                float v;
+                memcpy(&v, p, 4);
+                return v;
+            }
+            case componentByte:          return normalized ? std::max(*(const int8_t*)p / 127.0f, -1.0f) : *(const int8_t*)p;
+            case componentUnsignedByte:  return normalized ? *(const uint8_t*)p / 255.0f : *(const uint8_t*)p;
+            case componentShort: {
+                int16_t v;
+                memcpy(&v, p, 2);
+                return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+            }
+            case componentUnsignedShort: {
+                uint16_t v;
+                memcpy(&v, p, 2);
+                return normalized ? v / 65535.0f : v;
+            }
+        }
+        return 0;
+    }
+
+    int typeComponents(const std::string& type){
+        if(type == "SCALAR") return 1;
+        if(type == "VEC2")   return 2;
+        if(type == "VEC3")   return 3;
+        if(type == "VEC4")   return 4;
+        return 0;
+    }
+
+    // Where an accessor's elements are. `data` is null for an accessor without a bufferView, which is all zeros.
+    struct AccessorView {
+        const char* data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+    };
+
+    bool accessorView(const Gltf& gltf, const Json* accessors, int64_t index, AccessorView& view, const char*& error){
+        const Json* accessor = accessors ? accessors->at(index) : nullptr;
+        if(!accessor){
+            error = "an accessor that isn't there";
+            return false;
+        }
+        if(accessor->get("sparse")){
+            error = "a sparse accessor";
+            return false;
+        }
+        const Json* type = accessor->get("type");
+        const Json* normalized = accessor->get("normalized");
+        view.count = (size_t)accessor->num("count", 0);
+        view.componentType = (int)accessor->num("componentType", 0);
+        view.components = type ? typeComponents(type->string) : 0;
+        view.normalized = normalized && normalized->number != 0;
+        const int elementBytes = componentBytes(view.componentType) * view.components;
+        if(!elementBytes){
+            error = "an accessor type that isn't supported";
+            return false;
+        }
+        const Json* bufferViewIndex = accessor->get("bufferView");
+        if(!bufferViewIndex) return true;
+
+        const Json* bufferViews = gltf.json.get("bufferViews");
+        const Json* bufferView = bufferViews ? bufferViews->at((int64_t)bufferViewIndex->number) : nullptr;
+        const int64_t buffer = bufferView ? (int64_t)bufferView->num("buffer", -1) : -1;
+        if(buffer < 0 || (size_t)buffer >= gltf.buffers.size()){
+            error = "a bufferView that isn't there";
+            return false;
+        }
+        const size_t viewOffset = (size_t)bufferView->num("byteOffset", 0);
+        const size_t viewLength = (size_t)bufferView->num("byteLength", 0);
+        const size_t offset = (size_t)accessor->num("byteOffset", 0);
+        view.stride = (size_t)bufferView->num("byteStride", elementBytes);
+        const std::vector<char>& data = gltf.buffers[buffer];
+        if(viewOffset + viewLength > data.size() ||
+           (view.count && offset + view.stride * (view.count - 1) + elementBytes > viewLength)){
+            error = "an accessor running past its buffer";
+            return false;
+        }
+        view.data = data.data() + viewOffset + offset;
+        return true;
+    }
+
+    // `components` floats an element, extra ones in the file are dropped and missing ones are 0
+    bool readFloats(const Gltf& gltf, const Json* accessors, int64_t index, int components, std::vector<float>& out,
+                    const char*& error){
+        AccessorView view;
+        if(!accessorView(gltf, accessors, index, view, error)) return false;
+        if(view.componentType == componentUnsignedInt){
+            error = "a vertex attribute of 32 bit integers";
+            return false;
+        }
+        out.assign(view.count * components, 0.0f);
+        if(!view.data) return true;
+        const int componentSize = componentBytes(view.componentType);
+        const int used = std::min(components, view.components);
+        for(size_t i = 0; i < view.count; i++){
+            const char* element = view.data + i * view.stride;
+            for(int c = 0; c < used; c++){
+                out[i * components + c] = readComponent(element + c * componentSize, view.componentType, view.normalized);
+            }
+        }
+        return true;
+    }
+
+    bool readIndices(const Gltf& gltf, const Json* accessors, int64_t index, std::vector<uint32_t>& out,
+                     const char*& error){
+        AccessorView view;
+        if(!accessorView(gltf, accessors, index, view, error)) return false;
+        if(view.components != 1 || view.componentType == componentFloat || view.componentType == componentByte ||
+           view.componentType == componentShort){
+            error = "indices that aren't unsigned integers";
+            return false;
+        }
+        out.assign(view.count, 0);
+        if(!view.data) return true;
+        for(size_t i = 0; i < view.count; i++){
+            const char* element = view.data + i * view.stride;
+            switch(view.componentType){
+                case componentUnsignedByte: out[i] = *(const uint8_t*)element; break;
+                case componentUnsignedShort: {
+                    uint16_t v;
+                    memcpy(&v, element, 2);
+                    out[i] = v;
+                    break;
+                }
+                default: memcpy(&out[i], element, 4);
+            }
+        }
+        return true;
+    }
+
+    // Column major like glTF's
+    struct Matrix {
+        float m[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    };
+
+    Matrix multiply(const Matrix& a, const Matrix& b){
+        Matrix r;
+        for(int col = 0; col < 4; col++){
+            for(int row = 0; row < 4; row++){
+                float sum = 0;
+                for(int k = 0; k < 4; k++) sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+                r.m[col * 4 + row] = sum;
+            }
+        }
+        return r;
+    }
+
+    void readNumbers(const Json* array, float* out, size_t count){
+        if(!array) return;
+        for(size_t i = 0; i < count && i < array->items.size(); i++) out[i] = (float)array->items[i].number;
+    }
+
+    Matrix nodeMatrix(const Json& node){
+        Matrix local;
+        if(const Json* matrix = node.get("matrix")){
+            readNumbers(matrix, local.m, 16);
+            return local;
+        }
+        // T * R * S
+        float t[3] = {0, 0, 0}, r[4] = {0, 0, 0, 1}, s[3] = {1, 1, 1};
+        readNumbers(node.get("translation"), t, 3);
+        readNumbers(node.get("rotation"), r, 4);
+        readNumbers(node.get("scale"), s, 3);
+        const float x = r[0], y = r[1], z = r[2], w = r[3];
+        const float rotation[9] = {
+            1 - 2 * (y * y + z * z), 2 * (x * y + z * w),     2 * (x * z - y * w),
+            2 * (x * y - z * w),     1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+            2 * (x * z + y * w),     2 * (y * z - x * w),     1 - 2 * (x * x + y * y),
+        };
+        for(int col = 0; col < 3; col++){
+            for(int row = 0; row < 3; row++) local.m[col * 4 + row] = rotation[col * 3 + row] * s[col];
+        }
+        local.m[12] = t[0];
+        local.m[13] = t[1];
+        local.m[14] = t[2];
+        return local;
+    }
+
+    struct GltfPrimitive {
+        const Json* primitive;
+        Matrix transform;
+        MeshData out;
+        const char* error = nullptr;
+    };
+
+    // Nesting deeper than this is rejected rather than risking the stack
+    const int maxNodeDepth = 256;
+
+    // A node belongs to at most one parent, so reaching one twice means the file has a cycle (or a node shared
+    // between trees, which glTF doesn't allow either). Either way the walk stops there instead of looping.
+    bool addNode(const Json* nodes, const Json* meshes, int64_t index, const Matrix& parent,
+                 std::vector<GltfPrimitive>& primitives, std::vector<uint8_t>& visited, int depth, const char*& error){
+        const Json* node = nodes->at(index);
+        if(!node){
+            error = "a node index out of range";
+            return false;
+        }
+        if(visited[index]){
+            error = "a node that is its own ancestor or has two parents";
+            return false;
+        }
+        if(depth > maxNodeDepth){
+            error = "nodes nested too deep";
+            return false;
+        }
+        visited[index] = 1;
+
+        const Matrix world = multiply(parent, nodeMatrix(*node));
+        if(const Json* meshIndex = node->get("mesh")){
+            const Json* mesh = meshes ? meshes->at((int64_t)meshIndex->number) : nullptr;
+            const Json* list = mesh ? mesh->get("primitives") : nullptr;
+            if(list) for(const Json& primitive : list->items) primitives.push_back({&primitive, world, {}, nullptr});
+        }
+        if(const Json* children = node->get("children")){
+            for(const Json& child : children->items){
+                if(!addNode(nodes, meshes, (int64_t)child.number, world, primitives, visited, depth + 1, error)) return false;
+            }
+        }
+        return true;
+    }
+
+    void decodePrimitive(const Gltf& gltf, GltfPrimitive& p){
+        const Json* accessors = gltf.json.get("accessors");
+        const Json* attributes = p.primitive->get("attributes");
+        const Json* position = attributes ? attributes->get("POSITION") : nullptr;
+        // Points and lines have nothing to draw here
+        if(p.primitive->num("mode", 4) != 4 || !position) return;
+
+        std::vector<float> positions, uvs;
+        if(!readFloats(gltf, accessors, (int64_t)position->number, 3, positions, p.error)) return;
+        const size_t count = positions.size() / 3;
+        if(const Json* uv = attributes->get("TEXCOORD_0")){
+            if(!readFloats(gltf, accessors, (int64_t)uv->number, 2, uvs, p.error)) return;
+        }
+        uvs.resize(count * 2, 0.0f);
+
+        const float* m = p.transform.m;
+        p.out.verts.resize(count);
+        for(size_t i = 0; i < count; i++){
+            const float x = positions[i * 3], y = positions[i * 3 + 1], z = positions[i * 3 + 2];
+            Vert& v = p.out.verts[i];
+            v.pos[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+            v.pos[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+            v.pos[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+            v.uv[0] = uvs[i * 2];
+            v.uv[1] = uvs[i * 2 + 1];
+        }
+
+        if(const Json* indices = p.primitive->get("indices")){
+            if(!readIndices(gltf, accessors, (int64_t)indices->number, p.out.indices, p.error)) return;
+            for(uint32_t index : p.out.indices){
+                if(index >= count){
+                    p.error = "an index past the end of its vertices";
+                    return;
+                }
+            }
+        } else {
+            p.out.indices.resize(count);
+            for(size_t i = 0; i < count; i++) p.out.indices[i] = (uint32_t)i;
+        }
+        p.out.indices.resize(p.out.indices.size() / 3 * 3);
+    }
+
+    bool parseGltf(const char* fName, const char* json, size_t size, Gltf& gltf){
+        JsonParser parser{json, json + size};
+        if(!parser.parse(gltf.json) || gltf.json.type != Json::jsonObject){
+            printf("\'%s\': the JSON doesn't parse (around byte %zu)\n", fName, (size_t)(parser.p - json));
+            return false;
+        }
+        const Json* asset = gltf.json.get("asset");
+        const Json* version = asset ? asset->get("version") : nullptr;
+        if(!version || version->string.compare(0, 2, "2.")){
+            printf("\'%s\': not a glTF 2 file\n", fName);
+            return false;
+        }
+        return true;
+    }
+}
+
+bool meshImportObj(const char* fName, MeshData& mesh){
+    PROFILE_ZONE("import obj");
+    std::vector<char> text;
+    if(!readFile(fName, text)){
+        printf("Failed to read \'%s\'\n", fName);
+        return false;
+    }
+
+    // Chunks of about a MB split on line ends, a few per worker so one with all the faces doesn't hold up the rest
+    const size_t chunkBytes = std::max<size_t>(1 << 20, text.size() / ((jobsWorkerCount() + 1) * 4));
+    std::vector<ObjChunk> chunks;
+    const char* end = text.data() + text.size();
+    for(const char* p = text.data(); p < end;){
+        const char* chunkEnd = p + std::min<size_t>(chunkBytes, end - p);
+        const char* newline = (const char*)memchr(chunkEnd, '\n', end - chunkEnd);
+        chunkEnd = newline ? newline + 1 : end;
+        chunks.emplace_back();
+        chunks.back().begin = p;
+        chunks.back().end = chunkEnd;
+        p = chunkEnd;
+    }
+    parallelFor(chunks.size(), [&](size_t i){
+        parseObjChunk(chunks[i]);
+    });
+
+    std::vector<float> positions, uvs;
+    size_t corners = 0, badLines = 0;
+    for(ObjChunk& chunk : chunks){
+        chunk.firstPosition = positions.size() / 3;
+        chunk.firstUv = uvs.size() / 2;
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+        corners += chunk.corners.size();
+        badLines += chunk.badLines;
+        std::vector<float>().swap(chunk.positions);
+        std::vector<float>().swap(chunk.uvs);
+    }
+    const int64_t positionCount = positions.size() / 3, uvCount = uvs.size() / 2;
+    if(badLines) printf("\'%s\': skipped %zu lines that didn't parse\n", fName, badLines);
+
+    // Every distinct (v, vt) pair becomes one vertex
+    mesh.verts.clear();
+    mesh.indices.clear();
+    mesh.indices.reserve(corners);
+    CornerTable table(std::min<size_t>(corners, positionCount * 2 + 16));
+    for(const ObjChunk& chunk : chunks){
+        for(const ObjCorner& corner : chunk.corners){
+            const int64_t v = corner.v + (corner.relative & relativeV ? chunk.firstPosition : 0);
+            int64_t vt = corner.vt;
+            if(vt != noUv) vt += corner.relative & relativeVt ? chunk.firstUv : 0;
+            if(v < 0 || v >= positionCount || (vt != noUv && (vt < 0 || vt >= uvCount))){
+                printf("\'%s\': a face points at a vertex that isn't there\n", fName);
+                return false;
+            }
+            bool added;
+            const uint64_t key = (uint64_t)v << 32 | (uint64_t)(vt == noUv ? 0 : vt + 1);
+            const uint32_t index = table.find(key, (uint32_t)mesh.verts.size(), added);
+            if(added){
+                Vert vert;
+                memcpy(vert.pos, &positions[v * 3], sizeof(vert.pos));
+                vert.uv[0] = vt == noUv ? 0.0f : uvs[vt * 2];
+                vert.uv[1] = vt == noUv ? 0.0f : 1.0f - uvs[vt * 2 + 1];
+                mesh.verts.push_back(vert);
+            }
+            mesh.indices.push_back(index);
+        }
+    }
+    if(mesh.indices.empty()){
+        printf("\'%s\': no faces\n", fName);
+        return false;
+    }
+    return true;
+}
+
+bool meshImportGltf(const char* fName, MeshData& mesh){
+    PROFILE_ZONE("import gltf");
+    std::vector<char> file;
+    if(!readFile(fName, file)){
+        printf("Failed to read \'%s\'\n", fName);
+        return false;
+    }
+
+    Gltf gltf;
+    std::vector<char> glbBin;
+    uint32_t header[3] = {};
+    if(file.size() >= 12) memcpy(header, file.data(), 12);
+    if(header[0] == 0x46546c67){
+        // .glb: 12 byte header then chunks of (length, type, data), JSON first
+        if(header[1] != 2){
+            printf("\'%s\': glb version %u, only 2 is supported\n", fName, header[1]);
+            return false;
+        }
+        bool haveJson = false;
+        for(size_t at = 12; at + 8 <= file.size();){
+            uint32_t chunk[2];
+            memcpy(chunk, file.data() + at, 8);
+            if(chunk[0] > file.size() - at - 8){
+                printf("\'%s\': glb chunk runs past the end of the file\n", fName);
+                return false;
+            }
+            const char* data = file.data() + at + 8;
+            if(chunk[1] == 0x4e4f534a && !haveJson){
+                if(!parseGltf(fName, data, chunk[0], gltf)) return false;
+                haveJson = true;
+            } else if(chunk[1] == 0x004e4942 && glbBin.empty()){
+                glbBin.assign(data, data + chunk[0]);
+            }
+            at += 8 + ((chunk[0] + 3) & ~3u);
+        }
+        if(!haveJson){
+            printf("\'%s\': glb without a JSON chunk\n", fName);
+            return false;
+        }
+    } else if(!parseGltf(fName, file.data(), file.size(), gltf)){
+        return false;
+    }
+    std::vector<char>().swap(file);
+    if(!loadBuffers(gltf, fName, glbBin)) return false;
+
+    // The default scene's node trees. Files without scenes just get their meshes as they are.
+    std::vector<GltfPrimitive> primitives;
+    const Json* nodes = gltf.json.get("nodes");
+    const Json* meshes = gltf.json.get("meshes");
+    const Json* scenes = gltf.json.get("scenes");
+    const Json* scene = scenes ? scenes->at((int64_t)gltf.json.num("scene", 0)) : nullptr;
+    const Json* roots = scene ? scene->get("nodes") : nullptr;
+    if(roots && nodes){
+        std::vector<uint8_t> visited(nodes->items.size(), 0);
+        const char* error = nullptr;
+        for(const Json& root : roots->items){
+            if(!addNode(nodes, meshes, (int64_t)root.number, Matrix(), primitives, visited, 0, error)){
+                printf("\'%s\': node tree has %s\n", fName, error);
+                return false;
+            }
+        }
+    } else if(meshes){
+        for(const Json& m : meshes->items){
+            const Json* list = m.get("primitives");
+            if(list) for(const Json& primitive : list->items) primitives.push_back({&primitive, Matrix(), {}, nullptr});
+        }
+    }
+
+    parallelFor(primitives.size(), [&](size_t i){
+        decodePrimitive(gltf, primitives[i]);
+    });
+
+    size_t vertCount = 0, indexCount = 0;
+    for(const GltfPrimitive& p : primitives){
+        if(p.error){
+            printf("\'%s\': a primitive has %s\n", fName, p.error);
+            return false;
+        }
+        vertCount += p.out.verts.size();
+        indexCount += p.out.indices.size();
+    }
+    if(!indexCount){
+        printf("\'%s\': no triangles\n", fName);
+        return false;
+    }
+    if(vertCount > UINT32_MAX){
+        printf("\'%s\': too many vertices\n", fName);
+        return false;
+    }
+    mesh.verts.clear();
+    mesh.indices.clear();
+    mesh.verts.reserve(vertCount);
+    mesh.indices.reserve(indexCount);
+    for(const GltfPrimitive& p : primitives){
+        const uint32_t base = (uint32_t)mesh.verts.size();
+        mesh.verts.insert(mesh.verts.end(), p.out.verts.begin(), p.out.verts.end());
+        for(uint32_t index : p.out.indices) mesh.indices.push_back(base + index);
+    }
+    return true;
+}
+
+bool meshImport(const char* fName, MeshData& mesh){
+    const char* dot = strrchr(fName, '.');
+    if(dot && !strcasecmp(dot, ".obj")) return meshImportObj(fName, mesh);
+    if(dot && (!strcasecmp(dot, ".gltf") || !strcasecmp(dot, ".glb"))) return meshImportGltf(fName, mesh);
+    printf("\'%s\': not a mesh format we know (.obj, .gltf, .glb)\n", fName);
+    return false;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "vert.h"
+
+// Reads triangle meshes out of OBJ and glTF 2.0 (.gltf with its buffers next to it or inlined, or .glb).
+// Only what vertex.glsl uses comes out: positions and the first uv set, indexed triangles.
+// Everything in the file ends up in one mesh. glTF node transforms are applied, materials are ignored.
+// uvs come out with v going down the image (glTF's way), OBJ's get flipped to match.
+//
+// Big files get split across the job workers: OBJ by line ranges, glTF by primitive.
+// This is the slow path, meshCache.h cooks the result so it only has to run once per file.
+
+struct MeshData {
+    std::vector<Vert> verts;
+    // Three per triangle
+    std::vector<uint32_t> indices;
+};
+
+bool meshImportObj(const char* fName, MeshData& mesh);
+bool meshImportGltf(const char* fName, MeshData& mesh);
+// Picks by extension
+bool meshImport(const char* fName, MeshData& mesh);
@@ -0,0 +1,278 @@
+#include "meshLod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "profiler.h"
+
+namespace {
+    // Fewer triangles than this isn't worth a level of its own
+    const size_t minLodTriangles = 32;
+    // A level has to come in at no more than this share of the triangles of the one before it
+    const double minLodReduction = 0.75;
+    // Collapses that stray further than this (fraction of the radius) aren't made, past it a level stops
+    // looking like the same object
+    const double maxLodError = 0.1;
+    const uint32_t noTarget = ~0u;
+
+    // Sum of squared distances to a set of planes, area weighted: xx xy xz xw yy yz yw zz zw ww, then the weight
+    struct Quadric {
+        double a[11];
+    };
+
+    void quadricAdd(Quadric& q, const Quadric& other){
+        for(int i = 0; i < 11; i++) q.a[i] += other.a[i];
+    }
+
+    // Weighted mean squared distance from p to the planes
+    double quadricError(const Quadric& q, const double* p){
+        const double* a = q.a;
+        const double x = p[0], y = p[1], z = p[2];
+        const double e = a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x +
+                         a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y +
+                         a[7] * z * z + 2 * a[8] * z + a[9];
+        return a[10] > 0 ? std::max(e, 0.0) / a[10] : 0.0;
+    }
+
+    void cross(const double* a, const double* b, const double* c, double* n){
+        const double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const double v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        n[0] = u[1] * v[2] - u[2] * v[1];
+        n[1] = u[2] * v[0] - u[0] * v[2];
+        n[2] = u[0] * v[1] - u[1] * v[0];
+    }
+
+    struct Simplifier {
+        size_t vertCount = 0;
+        // Centered and scaled so the bounding sphere has radius 1, errors come out as a fraction of it
+        std::vector<double> pos;
+        std::vector<Quadric> quadrics;
+        std::vector<uint8_t> locked;
+        std::vector<uint32_t> tris;
+        // Worst collapse so far, squared
+        double error = 0;
+
+        // Triangles around each vertex, rebuilt every pass
+        std::vector<uint32_t> adjOffset, adjTris;
+    };
+
+    void buildAdjacency(Simplifier& s){
+        s.adjOffset.assign(s.vertCount + 1, 0);
+        for(uint32_t v : s.tris) s.adjOffset[v + 1]++;
+        for(size_t v = 0; v < s.vertCount; v++) s.adjOffset[v + 1] += s.adjOffset[v];
+        s.adjTris.resize(s.tris.size());
+        std::vector<uint32_t> fill(s.adjOffset.begin(), s.adjOffset.end() - 1);
+        for(size_t i = 0; i < s.tris.size(); i++) s.adjTris[fill[s.tris[i]]++] = (uint32_t)(i / 3);
+    }
+
+    // Borders and seams stay put. Both are found on positions rather than vertices, a seam is one position
+    // with several vertices and a border is an edge only one triangle has.
+    void lockVertices(Simplifier& s){
+        std::vector<uint32_t> order(s.vertCount);
+        for(size_t v = 0; v < s.vertCount; v++) order[v] = (uint32_t)v;
+        const double* p = s.pos.data();
+        std::sort(order.begin(), order.end(), [p](uint32_t a, uint32_t b){
+            return memcmp(p + a * 3, p + b * 3, 3 * sizeof(double)) < 0;
+        });
+        // Vertex -> the first vertex at its position
+        std::vector<uint32_t> weld(s.vertCount);
+        std::vector<uint8_t> lockedWeld(s.vertCount, 0);
+        for(size_t i = 0; i < order.size();){
+            size_t j = i + 1;
+            while(j < order.size() && !memcmp(p + order[i] * 3, p + order[j] * 3, 3 * sizeof(double))) j++;
+            for(size_t k = i; k < j; k++) weld[order[k]] = order[i];
+            if(j - i > 1) lockedWeld[order[i]] = 1;
+            i = j;
+        }
+
+        std::vector<uint64_t> edges;
+        edges.reserve(s.tris.size());
+        for(size_t t = 0; t < s.tris.size(); t += 3){
+            for(int e = 0; e < 3; e++){
+                const uint32_t a = weld[s.tris[t + e]], b = weld[s.tris[t + (e + 1) % 3]];
+                edges.push_back((uint64_t)std::min(a, b) << 32 | std::max(a, b));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for(size_t i = 0; i < edges.size();){
+            size_t j = i + 1;
+            while(j < edges.size() && edges[j] == edges[i]) j++;
+            if(j - i == 1){
+                lockedWeld[edges[i] >> 32] = 1;
+                lockedWeld[edges[i] & 0xffffffff] = 1;
+            }
+            i = j;
+        }
+
+        s.locked.resize(s.vertCount);
+        for(size_t v = 0; v < s.vertCount; v++) s.locked[v] = lockedWeld[weld[v]];
+    }
+
+    void buildQuadrics(Simplifier& s){
+        s.quadrics.assign(s.vertCount, Quadric());
+        for(size_t t = 0; t < s.tris.size(); t += 3){
+            const double* a = &s.pos[s.tris[t] * 3];
+            double n[3];
+            cross(a, &s.pos[s.tris[t + 1] * 3], &s.pos[s.tris[t + 2] * 3], n);
+            const double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if(len <= 0) continue;
+            // Twice the area, as good a weight as the area itself
+            const double w = len;
+            n[0] /= len;
+            n[1] /= len;
+            n[2] /= len;
+            const double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+            const Quadric q = {{
+                w * n[0] * n[0], w * n[0] * n[1], w * n[0] * n[2], w * n[0] * d,
+                w * n[1] * n[1], w * n[1] * n[2], w * n[1] * d,
+                w * n[2] * n[2], w * n[2] * d,
+                w * d * d,
+                w,
+            }};
+            for(int c = 0; c < 3; c++) quadricAdd(s.quadrics[s.tris[t + c]], q);
+        }
+    }
+
+    // Moving u onto v turns one of u's triangles over
+    bool flips(const Simplifier& s, uint32_t u, uint32_t v){
+        for(uint32_t i = s.adjOffset[u]; i < s.adjOffset[u + 1]; i++){
+            const uint32_t* t = &s.tris[s.adjTris[i] * 3];
+            if(t[0] == v || t[1] == v || t[2] == v) continue;
+            const double* p[3];
+            const double* moved[3];
+            for(int c = 0; c < 3; c++){
+                p[c] = &s.pos[t[c] * 3];
+                moved[c] = t[c] == u ? &s.pos[v * 3] : p[c];
+            }
+            double before[3], after[3];
+            cross(p[0], p[1], p[2], before);
+            cross(moved[0], moved[1], moved[2], after);
+            if(before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0) return true;
+        }
+        return false;
+    }
+
+    // One round of collapses, none of them touching another's triangles so they can all be made off the same
+    // adjacency. Returns how many were made.
+    size_t simplifyPass(Simplifier& s, size_t targetTris){
+        buildAdjacency(s);
+
+        // Cheapest collapse for every vertex
+        std::vector<double> cost(s.vertCount, INFINITY);
+        std::vector<uint32_t> target(s.vertCount, noTarget);
+        for(size_t t = 0; t < s.tris.size(); t += 3){
+            for(int e = 0; e < 3; e++){
+                const uint32_t a = s.tris[t + e], b = s.tris[t + (e + 1) % 3];
+                for(int dir = 0; dir < 2; dir++){
+                    const uint32_t u = dir ? b : a, v = dir ? a : b;
+                    if(s.locked[u] || u == v) continue;
+                    Quadric q = s.quadrics[u];
+                    quadricAdd(q, s.quadrics[v]);
+                    const double c = quadricError(q, &s.pos[v * 3]);
+                    if(c < cost[u]){
+                        cost[u] = c;
+                        target[u] = v;
+                    }
+                }
+            }
+        }
+
+        std::vector<uint32_t> order;
+        for(size_t v = 0; v < s.vertCount; v++){
+            if(target[v] != noTarget && cost[v] <= maxLodError * maxLodError) order.push_back((uint32_t)v);
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return cost[a] < cost[b]; });
+
+        // Most collapses take two triangles with them
+        const size_t triCount = s.tris.size() / 3;
+        const size_t budget = triCount > targetTris ? (triCount - targetTris + 1) / 2 : 0;
+        std::vector<uint32_t> remap(s.vertCount);
+        for(size_t v = 0; v < s.vertCount; v++) remap[v] = (uint32_t)v;
+        std::vector<uint8_t> touched(s.vertCount, 0);
+        size_t collapses = 0;
+        for(uint32_t u : order){
+            if(collapses >= budget) break;
+            const uint32_t v = target[u];
+            if(touched[u] || touched[v] || flips(s, u, v)) continue;
+            remap[u] = v;
+            quadricAdd(s.quadrics[v], s.quadrics[u]);
+            s.error = std::max(s.error, cost[u]);
+            for(uint32_t i = s.adjOffset[u]; i < s.adjOffset[u + 1]; i++){
+                const uint32_t* t = &s.tris[s.adjTris[i] * 3];
+                touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+            }
+            touched[v] = 1;
+            collapses++;
+        }
+        if(!collapses) return 0;
+
+        // Collapsed triangles fold down to nothing and go
+        size_t out = 0;
+        for(size_t t = 0; t < s.tris.size(); t += 3){
+            const uint32_t a = remap[s.tris[t]], b = remap[s.tris[t + 1]], c = remap[s.tris[t + 2]];
+            if(a == b || b == c || a == c) continue;
+            s.tris[out++] = a;
+            s.tris[out++] = b;
+            s.tris[out++] = c;
+        }
+        s.tris.resize(out);
+        return collapses;
+    }
+}
+
+int meshBuildLods(const Vert* verts, size_t vertCount, std::vector<uint32_t>& indices, MeshLod* lods){
+    const size_t fullTris = indices.size() / 3;
+    if(!fullTris) return 0;
+    lods[0] = {0, (uint32_t)(fullTris * 3), 0.0f};
+    if(fullTris < minLodTriangles * 2) return 1;
+    PROFILE_ZONE("build lods");
+
+    Simplifier s;
+    s.vertCount = vertCount;
+    double lo[3], hi[3];
+    for(int c = 0; c < 3; c++){
+        lo[c] = INFINITY;
+        hi[c] = -INFINITY;
+    }
+    for(size_t v = 0; v < vertCount; v++){
+        for(int c = 0; c < 3; c++){
+            lo[c] = std::min(lo[c], (double)verts[v].pos[c]);
+            hi[c] = std::max(hi[c], (double)verts[v].pos[c]);
+        }
+    }
+    const double radius = 0.5 * std::sqrt((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) +
+                                          (hi[2] - lo[2]) * (hi[2] - lo[2]));
+    const double scale = radius > 0 ? 1.0 / radius : 1.0;
+    s.pos.resize(vertCount * 3);
+    for(size_t v = 0; v < vertCount; v++){
+        for(int c = 0; c < 3; c++) s.pos[v * 3 + c] = (verts[v].pos[c] - (lo[c] + hi[c]) * 0.5) * scale;
+    }
+    s.tris.assign(indices.begin(), indices.begin() + fullTris * 3);
+    lockVertices(s);
+    buildQuadrics(s);
+
+    int count = 1;
+    size_t prevTris = fullTris;
+    while(count < meshMaxLods){
+        const size_t targetTris = prevTris / 2;
+        if(targetTris < minLodTriangles) break;
+        while(s.tris.size() / 3 > targetTris && simplifyPass(s, targetTris)){}
+        const size_t tris = s.tris.size() / 3;
+        if(tris > prevTris * minLodReduction) break;
+
+        lods[count++] = {(uint32_t)indices.size(), (uint32_t)(tris * 3), (float)std::sqrt(s.error)};
+        indices.insert(indices.end(), s.tris.begin(), s.tris.end());
+        prevTris = tris;
+    }
+    return count;
+}
+
+int lodSelect(const MeshLod* lods, int count, int current, float screenRadius, float maxPixels){
+    if(count <= 1) return 0;
+    int lod = std::min(std::max(current, 0), count - 1);
+    // Finer while this level is clearly too rough, then coarser while the next one is clearly fine
+    while(lod > 0 && lods[lod].error * screenRadius > maxPixels * (1 + lodHysteresis)) lod--;
+    while(lod + 1 < count && lods[lod + 1].error * screenRadius < maxPixels * (1 - lodHysteresis)) lod++;
+    return lod;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vert.h"
+
+// Levels of detail for indexed meshes. Each level is a simplified copy of the level before it, made by
+// collapsing edges in order of quadric error (Garland & Heckbert). A collapse moves a vertex onto one of its
+// neighbours instead of somewhere new, so every level indexes the same vertices and all of them live one
+// after the other in a single index buffer.
+// Mesh borders and uv seams (vertices sharing a position) never move, so outlines and texturing hold up.
+
+const int meshMaxLods = 8;
+// How far a level has to be past the switch point before selection moves off it, as a fraction of the
+// pixel limit. Keeps a mesh sitting right on the line from flipping every frame.
+const float lodHysteresis = 0.25f;
+
+struct MeshLod {
+    // Into the shared index buffer, in indices
+    uint32_t firstIndex, indexCount;
+    // Furthest the level strays from the full mesh, as a fraction of the bounding sphere's radius
+    float error;
+};
+
+// Append simplified levels to `indices`, which holds the full detail triangles on the way in. Level 0 is those,
+// each one after aims for half the triangles of the one before it. Stops early once a level gets too coarse
+// to be worth having or stops getting smaller. Returns how many levels there are, 0 for no triangles.
+int meshBuildLods(const Vert* verts, size_t vertCount, std::vector<uint32_t>& indices, MeshLod* lods);
+
+// The level to draw for a mesh whose bounding sphere covers `screenRadius` pixels: the coarsest one that's off
+// by at most `maxPixels`, with hysteresis around `current`
+int lodSelect(const MeshLod* lods, int count, int current, float screenRadius, float maxPixels);
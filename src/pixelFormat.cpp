@@ -0,0 +1,336 @@
+#include "pixelFormat.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+// The NEON kernels lean on AArch64 only instructions (vdivq_f32, vcvtnq_u32_f32)
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define PIXEL_NEON 1
+#endif
+
+namespace {
+    struct SrgbTable {
+        float values[256];
+
+        SrgbTable(){
+            for(int i = 0; i < 256; i++){
+                float c = i / 255.0f;
+                values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+        }
+    };
+    const SrgbTable srgbTable;
+
+#if defined(__SSE4_1__)
+    // RGB triplets in the low 12 bytes -> RGBA with the alpha byte left zero
+    inline __m128i rgbToRgbaShuffle(){
+        return _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    }
+#endif
+}
+
+const float* const srgbToLinearTable = srgbTable.values;
+
+// ---- 8-bit swizzles ----
+
+template<>
+void PixelConverter<RGB8, RGBA8>::run(const uint8_t* src, uint8_t* dst, size_t count){
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i shuf = _mm256_broadcastsi128_si256(rgbToRgbaShuffle());
+    const __m256i alpha = _mm256_set1_epi32(0xff000000);
+    // Each iteration reads 24 bytes through two 16 byte loads, the last one reaches 4 bytes past the pixels
+    for(; i + 10 <= count; i += 8){
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src + i * 3))),
+                                            _mm_loadu_si128((const __m128i*)(src + i * 3 + 12)), 1);
+        v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuf), alpha);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), v);
+    }
+#elif defined(__SSE4_1__)
+    const __m128i shuf = rgbToRgbaShuffle();
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    for(; i + 6 <= count; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, shuf), alpha));
+    }
+#elif defined(PIXEL_NEON)
+    for(; i + 16 <= count; i += 16){
+        uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+        uint8x16x4_t rgba = {{rgb.val[0], rgb.val[1], rgb.val[2], vdupq_n_u8(255)}};
+        vst4q_u8(dst + i * 4, rgba);
+    }
+#endif
+    generic(src + i * 3, dst + i * 4, count - i);
+}
+
+template<>
+void PixelConverter<RGBA8, RGB8>::run(const uint8_t* src, uint8_t* dst, size_t count){
+    size_t i = 0;
+#if defined(__SSE4_1__)
+    const __m128i shuf = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    // 16 byte stores with 12 useful bytes, stop while there's still room for the spill
+    for(; i + 6 <= count; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 3), _mm_shuffle_epi8(v, shuf));
+    }
+#elif defined(PIXEL_NEON)
+    for(; i + 16 <= count; i += 16){
+        uint8x16x4_t rgba = vld4q_u8(src + i * 4);
+        uint8x16x3_t rgb = {{rgba.val[0], rgba.val[1], rgba.val[2]}};
+        vst3q_u8(dst + i * 3, rgb);
+    }
+#endif
+    generic(src + i * 4, dst + i * 3, count - i);
+}
+
+namespace {
+    // Swapping red and blue is the same shuffle both ways
+    void swapRedBlue(const uint8_t* src, uint8_t* dst, size_t count){
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i shuf = _mm256_broadcastsi128_si256(_mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15));
+        for(; i + 8 <= count; i += 8){
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+            _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(v, shuf));
+        }
+#elif defined(__SSE4_1__)
+        const __m128i shuf = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for(; i + 4 <= count; i += 4){
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(v, shuf));
+        }
+#elif defined(PIXEL_NEON)
+        for(; i + 16 <= count; i += 16){
+            uint8x16x4_t v = vld4q_u8(src + i * 4);
+            uint8x16_t r = v.val[0];
+            v.val[0] = v.val[2];
+            v.val[2] = r;
+            vst4q_u8(dst + i * 4, v);
+        }
+#endif
+        for(; i < count; i++){
+            uint8_t r = src[i * 4];
+            dst[i * 4 + 0] = src[i * 4 + 2];
+            dst[i * 4 + 1] = src[i * 4 + 1];
+            dst[i * 4 + 2] = r;
+            dst[i * 4 + 3] = src[i * 4 + 3];
+        }
+    }
+}
+
+template<>
+void PixelConverter<RGBA8, BGRA8>::run(const uint8_t* src, uint8_t* dst, size_t count){
+    swapRedBlue(src, dst, count);
+}
+
+template<>
+void PixelConverter<BGRA8, RGBA8>::run(const uint8_t* src, uint8_t* dst, size_t count){
+    swapRedBlue(src, dst, count);
+}
+
+template<>
+void PixelConverter<RGBA8, Premultiplied<RGBA8>>::run(const uint8_t* src, uint8_t* dst, size_t count){
+    size_t i = 0;
+#if defined(__AVX2__)
+    // Widen to 16 bits, multiply by alpha and divide by 255 with rounding: (x + 128 + ((x + 128) >> 8)) >> 8
+    const __m256i alphaShuf = _mm256_broadcastsi128_si256(_mm_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15));
+    const __m256i round = _mm256_set1_epi16(128);
+    const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+    for(; i + 8 <= count; i += 8){
+        __m256i px = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        __m256i lo = _mm256_unpacklo_epi8(px, _mm256_setzero_si256());
+        __m256i hi = _mm256_unpackhi_epi8(px, _mm256_setzero_si256());
+        lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, _mm256_shuffle_epi8(lo, alphaShuf)), round);
+        hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, _mm256_shuffle_epi8(hi, alphaShuf)), round);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+        __m256i out = _mm256_packus_epi16(lo, hi);
+        out = _mm256_blendv_epi8(out, px, alphaMask);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), out);
+    }
+#elif defined(__SSE4_1__)
+    const __m128i alphaShuf = _mm_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+    for(; i + 4 <= count; i += 4){
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i lo = _mm_unpacklo_epi8(px, _mm_setzero_si128());
+        __m128i hi = _mm_unpackhi_epi8(px, _mm_setzero_si128());
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, _mm_shuffle_epi8(lo, alphaShuf)), round);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, _mm_shuffle_epi8(hi, alphaShuf)), round);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        __m128i out = _mm_blendv_epi8(_mm_packus_epi16(lo, hi), px, alphaMask);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), out);
+    }
+#elif defined(PIXEL_NEON)
+    for(; i + 8 <= count; i += 8){
+        uint8x8x4_t v = vld4_u8(src + i * 4);
+        for(int c = 0; c < 3; c++){
+            uint16x8_t x = vmull_u8(v.val[c], v.val[3]);
+            v.val[c] = vraddhn_u16(x, vrshrq_n_u16(x, 8));
+        }
+        vst4_u8(dst + i * 4, v);
+    }
+#endif
+    for(; i < count; i++){
+        unsigned int a = src[i * 4 + 3];
+        for(int c = 0; c < 3; c++){
+            unsigned int x = src[i * 4 + c] * a + 128;
+            dst[i * 4 + c] = (x + (x >> 8)) >> 8;
+        }
+        dst[i * 4 + 3] = a;
+    }
+}
+
+// ---- 8-bit -> float ----
+
+namespace {
+    // RGBA8 -> normalized float, divides rather than multiplying by 1/255 so results match the driver's exactly
+    void expandRgba8(const uint8_t* src, float* dst, size_t count){
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256 scale = _mm256_set1_ps(255.0f);
+        for(; i + 2 <= count; i += 2){
+            __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i * 4)));
+            _mm256_storeu_ps(dst + i * 4, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+        }
+#elif defined(__SSE4_1__)
+        const __m128 scale = _mm_set1_ps(255.0f);
+        for(; i < count; i++){
+            int bits;
+            memcpy(&bits, src + i * 4, 4);
+            __m128i v = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bits));
+            _mm_storeu_ps(dst + i * 4, _mm_div_ps(_mm_cvtepi32_ps(v), scale));
+        }
+#elif defined(PIXEL_NEON)
+        const float32x4_t scale = vdupq_n_f32(255.0f);
+        for(; i + 4 <= count; i += 4){
+            uint8x16_t v = vld1q_u8(src + i * 4);
+            uint16x8_t lo = vmovl_u8(vget_low_u8(v)), hi = vmovl_u8(vget_high_u8(v));
+            vst1q_f32(dst + i * 4 +  0, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))),  scale));
+            vst1q_f32(dst + i * 4 +  4, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), scale));
+            vst1q_f32(dst + i * 4 +  8, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))),  scale));
+            vst1q_f32(dst + i * 4 + 12, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), scale));
+        }
+#endif
+        PixelConverter<RGBA8, RGBA32F>::generic(src + i * 4, dst + i * 4, count - i);
+    }
+}
+
+template<>
+void PixelConverter<RGBA8, RGBA32F>::run(const uint8_t* src, float* dst, size_t count){
+    expandRgba8(src, dst, count);
+}
+
+template<>
+void PixelConverter<RGB8, RGBA32F>::run(const uint8_t* src, float* dst, size_t count){
+    // Add alpha in a small cache resident block, then widen that
+    const size_t chunk = 256;
+    uint8_t rgba[chunk * 4];
+    for(size_t i = 0; i < count; i += chunk){
+        size_t n = count - i < chunk ? count - i : chunk;
+        PixelConverter<RGB8, RGBA8>::run(src + i * 3, rgba, n);
+        expandRgba8(rgba, dst + i * 4, n);
+    }
+}
+
+template<>
+void PixelConverter<SRGB8, RGBA32F>::run(const uint8_t* src, float* dst, size_t count){
+    // Only 256 possible inputs, a table lookup beats evaluating pow in any width
+    const float* table = srgbToLinearTable;
+    for(size_t i = 0; i < count; i++){
+        dst[i * 4 + 0] = table[src[i * 3 + 0]];
+        dst[i * 4 + 1] = table[src[i * 3 + 1]];
+        dst[i * 4 + 2] = table[src[i * 3 + 2]];
+        dst[i * 4 + 3] = 1.0f;
+    }
+}
+
+// ---- float -> 8-bit ----
+
+template<>
+void PixelConverter<RGBA32F, RGBA8>::run(const float* src, uint8_t* dst, size_t count){
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), scale = _mm256_set1_ps(255.0f);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    for(; i + 8 <= count; i += 8){
+        __m256i v[4];
+        for(int k = 0; k < 4; k++){
+            __m256 f = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i * 4 + k * 8), zero), one);
+            v[k] = _mm256_cvtps_epi32(_mm256_mul_ps(f, scale));
+        }
+        // Packs work per 128 bit lane, put the pixels back in order afterwards
+        __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(v[0], v[1]), _mm256_packus_epi32(v[2], v[3]));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_permutevar8x32_epi32(packed, order));
+    }
+#elif defined(__SSE4_1__)
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f);
+    for(; i + 4 <= count; i += 4){
+        __m128i v[4];
+        for(int k = 0; k < 4; k++){
+            __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i * 4 + k * 4), zero), one);
+            v[k] = _mm_cvtps_epi32(_mm_mul_ps(f, scale));
+        }
+        __m128i packed = _mm_packus_epi16(_mm_packus_epi32(v[0], v[1]), _mm_packus_epi32(v[2], v[3]));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), packed);
+    }
+#elif defined(PIXEL_NEON)
+    const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f), scale = vdupq_n_f32(255.0f);
+    for(; i + 4 <= count; i += 4){
+        uint16x4_t v[4];
+        for(int k = 0; k < 4; k++){
+            float32x4_t f = vminq_f32(vmaxq_f32(vld1q_f32(src + i * 4 + k * 4), zero), one);
+            v[k] = vqmovn_u32(vcvtnq_u32_f32(vmulq_f32(f, scale)));
+        }
+        uint8x16_t packed = vcombine_u8(vqmovn_u16(vcombine_u16(v[0], v[1])), vqmovn_u16(vcombine_u16(v[2], v[3])));
+        vst1q_u8(dst + i * 4, packed);
+    }
+#endif
+    generic(src + i * 4, dst + i * 4, count - i);
+}
+
+template<>
+void PixelConverter<RGBA32F, RGB8>::run(const float* src, uint8_t* dst, size_t count){
+    convertPixelsVia<RGBA32F, RGBA8, RGB8>(src, dst, count);
+}
+
+// ---- half float ----
+
+template<>
+void PixelConverter<RGBA32F, RGBA16F>::run(const float* src, uint16_t* dst, size_t count){
+    size_t i = 0;
+#if defined(__F16C__)
+    for(; i + 2 <= count; i += 2){
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i * 4), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), h);
+    }
+#elif defined(PIXEL_NEON)
+    for(; i < count; i++){
+        vst1_u16(dst + i * 4, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i * 4))));
+    }
+#endif
+    generic(src + i * 4, dst + i * 4, count - i);
+}
+
+template<>
+void PixelConverter<RGB8, RGBA16F>::run(const uint8_t* src, uint16_t* dst, size_t count){
+    convertPixelsVia<RGB8, RGBA32F, RGBA16F>(src, dst, count);
+}
+
+template<>
+void PixelConverter<RGBA8, RGBA16F>::run(const uint8_t* src, uint16_t* dst, size_t count){
+    convertPixelsVia<RGBA8, RGBA32F, RGBA16F>(src, dst, count);
+}
+
+bool convertToRGBA32F(const uint8_t* src, int numCh, float* dst, size_t count){
+    switch(numCh){
+        case 1: convertPixels<L8,    RGBA32F>(src, dst, count); return true;
+        case 2: convertPixels<LA8,   RGBA32F>(src, dst, count); return true;
+        case 3: convertPixels<RGB8,  RGBA32F>(src, dst, count); return true;
+        case 4: convertPixels<RGBA8, RGBA32F>(src, dst, count); return true;
+    }
+    return false;
+}
@@ -0,0 +1,293 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "glad/glad.h"
+
+// Pixel format conversion.
+// Formats are types, so convertPixels<Src, Dst> picks its kernel at compile time. Any pair works through
+// the generic per-pixel path, hot pairs get SIMD specializations (AVX2/SSE4.1/NEON) in pixelFormat.cpp.
+
+// ---- Scalar helpers ----
+
+inline uint8_t unormToByte(float v){
+    v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    return (uint8_t)std::nearbyint(v * 255.0f);
+}
+
+inline uint16_t floatToHalf(float f){
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exp  = (bits >> 23) & 0xff;
+    uint32_t mant = bits & 0x7fffff;
+
+    if(exp == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);   // inf/nan
+    int e = (int)exp - 127 + 15;
+    if(e >= 31) return sign | 0x7c00;                           // overflow
+    if(e <= 0){
+        // Denormal or zero
+        if(e < -10) return sign;
+        mant |= 0x800000;
+        uint32_t shift = 14 - e;
+        uint32_t half = mant >> shift;
+        uint32_t rest = mant & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if(rest > mid || (rest == mid && (half & 1))) half++;
+        return sign | half;
+    }
+    uint32_t half = sign | (e << 10) | (mant >> 13);
+    uint32_t rest = mant & 0x1fff;
+    // Round to nearest even, carrying into the exponent is fine
+    if(rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return half;
+}
+
+inline float halfToFloat(uint16_t h){
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp  = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+
+    if(exp == 0){
+        if(mant == 0){
+            bits = sign;
+        } else {
+            // Renormalize
+            exp = 127 - 15 + 1;
+            while(!(mant & 0x400)){
+                mant <<= 1;
+                exp--;
+            }
+            bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+        }
+    } else if(exp == 31){
+        bits = sign | 0x7f800000 | (mant << 13);
+    } else {
+        bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+
+    float f;
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+// 8-bit sRGB -> linear, filled in pixelFormat.cpp
+extern const float* const srgbToLinearTable;
+
+inline float linearToSrgb(float v){
+    v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+}
+
+// ---- Formats ----
+// Each format describes its storage and how to get a pixel to and from normalized float RGBA.
+// glFormat/glType are what to hand to glTextureSubImage2D and friends for data in that format.
+
+// Single channel, shows up as grey like stb_image's 1 component output
+struct L8 {
+    typedef uint8_t Channel;
+    static constexpr int channels = 1;
+    static constexpr GLenum glFormat = GL_RED, glType = GL_UNSIGNED_BYTE;
+
+    static void load(const Channel* p, float out[4]){
+        out[0] = out[1] = out[2] = p[0] / 255.0f;
+        out[3] = 1.0f;
+    }
+    static void store(Channel* p, const float in[4]){
+        p[0] = unormToByte(in[0]);
+    }
+};
+
+struct LA8 {
+    typedef uint8_t Channel;
+    static constexpr int channels = 2;
+    static constexpr GLenum glFormat = GL_RG, glType = GL_UNSIGNED_BYTE;
+
+    static void load(const Channel* p, float out[4]){
+        out[0] = out[1] = out[2] = p[0] / 255.0f;
+        out[3] = p[1] / 255.0f;
+    }
+    static void store(Channel* p, const float in[4]){
+        p[0] = unormToByte(in[0]);
+        p[1] = unormToByte(in[3]);
+    }
+};
+
+struct RGB8 {
+    typedef uint8_t Channel;
+    static constexpr int channels = 3;
+    static constexpr GLenum glFormat = GL_RGB, glType = GL_UNSIGNED_BYTE;
+
+    static void load(const Channel* p, float out[4]){
+        for(int c = 0; c < 3; c++) out[c] = p[c] / 255.0f;
+        out[3] = 1.0f;
+    }
+    static void store(Channel* p, const float in[4]){
+        for(int c = 0; c < 3; c++) p[c] = unormToByte(in[c]);
+    }
+};
+
+struct RGBA8 {
+    typedef uint8_t Channel;
+    static constexpr int channels = 4;
+    static constexpr GLenum glFormat = GL_RGBA, glType = GL_UNSIGNED_BYTE;
+
+    static void load(const Channel* p, float out[4]){
+        for(int c = 0; c < 4; c++) out[c] = p[c] / 255.0f;
+    }
+    static void store(Channel* p, const float in[4]){
+        for(int c = 0; c < 4; c++) p[c] = unormToByte(in[c]);
+    }
+};
+
+// Same bytes as RGBA8 with red and blue swapped
+struct BGRA8 {
+    typedef uint8_t Channel;
+    static constexpr int channels = 4;
+    static constexpr GLenum glFormat = GL_BGRA, glType = GL_UNSIGNED_BYTE;
+
+    static void load(const Channel* p, float out[4]){
+        out[0] = p[2] / 255.0f;
+        out[1] = p[1] / 255.0f;
+        out[2] = p[0] / 255.0f;
+        out[3] = p[3] / 255.0f;
+    }
+    static void store(Channel* p, const float in[4]){
+        p[0] = unormToByte(in[2]);
+        p[1] = unormToByte(in[1]);
+        p[2] = unormToByte(in[0]);
+        p[3] = unormToByte(in[3]);
+    }
+};
+
+// sRGB encoded 8-bit color, loads come out linear. Alpha is always linear.
+struct SRGB8 {
+    typedef uint8_t Channel;
+    static constexpr int channels = 3;
+    static constexpr GLenum glFormat = GL_RGB, glType = GL_UNSIGNED_BYTE;
+
+    static void load(const Channel* p, float out[4]){
+        for(int c = 0; c < 3; c++) out[c] = srgbToLinearTable[p[c]];
+        out[3] = 1.0f;
+    }
+    static void store(Channel* p, const float in[4]){
+        for(int c = 0; c < 3; c++) p[c] = unormToByte(linearToSrgb(in[c]));
+    }
+};
+
+struct SRGBA8 {
+    typedef uint8_t Channel;
+    static constexpr int channels = 4;
+    static constexpr GLenum glFormat = GL_RGBA, glType = GL_UNSIGNED_BYTE;
+
+    static void load(const Channel* p, float out[4]){
+        for(int c = 0; c < 3; c++) out[c] = srgbToLinearTable[p[c]];
+        out[3] = p[3] / 255.0f;
+    }
+    static void store(Channel* p, const float in[4]){
+        for(int c = 0; c < 3; c++) p[c] = unormToByte(linearToSrgb(in[c]));
+        p[3] = unormToByte(in[3]);
+    }
+};
+
+struct RGBA16F {
+    typedef uint16_t Channel;
+    static constexpr int channels = 4;
+    static constexpr GLenum glFormat = GL_RGBA, glType = GL_HALF_FLOAT;
+
+    static void load(const Channel* p, float out[4]){
+        for(int c = 0; c < 4; c++) out[c] = halfToFloat(p[c]);
+    }
+    static void store(Channel* p, const float in[4]){
+        for(int c = 0; c < 4; c++) p[c] = floatToHalf(in[c]);
+    }
+};
+
+struct RGBA32F {
+    typedef float Channel;
+    static constexpr int channels = 4;
+    static constexpr GLenum glFormat = GL_RGBA, glType = GL_FLOAT;
+
+    static void load(const Channel* p, float out[4]){
+        for(int c = 0; c < 4; c++) out[c] = p[c];
+    }
+    static void store(Channel* p, const float in[4]){
+        for(int c = 0; c < 4; c++) p[c] = in[c];
+    }
+};
+
+// Wraps a format with alpha so color is stored multiplied by alpha
+template<typename F>
+struct Premultiplied : F {
+    static void load(const typename F::Channel* p, float out[4]){
+        F::load(p, out);
+        if(out[3] > 0.0f){
+            for(int c = 0; c < 3; c++) out[c] /= out[3];
+        }
+    }
+    static void store(typename F::Channel* p, const float in[4]){
+        const float px[4] = {in[0] * in[3], in[1] * in[3], in[2] * in[3], in[3]};
+        F::store(p, px);
+    }
+};
+
+// ---- Conversion ----
+
+template<typename Src, typename Dst>
+struct PixelConverter {
+    typedef typename Src::Channel SrcChannel;
+    typedef typename Dst::Channel DstChannel;
+
+    // Goes through float RGBA one pixel at a time, works for anything
+    static void generic(const SrcChannel* src, DstChannel* dst, size_t count){
+        float px[4];
+        for(size_t i = 0; i < count; i++){
+            Src::load(src + i * Src::channels, px);
+            Dst::store(dst + i * Dst::channels, px);
+        }
+    }
+
+    // Best kernel available for this pair
+    static void run(const SrcChannel* src, DstChannel* dst, size_t count){
+        generic(src, dst, count);
+    }
+};
+
+// Convert `count` pixels from src to dst
+template<typename Src, typename Dst>
+void convertPixels(const void* src, void* dst, size_t count){
+    PixelConverter<Src, Dst>::run((const typename Src::Channel*)src, (typename Dst::Channel*)dst, count);
+}
+
+// Convert in chunks through an intermediate format so two fast kernels can stand in for one missing one
+template<typename Src, typename Mid, typename Dst>
+void convertPixelsVia(const typename Src::Channel* src, typename Dst::Channel* dst, size_t count){
+    const size_t chunk = 256;
+    typename Mid::Channel tmp[chunk * Mid::channels];
+    for(size_t i = 0; i < count; i += chunk){
+        size_t n = count - i < chunk ? count - i : chunk;
+        PixelConverter<Src, Mid>::run(src + i * Src::channels, tmp, n);
+        PixelConverter<Mid, Dst>::run(tmp, dst + i * Dst::channels, n);
+    }
+}
+
+// Pairs with hand written kernels, see pixelFormat.cpp
+template<> void PixelConverter<RGB8, RGBA8>::run(const uint8_t* src, uint8_t* dst, size_t count);
+template<> void PixelConverter<RGBA8, BGRA8>::run(const uint8_t* src, uint8_t* dst, size_t count);
+template<> void PixelConverter<BGRA8, RGBA8>::run(const uint8_t* src, uint8_t* dst, size_t count);
+template<> void PixelConverter<RGBA8, Premultiplied<RGBA8>>::run(const uint8_t* src, uint8_t* dst, size_t count);
+template<> void PixelConverter<RGB8, RGBA32F>::run(const uint8_t* src, float* dst, size_t count);
+template<> void PixelConverter<RGBA8, RGBA32F>::run(const uint8_t* src, float* dst, size_t count);
+template<> void PixelConverter<SRGB8, RGBA32F>::run(const uint8_t* src, float* dst, size_t count);
+template<> void PixelConverter<RGBA32F, RGBA8>::run(const float* src, uint8_t* dst, size_t count);
+template<> void PixelConverter<RGBA8, RGB8>::run(const uint8_t* src, uint8_t* dst, size_t count);
+template<> void PixelConverter<RGBA32F, RGB8>::run(const float* src, uint8_t* dst, size_t count);
+template<> void PixelConverter<RGBA32F, RGBA16F>::run(const float* src, uint16_t* dst, size_t count);
+template<> void PixelConverter<RGB8, RGBA16F>::run(const uint8_t* src, uint16_t* dst, size_t count);
+template<> void PixelConverter<RGBA8, RGBA16F>::run(const uint8_t* src, uint16_t* dst, size_t count);
+
+// Runtime pick for 8-bit data with 1-4 channels (what stb_image hands back) into RGBA32F
+bool convertToRGBA32F(const uint8_t* src, int numCh, float* dst, size_t count);
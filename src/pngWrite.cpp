@@ -0,0 +1,403 @@
+#include "pngWrite.h"
+
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    // ---- Checksums ----
+
+    struct CrcTable {
+        uint32_t entries[256];
+        CrcTable(){
+            for(uint32_t n = 0; n < 256; n++){
+                uint32_t c = n;
+                for(int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+        }
+    };
+    const CrcTable crcTable;
+
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0){
+        crc = ~crc;
+        for(size_t i = 0; i < size; i++) crc = crcTable.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    uint32_t adler32(const uint8_t* data, size_t size){
+        uint32_t a = 1, b = 0;
+        while(size){
+            // Biggest run that can't overflow b before the modulo
+            size_t n = size < 5552 ? size : 5552;
+            size -= n;
+            while(n--){
+                a += *data++;
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void putBE32(std::vector<uint8_t>& out, uint32_t v){
+        out.push_back(v >> 24);
+        out.push_back(v >> 16);
+        out.push_back(v >> 8);
+        out.push_back(v);
+    }
+
+    void putChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size){
+        putBE32(out, size);
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+        putBE32(out, crc32(out.data() + start, size + 4));
+    }
+
+    // ---- Deflate ----
+
+    // Deflate fills bytes from the low bit up. Writes into space the caller already made, a whole
+    // 64-bit word at a time, and only moves the pointer past the bytes that are done.
+    struct BitWriter {
+        uint8_t* p;
+        uint64_t bits = 0;
+        int count = 0;
+
+        explicit BitWriter(uint8_t* p) : p(p) {}
+        void put(uint32_t value, int n){
+            bits |= (uint64_t)value << count;
+            count += n;
+            if(count >= 32){
+                memcpy(p, &bits, 8);
+                p += 4;
+                bits >>= 32;
+                count -= 32;
+            }
+        }
+        // Where the data ends once the last partial byte is out
+        uint8_t* flush(){
+            memcpy(p, &bits, 8);
+            return p + (count + 7) / 8;
+        }
+    };
+
+    // Huffman codes go in most significant bit first, so they get flipped before BitWriter sees them
+    uint32_t reverseBits(uint32_t v, int n){
+        uint32_t r = 0;
+        for(int i = 0; i < n; i++){
+            r = (r << 1) | (v & 1);
+            v >>= 1;
+        }
+        return r;
+    }
+
+    // The fixed literal/length code from RFC 1951 3.2.6, built once already flipped
+    struct FixedCodes {
+        uint16_t code[288];
+        uint8_t length[288];
+        FixedCodes(){
+            for(int s = 0; s < 288; s++){
+                if(s < 144)      { code[s] = 0x30 + s;          length[s] = 8; }
+                else if(s < 256) { code[s] = 0x190 + s - 144;   length[s] = 9; }
+                else if(s < 280) { code[s] = s - 256;           length[s] = 7; }
+                else             { code[s] = 0xc0 + s - 280;    length[s] = 8; }
+                code[s] = reverseBits(code[s], length[s]);
+            }
+        }
+    };
+    const FixedCodes fixedCodes;
+
+    const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const uint16_t distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+                                   4097, 6145, 8193, 12289, 16385, 24577};
+    const uint8_t distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    const int windowSize = 32768;
+    const int minMatch = 3, maxMatch = 258;
+    const int hashBits = 15;
+    // How many earlier spots with the same hash get a look, more finds longer matches but costs time
+    const int maxChainSteps = 8;
+    // A match this long is taken without looking for a better one
+    const int niceMatch = 64;
+    // Past this only the start of a match goes in the hash table, flat areas are all long matches anyway
+    const int maxInsertMatch = 16;
+
+    void putSymbol(BitWriter& bw, int symbol){
+        bw.put(fixedCodes.code[symbol], fixedCodes.length[symbol]);
+    }
+
+    void putMatch(BitWriter& bw, int length, int dist){
+        int l = 28;
+        while(lengthBase[l] > length) l--;
+        putSymbol(bw, 257 + l);
+        bw.put(length - lengthBase[l], lengthExtra[l]);
+
+        int d = 29;
+        while(distBase[d] > dist) d--;
+        // Distance codes are all 5 bits in the fixed code
+        bw.put(reverseBits(d, 5), 5);
+        bw.put(dist - distBase[d], distExtra[d]);
+    }
+
+    // How many bytes a and b have in common, up to limit. Eight at a time, the first one that differs has the
+    // lowest set bit of the xor (little endian).
+    size_t matchLength(const uint8_t* a, const uint8_t* b, size_t limit){
+        size_t n = 0;
+        while(n + 8 <= limit){
+            uint64_t x, y;
+            memcpy(&x, a + n, 8);
+            memcpy(&y, b + n, 8);
+            if(x != y) return n + (__builtin_ctzll(x ^ y) >> 3);
+            n += 8;
+        }
+        while(n < limit && a[n] == b[n]) n++;
+        return n;
+    }
+
+    uint32_t hash3(const uint8_t* p){
+        const uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+        return (v * 2654435761u) >> (32 - hashBits);
+    }
+
+    // One final block with the fixed codes, matches found through hash chains over the last 32K
+    void deflateFixed(const uint8_t* data, size_t size, std::vector<uint8_t>& out){
+        std::vector<int32_t> head(1 << hashBits, -1);
+        std::vector<int32_t> prev(windowSize, -1);
+        auto insert = [&](size_t pos){
+            const uint32_t h = hash3(data + pos);
+            prev[pos & (windowSize - 1)] = head[h];
+            head[h] = (int32_t)pos;
+        };
+
+        // Fixed codes are at most 9 bits a byte, plus slack for BitWriter's whole word stores
+        const size_t start = out.size();
+        out.resize(start + size + size / 8 + 64);
+        BitWriter bw(out.data() + start);
+        // BFINAL, then BTYPE 01
+        bw.put(1, 1);
+        bw.put(1, 2);
+
+        size_t pos = 0;
+        while(pos < size){
+            int bestLength = 0, bestDist = 0;
+            if(pos + minMatch <= size){
+                const size_t limit = size - pos < (size_t)maxMatch ? size - pos : maxMatch;
+                int32_t candidate = head[hash3(data + pos)];
+                for(int step = 0; step < maxChainSteps && candidate >= 0 && pos - candidate <= (size_t)windowSize; step++){
+                    const uint8_t* a = data + candidate;
+                    const uint8_t* b = data + pos;
+                    // Can't beat what's already found unless the byte past it matches too
+                    if(a[bestLength] == b[bestLength]){
+                        const size_t n = matchLength(a, b, limit);
+                        if((int)n > bestLength){
+                            bestLength = n;
+                            bestDist = pos - candidate;
+                            if(n == limit || bestLength >= niceMatch) break;
+                        }
+                    }
+                    const int32_t next = prev[candidate & (windowSize - 1)];
+                    // Older than the window or an overwritten slot
+                    if(next >= candidate) break;
+                    candidate = next;
+                }
+                insert(pos);
+            }
+
+            if(bestLength >= minMatch){
+                putMatch(bw, bestLength, bestDist);
+                if(bestLength <= maxInsertMatch){
+                    for(size_t i = pos + 1; i < pos + bestLength && i + minMatch <= size; i++) insert(i);
+                }
+                pos += bestLength;
+            } else {
+                putSymbol(bw, data[pos]);
+                pos++;
+            }
+        }
+        putSymbol(bw, 256);
+        out.resize(bw.flush() - out.data());
+    }
+
+    // ---- Filters ----
+    // Each one works on `size` bytes with x the row, a the byte a pixel to the left, b the byte above and c above
+    // and to the left. The first pixel of a row has no left, filterRow does it with a and c as zeros.
+
+    uint8_t paeth(int a, int b, int c){
+        const int p = a + b - c;
+        const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+        if(pa <= pb && pa <= pc) return a;
+        if(pb <= pc) return b;
+        return c;
+    }
+
+#if defined(__SSE4_1__)
+    // Same as paeth() on 8 pixels widened to 16 bits
+    __m128i paeth16(__m128i a, __m128i b, __m128i c){
+        // p - a and p - b, p - c is the two added
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        const __m128i pc = _mm_abs_epi16(_mm_add_epi16(pa, pb));
+        pa = _mm_abs_epi16(pa);
+        pb = _mm_abs_epi16(pb);
+        const __m128i notA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+        const __m128i bOrC = _mm_blendv_epi8(b, c, _mm_cmpgt_epi16(pb, pc));
+        return _mm_blendv_epi8(a, bOrC, notA);
+    }
+#endif
+
+    void filterSub(const uint8_t* x, const uint8_t* a, uint8_t* out, size_t size){
+        size_t i = 0;
+#if defined(__SSE4_1__)
+        for(; i + 16 <= size; i += 16){
+            const __m128i vx = _mm_loadu_si128((const __m128i*)(x + i));
+            const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(vx, va));
+        }
+#endif
+        for(; i < size; i++) out[i] = x[i] - a[i];
+    }
+
+    void filterAvg(const uint8_t* x, const uint8_t* a, const uint8_t* b, uint8_t* out, size_t size){
+        size_t i = 0;
+#if defined(__SSE4_1__)
+        const __m128i one = _mm_set1_epi8(1);
+        for(; i + 16 <= size; i += 16){
+            const __m128i vx = _mm_loadu_si128((const __m128i*)(x + i));
+            const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+            // pavgb rounds up, PNG rounds down
+            const __m128i avg = _mm_sub_epi8(_mm_avg_epu8(va, vb), _mm_and_si128(_mm_xor_si128(va, vb), one));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(vx, avg));
+        }
+#endif
+        for(; i < size; i++) out[i] = x[i] - ((a[i] + b[i]) >> 1);
+    }
+
+    void filterPaeth(const uint8_t* x, const uint8_t* a, const uint8_t* b, const uint8_t* c, uint8_t* out, size_t size){
+        size_t i = 0;
+#if defined(__SSE4_1__)
+        const __m128i zero = _mm_setzero_si128();
+        for(; i + 16 <= size; i += 16){
+            const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+            const __m128i vc = _mm_loadu_si128((const __m128i*)(c + i));
+            const __m128i lo = paeth16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero), _mm_unpacklo_epi8(vc, zero));
+            const __m128i hi = paeth16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero), _mm_unpackhi_epi8(vc, zero));
+            const __m128i vx = _mm_loadu_si128((const __m128i*)(x + i));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(vx, _mm_packus_epi16(lo, hi)));
+        }
+#endif
+        for(; i < size; i++) out[i] = x[i] - paeth(a[i], b[i], c[i]);
+    }
+
+    // Sum of the residuals as signed bytes, small ones compress best
+    size_t filterCost(const uint8_t* f, size_t size){
+        size_t cost = 0, i = 0;
+#if defined(__SSE4_1__)
+        __m128i sums = _mm_setzero_si128();
+        for(; i + 16 <= size; i += 16){
+            const __m128i v = _mm_loadu_si128((const __m128i*)(f + i));
+            // |-128| comes out as 0x80, which is right read unsigned
+            sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_abs_epi8(v), _mm_setzero_si128()));
+        }
+        cost = _mm_cvtsi128_si64(sums) + _mm_extract_epi64(sums, 1);
+#endif
+        for(; i < size; i++) cost += f[i] < 128 ? f[i] : 256 - f[i];
+        return cost;
+    }
+
+    // Tries all five filters, the cheapest goes to `out` as its type byte then the filtered row.
+    // `bpp` is the distance to the pixel on the left, `above` is all zeros for the first row.
+    void filterRow(const uint8_t* row, const uint8_t* above, size_t rowBytes, int bpp, uint8_t* out, uint8_t* candidates){
+        uint8_t* sub = candidates;
+        uint8_t* up = sub + rowBytes;
+        uint8_t* avg = up + rowBytes;
+        uint8_t* pae = avg + rowBytes;
+        for(int i = 0; i < bpp; i++){
+            sub[i] = row[i];
+            avg[i] = row[i] - (above[i] >> 1);
+            pae[i] = row[i] - above[i];
+        }
+        const size_t rest = rowBytes - bpp;
+        filterSub(row, above, up, rowBytes);
+        filterSub(row + bpp, row, sub + bpp, rest);
+        filterAvg(row + bpp, row, above + bpp, avg + bpp, rest);
+        filterPaeth(row + bpp, row, above + bpp, above, pae + bpp, rest);
+
+        const uint8_t* filtered[5] = {row, sub, up, avg, pae};
+        int best = 0;
+        size_t bestCost = filterCost(row, rowBytes);
+        for(int type = 1; type < 5; type++){
+            const size_t cost = filterCost(filtered[type], rowBytes);
+            if(cost < bestCost){
+                bestCost = cost;
+                best = type;
+            }
+        }
+        out[0] = best;
+        memcpy(out + 1, filtered[best], rowBytes);
+    }
+}
+
+bool pngEncode(const uint8_t* pixels, int width, int height, int numCh, std::vector<uint8_t>& out){
+    out.clear();
+    if(width <= 0 || height <= 0 || numCh < 1 || numCh > 4){
+        printf("Can't write a %dx%d PNG with %d channels\n", width, height, numCh);
+        return false;
+    }
+
+    const size_t rowBytes = (size_t)width * numCh;
+    std::vector<uint8_t> filtered((rowBytes + 1) * height);
+    std::vector<uint8_t> candidates(rowBytes * 4);
+    const std::vector<uint8_t> zeros(rowBytes, 0);
+    for(int y = 0; y < height; y++){
+        const uint8_t* row = pixels + y * rowBytes;
+        filterRow(row, y ? row - rowBytes : zeros.data(), rowBytes, numCh, filtered.data() + y * (rowBytes + 1), candidates.data());
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    static const uint8_t colorTypes[5] = {0, 0, 4, 2, 6};
+    out.insert(out.end(), signature, signature + 8);
+
+    uint8_t header[13];
+    for(int i = 0; i < 4; i++){
+        header[i] = width >> (24 - 8 * i);
+        header[4 + i] = height >> (24 - 8 * i);
+    }
+    header[8] = 8;
+    header[9] = colorTypes[numCh];
+    // Deflate, adaptive filtering, no interlace
+    header[10] = header[11] = header[12] = 0;
+    putChunk(out, "IHDR", header, sizeof(header));
+
+    // zlib wrapper: 32K window deflate, no dictionary, header check bits so it divides by 31
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    deflateFixed(filtered.data(), filtered.size(), zlib);
+    putBE32(zlib, adler32(filtered.data(), filtered.size()));
+    putChunk(out, "IDAT", zlib.data(), zlib.size());
+
+    putChunk(out, "IEND", nullptr, 0);
+    return true;
+}
+
+bool pngWrite(const char* fName, const uint8_t* pixels, int width, int height, int numCh){
+    std::vector<uint8_t> png;
+    if(!pngEncode(pixels, width, height, numCh, png)) return false;
+
+    FILE* f = fopen(fName, "wb");
+    if(!f){
+        printf("Failed to open file \'%s\'\n", fName);
+        return false;
+    }
+    fwrite(png.data(), 1, png.size(), f);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Small PNG writer so frames can be saved without pulling in zlib.
+// Every row gets whichever filter looks cheapest, then it's all squeezed with LZ77 and deflate's fixed
+// Huffman codes. Not as small as zlib at level 9, but close enough for screenshots and a lot faster.
+
+// 8 bits per channel, 1-4 channels (gray, gray+alpha, RGB, RGBA), rows top down and tightly packed.
+// `out` is cleared and gets the whole file.
+bool pngEncode(const uint8_t* pixels, int width, int height, int numCh, std::vector<uint8_t>& out);
+bool pngWrite(const char* fName, const uint8_t* pixels, int width, int height, int numCh);
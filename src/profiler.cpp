@@ -0,0 +1,246 @@
+#include "profiler.h"
+
+#include <stdio.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+std::atomic<bool> profilerOn{false};
+
+namespace {
+    struct Event {
+        const char* name;
+        uint64_t start, end;
+    };
+
+    // A thread's events go in chunks so recording never moves what's already there
+    const size_t chunkEvents = 4096;
+    // About a million events, 24 MB, a thread. Past that they're dropped and counted.
+    const size_t maxChunks = 256;
+
+    struct ThreadEvents {
+        std::string name;
+        std::vector<std::unique_ptr<Event[]>> chunks;
+        size_t used = chunkEvents;
+        uint64_t dropped = 0;
+    };
+
+    struct GpuZone {
+        GLuint begin = 0, end = 0;
+        const char* name = nullptr;
+    };
+
+    struct Profiler {
+        bool used = false;
+        uint64_t origin = 0;
+        // Only held to add a thread
+        std::mutex lock;
+        std::vector<std::unique_ptr<ThreadEvents>> threads;
+
+        // GPU side, main thread only
+        bool gpu = false;
+        // CPU ns minus GPU ns
+        int64_t gpuOffset = 0;
+        std::vector<GpuZone> gpuZones;
+        std::vector<int> freeZones;
+        // Ended and waiting on the GPU, in the order they were issued
+        std::deque<int> pending;
+        std::vector<Event> gpuEvents;
+    };
+    Profiler profiler;
+
+    thread_local ThreadEvents* threadEvents = nullptr;
+
+    ThreadEvents& currentThread(){
+        if(!threadEvents){
+            std::lock_guard<std::mutex> lk(profiler.lock);
+            profiler.threads.emplace_back(new ThreadEvents());
+            threadEvents = profiler.threads.back().get();
+        }
+        return *threadEvents;
+    }
+
+    // False if it isn't done yet and `wait` is off
+    bool collect(int zone, bool wait){
+        GpuZone& z = profiler.gpuZones[zone];
+        if(!wait){
+            GLint available = 0;
+            glGetQueryObjectiv(z.end, GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available) return false;
+        }
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(z.begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(z.end, GL_QUERY_RESULT, &end);
+        profiler.gpuEvents.push_back({z.name, begin + profiler.gpuOffset, end + profiler.gpuOffset});
+        profiler.freeZones.push_back(zone);
+        return true;
+    }
+
+    // Collect in issue order, stopping at the first one that isn't done
+    void collectPending(bool wait){
+        while(!profiler.pending.empty() && collect(profiler.pending.front(), wait)){
+            profiler.pending.pop_front();
+        }
+    }
+
+    // Names are literals from our own code, but a stray quote would break the whole file
+    void writeString(FILE* f, const char* s){
+        fputc('"', f);
+        for(; *s; s++){
+            if(*s == '"' || *s == '\\') fputc('\\', f);
+            fputc(*s, f);
+        }
+        fputc('"', f);
+    }
+
+    void writeEvent(FILE* f, bool& first, int tid, const Event& e){
+        fprintf(f, first ? "\n" : ",\n");
+        first = false;
+        fprintf(f, "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":", tid,
+                ((int64_t)e.start - (int64_t)profiler.origin) / 1000.0, ((int64_t)e.end - (int64_t)e.start) / 1000.0);
+        writeString(f, e.name);
+        fputc('}', f);
+    }
+
+    void writeThreadName(FILE* f, bool& first, int tid, const char* name){
+        fprintf(f, first ? "\n" : ",\n");
+        first = false;
+        fprintf(f, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", tid);
+        writeString(f, name);
+        fprintf(f, "}}");
+    }
+}
+
+bool profilerBegin(){
+    // Threads hang on to their buffers, starting over would leave them pointing at freed ones
+    if(profiler.used) return false;
+    profiler.used = true;
+    profiler.origin = profilerNow();
+    profilerOn.store(true);
+    return true;
+}
+
+void profilerThreadName(const char* name){
+    if(!profilerOn.load(std::memory_order_relaxed)) return;
+    currentThread().name = name;
+}
+
+void profilerRecord(const char* name, uint64_t start, uint64_t end){
+    ThreadEvents& t = currentThread();
+    if(t.used == chunkEvents){
+        if(t.chunks.size() == maxChunks){
+            t.dropped++;
+            return;
+        }
+        t.chunks.emplace_back(new Event[chunkEvents]);
+        t.used = 0;
+    }
+    t.chunks.back()[t.used++] = {name, start, end};
+}
+
+bool profilerGpuInit(){
+    if(!profilerOn.load()) return false;
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    if(!bits){
+        printf("No GPU timestamps, GPU zones are off\n");
+        return false;
+    }
+    // Wait for the GPU to catch up so its clock reads now instead of whenever the queued work started
+    glFinish();
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    profiler.gpuOffset = (int64_t)profilerNow() - gpuNow;
+    profiler.gpu = true;
+    return true;
+}
+
+int profilerGpuBegin(const char* name){
+    if(!profiler.gpu) return -1;
+    int zone;
+    if(!profiler.freeZones.empty()){
+        zone = profiler.freeZones.back();
+        profiler.freeZones.pop_back();
+    } else {
+        zone = (int)profiler.gpuZones.size();
+        GpuZone z;
+        glCreateQueries(GL_TIMESTAMP, 1, &z.begin);
+        glCreateQueries(GL_TIMESTAMP, 1, &z.end);
+        profiler.gpuZones.push_back(z);
+    }
+    profiler.gpuZones[zone].name = name;
+    glQueryCounter(profiler.gpuZones[zone].begin, GL_TIMESTAMP);
+    return zone;
+}
+
+void profilerGpuEnd(int zone){
+    glQueryCounter(profiler.gpuZones[zone].end, GL_TIMESTAMP);
+    profiler.pending.push_back(zone);
+}
+
+void profilerFrameEnd(){
+    if(profiler.gpu) collectPending(false);
+}
+
+void profilerGpuShutdown(){
+    if(!profiler.gpu) return;
+    collectPending(true);
+    for(GpuZone& z : profiler.gpuZones){
+        glDeleteQueries(1, &z.begin);
+        glDeleteQueries(1, &z.end);
+    }
+    profiler.gpuZones.clear();
+    profiler.freeZones.clear();
+    profiler.gpu = false;
+}
+
+bool profilerEnd(const char* fName){
+    if(!profilerOn.load()) return false;
+    profilerOn.store(false);
+
+    FILE* f = fopen(fName, "wb");
+    if(!f){
+        printf("Failed to open \'%s\' for the trace\n", fName);
+        return false;
+    }
+    // Timestamps are microseconds from profilerBegin
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+    uint64_t events = 0, dropped = 0;
+    int tid = 1;
+    for(const std::unique_ptr<ThreadEvents>& t : profiler.threads){
+        char name[32];
+        if(t->name.empty()) snprintf(name, sizeof(name), "thread %d", tid);
+        writeThreadName(f, first, tid, t->name.empty() ? name : t->name.c_str());
+        for(size_t c = 0; c < t->chunks.size(); c++){
+            const size_t count = c + 1 == t->chunks.size() ? t->used : chunkEvents;
+            for(size_t i = 0; i < count; i++) writeEvent(f, first, tid, t->chunks[c][i]);
+            events += count;
+        }
+        dropped += t->dropped;
+        tid++;
+    }
+    if(!profiler.gpuEvents.empty()){
+        writeThreadName(f, first, tid, "GPU");
+        for(const Event& e : profiler.gpuEvents) writeEvent(f, first, tid, e);
+        events += profiler.gpuEvents.size();
+    }
+    fprintf(f, "\n]}\n");
+    const bool ok = !ferror(f);
+    fclose(f);
+
+    if(ok) printf("Profile: %llu zones in \'%s\'", (unsigned long long)events, fName);
+    else   printf("Failed to write the trace \'%s\'", fName);
+    if(dropped) printf(", %llu dropped", (unsigned long long)dropped);
+    printf("\n");
+
+    for(const std::unique_ptr<ThreadEvents>& t : profiler.threads){
+        t->chunks.clear();
+        t->chunks.shrink_to_fit();
+        t->used = chunkEvents;
+    }
+    profiler.gpuEvents.clear();
+    return ok;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "glad/glad.h"
+
+// Zone profiler, written out as Chrome trace JSON (chrome://tracing or ui.perfetto.dev).
+//
+// PROFILE_ZONE("name") times the rest of the enclosing scope on the calling thread. Each thread writes into
+// buffers of its own, so past a thread's first zone recording never takes a lock.
+// PROFILE_GPU_ZONE("name") puts timestamp queries around the GL commands issued in the scope. The results are
+// collected a few frames later by profilerFrameEnd, nothing waits on the GPU. GPU times get shifted onto the
+// CPU clock so both end up on one timeline, the GPU as a thread of its own.
+//
+// Names have to be string literals, only the pointer is kept. With the profiler off a zone is a load and a branch.
+// The profiler's own queries aren't in glCalls.h, so glCapture and glStats don't see them.
+
+extern std::atomic<bool> profilerOn;
+
+inline uint64_t profilerNow(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Start recording CPU zones, once a run. Before jobsInit so the workers get their names in.
+bool profilerBegin();
+// Name the calling thread in the trace
+void profilerThreadName(const char* name);
+// Start GPU zones, needs a current context. Lines the GPU clock up with the CPU one. False if the driver has
+// no timestamps, GPU zones are skipped then.
+bool profilerGpuInit();
+// Collect the GPU zones that have finished, call once a frame
+void profilerFrameEnd();
+// Wait for the GPU zones still out and free the queries, while the context is still there
+void profilerGpuShutdown();
+// Stop and write everything to `fName`. Every other thread has to be done recording by now (after jobsShutdown).
+bool profilerEnd(const char* fName);
+
+void profilerRecord(const char* name, uint64_t start, uint64_t end);
+// -1 when GPU zones aren't on
+int profilerGpuBegin(const char* name);
+void profilerGpuEnd(int zone);
+
+struct ProfileZone {
+    const char* name = nullptr;
+    uint64_t start = 0;
+
+    explicit ProfileZone(const char* zoneName){
+        if(!profilerOn.load(std::memory_order_relaxed)) return;
+        name = zoneName;
+        start = profilerNow();
+    }
+    ~ProfileZone(){
+        if(name) profilerRecord(name, start, profilerNow());
+    }
+};
+
+struct ProfileGpuZone {
+    int zone = -1;
+
+    explicit ProfileGpuZone(const char* name){
+        if(profilerOn.load(std::memory_order_relaxed)) zone = profilerGpuBegin(name);
+    }
+    ~ProfileGpuZone(){
+        if(zone >= 0) profilerGpuEnd(zone);
+    }
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_JOIN(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) ProfileGpuZone PROFILE_JOIN(profileGpuZone, __LINE__)(name)
@@ -0,0 +1,140 @@
+#include "progressiveLoad.h"
+
+#include <stdio.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "jobs.h"
+#include "profiler.h"
+#include "texCache.h"
+#include "texturePool.h"
+
+namespace {
+    // Most halvings the decoders do, previews can't go below that
+    const int maxScaleShift = 3;
+    // Previews jump the queue so everything on screen has something before any full decode starts
+    const int previewPriority = -1;
+    const int fullPriority = 0;
+
+    struct Pending {
+        int material;
+        // Level the preview goes in, 0 when there's no preview
+        int previewLevel;
+        // Finest level uploaded so far, one past previewLevel until anything is
+        int shown;
+
+        // Filled in by the jobs, guarded by resultLock
+        CachedTexture preview, full;
+        bool previewDone = false, fullDone = false;
+    };
+
+    std::vector<std::unique_ptr<Pending>> pending;
+    std::mutex resultLock;
+    JobGroup loads;
+
+    void submitLoad(Pending* p, bool preview, const std::string& fName, const ImageLoadOptions& opts, bool mipmaps){
+        jobsSubmit(loads, [p, preview, fName, opts, mipmaps]{
+            CachedTexture tex;
+            texCacheLoad(tex, fName.c_str(), opts, mipmaps);
+            std::lock_guard<std::mutex> guard(resultLock);
+            if(preview){
+                p->preview = tex;
+                p->previewDone = true;
+            } else {
+                p->full = tex;
+                p->fullDone = true;
+            }
+        }, preview ? previewPriority : fullPriority);
+    }
+
+    // The preview is a separate decode so its sizes round up where the mip chain rounds down,
+    // only the top left corner that fits the level goes up
+    void uploadPreview(Pending& p){
+        const CachedTexture& tex = p.preview;
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, tex.width);
+        textureUploadLevel(p.material, p.previewLevel, tex.glFormat, tex.glType, tex.level[0]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        p.shown = p.previewLevel;
+        textureSetMinLod(p.material, p.shown);
+    }
+}
+
+int progressiveTextureAdd(const char* fName, const ImageLoadOptions& opts){
+    std::vector<unsigned char> content;
+    int fullW, fullH, width, height;
+    if(!imageReadFile(fName, content) || !imageLoadInfo(content.data(), content.size(), &fullW, &fullH) ||
+       !imageLoadInfo(content.data(), content.size(), &width, &height, opts)){
+        printf("Failed to load texture \'%s\'\n", fName);
+        return -1;
+    }
+
+    // How far opts already shrink it, the preview goes the rest of the way down
+    int shift = 0;
+    while(shift < maxScaleShift && ((fullW + (1 << shift) - 1) >> shift) > width) shift++;
+    int previewLevel = maxScaleShift - shift;
+    while(previewLevel > 0 && !(width >> previewLevel && height >> previewLevel)) previewLevel--;
+
+    // Only the levels that get shown are kept, the pool never samples anything coarser than the preview
+    int material = textureReserve(width, height, previewLevel + 1, GL_RGBA32F);
+    if(material < 0) return -1;
+
+    pending.emplace_back(new Pending());
+    Pending* p = pending.back().get();
+    p->material = material;
+    p->previewLevel = previewLevel;
+    p->shown = previewLevel + 1;
+
+    if(previewLevel > 0){
+        ImageLoadOptions previewOpts;
+        previewOpts.scaleShift = shift + previewLevel;
+        submitLoad(p, true, fName, previewOpts, false);
+    }
+    submitLoad(p, false, fName, opts, previewLevel > 0);
+    return material;
+}
+
+bool progressiveTexturesUpdate(){
+    PROFILE_ZONE("upload textures");
+    std::lock_guard<std::mutex> guard(resultLock);
+    for(size_t i = 0; i < pending.size();){
+        Pending& p = *pending[i];
+
+        if(p.previewDone && p.preview.levels){
+            // Not worth showing if the full image beat it here
+            if(!p.fullDone) uploadPreview(p);
+            texCacheRelease(p.preview);
+        }
+
+        // One level per frame so a big level 0 doesn't land on the same frame as everything else
+        if(p.fullDone && p.full.levels && p.shown > 0){
+            p.shown--;
+            const CachedTexture& tex = p.full;
+            textureUploadLevel(p.material, p.shown, tex.glFormat, tex.glType, tex.level[p.shown]);
+            textureSetMinLod(p.material, p.shown);
+        }
+
+        // Both jobs have to be finished before the entry can go, they write into it
+        const bool settled = p.fullDone && (p.previewLevel == 0 || p.previewDone);
+        if(settled && (p.shown == 0 || !p.full.levels)){
+            // A failed full load leaves the preview (or placeholder) up
+            if(!p.full.levels) printf("Texture for material %d never finished loading\n", p.material);
+            texCacheRelease(p.full);
+            pending.erase(pending.begin() + i);
+            continue;
+        }
+        i++;
+    }
+    return !pending.empty();
+}
+
+void progressiveTexturesFree(){
+    jobsWait(loads);
+    std::lock_guard<std::mutex> guard(resultLock);
+    for(auto& p : pending){
+        texCacheRelease(p->preview);
+        texCacheRelease(p->full);
+    }
+    pending.clear();
+}
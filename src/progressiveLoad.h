@@ -0,0 +1,15 @@
+#pragma once
+
+#include "imageLoad.h"
+
+// Textures that show up straight away and sharpen as they load.
+// A material is reserved (a grey placeholder) right away, then two decodes go out on the job system: a quick
+// 1/8 scale preview that lands in a coarse mip level, and the full image after it. Once the full one is in,
+// the finer levels go up one per frame and the material's minLod steps down to 0 with them.
+
+// Start loading `fName`, returns its material index or -1 if the image can't be read
+int progressiveTextureAdd(const char* fName, const ImageLoadOptions& opts);
+// Upload whatever finished since last frame, false once every texture is fully loaded
+bool progressiveTexturesUpdate();
+// Waits for outstanding decodes and drops them, call before texturePoolsFree
+void progressiveTexturesFree();
@@ -0,0 +1,300 @@
+#include "shaderVariants.h"
+
+#include <stdio.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "fileUtil.h"
+#include "profiler.h"
+
+namespace {
+    const char fileMagic[8] = {'S', 'H', 'A', 'D', 'E', 'R', 'B', 'N'};
+    const uint32_t fileVersion = 1;
+    const char* const fileExt = ".bin";
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t binaryFormat;
+        uint64_t key;
+        uint64_t size;
+    };
+
+    std::string cacheDir;
+    bool cacheEnabled = false;
+
+    uint64_t hashString(const char* s, uint64_t h = hashSeed){
+        // Include the terminator so "ab"+"c" and "a"+"bc" come out different
+        return s ? hashBytes(s, strlen(s) + 1, h) : h;
+    }
+
+    bool readFile(const char* fName, std::string& out){
+        std::ifstream fs(fName, std::ifstream::in | std::ifstream::binary);
+        if(fs.fail()){
+            printf("Failed to open file \'%s\'\n", fName);
+            return false;
+        }
+        std::stringstream ss;
+        ss << fs.rdbuf();
+        out = ss.str();
+        return true;
+    }
+
+    // Every `#pragma keywords` line in `source`
+    void parseKeywords(const std::string& source, std::vector<std::string>& keywords){
+        std::istringstream lines(source);
+        std::string line;
+        while(std::getline(lines, line)){
+            std::istringstream words(line);
+            std::string pragma, name, word;
+            words >> pragma >> name;
+            if(pragma != "#pragma" || name != "keywords") continue;
+
+            while(words >> word){
+                bool known = false;
+                for(const std::string& k : keywords) known = known || k == word;
+                if(!known) keywords.push_back(word);
+            }
+        }
+    }
+
+    std::string definesFor(const ShaderProgram& prog, ShaderKeywords keywords){
+        std::string defines;
+        for(size_t i = 0; i < prog.keywords.size(); i++){
+            if(keywords & (1u << i)) defines += "#define " + prog.keywords[i] + "\n";
+        }
+        return defines;
+    }
+
+    unsigned int compileStage(const ShaderStage& stage, const std::string& defines){
+        PROFILE_ZONE("compile shader");
+        const std::string& source = stage.source;
+        // #version has to stay first, the defines go on the line after it and #line puts the numbering back
+        const char* parts[3];
+        GLint lengths[3];
+        std::string prefix = defines;
+        size_t split = 0;
+        if(source.compare(0, 8, "#version") == 0){
+            split = source.find('\n');
+            split = split == std::string::npos ? source.size() : split + 1;
+            prefix += "#line 2\n";
+        }
+        parts[0] = source.data();           lengths[0] = split;
+        parts[1] = prefix.data();           lengths[1] = prefix.size();
+        parts[2] = source.data() + split;   lengths[2] = source.size() - split;
+
+        unsigned int shader = glCreateShader(stage.type);
+        glShaderSource(shader, 3, parts, lengths);
+        glCompileShader(shader);
+
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if(!success){
+            char infoLog[512] = {0};
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            printf("compiling \'%s\' failed:\n%s%s\n", stage.file.c_str(), defines.c_str(), infoLog);
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    // Binaries only work with the exact driver that made them, so that's part of the key too
+    uint64_t variantKey(const ShaderProgram& prog, const std::string& defines){
+        uint64_t h = hashString(defines.c_str());
+        for(const ShaderStage& stage : prog.stages) h = hashString(stage.source.c_str(), h);
+        h = hashString((const char*)glGetString(GL_VENDOR), h);
+        h = hashString((const char*)glGetString(GL_RENDERER), h);
+        h = hashString((const char*)glGetString(GL_VERSION), h);
+        return hashBytes(&fileVersion, sizeof(fileVersion), h);
+    }
+
+    std::string entryPath(uint64_t key){
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx", (unsigned long long)key);
+        return cacheDir + name + fileExt;
+    }
+
+    GLuint loadBinary(const std::string& path, uint64_t key){
+        FILE* f = fopen(path.c_str(), "rb");
+        if(!f) return 0;
+
+        FileHeader header;
+        std::vector<char> binary;
+        bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+                  !memcmp(header.magic, fileMagic, sizeof(fileMagic)) && header.version == fileVersion &&
+                  header.key == key && header.size > 0 && header.size < (64u << 20);
+        if(ok){
+            binary.resize(header.size);
+            ok = fread(binary.data(), 1, binary.size(), f) == binary.size();
+        }
+        fclose(f);
+        if(!ok) return 0;
+
+        // A driver update can turn the binary down even with a matching key, then it's just compiled again
+        GLuint prog = glCreateProgram();
+        glProgramBinary(prog, header.binaryFormat, binary.data(), binary.size());
+        GLint linked;
+        glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+        if(!linked){
+            glDeleteProgram(prog);
+            return 0;
+        }
+        return prog;
+    }
+
+    void storeBinary(GLuint prog, const std::string& path, uint64_t key){
+        GLint size = 0;
+        glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &size);
+        if(size <= 0) return;
+
+        // Header and binary in one buffer so the file goes down in one piece
+        std::vector<char> file(sizeof(FileHeader) + size);
+        GLenum format;
+        glGetProgramBinary(prog, size, &size, &format, file.data() + sizeof(FileHeader));
+
+        FileHeader header = {};
+        memcpy(header.magic, fileMagic, sizeof(fileMagic));
+        header.version = fileVersion;
+        header.binaryFormat = format;
+        header.key = key;
+        header.size = size;
+        memcpy(file.data(), &header, sizeof(header));
+
+        if(!writeFileAtomic(path, file.data(), sizeof(FileHeader) + size)){
+            printf("Failed to write shader cache entry \'%s\'\n", path.c_str());
+        }
+    }
+
+    GLuint buildVariant(const ShaderProgram& prog, ShaderKeywords keywords){
+        PROFILE_ZONE("build shader variant");
+        const std::string defines = definesFor(prog, keywords);
+        uint64_t key = 0;
+        std::string path;
+        if(cacheEnabled){
+            key = variantKey(prog, defines);
+            path = entryPath(key);
+            if(GLuint cached = loadBinary(path, key)) return cached;
+        }
+
+        unsigned int shaderProg = glCreateProgram();
+        bool compiled = true;
+        for(const ShaderStage& stage : prog.stages){
+            unsigned int shader = compileStage(stage, defines);
+            if(!shader){
+                compiled = false;
+                break;
+            }
+            glAttachShader(shaderProg, shader);
+            // Only flagged for deletion, it goes once the program lets go of it
+            glDeleteShader(shader);
+        }
+        if(!compiled){
+            glDeleteProgram(shaderProg);
+            return 0;
+        }
+        if(cacheEnabled) glProgramParameteri(shaderProg, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        {
+            PROFILE_ZONE("link shader");
+            glLinkProgram(shaderProg);
+        }
+
+        GLint result;
+        glGetProgramiv(shaderProg, GL_LINK_STATUS, &result);
+        if(result == GL_FALSE){
+            char infoLog[512] = {0};
+            glGetProgramInfoLog(shaderProg, sizeof(infoLog), NULL, infoLog);
+            printf("Error linking shader:\n%s%s\n", defines.c_str(), infoLog);
+            glDeleteProgram(shaderProg);
+            return 0;
+        }
+
+        if(cacheEnabled) storeBinary(shaderProg, path, key);
+        return shaderProg;
+    }
+
+    // Read every stage's source and gather up their keywords
+    bool loadStages(ShaderProgram& prog){
+        prog.keywords.clear();
+        for(ShaderStage& stage : prog.stages){
+            if(!readFile(stage.file.c_str(), stage.source)) return false;
+            parseKeywords(stage.source, prog.keywords);
+        }
+        if(prog.keywords.size() > (size_t)maxShaderKeywords){
+            printf("\'%s\' declares %zu keywords, only the first %d can be used\n",
+                   prog.stages.back().file.c_str(), prog.keywords.size(), maxShaderKeywords);
+            prog.keywords.resize(maxShaderKeywords);
+        }
+        return true;
+    }
+}
+
+bool shaderCacheInit(const char* dir){
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if(formats <= 0){
+        printf("Driver can't save program binaries, shaders will compile every run\n");
+        return false;
+    }
+
+    cacheDir = dir;
+    while(cacheDir.size() > 1 && cacheDir.back() == '/') cacheDir.pop_back();
+    if(!makeDirs(cacheDir)){
+        printf("Failed to create shader cache directory \'%s\'\n", dir);
+        return false;
+    }
+    cacheEnabled = true;
+    return true;
+}
+
+void shaderCacheShutdown(){
+    cacheEnabled = false;
+    cacheDir.clear();
+}
+
+bool shaderProgramLoad(ShaderProgram& prog, const char* vertFile, const char* fragFile){
+    shaderProgramFree(prog);
+    prog.stages = {{GL_VERTEX_SHADER, vertFile, ""}, {GL_FRAGMENT_SHADER, fragFile, ""}};
+    return loadStages(prog);
+}
+
+bool shaderComputeLoad(ShaderProgram& prog, const char* computeFile){
+    shaderProgramFree(prog);
+    prog.stages = {{GL_COMPUTE_SHADER, computeFile, ""}};
+    return loadStages(prog);
+}
+
+ShaderKeywords shaderKeywords(const ShaderProgram& prog, const char* names){
+    ShaderKeywords keywords = 0;
+    std::string list = names;
+    for(char& c : list) if(c == ',') c = ' ';
+    std::istringstream words(list);
+    std::string word;
+    while(words >> word){
+        size_t i = 0;
+        while(i < prog.keywords.size() && prog.keywords[i] != word) i++;
+        if(i < prog.keywords.size()) keywords |= 1u << i;
+        else                         printf("\'%s\' has no keyword \'%s\'\n", prog.stages.back().file.c_str(), word.c_str());
+    }
+    return keywords;
+}
+
+GLuint shaderVariant(ShaderProgram& prog, ShaderKeywords keywords){
+    auto found = prog.variants.find(keywords);
+    if(found != prog.variants.end()) return found->second;
+
+    // Failures get remembered too so a broken variant isn't recompiled every frame
+    GLuint variant = buildVariant(prog, keywords);
+    prog.variants[keywords] = variant;
+    return variant;
+}
+
+void shaderWarmUp(ShaderProgram& prog, const ShaderKeywords* keywords, size_t count){
+    for(size_t i = 0; i < count; i++) shaderVariant(prog, keywords[i]);
+}
+
+void shaderProgramFree(ShaderProgram& prog){
+    for(auto& variant : prog.variants) glDeleteProgram(variant.second);
+    prog.variants.clear();
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glad/glad.h"
+
+// A vertex + fragment source pair (or a compute shader), compiled into as many variants as there are keyword
+// combinations in use.
+// A shader declares its keywords with a line like
+//     #pragma keywords SHOW_LOAD_LEVEL SINGLE_MATERIAL
+// (drivers ignore pragmas they don't know) and a variant gets a #define for each one that's on, slipped in
+// right after the #version line. Variants are compiled the first time they're asked for, kept around by
+// keyword set, and their program binaries are stored on disk so the next run can skip compiling altogether.
+
+// Bit n is the program's nth keyword, so a program can have at most 32
+typedef uint32_t ShaderKeywords;
+const int maxShaderKeywords = 32;
+
+struct ShaderStage {
+    GLenum type;
+    std::string file, source;
+};
+
+struct ShaderProgram {
+    std::vector<ShaderStage> stages;
+    // In the order they were declared, earlier stages first
+    std::vector<std::string> keywords;
+    std::unordered_map<ShaderKeywords, GLuint> variants;
+};
+
+// Keep program binaries in `dir` (made if it's missing). Without it variants still work, they just always compile.
+bool shaderCacheInit(const char* dir);
+void shaderCacheShutdown();
+
+// Read both sources and their keywords, nothing gets compiled yet
+bool shaderProgramLoad(ShaderProgram& prog, const char* vertFile, const char* fragFile);
+// Same for a compute program
+bool shaderComputeLoad(ShaderProgram& prog, const char* computeFile);
+// Keywords named in a comma or space separated list, names the program doesn't declare are reported and skipped
+ShaderKeywords shaderKeywords(const ShaderProgram& prog, const char* names);
+// The program for one keyword set, built (or loaded from disk) the first time. 0 if it doesn't compile.
+GLuint shaderVariant(ShaderProgram& prog, ShaderKeywords keywords);
+// Build variants ahead of time so the first frame that wants one doesn't hitch
+void shaderWarmUp(ShaderProgram& prog, const ShaderKeywords* keywords, size_t count);
+// Deletes every variant
+void shaderProgramFree(ShaderProgram& prog);
@@ -0,0 +1,459 @@
+#include "softRaster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "drawConstants.h"
+#include "imageLoad.h"
+#include "jobs.h"
+#include "pixelFormat.h"
+#include "profiler.h"
+#include "texCache.h"
+
+namespace {
+    // Screen is cut into tiles of this size, one job per tile
+    const int tileSize = 32;
+    // Vertex positions are snapped to 1/256th of a pixel like the hardware does
+    const int subPixelBits = 8;
+
+    // ---- Lane groups ----
+    // The shading code is written once against these and instantiated per instruction set.
+
+    struct ScalarLanes {
+        static constexpr int count = 1;
+        typedef float F;
+        typedef int I;
+
+        static F splat(float v)         { return v; }
+        static F ramp()                 { return 0; }
+        static F add(F a, F b)          { return a + b; }
+        static F sub(F a, F b)          { return a - b; }
+        static F mul(F a, F b)          { return a * b; }
+        static F div(F a, F b)          { return a / b; }
+        static F madd(F a, F b, F c)    { return a * b + c; }
+        static F floor(F v)             { return std::floor(v); }
+        static I toInt(F v)             { return (int)v; }
+        static I splatI(int v)          { return v; }
+        static I addI(I a, I b)         { return a + b; }
+        static I mulI(I a, I b)         { return a * b; }
+        static F gather(const float* base, I idx) { return base[idx]; }
+
+        static void storeRGBA(float* dst, F r, F g, F b, F a){
+            dst[0] = r; dst[1] = g; dst[2] = b; dst[3] = a;
+        }
+    };
+
+#ifdef __AVX2__
+    struct Avx2Lanes {
+        static constexpr int count = 8;
+        typedef __m256 F;
+        typedef __m256i I;
+
+        static F splat(float v)         { return _mm256_set1_ps(v); }
+        static F ramp()                 { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+        static F add(F a, F b)          { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b)          { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b)          { return _mm256_mul_ps(a, b); }
+        static F div(F a, F b)          { return _mm256_div_ps(a, b); }
+        static F madd(F a, F b, F c)    { return _mm256_fmadd_ps(a, b, c); }
+        static F floor(F v)             { return _mm256_floor_ps(v); }
+        static I toInt(F v)             { return _mm256_cvttps_epi32(v); }
+        static I splatI(int v)          { return _mm256_set1_epi32(v); }
+        static I addI(I a, I b)         { return _mm256_add_epi32(a, b); }
+        static I mulI(I a, I b)         { return _mm256_mullo_epi32(a, b); }
+        static F gather(const float* base, I idx) { return _mm256_i32gather_ps(base, idx, 4); }
+
+        // 4 planar vectors of 8 -> 8 interleaved RGBA pixels
+        static void storeRGBA(float* dst, F r, F g, F b, F a){
+            F rg0 = _mm256_unpacklo_ps(r, g), rg1 = _mm256_unpackhi_ps(r, g);
+            F ba0 = _mm256_unpacklo_ps(b, a), ba1 = _mm256_unpackhi_ps(b, a);
+            F p04 = _mm256_shuffle_ps(rg0, ba0, 0x44), p15 = _mm256_shuffle_ps(rg0, ba0, 0xEE);
+            F p26 = _mm256_shuffle_ps(rg1, ba1, 0x44), p37 = _mm256_shuffle_ps(rg1, ba1, 0xEE);
+            _mm256_storeu_ps(dst +  0, _mm256_permute2f128_ps(p04, p15, 0x20));
+            _mm256_storeu_ps(dst +  8, _mm256_permute2f128_ps(p26, p37, 0x20));
+            _mm256_storeu_ps(dst + 16, _mm256_permute2f128_ps(p04, p15, 0x31));
+            _mm256_storeu_ps(dst + 24, _mm256_permute2f128_ps(p26, p37, 0x31));
+        }
+    };
+#endif
+
+#ifdef __AVX512F__
+    struct Avx512Lanes {
+        static constexpr int count = 16;
+        typedef __m512 F;
+        typedef __m512i I;
+
+        static F splat(float v)         { return _mm512_set1_ps(v); }
+        static F ramp()                 { return _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15); }
+        static F add(F a, F b)          { return _mm512_add_ps(a, b); }
+        static F sub(F a, F b)          { return _mm512_sub_ps(a, b); }
+        static F mul(F a, F b)          { return _mm512_mul_ps(a, b); }
+        static F div(F a, F b)          { return _mm512_div_ps(a, b); }
+        static F madd(F a, F b, F c)    { return _mm512_fmadd_ps(a, b, c); }
+        static F floor(F v)             { return _mm512_floor_ps(v); }
+        static I toInt(F v)             { return _mm512_cvttps_epi32(v); }
+        static I splatI(int v)          { return _mm512_set1_epi32(v); }
+        static I addI(I a, I b)         { return _mm512_add_epi32(a, b); }
+        static I mulI(I a, I b)         { return _mm512_mullo_epi32(a, b); }
+        static F gather(const float* base, I idx) { return _mm512_i32gather_ps(idx, base, 4); }
+
+        static void storeRGBA(float* dst, F r, F g, F b, F a){
+            const I idx = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(4));
+            _mm512_i32scatter_ps(dst + 0, idx, r, 4);
+            _mm512_i32scatter_ps(dst + 1, idx, g, 4);
+            _mm512_i32scatter_ps(dst + 2, idx, b, 4);
+            _mm512_i32scatter_ps(dst + 3, idx, a, 4);
+        }
+    };
+    typedef Avx512Lanes WideLanes;
+#elif defined(__AVX2__)
+    typedef Avx2Lanes WideLanes;
+#else
+    typedef ScalarLanes WideLanes;
+#endif
+
+    // Wrap integer-valued `c` into [0, size) like GL_REPEAT
+    template<typename L>
+    typename L::I wrapCoord(typename L::F c, float size){
+        typename L::F s = L::splat(size);
+        typename L::F wrapped = L::sub(c, L::mul(s, L::floor(L::div(c, s))));
+        return L::toInt(wrapped);
+    }
+
+    // GL_LINEAR + GL_REPEAT lookup, writes RGBA into out
+    template<typename L>
+    void sampleBilinear(const SoftTexture& tex, typename L::F u, typename L::F v, typename L::F out[4]){
+        typedef typename L::F F;
+        typedef typename L::I I;
+
+        F x = L::sub(L::mul(u, L::splat(tex.width)),  L::splat(0.5f));
+        F y = L::sub(L::mul(v, L::splat(tex.height)), L::splat(0.5f));
+        F x0 = L::floor(x), y0 = L::floor(y);
+        F fx = L::sub(x, x0), fy = L::sub(y, y0);
+
+        I ix0 = wrapCoord<L>(x0, tex.width);
+        I ix1 = wrapCoord<L>(L::add(x0, L::splat(1)), tex.width);
+        I iy0 = wrapCoord<L>(y0, tex.height);
+        I iy1 = wrapCoord<L>(L::add(y0, L::splat(1)), tex.height);
+
+        I w = L::splatI(tex.width), four = L::splatI(4);
+        I row0 = L::mulI(iy0, w), row1 = L::mulI(iy1, w);
+        I i00 = L::mulI(L::addI(row0, ix0), four);
+        I i01 = L::mulI(L::addI(row0, ix1), four);
+        I i10 = L::mulI(L::addI(row1, ix0), four);
+        I i11 = L::mulI(L::addI(row1, ix1), four);
+
+        for(int c = 0; c < 4; c++){
+            const float* base = tex.texels + c;
+            F t00 = L::gather(base, i00), t01 = L::gather(base, i01);
+            F t10 = L::gather(base, i10), t11 = L::gather(base, i11);
+            F top    = L::madd(L::sub(t01, t00), fx, t00);
+            F bottom = L::madd(L::sub(t11, t10), fx, t10);
+            out[c] = L::madd(L::sub(bottom, top), fy, top);
+        }
+    }
+
+    // frag.glsl for L::count pixels starting at dst, uv at the first pixel center given, stepping by dudx/dvdx
+    template<typename L>
+    void shadeGroup(float* dst, float u, float v, float dudx, float dvdx,
+                    const SoftTexture& tex1, const SoftTexture& tex2, const DrawConstants& constants){
+        typedef typename L::F F;
+
+        F uu = L::madd(L::ramp(), L::splat(dudx), L::splat(u));
+        F vv = L::madd(L::ramp(), L::splat(dvdx), L::splat(v));
+
+        F a[4], b[4];
+        sampleBilinear<L>(tex1, uu, vv, a);
+        sampleBilinear<L>(tex2, uu, vv, b);
+
+        F w1 = L::splat(constants.blend[0]), w2 = L::splat(constants.blend[1]);
+        F out[4];
+        for(int c = 0; c < 4; c++){
+            out[c] = L::madd(a[c], w1, L::mul(b[c], w2));
+        }
+        L::storeRGBA(dst, out[0], out[1], out[2], out[3]);
+    }
+
+    // Triangle after viewport transform with everything needed to walk it
+    struct SetupTri {
+        // Edge i: A*px + B*py + C >= bias, px/py in sub pixel units
+        int64_t A[3], B[3], C[3], bias[3];
+        int minX, maxX, minY, maxY;
+        // uv = uv0 + d/dx * (x - x0) + d/dy * (y - y0), in pixels
+        float x0, y0;
+        float u0, v0;
+        float dudx, dudy, dvdx, dvdy;
+    };
+
+    int64_t floorDiv(int64_t a, int64_t b){
+        int64_t q = a / b;
+        if((a % b != 0) && ((a < 0) != (b < 0))) q--;
+        return q;
+    }
+
+    int64_t ceilDiv(int64_t a, int64_t b){
+        return -floorDiv(-a, b);
+    }
+
+    bool setupTriangle(const Vert* v, int width, int height, SetupTri& tri){
+        const int64_t one = 1 << subPixelBits;
+
+        // vertex.glsl passes positions straight through, so NDC -> window is all that's left
+        int64_t x[3], y[3];
+        for(int i = 0; i < 3; i++){
+            x[i] = llround((v[i].pos[0] + 1.0) * 0.5 * width  * one);
+            y[i] = llround((v[i].pos[1] + 1.0) * 0.5 * height * one);
+        }
+
+        int idx[3] = {0, 1, 2};
+        int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+        if(area == 0) return false;
+        if(area < 0){
+            // No culling is enabled so clockwise triangles draw too, just walk them the other way round
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(idx[1], idx[2]);
+            area = -area;
+        }
+
+        for(int i = 0; i < 3; i++){
+            int j = (i + 1) % 3;
+            tri.A[i] = y[i] - y[j];
+            tri.B[i] = x[j] - x[i];
+            tri.C[i] = -(tri.A[i] * x[i] + tri.B[i] * y[i]);
+            // Top-left rule so pixels on a shared edge belong to exactly one triangle
+            bool left = y[j] < y[i];
+            bool top  = y[j] == y[i] && x[j] < x[i];
+            tri.bias[i] = (left || top) ? 0 : 1;
+        }
+
+        int64_t minX = std::min({x[0], x[1], x[2]}), maxX = std::max({x[0], x[1], x[2]});
+        int64_t minY = std::min({y[0], y[1], y[2]}), maxY = std::max({y[0], y[1], y[2]});
+        tri.minX = (int)std::max<int64_t>(0, floorDiv(minX, one));
+        tri.minY = (int)std::max<int64_t>(0, floorDiv(minY, one));
+        tri.maxX = (int)std::min<int64_t>(width - 1, floorDiv(maxX, one));
+        tri.maxY = (int)std::min<int64_t>(height - 1, floorDiv(maxY, one));
+        if(tri.minX > tri.maxX || tri.minY > tri.maxY) return false;
+
+        // Attribute planes, done in pixels
+        double fx[3], fy[3];
+        for(int i = 0; i < 3; i++){
+            fx[i] = (double)x[i] / one;
+            fy[i] = (double)y[i] / one;
+        }
+        double fArea = (fx[1] - fx[0]) * (fy[2] - fy[0]) - (fx[2] - fx[0]) * (fy[1] - fy[0]);
+        const Vert& a = v[idx[0]];
+        const Vert& b = v[idx[1]];
+        const Vert& c = v[idx[2]];
+        double du1 = b.uv[0] - a.uv[0], du2 = c.uv[0] - a.uv[0];
+        double dv1 = b.uv[1] - a.uv[1], dv2 = c.uv[1] - a.uv[1];
+        tri.x0 = fx[0];
+        tri.y0 = fy[0];
+        tri.u0 = a.uv[0];
+        tri.v0 = a.uv[1];
+        tri.dudx = (du1 * (fy[2] - fy[0]) - du2 * (fy[1] - fy[0])) / fArea;
+        tri.dudy = (du2 * (fx[1] - fx[0]) - du1 * (fx[2] - fx[0])) / fArea;
+        tri.dvdx = (dv1 * (fy[2] - fy[0]) - dv2 * (fy[1] - fy[0])) / fArea;
+        tri.dvdy = (dv2 * (fx[1] - fx[0]) - dv1 * (fx[2] - fx[0])) / fArea;
+
+        return true;
+    }
+
+    // Range of pixel columns on row `y` covered by `tri`, clipped to [x0, x1]. Empty when first > last.
+    void rowSpan(const SetupTri& tri, int y, int x0, int x1, int& first, int& last){
+        const int64_t one = 1 << subPixelBits, half = one / 2;
+        const int64_t py = (int64_t)y * one + half;
+
+        int64_t lo = x0, hi = x1;
+        for(int i = 0; i < 3; i++){
+            int64_t rest = tri.B[i] * py + tri.C[i];
+            // Solve A*px + rest >= bias for the pixel center px = x*one + half
+            if(tri.A[i] > 0){
+                int64_t px = ceilDiv(tri.bias[i] - rest, tri.A[i]);
+                lo = std::max(lo, ceilDiv(px - half, one));
+            } else if(tri.A[i] < 0){
+                int64_t px = floorDiv(rest - tri.bias[i], -tri.A[i]);
+                hi = std::min(hi, floorDiv(px - half, one));
+            } else if(rest < tri.bias[i]){
+                lo = 1;
+                hi = 0;
+                break;
+            }
+        }
+        first = (int)lo;
+        last = (int)hi;
+    }
+
+    void drawTriangleInTile(SoftTarget& target, const SetupTri& tri, int tx0, int ty0, int tx1, int ty1,
+                            const SoftTexture& tex1, const SoftTexture& tex2, const DrawConstants& constants){
+        const int x0 = std::max(tx0, tri.minX), x1 = std::min(tx1, tri.maxX);
+        const int y0 = std::max(ty0, tri.minY), y1 = std::min(ty1, tri.maxY);
+
+        for(int y = y0; y <= y1; y++){
+            int first, last;
+            rowSpan(tri, y, x0, x1, first, last);
+            if(first > last) continue;
+
+            float cy = y + 0.5f - tri.y0;
+            float* dst = target.pixels + ((size_t)y * target.width + first) * 4;
+            int x = first;
+            for(; x + WideLanes::count - 1 <= last; x += WideLanes::count, dst += 4 * WideLanes::count){
+                float cx = x + 0.5f - tri.x0;
+                float u = tri.u0 + tri.dudx * cx + tri.dudy * cy;
+                float v = tri.v0 + tri.dvdx * cx + tri.dvdy * cy;
+                shadeGroup<WideLanes>(dst, u, v, tri.dudx, tri.dvdx, tex1, tex2, constants);
+            }
+            for(; x <= last; x++, dst += 4){
+                float cx = x + 0.5f - tri.x0;
+                float u = tri.u0 + tri.dudx * cx + tri.dudy * cy;
+                float v = tri.v0 + tri.dvdx * cx + tri.dvdy * cy;
+                shadeGroup<ScalarLanes>(dst, u, v, tri.dudx, tri.dvdx, tex1, tex2, constants);
+            }
+        }
+    }
+
+    // Scratch kept between frames so steady state rendering doesn't allocate
+    std::vector<SetupTri> setupTris;
+    std::vector<std::vector<unsigned int>> tileBins;
+}
+
+bool softTextureFromRGB8(SoftTexture& tex, const unsigned char* raw, int width, int height, int numCh){
+    if(!raw || numCh < 1 || numCh > 4) return false;
+
+    softTextureFree(tex);
+    tex.texels = (float*)malloc((size_t)width * height * 4 * sizeof(float));
+    if(!tex.texels) return false;
+    tex.width = width;
+    tex.height = height;
+
+    return convertToRGBA32F(raw, numCh, tex.texels, (size_t)width * height);
+}
+
+bool softTextureFromRGBA32F(SoftTexture& tex, const float* texels, int width, int height){
+    if(!texels) return false;
+
+    softTextureFree(tex);
+    tex.texels = (float*)malloc((size_t)width * height * 4 * sizeof(float));
+    if(!tex.texels) return false;
+    tex.width = width;
+    tex.height = height;
+
+    memcpy(tex.texels, texels, (size_t)width * height * 4 * sizeof(float));
+    return true;
+}
+
+bool softTextureLoad(SoftTexture& tex, const char* fName, const ImageLoadOptions& opts){
+    // Goes through the texture cache like the GPU path so warm starts skip the decode here too
+    CachedTexture cached;
+    if(!texCacheLoad(cached, fName, opts, false)) return false;
+    bool ok = softTextureFromRGBA32F(tex, (const float*)cached.level[0], cached.width, cached.height);
+    texCacheRelease(cached);
+    return ok;
+}
+
+void softTextureFree(SoftTexture& tex){
+    free(tex.texels);
+    tex = SoftTexture();
+}
+
+bool softTargetCreate(SoftTarget& target, int width, int height){
+    softTargetFree(target);
+    target.pixels = (float*)malloc((size_t)width * height * 4 * sizeof(float));
+    if(!target.pixels) return false;
+    target.width = width;
+    target.height = height;
+    return true;
+}
+
+void softTargetFree(SoftTarget& target){
+    free(target.pixels);
+    target = SoftTarget();
+}
+
+void softRenderFrame(SoftTarget& target, const float clearColor[4],
+                     const Vert* verts, size_t vertCount,
+                     const SoftTexture& tex1, const SoftTexture& tex2, float time){
+    PROFILE_ZONE("soft render");
+    // The blend weights only depend on `time`, work them out once instead of per pixel
+    const DrawConstants constants = drawConstantsAt(time);
+
+    const int tilesX = (target.width  + tileSize - 1) / tileSize;
+    const int tilesY = (target.height + tileSize - 1) / tileSize;
+
+    // Set up every triangle once and drop it in the bins of the tiles it touches
+    setupTris.clear();
+    tileBins.resize(tilesX * tilesY);
+    for(auto& bin : tileBins) bin.clear();
+
+    for(size_t i = 0; i + 2 < vertCount; i += 3){
+        SetupTri tri;
+        if(!setupTriangle(verts + i, target.width, target.height, tri)) continue;
+
+        unsigned int triIdx = setupTris.size();
+        setupTris.push_back(tri);
+        for(int ty = tri.minY / tileSize; ty <= tri.maxY / tileSize; ty++){
+            for(int tx = tri.minX / tileSize; tx <= tri.maxX / tileSize; tx++){
+                tileBins[ty * tilesX + tx].push_back(triIdx);
+            }
+        }
+    }
+
+    const bool haveTextures = tex1.texels && tex2.texels;
+
+    auto shadeTile = [&](size_t tile){
+        const int tx0 = (tile % tilesX) * tileSize;
+        const int ty0 = (tile / tilesX) * tileSize;
+        const int tx1 = std::min(tx0 + tileSize, target.width) - 1;
+        const int ty1 = std::min(ty0 + tileSize, target.height) - 1;
+
+        for(int y = ty0; y <= ty1; y++){
+            float* row = target.pixels + ((size_t)y * target.width + tx0) * 4;
+            for(int x = tx0; x <= tx1; x++, row += 4){
+                row[0] = clearColor[0];
+                row[1] = clearColor[1];
+                row[2] = clearColor[2];
+                row[3] = clearColor[3];
+            }
+        }
+
+        if(!haveTextures) return;
+
+        // Submission order, later triangles overwrite earlier ones like with no depth test
+        for(unsigned int triIdx : tileBins[tile]){
+            drawTriangleInTile(target, setupTris[triIdx], tx0, ty0, tx1, ty1, tex1, tex2, constants);
+        }
+    };
+    // Through a reference so the std::function parallelFor takes doesn't copy all those captures to the heap
+    parallelFor(tilesX * tilesY, std::ref(shadeTile));
+}
+
+bool softWritePPM(const SoftTarget& target, const char* fName){
+    FILE* f = fopen(fName, "wb");
+    if(!f){
+        printf("Failed to open file \'%s\'\n", fName);
+        return false;
+    }
+
+    fprintf(f, "P6\n%d %d\n255\n", target.width, target.height);
+
+    std::vector<unsigned char> line(target.width * 3);
+    // PPM goes top down, the target is bottom up
+    for(int y = target.height - 1; y >= 0; y--){
+        convertPixels<RGBA32F, RGB8>(target.pixels + (size_t)y * target.width * 4, line.data(), target.width);
+        fwrite(line.data(), 1, line.size(), f);
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+
+#include "imageLoad.h"
+#include "vert.h"
+
+// CPU reference implementation of vertex.glsl + frag.glsl.
+// Used to produce golden images on machines without a GPU, and as a fallback backend.
+
+// A texture the way the GPU sees it after upload: RGBA32F texels, row 0 is t = 0
+struct SoftTexture {
+    int width = 0, height = 0;
+    float* texels = nullptr;
+};
+
+// Render target laid out like fb_tex: RGBA32F, row 0 is the bottom of the screen
+struct SoftTarget {
+    int width = 0, height = 0;
+    float* pixels = nullptr;
+};
+
+// Expand decoded 8-bit image data the same way glTextureSubImage2D does with GL_RGB/GL_UNSIGNED_BYTE
+bool softTextureFromRGB8(SoftTexture& tex, const unsigned char* raw, int width, int height, int numCh);
+// Straight copy of texels already in RGBA32F, like a level out of the texture cache
+bool softTextureFromRGBA32F(SoftTexture& tex, const float* texels, int width, int height);
+bool softTextureLoad(SoftTexture& tex, const char* fName, const ImageLoadOptions& opts = ImageLoadOptions());
+void softTextureFree(SoftTexture& tex);
+
+bool softTargetCreate(SoftTarget& target, int width, int height);
+void softTargetFree(SoftTarget& target);
+
+// Clear `target` then draw `vertCount` verts as GL_TRIANGLES with tex1/tex2 bound and the `time` uniform set.
+// Work is split into screen tiles spread over the job system.
+void softRenderFrame(SoftTarget& target, const float clearColor[4],
+                     const Vert* verts, size_t vertCount,
+                     const SoftTexture& tex1, const SoftTexture& tex2, float time);
+
+// Dump the target as a binary PPM (top row first, 8 bits per channel)
+bool softWritePPM(const SoftTarget& target, const char* fName);
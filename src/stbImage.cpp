@@ -0,0 +1,9 @@
+// stb_image's implementation, with its allocations going through the scratch allocator so decodes inside an
+// ArenaScope (see arena.h) reuse the scope's memory instead of hitting the heap
+#include "arena.h"
+
+#define STBI_MALLOC(size) scratchMalloc(size)
+#define STBI_REALLOC_SIZED(p, oldSize, newSize) scratchRealloc(p, oldSize, newSize)
+#define STBI_FREE(p) scratchFree(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
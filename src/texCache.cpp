@@ -0,0 +1,292 @@
+#include "texCache.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "fileUtil.h"
+#include "pixelFormat.h"
+
+namespace {
+    // Bump whenever the layout or what goes into a texel changes, old entries then just miss
+    const uint32_t fileVersion = 1;
+    const char fileMagic[8] = {'T', 'E', 'X', 'C', 'A', 'C', 'H', 'E'};
+    const char* const fileExt = ".tex";
+    // Every level starts on a cache line, the mapping itself is page aligned
+    const size_t levelAlign = 64;
+    // Past anything GL would take, and small enough that level sizes can't overflow
+    const int maxTextureSize = 1 << 16;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t levels;
+        uint64_t key;
+        uint64_t contentSize;
+        int32_t width, height;
+        uint32_t internalFormat, glFormat, glType;
+        uint32_t pad;
+        uint64_t levelOffset[texCacheMaxLevels];
+        uint64_t levelSize[texCacheMaxLevels];
+    };
+
+    std::string cacheDir;
+    size_t cacheLimit = 0;
+    bool cacheEnabled = false;
+    // Trimming walks the whole directory, keep loads on other threads from doing it at the same time
+    std::mutex trimLock;
+
+    uint64_t entryKey(const std::vector<unsigned char>& content, const char* fName, const ImageLoadOptions& opts, bool mipmaps){
+        uint64_t h = hashBytes(content.data(), content.size());
+        h = hashBytes(fName, strlen(fName), h);
+        const int64_t params[] = {opts.displayWidth, opts.displayHeight, (int64_t)opts.maxBytes, opts.scaleShift, mipmaps, fileVersion};
+        return hashBytes(params, sizeof(params), h);
+    }
+
+    std::string entryPath(uint64_t key){
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx", (unsigned long long)key);
+        return cacheDir + name + fileExt;
+    }
+
+    void fillLevels(CachedTexture& tex, const FileHeader& header){
+        tex.width = header.width;
+        tex.height = header.height;
+        tex.levels = header.levels;
+        tex.internalFormat = header.internalFormat;
+        tex.glFormat = header.glFormat;
+        tex.glType = header.glType;
+        for(int l = 0; l < tex.levels; l++){
+            tex.level[l] = (const uint8_t*)tex.block + header.levelOffset[l];
+            tex.levelSize[l] = header.levelSize[l];
+        }
+    }
+
+    bool mapEntry(CachedTexture& tex, const std::string& path, uint64_t key, size_t contentSize){
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+
+        struct stat st;
+        if(fstat(fd, &st) || (size_t)st.st_size < sizeof(FileHeader)){
+            close(fd);
+            return false;
+        }
+        void* block = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // Bump the mtime, that's what trimming goes by
+        futimens(fd, nullptr);
+        close(fd);
+        if(block == MAP_FAILED) return false;
+
+        // Don't trust anything about the file until it checks out
+        const FileHeader& header = *(const FileHeader*)block;
+        bool ok = !memcmp(header.magic, fileMagic, sizeof(fileMagic)) && header.version == fileVersion &&
+                  header.key == key && header.contentSize == contentSize &&
+                  header.levels >= 1 && header.levels <= (uint32_t)texCacheMaxLevels &&
+                  header.width > 0 && header.height > 0 && header.width <= maxTextureSize && header.height <= maxTextureSize;
+        const uint64_t size = st.st_size;
+        for(uint32_t l = 0; ok && l < header.levels; l++){
+            // Subtracting so a huge offset or size can't wrap around
+            ok = header.levelOffset[l] % levelAlign == 0 && header.levelOffset[l] <= size && header.levelSize[l] <= size - header.levelOffset[l] &&
+                 header.levelSize[l] == (uint64_t)texCacheLevelSize(header.width, l) * texCacheLevelSize(header.height, l) * 4 * sizeof(float);
+        }
+        if(!ok){
+            munmap(block, st.st_size);
+            return false;
+        }
+
+        tex.block = block;
+        tex.blockSize = st.st_size;
+        tex.mapped = true;
+        fillLevels(tex, header);
+        return true;
+    }
+
+    // 2x2 box filter, odd sizes reuse the last row/column
+    void downsample(const float* src, int w, int h, float* dst){
+        const int dw = texCacheLevelSize(w, 1), dh = texCacheLevelSize(h, 1);
+        for(int y = 0; y < dh; y++){
+            const float* r0 = src + (size_t)std::min(y * 2, h - 1) * w * 4;
+            const float* r1 = src + (size_t)std::min(y * 2 + 1, h - 1) * w * 4;
+            float* out = dst + (size_t)y * dw * 4;
+            for(int x = 0; x < dw; x++){
+                const int x0 = std::min(x * 2, w - 1) * 4, x1 = std::min(x * 2 + 1, w - 1) * 4;
+                for(int c = 0; c < 4; c++){
+                    out[x * 4 + c] = (r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c]) * 0.25f;
+                }
+            }
+        }
+    }
+
+    // Decode into a block laid out exactly like the cache file
+    bool buildEntry(CachedTexture& tex, const std::vector<unsigned char>& content, const char* fName,
+                    const ImageLoadOptions& opts, bool mipmaps, uint64_t key){
+        // Decoder buffers come out of this thread's scratch arena, raw is gone again before the scope ends
+        ArenaScope scratch(threadScratchArena());
+        int width, height, numCh;
+        unsigned char* raw = imageLoadMemory(content.data(), content.size(), &width, &height, &numCh, opts);
+        if(!raw){
+            printf("Failed to load texture \'%s\'\n", fName);
+            return false;
+        }
+
+        FileHeader header = {};
+        memcpy(header.magic, fileMagic, sizeof(fileMagic));
+        header.version = fileVersion;
+        header.key = key;
+        header.contentSize = content.size();
+        header.width = width;
+        header.height = height;
+        header.internalFormat = GL_RGBA32F;
+        header.glFormat = RGBA32F::glFormat;
+        header.glType = RGBA32F::glType;
+
+        int levels = 1;
+        if(mipmaps){
+            while(levels < texCacheMaxLevels && (width >> levels || height >> levels)) levels++;
+        }
+        header.levels = levels;
+
+        size_t offset = (sizeof(FileHeader) + levelAlign - 1) / levelAlign * levelAlign;
+        for(int l = 0; l < levels; l++){
+            header.levelOffset[l] = offset;
+            header.levelSize[l] = (size_t)texCacheLevelSize(width, l) * texCacheLevelSize(height, l) * 4 * sizeof(float);
+            offset += (header.levelSize[l] + levelAlign - 1) / levelAlign * levelAlign;
+        }
+
+        void* block = nullptr;
+        if(posix_memalign(&block, levelAlign, offset)){
+            imageFree(raw);
+            return false;
+        }
+        memset(block, 0, offset);
+        memcpy(block, &header, sizeof(header));
+
+        tex.block = block;
+        tex.blockSize = offset;
+        tex.mapped = false;
+        fillLevels(tex, header);
+
+        bool ok = convertToRGBA32F(raw, numCh, (float*)tex.level[0], (size_t)width * height);
+        imageFree(raw);
+        for(int l = 1; l < levels; l++){
+            downsample((const float*)tex.level[l - 1], texCacheLevelSize(width, l - 1), texCacheLevelSize(height, l - 1), (float*)tex.level[l]);
+        }
+        return ok;
+    }
+
+    // Drop the least recently used entries until the directory fits, leaving `keep` alone.
+    // Temp files nobody is going to finish get deleted along the way.
+    void trimCache(const std::string& keep){
+        std::lock_guard<std::mutex> guard(trimLock);
+
+        struct Entry {
+            std::string path;
+            size_t size;
+            struct timespec used;
+        };
+        std::vector<Entry> entries;
+        size_t total = 0;
+
+        DIR* dir = opendir(cacheDir.c_str());
+        if(!dir) return;
+        const size_t extLen = strlen(fileExt);
+        while(dirent* ent = readdir(dir)){
+            size_t len = strlen(ent->d_name);
+            const bool isEntry = len > extLen && !strcmp(ent->d_name + len - extLen, fileExt);
+            if(!isEntry && !strstr(ent->d_name, ".tmp")) continue;
+            Entry e;
+            e.path = cacheDir + "/" + ent->d_name;
+            struct stat st;
+            if(stat(e.path.c_str(), &st)) continue;
+            if(!isEntry){
+                if(staleTempFile(ent->d_name, st.st_mtim.tv_sec)) unlink(e.path.c_str());
+                continue;
+            }
+            e.size = st.st_size;
+            e.used = st.st_mtim;
+            total += e.size;
+            entries.push_back(e);
+        }
+        closedir(dir);
+
+        if(total <= cacheLimit) return;
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+            return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+        });
+        for(const Entry& e : entries){
+            if(total <= cacheLimit) break;
+            if(e.path == keep) continue;
+            if(!unlink(e.path.c_str())) total -= e.size;
+        }
+    }
+
+    // Written whole then renamed in, so nobody ever maps half a file
+    void storeEntry(const CachedTexture& tex, const std::string& path){
+        if(tex.blockSize > cacheLimit) return;
+        if(!writeFileAtomic(path, tex.block, tex.blockSize)){
+            printf("Failed to write texture cache entry \'%s\'\n", path.c_str());
+            return;
+        }
+        trimCache(path);
+    }
+}
+
+bool texCacheInit(const char* dir, size_t maxBytes){
+    cacheDir = dir;
+    while(cacheDir.size() > 1 && cacheDir.back() == '/') cacheDir.pop_back();
+    cacheLimit = maxBytes;
+    cacheEnabled = makeDirs(cacheDir);
+    if(!cacheEnabled){
+        printf("Failed to create texture cache directory \'%s\'\n", dir);
+        return false;
+    }
+    // The limit may have shrunk since last time
+    trimCache("");
+    return true;
+}
+
+void texCacheShutdown(){
+    cacheEnabled = false;
+    cacheDir.clear();
+}
+
+bool texCacheLoad(CachedTexture& tex, const char* fName, const ImageLoadOptions& opts, bool mipmaps){
+    // The file has to be read to hash it, that's still far cheaper than decoding it
+    std::vector<unsigned char> content;
+    if(!imageReadFile(fName, content)){
+        printf("Failed to open file \'%s\'\n", fName);
+        return false;
+    }
+
+    const uint64_t key = entryKey(content, fName, opts, mipmaps);
+    std::string path;
+    if(cacheEnabled){
+        path = entryPath(key);
+        if(mapEntry(tex, path, key, content.size())) return true;
+    }
+
+    if(!buildEntry(tex, content, fName, opts, mipmaps, key)){
+        texCacheRelease(tex);
+        return false;
+    }
+    if(cacheEnabled) storeEntry(tex, path);
+    return true;
+}
+
+void texCacheRelease(CachedTexture& tex){
+    if(tex.mapped) munmap(tex.block, tex.blockSize);
+    else           free(tex.block);
+    tex = CachedTexture();
+}
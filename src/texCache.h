@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+
+#include "glad/glad.h"
+#include "imageLoad.h"
+
+// Decoded textures kept on disk, ready to hand straight to glTextureSubImage2D.
+// Entries are keyed by a hash of the file contents, its path and the load options, so editing an image or
+// loading it at a different size just misses. A hit maps the file instead of decoding anything.
+// The directory gets trimmed back under its size limit, least recently used first, whenever an entry is added.
+
+const int texCacheMaxLevels = 16;
+
+struct CachedTexture {
+    // Size of level 0, level n is max(1, size >> n)
+    int width = 0, height = 0;
+    int levels = 0;
+    // What to give glTextureStorage2D and glTextureSubImage2D
+    GLenum internalFormat = 0, glFormat = 0, glType = 0;
+    const void* level[texCacheMaxLevels] = {};
+    size_t levelSize[texCacheMaxLevels] = {};
+
+    // The bytes behind `level`, a mapping of the cache file on a hit or an allocation otherwise
+    void* block = nullptr;
+    size_t blockSize = 0;
+    bool mapped = false;
+};
+
+inline int texCacheLevelSize(int size, int level){
+    return size >> level > 0 ? size >> level : 1;
+}
+
+// Keep entries in `dir` (made if it's missing) using at most maxBytes of disk.
+// Without a cache texCacheLoad still works, it just decodes every time.
+bool texCacheInit(const char* dir, size_t maxBytes);
+void texCacheShutdown();
+
+// Load `fName` as RGBA32F texels, with a full mip chain if `mipmaps` is set.
+// Comes from the cache when it can, otherwise it's decoded and stored for next time.
+bool texCacheLoad(CachedTexture& tex, const char* fName, const ImageLoadOptions& opts, bool mipmaps);
+void texCacheRelease(CachedTexture& tex);
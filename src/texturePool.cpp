@@ -0,0 +1,142 @@
+#include "texturePool.h"
+
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+#include "gpuResources.h"
+
+namespace {
+    struct Pool {
+        GpuTexture tex;
+        int width, height, levels;
+        GLenum internalFormat;
+        int capacity = 0, used = 0;
+    };
+
+    std::vector<Pool> pools;
+    std::vector<Material> materials;
+    GpuBuffer materialBuffer;
+    bool materialsDirty = false;
+
+    GpuTexture createArray(const Pool& pool, int layers){
+        char label[64];
+        snprintf(label, sizeof(label), "texture pool %dx%d", pool.width, pool.height);
+        GpuTexture tex = gpuTextureCreate({GL_TEXTURE_2D_ARRAY, pool.internalFormat, pool.width, pool.height, layers, pool.levels},
+                                          gpuTextures, label);
+        // Could be a recycled one, so the parameters get set either way
+        const GLuint id = tex.id();
+        glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, pool.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return tex;
+    }
+
+    // Double the layer count, arrays can't be resized so the old layers get copied into a new one
+    bool growPool(Pool& pool){
+        GLint maxLayers;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        if(pool.capacity >= maxLayers) return false;
+
+        int capacity = pool.capacity ? pool.capacity * 2 : 1;
+        if(capacity > maxLayers) capacity = maxLayers;
+
+        GpuTexture tex = createArray(pool, capacity);
+        if(pool.tex.id()){
+            for(int l = 0; l < pool.levels; l++){
+                glCopyImageSubData(pool.tex.id(), GL_TEXTURE_2D_ARRAY, l, 0, 0, 0,
+                                   tex.id(),      GL_TEXTURE_2D_ARRAY, l, 0, 0, 0,
+                                   texCacheLevelSize(pool.width, l), texCacheLevelSize(pool.height, l), pool.used);
+            }
+            // Pools only ever grow, nothing will want one this size again
+            pool.tex.destroy();
+        }
+        pool.tex = std::move(tex);
+        pool.capacity = capacity;
+        return true;
+    }
+
+    // A pool with room for another layer, making one if all the matching ones are full
+    int findPool(int width, int height, int levels, GLenum internalFormat){
+        for(size_t i = 0; i < pools.size(); i++){
+            Pool& pool = pools[i];
+            if(pool.width != width || pool.height != height || pool.levels != levels || pool.internalFormat != internalFormat) continue;
+            if(pool.used < pool.capacity || growPool(pool)) return i;
+        }
+
+        if(pools.size() >= (size_t)maxTexturePools){
+            printf("Out of texture pools (%d), can't add a %dx%d texture\n", maxTexturePools, width, height);
+            return -1;
+        }
+        Pool pool;
+        pool.width = width;
+        pool.height = height;
+        pool.levels = levels;
+        pool.internalFormat = internalFormat;
+        if(!growPool(pool)) return -1;
+        pools.push_back(std::move(pool));
+        return pools.size() - 1;
+    }
+}
+
+int textureAdd(const CachedTexture& tex){
+    if(!tex.levels) return -1;
+
+    int material = textureReserve(tex.width, tex.height, tex.levels, tex.internalFormat);
+    if(material < 0) return -1;
+    for(int l = 0; l < tex.levels; l++){
+        textureUploadLevel(material, l, tex.glFormat, tex.glType, tex.level[l]);
+    }
+    textureSetMinLod(material, 0.0f);
+    return material;
+}
+
+int textureReserve(int width, int height, int levels, GLenum internalFormat){
+    int p = findPool(width, height, levels, internalFormat);
+    if(p < 0) return -1;
+
+    const int layer = pools[p].used++;
+    materials.push_back({(uint32_t)p, (uint32_t)layer, materialNotLoaded});
+    materialsDirty = true;
+    return materials.size() - 1;
+}
+
+void textureUploadLevel(int material, int level, GLenum format, GLenum type, const void* data){
+    const Material& m = materials[material];
+    const Pool& pool = pools[m.pool];
+    glTextureSubImage3D(pool.tex.id(), level, 0, 0, m.layer, texCacheLevelSize(pool.width, level), texCacheLevelSize(pool.height, level), 1,
+                        format, type, data);
+}
+
+void textureSetMinLod(int material, float lod){
+    if(materials[material].minLod == lod) return;
+    materials[material].minLod = lod;
+    materialsDirty = true;
+}
+
+void texturePoolsBind(){
+    if(materialsDirty){
+        // Only changes when textures get added or finish loading. A new one each time so the last frame's reads never
+        // wait on the upload, the one it replaces goes back to the spares and comes around again next time.
+        materialBuffer = gpuBufferCreate({materials.size() * sizeof(Material), GL_DYNAMIC_STORAGE_BIT}, gpuBuffers,
+                                         "materials", materials.data());
+        materialsDirty = false;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, materialBufferBinding, materialBuffer.id());
+
+    for(size_t i = 0; i < pools.size(); i++){
+        glBindTextureUnit(firstPoolUnit + i, pools[i].tex.id());
+    }
+}
+
+void texturePoolsFree(){
+    pools.clear();
+    materials.clear();
+    materialBuffer.reset();
+    materialsDirty = false;
+}
+
+int textureMaterialCount(){
+    return materials.size();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+
+#include "glad/glad.h"
+#include "texCache.h"
+
+// Textures live as layers of GL_TEXTURE_2D_ARRAY pools, one pool per size/format/level count.
+// Shaders pick one by material index out of the material SSBO, so adding a texture never costs a unit or a bind.
+// Pools start small and double (copying the old layers over) when they fill up.
+
+// Has to match the size of the pools[] sampler array in frag.glsl
+const int maxTexturePools = 16;
+// Binding points the shader side expects
+const GLuint materialBufferBinding = 1;
+const GLuint firstPoolUnit = 0;
+
+// Mirrors struct Material in frag.glsl (std430)
+struct Material {
+    uint32_t pool;
+    uint32_t layer;
+    // The shader samples exactly this level, it's only above 0 while finer levels are still on their way.
+    // materialNotLoaded shows a placeholder instead.
+    float minLod;
+};
+
+const float materialNotLoaded = -1.0f;
+
+// Upload `tex` into a pool layer, returns its material index or -1
+int textureAdd(const CachedTexture& tex);
+// Claim a layer without filling it, it shows as a placeholder until textureSetMinLod says otherwise
+int textureReserve(int width, int height, int levels, GLenum internalFormat);
+// Fill in one level of a material's layer, `data` has to be that level's full size
+void textureUploadLevel(int material, int level, GLenum format, GLenum type, const void* data);
+void textureSetMinLod(int material, float lod);
+// Bind every pool and the material buffer, refreshing the buffer if materials were added since last time
+void texturePoolsBind();
+// Delete the pools and material buffer, material indices are invalid afterwards
+void texturePoolsFree();
+
+int textureMaterialCount();
@@ -0,0 +1,190 @@
+#include "tilePyramid.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pixelFormat.h"
+
+namespace {
+    const char fileMagic[8] = {'P', 'Y', 'R', 'A', 'M', 'I', 'D', '\0'};
+    const uint32_t fileVersion = 1;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t payload, border;
+        uint32_t width, height;
+        uint32_t levels;
+    };
+
+    // Page aligned so tile reads never straddle more pages than they have to
+    const size_t dataAlign = 4096;
+
+    bool setupLevels(TilePyramid& pyr, int width, int height){
+        pyr.width = width;
+        pyr.height = height;
+        pyr.levels = 0;
+        size_t tiles = 0;
+        for(int l = 0; l < maxPyramidLevels; l++){
+            PyramidLevel& level = pyr.level[l];
+            level.width  = (width  + (1 << l) - 1) >> l;
+            level.height = (height + (1 << l) - 1) >> l;
+            level.tilesX = (level.width  + tilePayload - 1) / tilePayload;
+            level.tilesY = (level.height + tilePayload - 1) / tilePayload;
+            level.firstTile = tiles;
+            tiles += (size_t)level.tilesX * level.tilesY;
+            pyr.levels++;
+            if(level.tilesX == 1 && level.tilesY == 1) break;
+        }
+        pyr.tileCount = tiles;
+        pyr.dataStart = (sizeof(FileHeader) + dataAlign - 1) / dataAlign * dataAlign;
+        const PyramidLevel& last = pyr.level[pyr.levels - 1];
+        return last.tilesX == 1 && last.tilesY == 1;
+    }
+
+    bool toRGBA8(const unsigned char* src, int numCh, uint8_t* dst, size_t count){
+        switch(numCh){
+            case 1: convertPixels<L8, RGBA8>(src, dst, count);   return true;
+            case 2: convertPixels<LA8, RGBA8>(src, dst, count);  return true;
+            case 3: convertPixels<RGB8, RGBA8>(src, dst, count); return true;
+            case 4: memcpy(dst, src, count * 4);                 return true;
+        }
+        return false;
+    }
+
+    // Copy a tile plus its apron out of an RGBA8 level, clamping at the edges
+    void cutTile(const uint8_t* levelPixels, int w, int h, int tx, int ty, uint8_t* page){
+        const int x0 = tx * tilePayload - tileBorder, y0 = ty * tilePayload - tileBorder;
+        for(int y = 0; y < tilePageSize; y++){
+            const int sy = std::min(std::max(y0 + y, 0), h - 1);
+            const uint32_t* row = (const uint32_t*)levelPixels + (size_t)sy * w;
+            uint32_t* out = (uint32_t*)page + (size_t)y * tilePageSize;
+            for(int x = 0; x < tilePageSize; x++){
+                out[x] = row[std::min(std::max(x0 + x, 0), w - 1)];
+            }
+        }
+    }
+
+    // 2x2 box filter to the next level, odd sizes reuse the last row/column
+    void halve(const uint8_t* src, int w, int h, uint8_t* dst){
+        const int dw = (w + 1) / 2, dh = (h + 1) / 2;
+        for(int y = 0; y < dh; y++){
+            const uint8_t* r0 = src + (size_t)std::min(y * 2, h - 1) * w * 4;
+            const uint8_t* r1 = src + (size_t)std::min(y * 2 + 1, h - 1) * w * 4;
+            uint8_t* out = dst + (size_t)y * dw * 4;
+            for(int x = 0; x < dw; x++){
+                const int x0 = std::min(x * 2, w - 1) * 4, x1 = std::min(x * 2 + 1, w - 1) * 4;
+                for(int c = 0; c < 4; c++){
+                    out[x * 4 + c] = (r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2;
+                }
+            }
+        }
+    }
+}
+
+bool pyramidBuild(const char* outName, const unsigned char* pixels, int width, int height, int numCh){
+    TilePyramid pyr;
+    if(width <= 0 || height <= 0 || !setupLevels(pyr, width, height)) return false;
+
+    std::vector<uint8_t> level((size_t)width * height * 4);
+    if(!toRGBA8(pixels, numCh, level.data(), (size_t)width * height)) return false;
+
+    // Same write-then-rename as the texture cache so a reader never sees half a file
+    std::string tmp = std::string(outName) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if(!f){
+        printf("Failed to open file \'%s\'\n", tmp.c_str());
+        return false;
+    }
+
+    FileHeader header = {};
+    memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = fileVersion;
+    header.payload = tilePayload;
+    header.border = tileBorder;
+    header.width = width;
+    header.height = height;
+    header.levels = pyr.levels;
+
+    std::vector<uint8_t> pad(pyr.dataStart - sizeof(header), 0);
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(pad.data(), 1, pad.size(), f) == pad.size();
+
+    std::vector<uint8_t> page(tilePageBytes);
+    std::vector<uint8_t> next;
+    for(int l = 0; l < pyr.levels && ok; l++){
+        const PyramidLevel& lv = pyr.level[l];
+        for(int ty = 0; ty < lv.tilesY && ok; ty++){
+            for(int tx = 0; tx < lv.tilesX && ok; tx++){
+                cutTile(level.data(), lv.width, lv.height, tx, ty, page.data());
+                ok = fwrite(page.data(), 1, page.size(), f) == page.size();
+            }
+        }
+        if(l + 1 < pyr.levels){
+            next.resize((size_t)pyr.level[l + 1].width * pyr.level[l + 1].height * 4);
+            halve(level.data(), lv.width, lv.height, next.data());
+            level.swap(next);
+        }
+    }
+
+    ok = fclose(f) == 0 && ok;
+    if(!ok || rename(tmp.c_str(), outName)){
+        printf("Failed to write pyramid \'%s\'\n", outName);
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool pyramidOpen(TilePyramid& pyr, const char* fName){
+    pyramidClose(pyr);
+
+    int fd = open(fName, O_RDONLY);
+    if(fd < 0){
+        printf("Failed to open file \'%s\'\n", fName);
+        return false;
+    }
+
+    FileHeader header;
+    bool ok = pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+              !memcmp(header.magic, fileMagic, sizeof(fileMagic)) && header.version == fileVersion &&
+              header.payload == tilePayload && header.border == tileBorder &&
+              header.width > 0 && header.height > 0 && header.width < (1u << 30) && header.height < (1u << 30) &&
+              setupLevels(pyr, header.width, header.height) && (uint32_t)pyr.levels == header.levels;
+
+    // Make sure every tile is actually there
+    off_t size = lseek(fd, 0, SEEK_END);
+    ok = ok && size >= 0 && (size_t)size >= pyr.dataStart + pyr.tileCount * tilePageBytes;
+    if(!ok){
+        printf("\'%s\' isn't a usable pyramid file\n", fName);
+        close(fd);
+        pyr = TilePyramid();
+        return false;
+    }
+
+    pyr.fd = fd;
+    return true;
+}
+
+void pyramidClose(TilePyramid& pyr){
+    if(pyr.fd >= 0) close(pyr.fd);
+    pyr = TilePyramid();
+}
+
+bool pyramidReadTile(const TilePyramid& pyr, size_t tile, uint8_t* page){
+    if(pyr.fd < 0 || tile >= pyr.tileCount) return false;
+    // pread doesn't touch the file position, so readers on other threads can't trip over each other
+    size_t done = 0;
+    while(done < tilePageBytes){
+        ssize_t got = pread(pyr.fd, page + done, tilePageBytes - done, pyr.dataStart + tile * tilePageBytes + done);
+        if(got <= 0) return false;
+        done += got;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Tiled image pyramid on disk, for images too big to upload (or even hold) in one go.
+// Level 0 is the full image and level n is ceil(size / 2^n), down to the first level that fits in one tile,
+// so a texel coordinate at level n is exactly the level 0 one divided by 2^n.
+// Every level is cut into tilePayload square tiles. Each one is stored as a tilePageSize square RGBA8 page with a
+// tileBorder apron copied from its neighbours (clamped at the image edge) so it can be bilinear filtered on its own.
+// Tiles are stored level by level, row by row, all the same size, so finding one is just arithmetic.
+
+const int tilePayload = 254;
+const int tileBorder = 1;
+const int tilePageSize = tilePayload + 2 * tileBorder;
+const size_t tilePageBytes = (size_t)tilePageSize * tilePageSize * 4;
+const int maxPyramidLevels = 24;
+
+struct PyramidLevel {
+    int width, height;
+    int tilesX, tilesY;
+    // Index of this level's top left tile
+    size_t firstTile;
+};
+
+struct TilePyramid {
+    int fd = -1;
+    int width = 0, height = 0;
+    int levels = 0;
+    PyramidLevel level[maxPyramidLevels];
+    size_t tileCount = 0;
+    size_t dataStart = 0;
+};
+
+// Cut 8-bit pixels with 1-4 channels (what imageLoad hands back) into a pyramid file
+bool pyramidBuild(const char* outName, const unsigned char* pixels, int width, int height, int numCh);
+
+bool pyramidOpen(TilePyramid& pyr, const char* fName);
+void pyramidClose(TilePyramid& pyr);
+
+inline size_t pyramidTileIndex(const TilePyramid& pyr, int level, int x, int y){
+    return pyr.level[level].firstTile + (size_t)y * pyr.level[level].tilesX + x;
+}
+
+// Read one tile's page (tilePageBytes) into `page`. Fine to call from several threads at once.
+bool pyramidReadTile(const TilePyramid& pyr, size_t tile, uint8_t* page);
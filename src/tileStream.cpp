@@ -0,0 +1,245 @@
+#include "tileStream.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "arena.h"
+#include "profiler.h"
+
+namespace {
+    // Keeps a burst of new tiles from turning into one long frame
+    const int maxUploadsPerFrame = 8;
+
+    int maxInFlight(){
+        return (jobsWorkerCount() + 1) * 2;
+    }
+
+    struct Want {
+        size_t tile;
+        float coverage;
+    };
+
+    // Rebuilt every frame, so it lives in the frame arena. Sized for every tile of the levels involved.
+    struct WantList {
+        Want* items;
+        size_t count;
+    };
+
+    // Level with at most one texel per pixel over `view`, same pick tiled.glsl makes per pixel
+    int viewLevel(const TileStream& ts, const float view[4], int screenW, int screenH){
+        const float rho = std::max((view[2] - view[0]) * ts.pyr.width / screenW, (view[3] - view[1]) * ts.pyr.height / screenH);
+        int level = rho > 1.0f ? (int)std::floor(std::log2(rho)) : 0;
+        return std::min(level, ts.pyr.levels - 1);
+    }
+
+    // Every tile of `level` overlapping the view, weighted by how many pixels it covers
+    void addLevelWants(const TileStream& ts, int level, float weight, const float view[4], int screenW, int screenH, WantList& wants){
+        const float u0 = std::max(view[0], 0.0f), v0 = std::max(view[1], 0.0f);
+        const float u1 = std::min(view[2], 1.0f), v1 = std::min(view[3], 1.0f);
+        if(u1 <= u0 || v1 <= v0) return;
+
+        const PyramidLevel& lv = ts.pyr.level[level];
+        // Tile size in uv
+        const float tileU = (float)tilePayload * (1 << level) / ts.pyr.width;
+        const float tileV = (float)tilePayload * (1 << level) / ts.pyr.height;
+        const float pixelsPerU = screenW / (view[2] - view[0]), pixelsPerV = screenH / (view[3] - view[1]);
+
+        const int tx0 = std::min((int)(u0 / tileU), lv.tilesX - 1), tx1 = std::min((int)(u1 / tileU), lv.tilesX - 1);
+        const int ty0 = std::min((int)(v0 / tileV), lv.tilesY - 1), ty1 = std::min((int)(v1 / tileV), lv.tilesY - 1);
+        for(int ty = ty0; ty <= ty1; ty++){
+            for(int tx = tx0; tx <= tx1; tx++){
+                const float w = std::min(u1, (tx + 1) * tileU) - std::max(u0, tx * tileU);
+                const float h = std::min(v1, (ty + 1) * tileV) - std::max(v0, ty * tileV);
+                if(w <= 0 || h <= 0) continue;
+                wants.items[wants.count++] = {pyramidTileIndex(ts.pyr, level, tx, ty), w * pixelsPerU * h * pixelsPerV * weight};
+            }
+        }
+    }
+
+    // A page for a newly loaded tile: a free one, or whichever has gone unwanted the longest
+    int findPage(TileStream& ts){
+        const size_t coarsest = ts.pyr.tileCount - 1;
+        int best = -1;
+        uint64_t bestWanted = ts.frame;
+        for(size_t p = 0; p < ts.pageTile.size(); p++){
+            const int64_t tile = ts.pageTile[p];
+            if(tile < 0) return p;
+            const uint64_t wanted = ts.tiles[tile].lastWanted;
+            // Anything wanted this frame stays, and the coarsest tile is the fallback for everything so it never goes
+            if((size_t)tile == coarsest || wanted >= ts.frame) continue;
+            if(best < 0 || wanted < bestWanted){
+                best = p;
+                bestWanted = wanted;
+            }
+        }
+        if(best >= 0){
+            ts.tiles[ts.pageTile[best]].page = -1;
+            ts.pageTile[best] = -1;
+            ts.tilesEvicted++;
+        }
+        return best;
+    }
+
+    void uploadLoaded(TileStream& ts){
+        std::vector<TileStream::Loaded> ready;
+        {
+            std::lock_guard<std::mutex> guard(ts.loadedLock);
+            const size_t n = std::min<size_t>(ts.loaded.size(), maxUploadsPerFrame);
+            ready.assign(std::make_move_iterator(ts.loaded.begin()), std::make_move_iterator(ts.loaded.begin() + n));
+            ts.loaded.erase(ts.loaded.begin(), ts.loaded.begin() + n);
+        }
+
+        for(TileStream::Loaded& l : ready){
+            ts.inFlight--;
+            TileStream::Tile& tile = ts.tiles[l.tile];
+            tile.loading = false;
+            if(l.page.empty()){
+                printf("Failed to read tile %zu\n", l.tile);
+                continue;
+            }
+
+            const int page = findPage(ts);
+            // Cache is full of tiles this frame needs more, it gets asked for again if it's still wanted
+            if(page < 0) continue;
+
+            const int px = page % ts.pagesPerSide, py = page / ts.pagesPerSide;
+            glTextureSubImage2D(ts.pages.id(), 0, px * tilePageSize, py * tilePageSize, tilePageSize, tilePageSize,
+                                GL_RGBA, GL_UNSIGNED_BYTE, l.page.data());
+            tile.page = page;
+            ts.pageTile[page] = l.tile;
+            ts.tilesLoaded++;
+            ts.tableDirty = true;
+        }
+    }
+
+    void requestTile(TileStream& ts, size_t tile, float coverage){
+        ts.tiles[tile].loading = true;
+        ts.inFlight++;
+        // Lower runs first on the job system, so more coverage means more negative
+        const int priority = -(int)std::min(coverage, 1e9f);
+        TileStream* stream = &ts;
+        jobsSubmit(ts.loads, [stream, tile]{
+            TileStream::Loaded l;
+            l.tile = tile;
+            l.page.resize(tilePageBytes);
+            if(!pyramidReadTile(stream->pyr, tile, l.page.data())) l.page.clear();
+            std::lock_guard<std::mutex> guard(stream->loadedLock);
+            stream->loaded.push_back(std::move(l));
+        }, priority);
+    }
+
+    // Each entry points at its own page if loaded, otherwise copies its parent's, coarsest level first
+    void rebuildTable(TileStream& ts){
+        const PyramidLevel& base = ts.pyr.level[0];
+        const size_t layer = (size_t)base.tilesX * base.tilesY * 4;
+        for(int l = ts.pyr.levels - 1; l >= 0; l--){
+            const PyramidLevel& lv = ts.pyr.level[l];
+            for(int y = 0; y < lv.tilesY; y++){
+                for(int x = 0; x < lv.tilesX; x++){
+                    uint16_t* entry = &ts.table[layer * l + ((size_t)y * base.tilesX + x) * 4];
+                    const int page = ts.tiles[pyramidTileIndex(ts.pyr, l, x, y)].page;
+                    if(page >= 0){
+                        entry[0] = page % ts.pagesPerSide;
+                        entry[1] = page / ts.pagesPerSide;
+                        entry[2] = l;
+                        entry[3] = 1;
+                    } else if(l + 1 < ts.pyr.levels){
+                        memcpy(entry, &ts.table[layer * (l + 1) + ((size_t)(y / 2) * base.tilesX + x / 2) * 4], 4 * sizeof(uint16_t));
+                    } else {
+                        memset(entry, 0, 4 * sizeof(uint16_t));
+                    }
+                }
+            }
+        }
+        glTextureSubImage3D(ts.indirection.id(), 0, 0, 0, 0, base.tilesX, base.tilesY, ts.pyr.levels,
+                            GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, ts.table.data());
+        ts.tableDirty = false;
+    }
+}
+
+bool tileStreamOpen(TileStream& ts, const char* pyramidFile, int pagesPerSide){
+    if(!pyramidOpen(ts.pyr, pyramidFile)) return false;
+
+    GLint maxSize;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    ts.pagesPerSide = std::max(1, std::min(pagesPerSide, maxSize / tilePageSize));
+    const int cacheSize = ts.pagesPerSide * tilePageSize;
+
+    ts.pages = gpuTextureCreate({GL_TEXTURE_2D, GL_RGBA8, cacheSize, cacheSize}, gpuStreaming, "tile pages");
+    glTextureParameteri(ts.pages.id(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(ts.pages.id(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(ts.pages.id(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(ts.pages.id(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Integer textures have to use nearest filtering or they count as incomplete
+    const PyramidLevel& base = ts.pyr.level[0];
+    ts.indirection = gpuTextureCreate({GL_TEXTURE_2D_ARRAY, GL_RGBA16UI, base.tilesX, base.tilesY, ts.pyr.levels},
+                                      gpuStreaming, "tile indirection");
+    glTextureParameteri(ts.indirection.id(), GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(ts.indirection.id(), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    ts.tiles.assign(ts.pyr.tileCount, TileStream::Tile());
+    ts.pageTile.assign((size_t)ts.pagesPerSide * ts.pagesPerSide, -1);
+    ts.table.assign((size_t)base.tilesX * base.tilesY * ts.pyr.levels * 4, 0);
+    ts.tableDirty = true;
+    ts.frame = 0;
+    ts.inFlight = 0;
+    ts.tilesLoaded = ts.tilesEvicted = 0;
+    return true;
+}
+
+void tileStreamUpdate(TileStream& ts, const float view[4], int screenW, int screenH){
+    PROFILE_ZONE("tile stream");
+    if(ts.pyr.fd < 0) return;
+    ts.frame++;
+
+    // The coarsest tile backs everything else, then the level the view needs and the one above it for zooming out
+    const int level = viewLevel(ts, view, screenW, screenH);
+    size_t most = 1;
+    for(int l = level; l <= level + 1 && l < ts.pyr.levels; l++) most += (size_t)ts.pyr.level[l].tilesX * ts.pyr.level[l].tilesY;
+    WantList wants = {frameAlloc<Want>(most), 0};
+    if(!wants.items) return;
+    wants.items[wants.count++] = {ts.pyr.tileCount - 1, INFINITY};
+    addLevelWants(ts, level, 1.0f, view, screenW, screenH, wants);
+    if(level + 1 < ts.pyr.levels - 1) addLevelWants(ts, level + 1, 0.25f, view, screenW, screenH, wants);
+
+    // No point asking for more than fits
+    Want* const end = wants.items + std::min(wants.count, ts.pageTile.size());
+    std::sort(wants.items, wants.items + wants.count, [](const Want& a, const Want& b){ return a.coverage > b.coverage; });
+    for(const Want* w = wants.items; w != end; w++) ts.tiles[w->tile].lastWanted = ts.frame;
+
+    uploadLoaded(ts);
+
+    for(const Want* w = wants.items; w != end; w++){
+        if(ts.inFlight >= maxInFlight()) break;
+        const TileStream::Tile& tile = ts.tiles[w->tile];
+        if(tile.page < 0 && !tile.loading) requestTile(ts, w->tile, w->coverage);
+    }
+
+    if(ts.tableDirty) rebuildTable(ts);
+}
+
+void tileStreamBind(TileStream& ts, GLuint program, GLuint pageUnit, GLuint indirectionUnit){
+    glBindTextureUnit(pageUnit, ts.pages.id());
+    glBindTextureUnit(indirectionUnit, ts.indirection.id());
+    glProgramUniform1i(program, glGetUniformLocation(program, "pages"), pageUnit);
+    glProgramUniform1i(program, glGetUniformLocation(program, "indirection"), indirectionUnit);
+    glProgramUniform2i(program, glGetUniformLocation(program, "imageSize"), ts.pyr.width, ts.pyr.height);
+    glProgramUniform1i(program, glGetUniformLocation(program, "levels"), ts.pyr.levels);
+    glProgramUniform1f(program, glGetUniformLocation(program, "pageCacheSize"), (float)(ts.pagesPerSide * tilePageSize));
+}
+
+void tileStreamClose(TileStream& ts){
+    // Reads in flight still point at the pyramid
+    jobsWait(ts.loads);
+    ts.loaded.clear();
+
+    ts.pages.reset();
+    ts.indirection.reset();
+    pyramidClose(ts.pyr);
+    ts.tiles.clear();
+    ts.pageTile.clear();
+    ts.table.clear();
+}
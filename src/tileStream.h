@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "glad/glad.h"
+#include "gpuResources.h"
+#include "jobs.h"
+#include "tilePyramid.h"
+
+// Streams a tile pyramid through a fixed size page cache so only what's on screen has to be resident.
+// tiled.glsl looks each sample up in an indirection table (one RGBA16UI layer per level, entry per tile) that
+// points at the page holding that tile, or at the closest coarser tile that is loaded while it isn't.
+// Tiles are read on the job system, biggest on-screen coverage first, and uploaded a few per frame.
+// There's no sparse texture path, the glad loader here doesn't have ARB_sparse_texture.
+
+struct TileStream {
+    TilePyramid pyr;
+
+    // Physical page cache, pagesPerSide^2 pages of tilePageSize RGBA8
+    GpuTexture pages;
+    int pagesPerSide = 0;
+    // RGBA16UI 2D array, layer n is level n: page x, page y, level the page holds, 1 if there's anything at all
+    GpuTexture indirection;
+
+    struct Tile {
+        int page = -1;
+        bool loading = false;
+        uint64_t lastWanted = 0;
+    };
+    std::vector<Tile> tiles;
+    // Tile in each page, -1 when free
+    std::vector<int64_t> pageTile;
+    std::vector<uint16_t> table;
+    bool tableDirty = true;
+    uint64_t frame = 0;
+
+    // Finished reads waiting for the main thread to upload them
+    struct Loaded {
+        size_t tile;
+        std::vector<uint8_t> page;
+    };
+    std::mutex loadedLock;
+    std::vector<Loaded> loaded;
+    JobGroup loads;
+    int inFlight = 0;
+
+    // Running totals for the curious
+    uint64_t tilesLoaded = 0, tilesEvicted = 0;
+};
+
+bool tileStreamOpen(TileStream& ts, const char* pyramidFile, int pagesPerSide = 8);
+// Tell the streamer what's on screen: the image area view = {u0, v0, u1, v1} is drawn screenW x screenH pixels big.
+// Queues reads for what that needs, uploads whatever finished and refreshes the indirection table.
+// Its per frame lists come out of the frame arena, so call it between frameArenaBegin calls.
+void tileStreamUpdate(TileStream& ts, const float view[4], int screenW, int screenH);
+// Bind the page cache and indirection table and set the uniforms tiled.glsl reads on `program`
+void tileStreamBind(TileStream& ts, GLuint program, GLuint pageUnit, GLuint indirectionUnit);
+// Waits for outstanding reads, then frees everything
+void tileStreamClose(TileStream& ts);
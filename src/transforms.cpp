@@ -0,0 +1,147 @@
+#include "transforms.h"
+
+#include <algorithm>
+
+#include "jobs.h"
+#include "profiler.h"
+
+namespace {
+    template<typename T>
+    void permute(std::vector<T>& v, const std::vector<uint32_t>& order, size_t stride = 1){
+        std::vector<T> sorted(v.size());
+        for(size_t i = 0; i < order.size(); i++){
+            std::copy(v.begin() + order[i] * stride, v.begin() + (order[i] + 1) * stride, sorted.begin() + i * stride);
+        }
+        v.swap(sorted);
+    }
+
+    // Counting sort on depth, stable so siblings keep the order they were added in
+    void sortByDepth(Transforms& t){
+        const size_t count = t.idAt.size();
+        uint16_t maxDepth = 0;
+        for(uint16_t d : t.depth) maxDepth = std::max(maxDepth, d);
+        t.depthStart.assign(maxDepth + 2, 0);
+        for(uint16_t d : t.depth) t.depthStart[d + 1]++;
+        for(size_t d = 1; d < t.depthStart.size(); d++) t.depthStart[d] += t.depthStart[d - 1];
+
+        // order[new] = old
+        std::vector<uint32_t> order(count), next(t.depthStart.begin(), t.depthStart.end() - 1);
+        for(size_t i = 0; i < count; i++) order[next[t.depth[i]]++] = (uint32_t)i;
+        std::vector<uint32_t> moved(count);
+        for(size_t i = 0; i < count; i++) moved[order[i]] = (uint32_t)i;
+
+        std::vector<uint32_t> parent(count);
+        for(size_t i = 0; i < count; i++){
+            const uint32_t p = t.parent[order[i]];
+            parent[i] = p == noTransform ? noTransform : moved[p];
+        }
+        t.parent.swap(parent);
+        permute(t.depth, order);
+        permute(t.posX, order);
+        permute(t.posY, order);
+        permute(t.posZ, order);
+        permute(t.rotX, order);
+        permute(t.rotY, order);
+        permute(t.rotZ, order);
+        permute(t.rotW, order);
+        permute(t.scaleX, order);
+        permute(t.scaleY, order);
+        permute(t.scaleZ, order);
+        permute(t.world, order);
+        permute(t.dirty, order);
+        permute(t.idAt, order);
+        for(size_t i = 0; i < count; i++) t.indexOf[t.idAt[i]] = (uint32_t)i;
+        t.needsSort = false;
+    }
+
+    // One chunk of one depth. Parents are a depth up and already final, so they can be read freely.
+    void updateRange(Transforms& t, size_t begin, size_t end){
+        for(size_t i = begin; i < end; i++){
+            const uint32_t p = t.parent[i];
+            if(!t.dirty[i] && (p == noTransform || !t.dirty[p])) continue;
+            const Mat4 local = mat4Trs({t.posX[i], t.posY[i], t.posZ[i]}, {t.rotX[i], t.rotY[i], t.rotZ[i], t.rotW[i]},
+                                       {t.scaleX[i], t.scaleY[i], t.scaleZ[i]});
+            t.world[i] = p == noTransform ? local : t.world[p] * local;
+            // Passes it on to the children
+            t.dirty[i] = 1;
+        }
+    }
+}
+
+TransformId transformAdd(Transforms& t, TransformId parent){
+    const TransformId id = (TransformId)t.indexOf.size();
+    const uint32_t index = (uint32_t)t.idAt.size();
+    const uint16_t depth = parent == noTransform ? 0 : t.depth[t.indexOf[parent]] + 1;
+    t.parent.push_back(parent == noTransform ? noTransform : t.indexOf[parent]);
+    t.depth.push_back(depth);
+    t.posX.push_back(0);
+    t.posY.push_back(0);
+    t.posZ.push_back(0);
+    t.rotX.push_back(0);
+    t.rotY.push_back(0);
+    t.rotZ.push_back(0);
+    t.rotW.push_back(1);
+    t.scaleX.push_back(1);
+    t.scaleY.push_back(1);
+    t.scaleZ.push_back(1);
+    t.world.push_back(mat4Identity());
+    t.dirty.push_back(1);
+    t.dirtyCount++;
+    t.idAt.push_back(id);
+    t.indexOf.push_back(index);
+
+    // Still in depth order as long as it goes on the deepest run, otherwise the next update sorts
+    if(index && depth < t.depth[index - 1]){
+        t.needsSort = true;
+    } else if(!t.needsSort){
+        while(t.depthStart.size() < (size_t)depth + 2) t.depthStart.push_back(index);
+        t.depthStart.back() = index + 1;
+    }
+    return id;
+}
+
+void transformSet(Transforms& t, TransformId id, const float pos[3], const float rot[4], const float scale[3]){
+    const uint32_t i = t.indexOf[id];
+    t.posX[i] = pos[0];
+    t.posY[i] = pos[1];
+    t.posZ[i] = pos[2];
+    t.rotX[i] = rot[0];
+    t.rotY[i] = rot[1];
+    t.rotZ[i] = rot[2];
+    t.rotW[i] = rot[3];
+    t.scaleX[i] = scale[0];
+    t.scaleY[i] = scale[1];
+    t.scaleZ[i] = scale[2];
+    if(!t.dirty[i]){
+        t.dirty[i] = 1;
+        t.dirtyCount++;
+    }
+}
+
+void transformsUpdate(Transforms& t, std::vector<TransformId>& changed){
+    changed.clear();
+    if(t.needsSort) sortByDepth(t);
+    if(!t.dirtyCount) return;
+    PROFILE_ZONE("transforms");
+
+    for(size_t d = 0; d + 1 < t.depthStart.size(); d++){
+        const size_t begin = t.depthStart[d], end = t.depthStart[d + 1];
+        const size_t chunks = (end - begin + transformChunk - 1) / transformChunk;
+        if(chunks == 1){
+            updateRange(t, begin, end);
+            continue;
+        }
+        parallelFor(chunks, [&](size_t c){
+            const size_t first = begin + c * transformChunk;
+            updateRange(t, first, std::min(end, first + transformChunk));
+        });
+    }
+
+    // Whatever is still marked got recomputed
+    for(size_t i = 0; i < t.dirty.size(); i++){
+        if(!t.dirty[i]) continue;
+        changed.push_back(t.idAt[i]);
+        t.dirty[i] = 0;
+    }
+    t.dirtyCount = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vecMath.h"
+
+// Transform hierarchy for everything the scene draws.
+// Nodes are stored sorted by depth, roots first, so a parent always comes before its children and each depth is
+// one contiguous run. Local position, rotation and scale are kept one array per component (SoA), world matrices
+// a Mat4 a node. An update walks the depths in order and splits each one into chunks for the job workers:
+// a node whose parent was just recomputed is always in an earlier run, so nothing in a run waits on anything else.
+// Only nodes that were set, or sit under one that was, get recomputed.
+// Callers hold TransformIds, which stay put while the storage gets re-sorted underneath them.
+
+typedef uint32_t TransformId;
+const TransformId noTransform = ~0u;
+
+// Nodes a job when an update goes wide
+const size_t transformChunk = 4096;
+
+struct Transforms {
+    // All by depth order index
+    std::vector<uint32_t> parent;
+    std::vector<uint16_t> depth;
+    std::vector<float> posX, posY, posZ;
+    // Unit quaternion
+    std::vector<float> rotX, rotY, rotZ, rotW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<Mat4> world;
+    std::vector<uint8_t> dirty;
+    std::vector<TransformId> idAt;
+
+    // Depth order index of each id
+    std::vector<uint32_t> indexOf;
+    // Where each depth's run starts, plus one past the end
+    std::vector<uint32_t> depthStart;
+    // Something was added out of depth order
+    bool needsSort = false;
+    size_t dirtyCount = 0;
+};
+
+// Identity local transform under `parent` (noTransform for a root). The parent has to exist already.
+TransformId transformAdd(Transforms& transforms, TransformId parent);
+// Rotation is a unit quaternion (x, y, z, w)
+void transformSet(Transforms& transforms, TransformId id, const float pos[3], const float rot[4], const float scale[3]);
+inline size_t transformCount(const Transforms& transforms){
+    return transforms.idAt.size();
+}
+
+// Bring world matrices up to date. Ids of every node whose world matrix changed go in `changed`, which is
+// overwritten and only grows.
+void transformsUpdate(Transforms& transforms, std::vector<TransformId>& changed);
+// As of the last update
+inline const Mat4& transformWorld(const Transforms& transforms, TransformId id){
+    return transforms.world[transforms.indexOf[id]];
+}
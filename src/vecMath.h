@@ -0,0 +1,381 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#define VECMATH_SSE 1
+#endif
+// vmlaq_laneq_f32 is AArch64 only
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define VECMATH_NEON 1
+#endif
+
+// Small vector math: Vec2/3/4, Mat3/4, Quat and Aabb.
+// Everything is laid out the way std430 lays out the matching GLSL type, so arrays of them (and structs built
+// from them) can be memcpy'd straight into an ssbo:
+// - Vec3 is 16 byte aligned and sized like a vec3 array element. A float that follows a vec3 in a GLSL struct
+//   sits in its padding, so a C++ struct has to put it there itself (or use a Vec4).
+// - Matrices are column major, Mat3 is three Vec3 columns (48 bytes), Mat4 four Vec4s (64).
+// Operations are constexpr. During constant evaluation they take the scalar path, at run time Vec4 and Mat4 go
+// through SSE or NEON where the build has them (-march=native).
+// The batch functions at the bottom work on many points or matrices a call, 8 a go with AVX.
+
+struct alignas(8) Vec2 {
+    float x, y;
+};
+
+struct alignas(16) Vec3 {
+    float x, y, z;
+};
+
+struct alignas(16) Vec4 {
+    float x, y, z, w;
+};
+
+// Unit length for rotations, (x, y, z) is the axis times sin(angle / 2) and w cos(angle / 2)
+struct alignas(16) Quat {
+    float x, y, z, w;
+};
+
+struct Mat3 {
+    Vec3 cols[3];
+};
+
+struct Mat4 {
+    Vec4 cols[4];
+};
+
+struct Aabb {
+    Vec3 min, max;
+};
+
+static_assert(sizeof(Vec2) == 8 && alignof(Vec2) == 8, "Vec2 has to match std430 vec2");
+static_assert(sizeof(Vec3) == 16 && alignof(Vec3) == 16, "Vec3 has to match std430 vec3 arrays");
+static_assert(sizeof(Vec4) == 16 && alignof(Vec4) == 16, "Vec4 has to match std430 vec4");
+static_assert(sizeof(Mat3) == 48 && sizeof(Mat4) == 64, "Matrices have to match std430 mat3 and mat4");
+static_assert(sizeof(Aabb) == 32, "Aabb has to match a std430 struct of two vec3s");
+
+// ---- SIMD helpers, run time only ----
+
+#if defined(VECMATH_SSE)
+inline __m128 vecLoad(const Vec4& v){
+    return _mm_load_ps(&v.x);
+}
+inline Vec4 vecStore(__m128 r){
+    Vec4 v;
+    _mm_store_ps(&v.x, r);
+    return v;
+}
+// Column combination a.cols * (x, y, z, w), the core of every Mat4 product
+inline __m128 vecCombine(const __m128* cols, __m128 v){
+    __m128 r = _mm_mul_ps(cols[0], _mm_shuffle_ps(v, v, 0x00));
+    r = _mm_add_ps(r, _mm_mul_ps(cols[1], _mm_shuffle_ps(v, v, 0x55)));
+    r = _mm_add_ps(r, _mm_mul_ps(cols[2], _mm_shuffle_ps(v, v, 0xaa)));
+    return _mm_add_ps(r, _mm_mul_ps(cols[3], _mm_shuffle_ps(v, v, 0xff)));
+}
+#elif defined(VECMATH_NEON)
+inline float32x4_t vecLoad(const Vec4& v){
+    return vld1q_f32(&v.x);
+}
+inline Vec4 vecStore(float32x4_t r){
+    Vec4 v;
+    vst1q_f32(&v.x, r);
+    return v;
+}
+inline float32x4_t vecCombine(const float32x4_t* cols, float32x4_t v){
+    float32x4_t r = vmulq_laneq_f32(cols[0], v, 0);
+    r = vmlaq_laneq_f32(r, cols[1], v, 1);
+    r = vmlaq_laneq_f32(r, cols[2], v, 2);
+    return vmlaq_laneq_f32(r, cols[3], v, 3);
+}
+#endif
+
+#if defined(VECMATH_SSE) || defined(VECMATH_NEON)
+// Run time, so the intrinsics are fair game. GCC and clang both have this in C++17.
+#define VECMATH_SIMD_NOW (!__builtin_is_constant_evaluated())
+#endif
+
+// ---- Vec2 ----
+
+constexpr Vec2 operator+(Vec2 a, Vec2 b){ return {a.x + b.x, a.y + b.y}; }
+constexpr Vec2 operator-(Vec2 a, Vec2 b){ return {a.x - b.x, a.y - b.y}; }
+constexpr Vec2 operator*(Vec2 a, Vec2 b){ return {a.x * b.x, a.y * b.y}; }
+constexpr Vec2 operator*(Vec2 a, float s){ return {a.x * s, a.y * s}; }
+constexpr Vec2 operator-(Vec2 a){ return {-a.x, -a.y}; }
+constexpr bool operator==(Vec2 a, Vec2 b){ return a.x == b.x && a.y == b.y; }
+constexpr float dot(Vec2 a, Vec2 b){ return a.x * b.x + a.y * b.y; }
+
+// ---- Vec3 ----
+// Scalar only, the compiler vectorizes these about as well as hand written SSE that has to mask off the padding
+
+constexpr Vec3 operator+(Vec3 a, Vec3 b){ return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+constexpr Vec3 operator-(Vec3 a, Vec3 b){ return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+constexpr Vec3 operator*(Vec3 a, Vec3 b){ return {a.x * b.x, a.y * b.y, a.z * b.z}; }
+constexpr Vec3 operator*(Vec3 a, float s){ return {a.x * s, a.y * s, a.z * s}; }
+constexpr Vec3 operator-(Vec3 a){ return {-a.x, -a.y, -a.z}; }
+constexpr bool operator==(Vec3 a, Vec3 b){ return a.x == b.x && a.y == b.y && a.z == b.z; }
+constexpr float dot(Vec3 a, Vec3 b){ return a.x * b.x + a.y * b.y + a.z * b.z; }
+constexpr Vec3 cross(Vec3 a, Vec3 b){
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+constexpr Vec3 vecMin(Vec3 a, Vec3 b){
+    return {a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z};
+}
+constexpr Vec3 vecMax(Vec3 a, Vec3 b){
+    return {a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z};
+}
+constexpr Vec3 vecAbs(Vec3 a){
+    return {a.x < 0 ? -a.x : a.x, a.y < 0 ? -a.y : a.y, a.z < 0 ? -a.z : a.z};
+}
+constexpr Vec3 lerp(Vec3 a, Vec3 b, float t){ return a + (b - a) * t; }
+inline float length(Vec3 a){ return std::sqrt(dot(a, a)); }
+// Zero stays zero
+inline Vec3 normalize(Vec3 a){
+    const float len = length(a);
+    return len > 0 ? a * (1.0f / len) : a;
+}
+
+// ---- Vec4 ----
+
+constexpr Vec4 toVec4(Vec3 v, float w){ return {v.x, v.y, v.z, w}; }
+constexpr Vec3 toVec3(Vec4 v){ return {v.x, v.y, v.z}; }
+
+constexpr Vec4 operator+(Vec4 a, Vec4 b){
+#if defined(VECMATH_SSE)
+    if(VECMATH_SIMD_NOW) return vecStore(_mm_add_ps(vecLoad(a), vecLoad(b)));
+#elif defined(VECMATH_NEON)
+    if(VECMATH_SIMD_NOW) return vecStore(vaddq_f32(vecLoad(a), vecLoad(b)));
+#endif
+    return {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+}
+constexpr Vec4 operator-(Vec4 a, Vec4 b){
+#if defined(VECMATH_SSE)
+    if(VECMATH_SIMD_NOW) return vecStore(_mm_sub_ps(vecLoad(a), vecLoad(b)));
+#elif defined(VECMATH_NEON)
+    if(VECMATH_SIMD_NOW) return vecStore(vsubq_f32(vecLoad(a), vecLoad(b)));
+#endif
+    return {a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
+}
+constexpr Vec4 operator*(Vec4 a, Vec4 b){
+#if defined(VECMATH_SSE)
+    if(VECMATH_SIMD_NOW) return vecStore(_mm_mul_ps(vecLoad(a), vecLoad(b)));
+#elif defined(VECMATH_NEON)
+    if(VECMATH_SIMD_NOW) return vecStore(vmulq_f32(vecLoad(a), vecLoad(b)));
+#endif
+    return {a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w};
+}
+constexpr Vec4 operator*(Vec4 a, float s){ return a * Vec4{s, s, s, s}; }
+constexpr Vec4 operator-(Vec4 a){ return {-a.x, -a.y, -a.z, -a.w}; }
+constexpr bool operator==(Vec4 a, Vec4 b){ return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+constexpr float dot(Vec4 a, Vec4 b){ return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+constexpr Vec4 lerp(Vec4 a, Vec4 b, float t){ return a + (b - a) * t; }
+
+// ---- Quat ----
+
+constexpr Quat quatIdentity(){ return {0, 0, 0, 1}; }
+// Hamilton product, applies b then a
+constexpr Quat operator*(Quat a, Quat b){
+    return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+constexpr bool operator==(Quat a, Quat b){ return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+constexpr Quat conjugate(Quat q){ return {-q.x, -q.y, -q.z, q.w}; }
+constexpr Vec3 rotate(Quat q, Vec3 v){
+    // v + 2w(u x v) + 2u x (u x v), u being the vector part
+    const Vec3 u = {q.x, q.y, q.z};
+    const Vec3 t = cross(u, v) * 2.0f;
+    return v + t * q.w + cross(u, t);
+}
+// `axis` has to be unit length
+inline Quat quatAxisAngle(Vec3 axis, float radians){
+    const float s = std::sin(radians * 0.5f);
+    return {axis.x * s, axis.y * s, axis.z * s, std::cos(radians * 0.5f)};
+}
+inline Quat normalize(Quat q){
+    const float len = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    const float s = len > 0 ? 1.0f / len : 0.0f;
+    return {q.x * s, q.y * s, q.z * s, len > 0 ? q.w * s : 1.0f};
+}
+
+// ---- Mat3 ----
+
+constexpr Mat3 mat3Identity(){ return {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}}; }
+constexpr Vec3 operator*(const Mat3& m, Vec3 v){
+    return m.cols[0] * v.x + m.cols[1] * v.y + m.cols[2] * v.z;
+}
+constexpr Mat3 operator*(const Mat3& a, const Mat3& b){
+    return {{a * b.cols[0], a * b.cols[1], a * b.cols[2]}};
+}
+constexpr Mat3 transpose(const Mat3& m){
+    return {{{m.cols[0].x, m.cols[1].x, m.cols[2].x}, {m.cols[0].y, m.cols[1].y, m.cols[2].y}, {m.cols[0].z, m.cols[1].z, m.cols[2].z}}};
+}
+constexpr Mat3 mat3FromQuat(Quat q){
+    const float xx = q.x * q.x * 2, yy = q.y * q.y * 2, zz = q.z * q.z * 2;
+    const float xy = q.x * q.y * 2, xz = q.x * q.z * 2, yz = q.y * q.z * 2;
+    const float wx = q.w * q.x * 2, wy = q.w * q.y * 2, wz = q.w * q.z * 2;
+    return {{{1 - yy - zz, xy + wz, xz - wy}, {xy - wz, 1 - xx - zz, yz + wx}, {xz + wy, yz - wx, 1 - xx - yy}}};
+}
+
+// ---- Mat4 ----
+
+constexpr Mat4 mat4Identity(){ return {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}}; }
+constexpr bool operator==(const Mat4& a, const Mat4& b){
+    return a.cols[0] == b.cols[0] && a.cols[1] == b.cols[1] && a.cols[2] == b.cols[2] && a.cols[3] == b.cols[3];
+}
+
+constexpr Vec4 operator*(const Mat4& m, Vec4 v){
+#if defined(VECMATH_SSE) || defined(VECMATH_NEON)
+    if(VECMATH_SIMD_NOW){
+        const decltype(vecLoad(v)) cols[4] = {vecLoad(m.cols[0]), vecLoad(m.cols[1]), vecLoad(m.cols[2]), vecLoad(m.cols[3])};
+        return vecStore(vecCombine(cols, vecLoad(v)));
+    }
+#endif
+    return {m.cols[0].x * v.x + m.cols[1].x * v.y + m.cols[2].x * v.z + m.cols[3].x * v.w,
+            m.cols[0].y * v.x + m.cols[1].y * v.y + m.cols[2].y * v.z + m.cols[3].y * v.w,
+            m.cols[0].z * v.x + m.cols[1].z * v.y + m.cols[2].z * v.z + m.cols[3].z * v.w,
+            m.cols[0].w * v.x + m.cols[1].w * v.y + m.cols[2].w * v.z + m.cols[3].w * v.w};
+}
+
+constexpr Mat4 operator*(const Mat4& a, const Mat4& b){
+#if defined(VECMATH_SSE) || defined(VECMATH_NEON)
+    if(VECMATH_SIMD_NOW){
+        // a's columns stay in registers for all four of b's
+        const decltype(vecLoad(a.cols[0])) cols[4] = {vecLoad(a.cols[0]), vecLoad(a.cols[1]), vecLoad(a.cols[2]), vecLoad(a.cols[3])};
+        Mat4 r = {};
+        for(int c = 0; c < 4; c++) r.cols[c] = vecStore(vecCombine(cols, vecLoad(b.cols[c])));
+        return r;
+    }
+#endif
+    return {{a * b.cols[0], a * b.cols[1], a * b.cols[2], a * b.cols[3]}};
+}
+
+constexpr Vec3 transformPoint(const Mat4& m, Vec3 p){ return toVec3(m * toVec4(p, 1)); }
+constexpr Vec3 transformVector(const Mat4& m, Vec3 v){ return toVec3(m * toVec4(v, 0)); }
+
+constexpr Mat4 transpose(const Mat4& m){
+    return {{{m.cols[0].x, m.cols[1].x, m.cols[2].x, m.cols[3].x},
+             {m.cols[0].y, m.cols[1].y, m.cols[2].y, m.cols[3].y},
+             {m.cols[0].z, m.cols[1].z, m.cols[2].z, m.cols[3].z},
+             {m.cols[0].w, m.cols[1].w, m.cols[2].w, m.cols[3].w}}};
+}
+constexpr Mat4 mat4Translate(Vec3 t){ return {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {t.x, t.y, t.z, 1}}}; }
+constexpr Mat4 mat4Scale(Vec3 s){ return {{{s.x, 0, 0, 0}, {0, s.y, 0, 0}, {0, 0, s.z, 0}, {0, 0, 0, 1}}}; }
+// translate * rotate * scale in one go
+constexpr Mat4 mat4Trs(Vec3 t, Quat r, Vec3 s){
+    const Mat3 m = mat3FromQuat(r);
+    return {{toVec4(m.cols[0] * s.x, 0), toVec4(m.cols[1] * s.y, 0), toVec4(m.cols[2] * s.z, 0), toVec4(t, 1)}};
+}
+constexpr Mat3 mat3FromMat4(const Mat4& m){
+    return {{toVec3(m.cols[0]), toVec3(m.cols[1]), toVec3(m.cols[2])}};
+}
+// Inverse of a matrix whose bottom row is 0 0 0 1, through the 3x3 adjugate
+constexpr Mat4 affineInverse(const Mat4& m){
+    const Vec3 a = toVec3(m.cols[0]), b = toVec3(m.cols[1]), c = toVec3(m.cols[2]);
+    const Vec3 r0 = cross(b, c), r1 = cross(c, a), r2 = cross(a, b);
+    const float det = dot(a, r0);
+    const float s = det != 0 ? 1.0f / det : 0.0f;
+    // Rows of the inverse are the cross products over the determinant
+    const Mat3 inv = transpose(Mat3{{r0 * s, r1 * s, r2 * s}});
+    const Vec3 t = -(inv * toVec3(m.cols[3]));
+    return {{toVec4(inv.cols[0], 0), toVec4(inv.cols[1], 0), toVec4(inv.cols[2], 0), toVec4(t, 1)}};
+}
+
+// ---- Aabb ----
+
+// Grows to fit anything, min > max until then
+constexpr Aabb aabbEmpty(){ return {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}}; }
+constexpr Aabb aabbFromCenter(Vec3 center, Vec3 extent){ return {center - extent, center + extent}; }
+constexpr Vec3 aabbCenter(const Aabb& box){ return (box.min + box.max) * 0.5f; }
+// Half sizes
+constexpr Vec3 aabbExtent(const Aabb& box){ return (box.max - box.min) * 0.5f; }
+constexpr Aabb aabbGrow(const Aabb& box, Vec3 p){ return {vecMin(box.min, p), vecMax(box.max, p)}; }
+constexpr Aabb aabbUnion(const Aabb& a, const Aabb& b){ return {vecMin(a.min, b.min), vecMax(a.max, b.max)}; }
+// Box around `box` once it's been through affine `m` (Arvo): the center moves, the extent goes through |m|
+constexpr Aabb transformAabb(const Mat4& m, const Aabb& box){
+    const Vec3 e = aabbExtent(box);
+    const Vec3 extent = vecAbs(toVec3(m.cols[0])) * e.x + vecAbs(toVec3(m.cols[1])) * e.y + vecAbs(toVec3(m.cols[2])) * e.z;
+    return aabbFromCenter(transformPoint(m, aabbCenter(box)), extent);
+}
+
+// ---- Batches ----
+
+// Points kept one array per component (SoA) through affine `m`, the bottom row is taken to be 0 0 0 1.
+// out may be the same arrays as in.
+inline void transformPoints(const Mat4& m, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ,
+                            size_t count){
+    size_t i = 0;
+#if defined(__AVX__)
+    __m256 col[4][3];
+    for(int c = 0; c < 4; c++){
+        col[c][0] = _mm256_set1_ps(m.cols[c].x);
+        col[c][1] = _mm256_set1_ps(m.cols[c].y);
+        col[c][2] = _mm256_set1_ps(m.cols[c].z);
+    }
+    for(; i + 8 <= count; i += 8){
+        const __m256 x = _mm256_loadu_ps(inX + i), y = _mm256_loadu_ps(inY + i), z = _mm256_loadu_ps(inZ + i);
+        __m256 r[3];
+        for(int k = 0; k < 3; k++){
+            r[k] = _mm256_add_ps(col[3][k], _mm256_mul_ps(col[0][k], x));
+            r[k] = _mm256_add_ps(r[k], _mm256_mul_ps(col[1][k], y));
+            r[k] = _mm256_add_ps(r[k], _mm256_mul_ps(col[2][k], z));
+        }
+        _mm256_storeu_ps(outX + i, r[0]);
+        _mm256_storeu_ps(outY + i, r[1]);
+        _mm256_storeu_ps(outZ + i, r[2]);
+    }
+#elif defined(VECMATH_NEON)
+    float32x4_t col[4][3];
+    for(int c = 0; c < 4; c++){
+        col[c][0] = vdupq_n_f32(m.cols[c].x);
+        col[c][1] = vdupq_n_f32(m.cols[c].y);
+        col[c][2] = vdupq_n_f32(m.cols[c].z);
+    }
+    for(; i + 4 <= count; i += 4){
+        const float32x4_t x = vld1q_f32(inX + i), y = vld1q_f32(inY + i), z = vld1q_f32(inZ + i);
+        float32x4_t r[3];
+        for(int k = 0; k < 3; k++){
+            r[k] = vmlaq_f32(col[3][k], col[0][k], x);
+            r[k] = vmlaq_f32(r[k], col[1][k], y);
+            r[k] = vmlaq_f32(r[k], col[2][k], z);
+        }
+        vst1q_f32(outX + i, r[0]);
+        vst1q_f32(outY + i, r[1]);
+        vst1q_f32(outZ + i, r[2]);
+    }
+#endif
+    for(; i < count; i++){
+        const Vec3 p = transformPoint(m, {inX[i], inY[i], inZ[i]});
+        outX[i] = p.x;
+        outY[i] = p.y;
+        outZ[i] = p.z;
+    }
+}
+
+// out[i] = a[i] * b[i]. out may be a or b.
+inline void mulMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count){
+#if defined(__AVX__)
+    // Two of b's columns a register. _mm256_permute_ps broadcasts within each 128 bit half, so one permute
+    // gives the same component of both columns.
+    for(size_t i = 0; i < count; i++){
+        const __m256 cols[4] = {_mm256_broadcast_ps((const __m128*)&a[i].cols[0]), _mm256_broadcast_ps((const __m128*)&a[i].cols[1]),
+                                _mm256_broadcast_ps((const __m128*)&a[i].cols[2]), _mm256_broadcast_ps((const __m128*)&a[i].cols[3])};
+        const __m256 b01 = _mm256_loadu_ps(&b[i].cols[0].x), b23 = _mm256_loadu_ps(&b[i].cols[2].x);
+        __m256 r01 = _mm256_mul_ps(cols[0], _mm256_permute_ps(b01, 0x00));
+        __m256 r23 = _mm256_mul_ps(cols[0], _mm256_permute_ps(b23, 0x00));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(cols[1], _mm256_permute_ps(b01, 0x55)));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(cols[1], _mm256_permute_ps(b23, 0x55)));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(cols[2], _mm256_permute_ps(b01, 0xaa)));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(cols[2], _mm256_permute_ps(b23, 0xaa)));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(cols[3], _mm256_permute_ps(b01, 0xff)));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(cols[3], _mm256_permute_ps(b23, 0xff)));
+        _mm256_storeu_ps(&out[i].cols[0].x, r01);
+        _mm256_storeu_ps(&out[i].cols[2].x, r23);
+    }
+#else
+    for(size_t i = 0; i < count; i++) out[i] = a[i] * b[i];
+#endif
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+// One vertex as vertex.glsl pulls it out of the ssbo. Everything is a float so the
+// std430 layout has no padding and this can be memcpy'd straight into the buffer.
+struct Vert {
+    float pos[3];
+    float uv[2];
+};
+
+// Cooked meshes quantize to this (the QUANTIZED keyword in vertex.glsl). Position is snorm16 over the mesh's
+// bounds with one short of padding, uv is unorm16 over the uv bounds, 12 bytes where Vert takes 20.
+// As uints that's pos.xy, pos.z and pad, uv, which is how vertex.glsl pulls it.
+struct PackedVert {
+    int16_t pos[4];
+    uint16_t uv[2];
+};